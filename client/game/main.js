@@ -29,12 +29,16 @@ const phaserConfig = {
 const game = new Phaser.Game(phaserConfig);
 
 const WS_URL = "ws://localhost:9001";
+// Offered at connect; the server picks binary when it supports it (see server/network/Protocol.hpp)
+const WS_PROTOCOL_BINARY = 'habbo.bin.1';
+const WS_PROTOCOL_JSON = 'habbo.json';
 let sceneRef = null;
 let ws = null;
 const players = {};
 let currentPlayer = null;
 let currentPlayerPOS;
 let currentRoom = null;
+let pendingResume = null; // set by SHARD_REDIRECT; sent as RESUME_SESSION on the next connect
 const furnitureGameObjects = {};
 let _uidCounter = 1;
 // -------------- DOM UI --------------
@@ -453,13 +457,14 @@ function spawnPlayer(username, tx, ty) {
   //     sceneRef.physics.add.collider(sprite, sceneRef.wallGroup);
   //   }
     
+  if (username === "You")
     currentPlayer = sprite;
   // }
   
   players[username] = sprite;
 }
 
-function movePlayer(username, tx, ty) {
+function movePlayer(username, tx, ty, duration = 400) {
   const sprite = players[username];
   if (!sprite) return;
 
@@ -501,7 +506,7 @@ function movePlayer(username, tx, ty) {
     targets: sprite,
     x: targetPos.x,
     y: targetPos.y - 16,
-    duration: 400,
+    duration,
     onStart: () => sprite.play('walk', true),
     onComplete: () => sprite.stop().setFrame(0)
   });
@@ -514,6 +519,38 @@ function movePlayer(username, tx, ty) {
   // }
 }
 
+// -------------- ROOM AVATARS --------------
+// Avatars are placed and moved by the server (ROOM_ENTERED, then ROOM_TICK
+// frames). Sprites stay keyed by name, with "You" for our own avatar.
+const roomAvatars = { selfId: 0, stepMs: 200, keys: {} };
+
+function resetRoomAvatars(selfId, stepMs) {
+  Object.values(roomAvatars.keys).forEach(key => {
+    if (key !== "You") removePlayer(key);
+  });
+  roomAvatars.selfId = selfId;
+  roomAvatars.stepMs = stepMs || roomAvatars.stepMs;
+  roomAvatars.keys = {};
+}
+
+function applyAvatar(a) {
+  let key = roomAvatars.keys[a.id];
+  if (!key) {
+    if (a.id !== roomAvatars.selfId && !a.name) return; // its first frame was missed
+    key = a.id === roomAvatars.selfId ? "You" : a.name;
+    roomAvatars.keys[a.id] = key;
+  }
+  const sprite = players[key];
+  if (!sprite) spawnPlayer(key, a.tx, a.ty);
+  else if (sprite.tx !== a.tx || sprite.ty !== a.ty) movePlayer(key, a.tx, a.ty, roomAvatars.stepMs);
+}
+
+function removeAvatar(id) {
+  const key = roomAvatars.keys[id];
+  if (key && key !== "You") removePlayer(key);
+  delete roomAvatars.keys[id];
+}
+
 function removePlayer(username) {
   if (players[username]) {
     players[username].destroy();
@@ -585,7 +622,7 @@ async function create() {
   await connectWebSocket();
 
   try {
-    const templates = await requestWS({ type: 'GET_ROOM_TEMPLATES' });
+    const templates = await fetchRoomTemplates();
     populateRoomButtons(templates || []);
     if (templates && templates.length > 0) {
       loadRoomTemplate(templates[2].id);
@@ -615,9 +652,9 @@ async function create() {
     
     if (currentRoom && insideRoom(tx, ty)) {
       log(`Clicked tile (${tx}, ${ty})`);
-      movePlayer("You", tx, ty);
-      // currentPlayerPOS = { x: tx, y: ty };
-      sendWS({ type: 'TILE_CLICK', room: currentRoom.name, tx, ty });
+      // The server plans the route and answers with PATH; offline we just move
+      if (ws && ws.readyState === WebSocket.OPEN) sendTileClick(tx, ty);
+      else movePlayer("You", tx, ty);
     }
   });
 
@@ -652,14 +689,15 @@ function update(time, dt) {
 }
 
 // -------------- WEBSOCKET --------------
-function connectWebSocket() {
+function connectWebSocket(url = WS_URL) {
   if (ws && ws.readyState === WebSocket.OPEN) {
     return Promise.resolve();
   }
 
   return new Promise((resolve, reject) => {
     try {
-      ws = new WebSocket(WS_URL);
+      ws = new WebSocket(url, [WS_PROTOCOL_BINARY, WS_PROTOCOL_JSON]);
+      ws.binaryType = 'arraybuffer';
     } catch (e) {
       log('WS ctor failed: ' + e.message);
       return reject(e);
@@ -674,7 +712,12 @@ function connectWebSocket() {
         log('Avatar texture not loaded yet.');
       }
 
-      joinRoom("Lobby");
+      if (pendingResume) {
+        sendWS({ type: 'RESUME_SESSION', ticket: pendingResume.ticket });
+        pendingResume = null;
+      } else {
+        joinRoom("Lobby");
+      }
 
       if (currentRoom && currentRoom.name) {
         sendWS({ type: 'SUBSCRIBE_ROOM', room: currentRoom.name });
@@ -683,6 +726,10 @@ function connectWebSocket() {
     };
 
     ws.onmessage = ev => {
+      if (ev.data instanceof ArrayBuffer) {
+        handleBinaryMessage(ev.data);
+        return;
+      }
       try {
         const msg = JSON.parse(ev.data);
         handleWSMessage(msg);
@@ -717,7 +764,168 @@ function sendWS(obj) {
   ws.send(JSON.stringify(obj));
 }
 
+// -------------- BINARY PROTOCOL --------------
+// Used only when the server accepted WS_PROTOCOL_BINARY; layouts mirror
+// server/network/Protocol.hpp. Coordinates are 1/16-tile fixed point.
+const BIN_OP = {
+  MOVE_FURNITURE: 0x01,
+  TILE_CLICK: 0x02,
+  FURNITURE_ADDED: 0x81,
+  FURNITURE_UPDATED: 0x82,
+  FURNITURE_REMOVED: 0x83,
+  PATH: 0x84,
+  ROOM_TICK: 0x85
+};
+const BIN_FURNITURE_HAS_UID = 0x01;
+const BIN_FURNITURE_HAS_ROTATION = 0x02;
+const BIN_AVATAR_WALKING = 0x01;
+const BIN_AVATAR_HAS_NAME = 0x02;
+const BIN_COORD_SCALE = 16;
+const textEncoder = new TextEncoder();
+const textDecoder = new TextDecoder();
+
+function binaryMode() {
+  return ws && ws.readyState === WebSocket.OPEN && ws.protocol === WS_PROTOCOL_BINARY;
+}
+
+class BinaryFrameWriter {
+  constructor() { this.bytes = []; }
+  u8(v) { this.bytes.push(v & 0xff); return this; }
+  varint(v) {
+    while (v >= 0x80) {
+      this.bytes.push((v % 0x80) | 0x80);
+      v = Math.floor(v / 0x80);
+    }
+    this.bytes.push(v);
+    return this;
+  }
+  svarint(v) { return this.varint(v < 0 ? -2 * v - 1 : 2 * v); }
+  coord(tiles) { return this.svarint(Math.round(tiles * BIN_COORD_SCALE)); }
+  str(s) {
+    const encoded = textEncoder.encode(s);
+    this.varint(encoded.length);
+    encoded.forEach(b => this.bytes.push(b));
+    return this;
+  }
+  finish() { return new Uint8Array(this.bytes); }
+}
+
+class BinaryFrameReader {
+  constructor(buffer) { this.view = new Uint8Array(buffer); this.pos = 0; this.ok = true; }
+  u8() {
+    if (this.pos >= this.view.length) { this.ok = false; return 0; }
+    return this.view[this.pos++];
+  }
+  // Numbers stay exact up to 2^53, which covers furniture versions
+  varint() {
+    let v = 0, scale = 1;
+    for (;;) {
+      const b = this.u8();
+      if (!this.ok) return 0;
+      v += (b & 0x7f) * scale;
+      if (!(b & 0x80)) return v;
+      scale *= 0x80;
+    }
+  }
+  svarint() { const v = this.varint(); return v % 2 ? -(v + 1) / 2 : v / 2; }
+  coord() { return this.svarint() / BIN_COORD_SCALE; }
+  str() {
+    const len = this.varint();
+    if (this.pos + len > this.view.length) { this.ok = false; return ''; }
+    const s = textDecoder.decode(this.view.subarray(this.pos, this.pos + len));
+    this.pos += len;
+    return s;
+  }
+}
+
+function sendTileClick(tx, ty) {
+  if (binaryMode()) {
+    ws.send(new BinaryFrameWriter().u8(BIN_OP.TILE_CLICK).coord(tx).coord(ty).finish());
+    return;
+  }
+  sendWS({ type: 'TILE_CLICK', room: currentRoom.name, tx, ty });
+}
+
+function sendFurnitureMove(uid, tx, ty) {
+  if (!binaryMode()) {
+    sendWS({ type: 'UPDATE_FURNITURE', room: currentRoom.name, uid, tx, ty });
+    return;
+  }
+  // Items the server already numbered go by id; a fresh item still goes by uid
+  const model = currentRoom.furniture.find(x => x.uid === uid);
+  const id = model && model.id ? model.id : 0;
+  const frame = new BinaryFrameWriter().u8(BIN_OP.MOVE_FURNITURE).u8(id ? 0 : BIN_FURNITURE_HAS_UID).varint(id);
+  if (!id) frame.str(uid);
+  ws.send(frame.coord(tx).coord(ty).finish());
+}
+
+function handleBinaryMessage(buffer) {
+  const r = new BinaryFrameReader(buffer);
+  const op = r.u8();
+  const roomId = r.varint();
+  const version = r.varint();
+  let change = 'updated';
+  const f = {};
+  switch (op) {
+    case BIN_OP.FURNITURE_ADDED:
+      f.id = r.varint();
+      f.uid = r.str();
+      f.name = r.str();
+      f.tx = r.coord();
+      f.ty = r.coord();
+      f.rotation = r.svarint();
+      break;
+    case BIN_OP.FURNITURE_UPDATED: {
+      const flags = r.u8();
+      const id = r.varint();
+      if (id) f.id = id;
+      if (flags & BIN_FURNITURE_HAS_UID) f.uid = r.str();
+      f.tx = r.coord();
+      f.ty = r.coord();
+      if (flags & BIN_FURNITURE_HAS_ROTATION) f.rotation = r.svarint();
+      break;
+    }
+    case BIN_OP.FURNITURE_REMOVED:
+      change = 'removed';
+      f.id = r.varint();
+      break;
+    case BIN_OP.PATH:
+      // The walk itself arrives through ROOM_TICK frames
+      if (r.u8() !== 0) log('No path to that tile.');
+      return;
+    case BIN_OP.ROOM_TICK: {
+      const avatars = [];
+      for (let n = r.varint(); n > 0 && r.ok; n--) {
+        const a = { id: r.varint() };
+        const flags = r.u8();
+        if (flags & BIN_AVATAR_HAS_NAME) a.name = r.str();
+        a.tx = r.coord();
+        a.ty = r.coord();
+        a.walking = (flags & BIN_AVATAR_WALKING) !== 0;
+        avatars.push(a);
+      }
+      const left = [];
+      for (let n = r.varint(); n > 0 && r.ok; n--) left.push(r.varint());
+      if (!r.ok || !currentRoom || roomId !== currentRoom.id) return;
+      avatars.forEach(applyAvatar);
+      left.forEach(removeAvatar);
+      return;
+    }
+    default:
+      return;
+  }
+  if (!r.ok || !currentRoom || roomId !== currentRoom.id) return;
+  if (!trackFurnitureVersion(version)) return;
+  applyFurnitureChange(change, f);
+}
+
 async function requestWS(obj, timeoutMs = 5000) {
+  const payload = await requestWSPayload(obj, timeoutMs);
+  return payload.data;
+}
+
+// Like requestWS, but resolves with the whole reply rather than its data
+async function requestWSPayload(obj, timeoutMs = 5000) {
   await connectWebSocket();
 
   return new Promise((resolve, reject) => {
@@ -729,7 +937,7 @@ async function requestWS(obj, timeoutMs = 5000) {
       try { payload = JSON.parse(ev.data); } catch (e) { return; }
       if (payload && payload.reqId === reqId) {
         ws.removeEventListener('message', listener);
-        resolve(payload.data);
+        resolve(payload);
       }
     }
 
@@ -755,9 +963,39 @@ function populateRoomButtons(roomTemplates) {
   });
 }
 
+// -------------- ROOM TEMPLATE CACHE --------------
+// Templates are kept in localStorage with the server's version tag; when the
+// catalogue has not changed the server answers with notModified only.
+const TEMPLATE_CACHE_KEY = 'roomTemplates';
+let roomTemplates = null;
+
+function readTemplateCache() {
+  try {
+    const cached = JSON.parse(localStorage.getItem(TEMPLATE_CACHE_KEY) || 'null');
+    return cached && cached.version && Array.isArray(cached.data) ? cached : null;
+  } catch (e) {
+    return null;
+  }
+}
+
+async function fetchRoomTemplates() {
+  const cached = readTemplateCache();
+  const reply = await requestWSPayload({ type: 'GET_ROOM_TEMPLATES', version: cached ? cached.version : '' });
+  if (reply.notModified && cached) {
+    roomTemplates = cached.data;
+  } else {
+    roomTemplates = Array.isArray(reply.data) ? reply.data : [];
+    try {
+      localStorage.setItem(TEMPLATE_CACHE_KEY, JSON.stringify({ version: reply.version, data: roomTemplates }));
+    } catch (e) { /* storage full or disabled: just skip caching */ }
+  }
+  return roomTemplates;
+}
+
 async function loadRoomTemplate(roomId) {
   try {
-    const tpl = await requestWS({ type: 'GET_ROOM_TEMPLATE', templateId: roomId });
+    const known = roomTemplates && roomTemplates.find(t => t.id === roomId);
+    const tpl = known || await requestWS({ type: 'GET_ROOM_TEMPLATE', templateId: roomId });
     if (!tpl) {
       log('Template not returned');
       return;
@@ -983,7 +1221,7 @@ function createFurnitureGO(scene, f) {
     const ff = currentRoom.furniture.find(x => x.uid === container.uid);
     if (ff) { ff.tx = tx; ff.ty = ty; }
 
-    sendWS({ type:'UPDATE_FURNITURE', room: currentRoom.name, uid: container.uid, tx, ty });
+    sendFurnitureMove(container.uid, tx, ty);
 
     if (sprite) sprite.clearTint();
   });
@@ -1001,6 +1239,61 @@ function centerCameraOnRoom(scene) {
   scene.cameras.main.centerOn(s.x, s.y-20);
 }
 
+// -------------- FURNITURE SYNC --------------
+// Server deltas carry a version; a gap means we missed something, so ask for
+// everything since the last version we applied instead of a full ROOM_STATE.
+// In large rooms we only hear about furniture in view, so gaps are normal
+// there; the server sends what we missed when our view moves.
+function trackFurnitureVersion(version) {
+  if (!version) return true;
+  const known = currentRoom.furnitureVersion || 0;
+  if (known && version <= known) return false;
+  if (known && version !== known + 1 && !currentRoom.viewFiltered) {
+    sendWS({ type: 'SUBSCRIBE_ROOM', room: currentRoom.name, version: known });
+    return false;
+  }
+  currentRoom.furnitureVersion = version;
+  return true;
+}
+
+function applyFurnitureChange(change, f) {
+  if (!f) return;
+  const idx = currentRoom.furniture.findIndex(x => (f.uid && x.uid === f.uid) || (f.id !== undefined && x.id === f.id));
+  // Binary events name known items by id only; reuse the uid we keyed them by
+  const key = f.uid || (idx !== -1 && currentRoom.furniture[idx].uid) || `dbid_${f.id}`;
+
+  if (change === 'removed') {
+    if (idx !== -1) currentRoom.furniture.splice(idx, 1);
+    const go = furnitureGameObjects[key] || furnitureGameObjects[`dbid_${f.id}`];
+    if (go) go.destroy();
+    delete furnitureGameObjects[key];
+    return;
+  }
+
+  const existing = idx !== -1 ? currentRoom.furniture[idx] : null;
+  if (existing) {
+    existing.tx = f.tx;
+    existing.ty = f.ty;
+    if (f.id !== undefined) existing.id = f.id;
+    const go = furnitureGameObjects[key] || furnitureGameObjects[`dbid_${f.id}`];
+    if (go) {
+      const s = tileToScreen(f.tx, f.ty);
+      go.x = s.x; go.y = s.y - (GLOBAL.tileH/2) * 0.2;
+    }
+  } else {
+    const model = {
+      uid: key,
+      id: f.id,
+      proto_id: f.proto_id || f.name,
+      tx: f.tx,
+      ty: f.ty,
+      color: f.color || undefined
+    };
+    currentRoom.furniture.push(model);
+    createFurnitureGO(sceneRef, model);
+  }
+}
+
 // -------------- WS MESSAGE HANDLER --------------
 function handleWSMessage(msg) {
   if (!msg || !msg.type) return;
@@ -1033,6 +1326,8 @@ function handleWSMessage(msg) {
       break;
     case 'ROOM_STATE':
       if (msg.room === currentRoom.name) {
+        currentRoom.id = msg.roomId;
+        currentRoom.furnitureVersion = msg.version || 0;
         currentRoom.furniture = msg.furniture || [];
         Object.values(furnitureGameObjects).forEach(go => go.destroy());
         Object.keys(furnitureGameObjects).forEach(k => delete furnitureGameObjects[k]);
@@ -1040,30 +1335,81 @@ function handleWSMessage(msg) {
         log('Room state synced from server.');
       }
       break;
+    case 'FURNITURE_ADDED':
     case 'FURNITURE_UPDATED':
+    case 'FURNITURE_REMOVED':
       if (msg.room !== currentRoom.name) return;
-      const f = msg.furniture;
-      const existing = currentRoom.furniture.find(x => x.uid === f.uid || x.id === f.id);
-      if (existing) {
-        existing.tx = f.tx;
-        existing.ty = f.ty;
-        const go = furnitureGameObjects[f.uid || `dbid_${f.id}`];
-        if (go) {
-          const s = tileToScreen(f.tx, f.ty);
-          go.x = s.x; go.y = s.y - (GLOBAL.tileH/2) * 0.2;
-        }
-      } else {
-        const model = {
-          uid: f.uid || (`dbid_${f.id}`),
-          id: f.id,
-          proto_id: f.proto_id || f.name,
-          tx: f.tx,
-          ty: f.ty,
-          color: f.color || undefined
-        };
-        currentRoom.furniture.push(model);
-        createFurnitureGO(sceneRef, model);
-      }
+      if (!trackFurnitureVersion(msg.version)) return;
+      applyFurnitureChange(msg.type === 'FURNITURE_REMOVED' ? 'removed' : 'updated', msg.furniture);
+      break;
+    case 'PATH':
+      // The walk itself arrives through ROOM_TICK frames
+      if (msg.error) log(`No path: ${msg.error}`);
+      break;
+    case 'SHARD_REDIRECT': {
+      // The room is served by another server shard: reconnect there and resume
+      const url = new URL(WS_URL);
+      url.port = String(msg.port);
+      pendingResume = { ticket: msg.ticket, room: msg.room };
+      const old = ws;
+      ws = null;
+      old.onclose = null;
+      old.close();
+      connectWebSocket(url.toString());
+      break;
+    }
+    case 'RESUME_SESSION_RESPONSE':
+      if (msg.error) log(`Could not resume session: ${msg.error}`);
+      break;
+    case 'ROOM_ENTERED':
+      if (msg.room !== currentRoom.name) return;
+      currentRoom.id = msg.roomId;
+      currentRoom.viewFiltered = !!msg.view;
+      resetRoomAvatars(msg.avatarId, msg.stepMs);
+      (msg.avatars || []).forEach(applyAvatar);
+      break;
+    case 'ROOM_TICK':
+      if (msg.roomId !== currentRoom.id) return;
+      (msg.avatars || []).forEach(applyAvatar);
+      (msg.left || []).forEach(removeAvatar);
+      break;
+    case 'FURNITURE_DELTAS':
+      if (msg.room !== currentRoom.name) return;
+      currentRoom.id = msg.roomId;
+      (msg.deltas || []).forEach(d => applyFurnitureChange(d.change, d.furniture));
+      currentRoom.furnitureVersion = msg.version;
+      break;
+    // Large rooms: everything in the cells that just came into view. Items we
+    // still show inside those areas but that are not listed were removed or
+    // moved away while out of sight; creates still in flight have no id yet.
+    case 'FURNITURE_VIEW': {
+      if (msg.room !== currentRoom.name) return;
+      const areas = msg.areas || [];
+      const listed = new Set((msg.furniture || []).map(f => f.uid || `dbid_${f.id}`));
+      const inArea = f => {
+        const x = Math.round(f.tx), y = Math.round(f.ty);
+        return areas.some(a => x >= a.x0 && x <= a.x1 && y >= a.y0 && y <= a.y1);
+      };
+      currentRoom.furniture
+        .filter(f => f.id && inArea(f) && !listed.has(f.uid) && !listed.has(`dbid_${f.id}`))
+        .forEach(f => applyFurnitureChange('removed', f));
+      (msg.furniture || []).forEach(f => applyFurnitureChange('updated', f));
+      break;
+    }
+    case 'CHAT_HISTORY':
+      if (!currentRoom || msg.room !== currentRoom.name) return;
+      (msg.lines || []).forEach(l => log(`${l.user}: ${l.message}`));
+      break;
+    // Rejected placements: drop the item we placed early, or put a moved one back
+    case 'CREATE_FURNITURE_RESPONSE':
+      if (msg.ok !== false || !msg.uid) break;
+      log(`Could not place furniture: ${msg.error || 'failed'}`);
+      applyFurnitureChange('removed', { uid: msg.uid });
+      break;
+    case 'UPDATE_FURNITURE_RESPONSE':
+      if (msg.ok !== false) break;
+      log(`Could not move furniture: ${msg.error || 'failed'}`);
+      if (msg.furniture) applyFurnitureChange('updated', msg.furniture);
       break;
     default:
       // other messages (create/update responses) are ignored here (requestWS resolves them)
@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+// ----------------------
+// Minimal benchmark harness (no external deps).
+// Runs fn in growing batches until minSeconds have elapsed and reports the
+// mean time per call. With HABBO_BENCH_CSV=<path> each result is also
+// appended there as "name,ns_per_op,iterations", for diffing two runs.
+// ----------------------
+// Stands in for a uWS socket in hotpath_bench: a send copies the
+// payload into the socket's send buffer, which is drained now and then
+struct MockSocket {
+    std::string outbox;
+    void send(std::string_view message) {
+        outbox.append(message);
+        if (outbox.size() > (1u << 16)) outbox.clear();
+    }
+};
+
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double nsPerOp = 0;
+};
+
+template <typename Fn>
+inline BenchResult runBench(const std::string& name, Fn&& fn, double minSeconds = 0.3) {
+    using clock = std::chrono::steady_clock;
+    uint64_t batch = 1;
+    uint64_t total = 0;
+    double elapsedNs = 0;
+    fn(); // warm-up
+    while (elapsedNs < minSeconds * 1e9) {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < batch; i++) fn();
+        elapsedNs += std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        total += batch;
+        if (batch < (1u << 20)) batch *= 2;
+    }
+    BenchResult r{name, total, elapsedNs / total};
+    std::printf("%-48s %12.1f ns/op %12llu iters\n", r.name.c_str(), r.nsPerOp, (unsigned long long)r.iterations);
+    if (const char* csvPath = std::getenv("HABBO_BENCH_CSV")) {
+        if (FILE* csv = std::fopen(csvPath, "a")) {
+            std::fprintf(csv, "%s,%.1f,%llu\n", r.name.c_str(), r.nsPerOp, (unsigned long long)r.iterations);
+            std::fclose(csv);
+        }
+    }
+    return r;
+}
@@ -0,0 +1,241 @@
+// Room fan-out through the server's own publish path: a uWS::App on a loop
+// thread with 50, 500 and 5000 loopback WebSocket clients subscribed to one
+// room by Broadcaster::subscribe, and bursts published by
+// Broadcaster::toRoom and toRoomExcept. Per message it reports the time the
+// publish call itself takes on the loop and the time until every subscriber
+// has read it back (topic tree, socket copies and syscalls on both ends, all
+// on this machine). How much of the copying uWS does inside the publish call
+// and how much when the loop drains depends on the uWS version, so compare
+// the delivery column across runs.
+#include <arpa/inet.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchUtil.hpp"
+#include "Broadcast.hpp"
+#include "User.hpp"
+#include "WsClient.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr int kBurst = 16;          // publishes per round
+static constexpr int kRounds = 50;
+static constexpr size_t kConnectBatch = 256;   // stays under the listen backlog
+
+static const std::string kPayload =
+    "{\"type\":\"FURNITURE_UPDATED\",\"room\":\"Lobby\",\"version\":1739812345678901,"
+    "\"furniture\":{\"id\":4812,\"uid\":\"fm2x9k1_17\",\"name\":\"B_table_long_1\","
+    "\"sprite_path\":\"\",\"tx\":7,\"ty\":3,\"rotation\":0,\"scale\":1,\"interactable\":false}}";
+
+// ----------------------
+// Server side: one loop thread, like a single shard
+// ----------------------
+struct BenchServer {
+    Room room;
+    Broadcaster broadcaster;
+    std::vector<WebSocket*> sockets;        // loop thread only
+    us_listen_socket_t* listenSocket = nullptr;
+    std::atomic<uWS::Loop*> loop{nullptr};
+    std::atomic<int> port{0};               // -1 if the bind failed
+    std::atomic<size_t> connected{0};
+    std::atomic<uint64_t> publishNs{0};     // publish calls only, summed over bursts
+    std::atomic<int> bursts{0};
+
+    void run() {
+        room.id = 1;
+        room.name = "Lobby";
+        room.topic = "room/1";
+        room.jsonTopic = "room/1/json";
+        room.binaryTopic = "room/1/bin";
+
+        uWS::App app;
+        loop.store(uWS::Loop::get());
+        broadcaster.attach(&app);
+        app.ws<User>("/*", {
+                // A whole run of bursts may sit in a socket's buffer; nothing may be dropped
+                .maxBackpressure = 64 * 1024 * 1024,
+                .open = [this](auto* ws) {
+                    sockets.push_back(ws);
+                    broadcaster.subscribe(ws, room);
+                    connected.fetch_add(1);
+                },
+                .close = [this](auto* ws, int, std::string_view) {
+                    for (size_t i = 0; i < sockets.size(); i++) {
+                        if (sockets[i] != ws) continue;
+                        sockets[i] = sockets.back();
+                        sockets.pop_back();
+                        break;
+                    }
+                    connected.fetch_sub(1);
+                }
+            })
+            .listen("127.0.0.1", 0, [this](auto* token) {
+                listenSocket = token;
+                port.store(token ? us_socket_local_port(0, (us_socket_t*)token) : -1);
+            });
+        if (listenSocket) app.run();
+    }
+
+    // Runs on the loop; `except` publishes from the first socket that opened
+    void publish(bool except) {
+        auto start = Clock::now();
+        for (int i = 0; i < kBurst; i++) {
+            if (except) broadcaster.toRoomExcept(sockets.front(), room, kPayload);
+            else broadcaster.toRoom(room, kPayload);
+        }
+        publishNs.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+        bursts.fetch_add(1);
+    }
+
+    void stop() {
+        if (listenSocket) us_listen_socket_close(0, listenSocket);
+        listenSocket = nullptr;
+    }
+};
+
+// ----------------------
+// Client side: plain epoll WebSocket clients from loadtest/
+// ----------------------
+struct Subscriber {
+    WsConnection conn;
+    uint64_t received = 0;
+};
+
+class Subscribers {
+public:
+    bool connect(const sockaddr_in& address, size_t count, BenchServer& server) {
+        while (clients.size() < count) {
+            size_t batch = std::min(kConnectBatch, count - clients.size());
+            for (size_t i = 0; i < batch; i++) {
+                auto client = std::make_unique<Subscriber>();
+                if (!client->conn.connect(address, "127.0.0.1")) return false;
+                poller.add(client->conn, client.get());
+                clients.push_back(std::move(client));
+            }
+            if (!waitFor([&] { return server.connected.load() == clients.size() && allOpen(); })) return false;
+        }
+        return true;
+    }
+
+    // Polls until `recipients` subscribers have read `expected` messages each
+    bool waitForDelivery(uint64_t expected, size_t recipients) {
+        return waitFor([&] {
+            size_t done = 0;
+            for (auto& client : clients) done += client->received >= expected;
+            return done >= recipients;
+        });
+    }
+
+    void reset() {
+        for (auto& client : clients) client->received = 0;
+    }
+
+    void closeAll() {
+        for (auto& client : clients) {
+            poller.remove(client->conn);
+            client->conn.close();
+        }
+        clients.clear();
+    }
+
+private:
+    bool allOpen() const {
+        for (auto& client : clients) {
+            if (!client->conn.open()) return false;
+        }
+        return true;
+    }
+
+    template <typename Done>
+    bool waitFor(Done&& done) {
+        auto deadline = Clock::now() + std::chrono::seconds(30);
+        while (!done()) {
+            if (Clock::now() > deadline) return false;
+            poller.poll(1, [this](void* tag, bool readable, bool writable) {
+                Subscriber& client = *(Subscriber*)tag;
+                bool open = !writable || client.conn.onWritable();
+                if (open && readable) open = client.conn.onReadable([&](std::string_view, bool) { client.received++; });
+                if (open) poller.update(client.conn, &client);
+                else poller.remove(client.conn);
+            });
+        }
+        return true;
+    }
+
+    WsPoller poller;
+    std::vector<std::unique_ptr<Subscriber>> clients;
+};
+
+// One row: kRounds bursts, each timed from the publish until the last subscriber has it
+static bool measure(const char* name, bool except, size_t subscribers, BenchServer& server, Subscribers& clients) {
+    clients.reset();
+    server.publishNs.store(0);
+    server.bursts.store(0);
+    uWS::Loop* loop = server.loop.load();
+    size_t recipients = except ? subscribers - 1 : subscribers;   // uWS skips the publisher
+    double deliveryNs = 0;
+    for (int round = 1; round <= kRounds; round++) {
+        auto start = Clock::now();
+        loop->defer([&server, except] { server.publish(except); });
+        if (!clients.waitForDelivery((uint64_t)round * kBurst, recipients)) {
+            std::fprintf(stderr, "❌ %s: subscribers stopped receiving at round %d\n", name, round);
+            return false;
+        }
+        deliveryNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        // A publish may deliver before it returns; wait for the burst to be counted
+        while (server.bursts.load() < round) std::this_thread::yield();
+    }
+    double messages = (double)kRounds * kBurst;
+    std::printf("%-30s %10.2f us/publish %10.2f us/delivery %12.0f frames/s\n", name, server.publishNs.load() / messages / 1000,
+                deliveryNs / messages / 1000, messages * recipients / (deliveryNs / 1e9));
+    return true;
+}
+
+int main() {
+    std::signal(SIGPIPE, SIG_IGN);
+    uint64_t files = raiseFileLimit();
+    if (files && files < 2 * 5000 + 64) {
+        std::fprintf(stderr, "⚠️ Open file limit is %llu; the 5000-subscriber run needs both ends of every connection\n",
+                     (unsigned long long)files);
+    }
+
+    BenchServer server;
+    std::thread loopThread([&server] { server.run(); });
+    while (server.port.load() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (server.port.load() < 0) {
+        std::fprintf(stderr, "❌ Could not bind a loopback port\n");
+        loopThread.join();
+        return 1;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)server.port.load());
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+    int status = 0;
+    for (size_t subscribers : {50, 500, 5000}) {
+        Subscribers clients;
+        std::printf("-- %zu subscribers, %zu-byte payload --\n", subscribers, kPayload.size());
+        bool ok = clients.connect(address, subscribers, server);
+        if (!ok) std::fprintf(stderr, "❌ Only %zu of %zu subscribers connected\n", server.connected.load(), subscribers);
+        ok = ok && measure("Broadcaster::toRoom", false, subscribers, server, clients);
+        ok = ok && measure("Broadcaster::toRoomExcept", true, subscribers, server, clients);
+        std::printf("\n");
+        clients.closeAll();
+        while (server.connected.load() != 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (!ok) {
+            status = 1;
+            break;
+        }
+    }
+
+    server.loop.load()->defer([&server] { server.stop(); });
+    loopThread.join();
+    return status;
+}
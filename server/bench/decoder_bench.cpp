@@ -0,0 +1,106 @@
+// Inbound JSON decoding: the old extract_string_field / extract_int_field
+// helpers (frame copied into a std::string, one rescan per field, if-chain of
+// type compares) versus JsonMessage (one tokenizing pass over the frame,
+// string_view fields, perfect-hash type lookup).
+#include <cctype>
+#include <string>
+#include <string_view>
+#include "BenchUtil.hpp"
+#include "JsonMessage.hpp"
+
+// Verbatim copies of the helpers main.cpp used before JsonMessage
+static std::string extract_string_field(const std::string& s, const std::string& key) {
+    std::string pat = "\"" + key + "\"";
+    auto pos = s.find(pat);
+    if (pos == std::string::npos) return "";
+    pos = s.find(':', pos + pat.size());
+    if (pos == std::string::npos) return "";
+    auto q1 = s.find('"', pos);
+    if (q1 == std::string::npos) return "";
+    auto q2 = s.find('"', q1 + 1);
+    if (q2 == std::string::npos) return "";
+    return s.substr(q1 + 1, q2 - (q1 + 1));
+}
+
+static long extract_int_field(const std::string& s, const std::string& key, long fallback = -1) {
+    std::string pat = "\"" + key + "\"";
+    auto pos = s.find(pat);
+    if (pos == std::string::npos) return fallback;
+    pos = s.find(':', pos + pat.size());
+    if (pos == std::string::npos) return fallback;
+    size_t start = pos + 1;
+    while (start < s.size() && isspace((unsigned char)s[start])) start++;
+    std::string num;
+    if (start < s.size() && (s[start] == '-' || isdigit((unsigned char)s[start]))) {
+        size_t i = start;
+        if (s[i] == '-') { num.push_back('-'); i++; }
+        while (i < s.size() && (isdigit((unsigned char)s[i]))) { num.push_back(s[i]); i++; }
+        try { return std::stol(num); } catch (...) { return fallback; }
+    }
+    return fallback;
+}
+
+static int legacyTypeIndex(const std::string& type) {
+    if (type == "GET_ROOM_TEMPLATES") return 1;
+    if (type == "GET_ROOM_TEMPLATE") return 2;
+    if (type == "GET_ROOM_FURNITURE") return 3;
+    if (type == "SUBSCRIBE_ROOM") return 4;
+    if (type == "CREATE_FURNITURE") return 5;
+    if (type == "UPDATE_FURNITURE") return 6;
+    if (type == "DELETE_FURNITURE") return 7;
+    return 0;
+}
+
+int main() {
+    const std::string_view updateFrame =
+        R"({"type":"UPDATE_FURNITURE","reqId":"r-1739812345-42","room":"Lobby","uid":"fm2x9k1_17","tx":7,"ty":3,"rotation":2})";
+    const std::string_view createFrame =
+        R"({"type":"CREATE_FURNITURE","reqId":"r-1739812345-43","room":"Lobby","uid":"fm2x9k1_18","furniture":{"proto_id":"B_table_long_1","tx":4,"ty":9,"color":"#aa3311"}})";
+
+    struct Case { const char* name; std::string_view frame; };
+    for (const Case& c : {Case{"UPDATE_FURNITURE", updateFrame}, Case{"CREATE_FURNITURE (nested)", createFrame}}) {
+        std::printf("-- %s, %zu bytes --\n", c.name, c.frame.size());
+        auto legacy = runBench("legacy: copy + rescan per field", [&] {
+            std::string msg(c.frame);
+            std::string type = extract_string_field(msg, "type");
+            std::string reqId = extract_string_field(msg, "reqId");
+            int index = legacyTypeIndex(type);
+            std::string room = extract_string_field(msg, "room");
+            std::string uid = extract_string_field(msg, "uid");
+            long tx = extract_int_field(msg, "tx", 0);
+            long ty = extract_int_field(msg, "ty", 0);
+            doNotOptimize(index);
+            doNotOptimize(reqId);
+            doNotOptimize(room);
+            doNotOptimize(uid);
+            doNotOptimize(tx + ty);
+        });
+        auto decoded = runBench("JsonMessage: single pass, views", [&] {
+            JsonMessage json;
+            json.parse(c.frame);
+            EventType type = json.type();
+            std::string_view reqId = json.str("reqId");
+            std::string_view room = json.str("room");
+            std::string_view uid = json.str("uid");
+            long tx = json.num("tx", 0);
+            long ty = json.num("ty", 0);
+            doNotOptimize(type);
+            doNotOptimize(reqId);
+            doNotOptimize(room);
+            doNotOptimize(uid);
+            doNotOptimize(tx + ty);
+        });
+        std::printf("%-48s %12.2fx\n\n", "speedup", legacy.nsPerOp / decoded.nsPerOp);
+    }
+
+    std::printf("-- type lookup only --\n");
+    const std::string typeName = "DELETE_FURNITURE";
+    auto chain = runBench("legacy: if-chain of string compares", [&] {
+        doNotOptimize(legacyTypeIndex(typeName));
+    });
+    auto hashed = runBench("eventTypeFromName: perfect hash", [&] {
+        doNotOptimize(eventTypeFromName(typeName));
+    });
+    std::printf("%-48s %12.2fx\n", "speedup", chain.nsPerOp / hashed.nsPerOp);
+    return 0;
+}
@@ -0,0 +1,190 @@
+// Regression suite for the per-message hot path, on the code the server
+// actually ships (no legacy copies): decoding inbound frames, escaping chat,
+// serializing furniture and templates, and fanning a room event out to its
+// subscribers. Run it before and after a change and compare the columns;
+// with HABBO_BENCH_CSV set, results are also appended to that file.
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BenchUtil.hpp"
+#include "JsonMessage.hpp"
+#include "JsonWriter.hpp"
+#include "Protocol.hpp"
+#include "RoomJson.hpp"
+#include "TemplateCatalogue.hpp"
+
+static std::vector<RoomObject> makeFurniture(size_t count) {
+    std::vector<RoomObject> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        objects.push_back({(int)(4000 + i), "B_table_long_" + std::to_string(i % 17), "furniture/tables/B_table_long.png",
+                           (float)(i % 64), (float)(i / 64) + 0.5f, (float)(i % 4) * 90.0f, 1.0f, i % 3 == 0});
+    }
+    return objects;
+}
+
+static std::vector<RoomTemplate> makeTemplates(size_t count) {
+    std::vector<RoomTemplate> templates;
+    for (size_t i = 0; i < count; i++) {
+        std::string layout = R"({"floor":[)";
+        for (int row = 0; row < 16; row++) layout += std::string(row ? "," : "") + R"("xxxxxxxxxxxxxxxx")";
+        layout += R"(],"door":{"x":3,"y":7}})";
+        templates.push_back({(int)i + 1, "Template " + std::to_string(i), 16, 16, 30, "rooms/floor_" + std::to_string(i) + ".png",
+                             layout, i % 2 == 0});
+    }
+    return templates;
+}
+
+static void decoding() {
+    struct Case { const char* name; std::string_view frame; };
+    const Case cases[] = {
+        {"decode UPDATE_FURNITURE",
+         R"({"type":"UPDATE_FURNITURE","reqId":"r-1739812345-42","room":"Lobby","uid":"fm2x9k1_17","tx":7,"ty":3,"rotation":2})"},
+        {"decode CREATE_FURNITURE (nested)",
+         R"({"type":"CREATE_FURNITURE","reqId":"r-1739812345-43","room":"Lobby","uid":"fm2x9k1_18","furniture":{"proto_id":"B_table_long_1","tx":4,"ty":9,"color":"#aa3311"}})"},
+        {"decode SUBSCRIBE_ROOM",
+         R"({"type":"SUBSCRIBE_ROOM","reqId":"r-1739812345-44","room":"Lobby","version":1739812345678901})"},
+        {"decode TILE_CLICK", R"({"type":"TILE_CLICK","reqId":"r-1739812345-45","tx":12,"ty":5})"},
+    };
+    std::printf("-- inbound JSON: parse + the fields its handler reads --\n");
+    for (const Case& c : cases) {
+        runBench(c.name, [&] {
+            JsonMessage json;
+            json.parse(c.frame);
+            doNotOptimize(json.type());
+            doNotOptimize(json.str("reqId"));
+            doNotOptimize(json.str("room"));
+            doNotOptimize(json.str("uid"));
+            doNotOptimize(json.num("tx", 0) + json.num("ty", 0) + json.num("version", 0));
+        });
+    }
+    std::printf("\n");
+}
+
+static void escaping() {
+    struct Case { const char* name; std::string line; };
+    const Case cases[] = {
+        {"escape chat: plain ASCII", "hello everyone, anyone up for a game?!!"},
+        {"escape chat: quotes + backslashes", R"(she said "meet at C:\rooms\lobby" \o/ "now")"},
+        {"escape chat: newlines + tabs", "line one\nline two\ttabbed\r\nline three\n"},
+        {"escape chat: UTF-8 emoji", "✅ joined 🎉🎉 welcome to the lobby, grab a seat by the 🔥 and say hi 👋 to everyone ✨✨"},
+        {"escape chat: 500 B, mostly clean", std::string(500, 'a') + "\"quoted\""},
+    };
+    std::printf("-- chat escaping (appendJsonEscaped) --\n");
+    std::string out;
+    for (const Case& c : cases) {
+        runBench(c.name, [&] {
+            out.clear();
+            appendJsonEscaped(out, c.line);
+            doNotOptimize(out.data());
+        });
+    }
+    std::printf("\n");
+}
+
+static void furniture() {
+    std::printf("-- furniture serialization (ROOM_STATE body, writeRoomObject) --\n");
+    for (size_t count : {10, 100, 1000}) {
+        std::vector<RoomObject> objects = makeFurniture(count);
+        std::vector<std::string> uids;
+        for (size_t i = 0; i < count; i++) uids.push_back(i % 2 ? "dbid_" + std::to_string(4000 + i) : "fm2x9k1_" + std::to_string(i));
+        std::string name = "room objects to JSON, " + std::to_string(count) + " items";
+        runBench(name, [&] {
+            JsonWriter w;
+            w.beginArray();
+            for (size_t i = 0; i < objects.size(); i++) writeRoomObject(w, objects[i], uids[i]);
+            w.endArray();
+            doNotOptimize(w.size());
+        });
+    }
+    std::printf("\n");
+}
+
+static void templates() {
+    std::printf("-- room templates --\n");
+    TemplateCatalogue catalogue;
+    catalogue.publish(makeTemplates(12));
+    runBench("templates: build catalogue (12, on reload)", [&] {
+        auto snapshot = TemplateCatalogue::build(makeTemplates(12));
+        doNotOptimize(snapshot->listJson.size());
+    });
+    runBench("templates: GET_ROOM_TEMPLATES response", [&] {
+        auto current = catalogue.current();
+        JsonWriter w;
+        w.beginObject().field("type", "ROOM_TEMPLATES").field("reqId", "r-1").field("version", current->version);
+        w.key("data").raw(current->listJson).endObject();
+        doNotOptimize(w.size());
+    });
+    runBench("templates: GET_ROOM_TEMPLATES notModified", [&] {
+        auto current = catalogue.current();
+        JsonWriter w;
+        w.beginObject().field("type", "ROOM_TEMPLATES").field("reqId", "r-1").field("version", current->version);
+        w.field("notModified", true).endObject();
+        doNotOptimize(w.size());
+    });
+    std::printf("\n");
+}
+
+// One event per publish through the server's encoders (writeFurnitureEvent,
+// writeFurnitureEventBinary): encoded once per wire format, then copied to
+// each subscriber (MockSocket standing in for the uWS topic tree)
+static void fanout() {
+    std::printf("-- furniture event encoding --\n");
+    RoomObject moved = makeFurniture(1).front();
+    RoomObject pending = moved;
+    pending.id = 0;
+    runBench("encode FURNITURE_UPDATED json", [&] {
+        JsonWriter object;
+        writeRoomObject(object, moved, "fm2x9k1_17");
+        JsonWriter w;
+        writeFurnitureEvent(w, FurnitureChange::Updated, "Lobby", 1739812345678901ull, object.view());
+        doNotOptimize(w.size());
+    });
+    runBench("encode FURNITURE_UPDATED binary", [&] {
+        std::string frame;
+        writeFurnitureEventBinary(frame, FurnitureChange::Updated, 7, 1739812345678901ull, moved, "fm2x9k1_17");
+        doNotOptimize(frame.size());
+    });
+    runBench("encode FURNITURE_UPDATED binary, by uid", [&] {
+        std::string frame;
+        writeFurnitureEventBinary(frame, FurnitureChange::Updated, 7, 0, pending, "fm2x9k1_17");
+        doNotOptimize(frame.size());
+    });
+    runBench("encode FURNITURE_ADDED binary", [&] {
+        std::string frame;
+        writeFurnitureEventBinary(frame, FurnitureChange::Added, 7, 1739812345678901ull, moved, "fm2x9k1_17");
+        doNotOptimize(frame.size());
+    });
+    std::printf("\n");
+
+    std::printf("-- room fan-out --\n");
+    for (size_t subscribers : {10, 100, 1000}) {
+        std::vector<MockSocket> sockets(subscribers);
+        std::string suffix = ", " + std::to_string(subscribers) + " subscribers";
+        runBench("FURNITURE_UPDATED json" + suffix, [&] {
+            JsonWriter object;
+            writeRoomObject(object, moved, "fm2x9k1_17");
+            JsonWriter w;
+            writeFurnitureEvent(w, FurnitureChange::Updated, "Lobby", 1739812345678901ull, object.view());
+            for (auto& socket : sockets) socket.send(w.view());
+        });
+        runBench("FURNITURE_UPDATED binary" + suffix, [&] {
+            std::string frame;
+            writeFurnitureEventBinary(frame, FurnitureChange::Updated, 7, 1739812345678901ull, moved, "fm2x9k1_17");
+            for (auto& socket : sockets) socket.send(frame);
+        });
+        runBench("chat line" + suffix, [&] {
+            std::string line = "swarm_user_42: hello everyone, anyone up for a game?!!";
+            for (size_t i = 1; i < sockets.size(); i++) sockets[i].send(line);   // everyone but the sender
+        });
+    }
+}
+
+int main() {
+    decoding();
+    escaping();
+    furniture();
+    templates();
+    fanout();
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Area-of-interest fan-out: 1000 avatars wandering a 64x64 room. Counts the
+// avatar updates that reach clients per tick when every frame goes to the
+// whole room versus per-view-cell frames from InterestGrid (including the
+// catch-ups viewers get when they cross cells), and times collect().
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "BenchUtil.hpp"
+#include "Interest.hpp"
+
+struct MockAvatar {
+    const void* owner = nullptr;
+    uint32_t id = 0;
+    Tile tile;
+    bool changed = false;
+    bool joined = false;
+};
+
+static constexpr int kRoomTiles = 64;
+static constexpr size_t kAvatars = 1000;
+static constexpr double kWalkingShare = 0.3;    // avatars taking a step in a given tick
+
+struct World {
+    std::vector<MockAvatar> avatars;
+    std::mt19937 rng{42};
+
+    World() {
+        std::uniform_int_distribution<int> coord(0, kRoomTiles - 1);
+        avatars.resize(kAvatars);
+        for (size_t i = 0; i < kAvatars; i++) {
+            avatars[i].owner = &avatars[i];
+            avatars[i].id = (uint32_t)i + 1;
+            avatars[i].tile = Tile{coord(rng), coord(rng)};
+            avatars[i].changed = avatars[i].joined = true;
+        }
+    }
+
+    void step() {
+        std::uniform_real_distribution<double> roll(0, 1);
+        std::uniform_int_distribution<int> delta(-1, 1);
+        for (auto& a : avatars) {
+            a.joined = false;
+            a.changed = roll(rng) < kWalkingShare;
+            if (!a.changed) continue;
+            a.tile.x = std::clamp(a.tile.x + delta(rng), 0, kRoomTiles - 1);
+            a.tile.y = std::clamp(a.tile.y + delta(rng), 0, kRoomTiles - 1);
+        }
+    }
+};
+
+int main() {
+    World world;
+    InterestGrid grid;
+    grid.resize(kRoomTiles, kRoomTiles);
+    std::vector<ViewFrame> frames;
+    std::vector<ViewMove> moves;
+    std::vector<uint32_t> departed;
+    grid.collect(world.avatars, departed, frames, moves);   // initial placement
+
+    const int ticks = 200;
+    uint64_t roomWide = 0;
+    uint64_t filtered = 0;
+    uint64_t catchUps = 0;
+    std::vector<uint32_t> viewers((size_t)grid.columns() * grid.rows());
+    for (int t = 0; t < ticks; t++) {
+        // Each viewer follows the cell it was announced in, like the server's topic subscriptions
+        std::fill(viewers.begin(), viewers.end(), 0);
+        for (const auto& a : world.avatars) {
+            ViewCell c = grid.placed(a.id);
+            viewers[(size_t)c.y * grid.columns() + c.x]++;
+        }
+        world.step();
+        size_t changed = 0;
+        for (const auto& a : world.avatars) changed += a.changed;
+        roomWide += (uint64_t)changed * world.avatars.size();
+
+        size_t count = grid.collect(world.avatars, departed, frames, moves);
+        for (size_t n = 0; n < count; n++) {
+            const ViewFrame& f = frames[n];
+            filtered += (uint64_t)(f.avatars.size() + f.left.size()) * viewers[(size_t)f.cell.y * grid.columns() + f.cell.x];
+        }
+        for (const ViewMove& move : moves) {
+            grid.forEachVisible(move.to, [&](ViewCell cell) {
+                if (!InterestGrid::sees(move.from, cell)) catchUps += grid.avatarsIn(cell).size();
+            });
+            grid.forEachVisible(move.from, [&](ViewCell cell) {
+                if (!InterestGrid::sees(move.to, cell)) catchUps += grid.avatarsIn(cell).size();
+            });
+        }
+    }
+    filtered += catchUps;
+
+    std::printf("-- %dx%d room, %zu avatars, %.0f%% stepping per tick --\n", kRoomTiles, kRoomTiles, kAvatars,
+                kWalkingShare * 100);
+    std::printf("%-48s %12.0f\n", "room-wide: avatar updates delivered per tick", (double)roomWide / ticks);
+    std::printf("%-48s %12.0f\n", "interest: avatar updates delivered per tick", (double)filtered / ticks);
+    std::printf("%-48s %12.0f\n", "  of which view catch-ups", (double)catchUps / ticks);
+    std::printf("%-48s %12.2fx\n\n", "fan-out reduction", (double)roomWide / (double)filtered);
+
+    runBench("InterestGrid::collect (one tick)", [&] {
+        world.step();
+        size_t count = grid.collect(world.avatars, departed, frames, moves);
+        doNotOptimize(count);
+    });
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Response serialization: the old std::ostringstream builders (fresh stream
+// per message, locale-aware float output, byte-at-a-time escaping) versus
+// JsonWriter (reused per-thread buffer, to_chars, SSE2 escape fast path).
+// The main case is a full ROOM_STATE, the largest payload the server sends.
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BenchUtil.hpp"
+#include "JsonWriter.hpp"
+
+// Mirrors RoomObject in core/Database.hpp without pulling in libpqxx
+struct RoomObject {
+    int id;
+    std::string name;
+    std::string spritePath;
+    float x, y, rotation, scale;
+    bool interactable;
+};
+
+// ---------- Legacy path (verbatim from main.cpp before JsonWriter) ----------
+static std::string escape_json_string(const std::string& in) {
+    std::string out;
+    out.reserve(in.size() + 10);
+    for (char c : in) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: out += c; break;
+        }
+    }
+    return out;
+}
+
+static void legacyWriteRoomObject(std::ostringstream& ss, const RoomObject& o, const std::string& uid) {
+    ss << "{";
+    ss << "\"id\":" << o.id << ",";
+    if (!uid.empty()) ss << "\"uid\":\"" << escape_json_string(uid) << "\",";
+    ss << "\"name\":\"" << escape_json_string(o.name) << "\",";
+    ss << "\"sprite_path\":\"" << escape_json_string(o.spritePath) << "\",";
+    ss << "\"tx\":" << o.x << ",";
+    ss << "\"ty\":" << o.y << ",";
+    ss << "\"rotation\":" << o.rotation << ",";
+    ss << "\"scale\":" << o.scale << ",";
+    ss << "\"interactable\":" << (o.interactable ? "true" : "false");
+    ss << "}";
+}
+
+static std::string legacyRoomState(const std::vector<RoomObject>& objs, const std::vector<std::string>& uids) {
+    std::ostringstream furniture;
+    furniture << "[";
+    for (size_t i = 0; i < objs.size(); i++) {
+        if (i) furniture << ",";
+        legacyWriteRoomObject(furniture, objs[i], uids[i]);
+    }
+    furniture << "]";
+
+    std::ostringstream out;
+    out << "{";
+    out << "\"type\":\"ROOM_STATE\",";
+    out << "\"reqId\":\"" << escape_json_string("r-1739812345-42") << "\",";
+    out << "\"room\":\"" << escape_json_string("Lobby") << "\",";
+    out << "\"version\":" << 1739812345678901ull << ",";
+    out << "\"furniture\":" << furniture.str();
+    out << "}";
+    return out.str();
+}
+
+// ---------- JsonWriter path (as main.cpp builds it now) ----------
+static void writeRoomObject(JsonWriter& w, const RoomObject& o, std::string_view uid) {
+    w.beginObject();
+    w.field("id", o.id);
+    w.optionalField("uid", uid);
+    w.field("name", o.name);
+    w.field("sprite_path", o.spritePath);
+    w.field("tx", o.x);
+    w.field("ty", o.y);
+    w.field("rotation", o.rotation);
+    w.field("scale", o.scale);
+    w.field("interactable", o.interactable);
+    w.endObject();
+}
+
+static size_t writerRoomState(const std::vector<RoomObject>& objs, const std::vector<std::string>& uids) {
+    JsonWriter w;
+    w.beginObject();
+    w.field("type", "ROOM_STATE");
+    w.field("reqId", "r-1739812345-42");
+    w.field("room", "Lobby");
+    w.field("version", 1739812345678901ull);
+    w.key("furniture").beginArray();
+    for (size_t i = 0; i < objs.size(); i++) writeRoomObject(w, objs[i], uids[i]);
+    w.endArray();
+    w.endObject();
+    doNotOptimize(w.view().data());
+    return w.size();
+}
+
+int main() {
+    for (size_t count : {50, 500, 2000}) {
+        std::vector<RoomObject> objs;
+        std::vector<std::string> uids;
+        for (size_t i = 0; i < count; i++) {
+            objs.push_back({(int)(4000 + i), "B_table_long_" + std::to_string(i % 17), "furniture/tables/B_table_long.png",
+                            (float)(i % 64), (float)(i / 64) + 0.5f, (float)(i % 4) * 90.0f, 1.0f, i % 3 == 0});
+            uids.push_back(i % 2 ? "dbid_" + std::to_string(4000 + i) : "fm2x9k1_" + std::to_string(i));
+        }
+        std::printf("-- ROOM_STATE, %zu objects (%zu bytes) --\n", count, legacyRoomState(objs, uids).size());
+        auto legacy = runBench("legacy: ostringstream", [&] {
+            std::string s = legacyRoomState(objs, uids);
+            doNotOptimize(s.data());
+        });
+        auto writer = runBench("JsonWriter: reused buffer, to_chars", [&] {
+            doNotOptimize(writerRoomState(objs, uids));
+        });
+        std::printf("%-48s %12.2fx\n\n", "speedup", legacy.nsPerOp / writer.nsPerOp);
+    }
+
+    std::printf("-- escaping a 4 KiB chat-sized string --\n");
+    std::string clean(4096, 'a');
+    for (size_t i = 0; i < clean.size(); i += 97) clean[i] = ' ';
+    clean[2000] = '"';
+    auto scalar = runBench("legacy: escape_json_string", [&] {
+        std::string s = escape_json_string(clean);
+        doNotOptimize(s.data());
+    });
+    std::string out;
+    auto simd = runBench("appendJsonEscaped", [&] {
+        out.clear();
+        appendJsonEscaped(out, clean);
+        doNotOptimize(out.data());
+    });
+    std::printf("%-48s %12.2fx\n", "speedup", scalar.nsPerOp / simd.nsPerOp);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Wire cost of high-frequency room traffic: text JSON (JsonWriter encode,
+// JsonMessage decode) versus the binary protocol in network/Protocol.hpp.
+// Reports bytes per message and encode+decode time for a furniture move
+// request, the FURNITURE_UPDATED event fanned out to a room, and a tile click.
+#include <string>
+#include "BenchUtil.hpp"
+#include "JsonMessage.hpp"
+#include "JsonWriter.hpp"
+#include "Protocol.hpp"
+
+static const uint64_t kVersion = 1739812345678901ull;
+
+// ---------- FURNITURE_UPDATED (server -> room) ----------
+static size_t jsonFurnitureUpdated(int id, float tx, float ty) {
+    JsonWriter w;
+    w.beginObject();
+    w.field("type", "FURNITURE_UPDATED");
+    w.field("room", "Lobby");
+    w.field("version", kVersion);
+    w.key("furniture").beginObject();
+    w.field("id", id).field("uid", "fm2x9k1_17").field("name", "B_table_long_1").field("sprite_path", "");
+    w.field("tx", tx).field("ty", ty).field("rotation", 90.0f).field("scale", 1.0f).field("interactable", false);
+    w.endObject();
+    w.endObject();
+
+    JsonMessage in;
+    in.parse(w.view());
+    doNotOptimize(in.num("id") + in.num("tx") + in.num("ty") + in.num("version"));
+    return w.size();
+}
+
+static size_t binaryFurnitureUpdated(int id, float tx, float ty) {
+    std::string frame;
+    BinaryWriter b(frame);
+    b.op(BinaryOp::FurnitureUpdated).varint(12).varint(kVersion);
+    b.u8(kFurnitureHasRotation).varint(id).coord(tx).coord(ty).svarint(90);
+
+    BinaryReader in(frame);
+    in.u8();
+    uint64_t sum = in.varint() + in.varint();
+    in.u8();
+    sum += in.varint();
+    doNotOptimize(sum + (uint64_t)in.coord() + (uint64_t)in.coord() + (uint64_t)in.svarint());
+    return frame.size();
+}
+
+// ---------- UPDATE_FURNITURE / MoveFurniture (client -> server) ----------
+static size_t jsonMoveRequest(float tx, float ty) {
+    JsonWriter w;
+    w.beginObject().field("type", "UPDATE_FURNITURE").field("room", "Lobby").field("uid", "dbid_4812");
+    w.field("tx", tx).field("ty", ty).field("reqId", "r-1739812345-42").endObject();
+
+    JsonMessage in;
+    in.parse(w.view());
+    doNotOptimize(in.type());
+    doNotOptimize(in.str("uid"));
+    doNotOptimize(in.num("tx") + in.num("ty"));
+    return w.size();
+}
+
+static size_t binaryMoveRequest(float tx, float ty) {
+    std::string frame;
+    BinaryWriter(frame).op(BinaryOp::MoveFurniture).u8(0).varint(4812).coord(tx).coord(ty);
+
+    BinaryReader in(frame);
+    in.u8();
+    in.u8();
+    doNotOptimize(in.varint() + (uint64_t)in.coord() + (uint64_t)in.coord());
+    return frame.size();
+}
+
+// ---------- TILE_CLICK ----------
+static size_t jsonTileClick(float tx, float ty) {
+    JsonWriter w;
+    w.beginObject().field("type", "TILE_CLICK").field("room", "Lobby").field("tx", tx).field("ty", ty).endObject();
+    JsonMessage in;
+    in.parse(w.view());
+    doNotOptimize(in.num("tx") + in.num("ty"));
+    return w.size();
+}
+
+static size_t binaryTileClick(float tx, float ty) {
+    std::string frame;
+    BinaryWriter(frame).op(BinaryOp::TileClick).coord(tx).coord(ty);
+    BinaryReader in(frame);
+    in.u8();
+    doNotOptimize(in.coord() + in.coord());
+    return frame.size();
+}
+
+template <typename JsonFn, typename BinaryFn>
+static void compare(const char* name, JsonFn jsonFn, BinaryFn binaryFn) {
+    size_t jsonBytes = jsonFn();
+    size_t binaryBytes = binaryFn();
+    std::printf("-- %s: %zu bytes JSON, %zu bytes binary (%.1fx smaller) --\n",
+                name, jsonBytes, binaryBytes, (double)jsonBytes / binaryBytes);
+    auto json = runBench("json: encode + decode", [&] { doNotOptimize(jsonFn()); });
+    auto binary = runBench("binary: encode + decode", [&] { doNotOptimize(binaryFn()); });
+    std::printf("%-48s %12.2fx\n\n", "speedup", json.nsPerOp / binary.nsPerOp);
+}
+
+int main() {
+    compare("FURNITURE_UPDATED event",
+            [] { return jsonFurnitureUpdated(4812, 17.0f, 23.0f); },
+            [] { return binaryFurnitureUpdated(4812, 17.0f, 23.0f); });
+    compare("furniture move request",
+            [] { return jsonMoveRequest(17.0f, 23.0f); },
+            [] { return binaryMoveRequest(17.0f, 23.0f); });
+    compare("TILE_CLICK",
+            [] { return jsonTileClick(17.0f, 23.0f); },
+            [] { return binaryTileClick(17.0f, 23.0f); });
+    return 0;
+}
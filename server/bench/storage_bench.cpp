@@ -0,0 +1,68 @@
+// Embedded store (LogStore) costs: hot reads that used to be a Postgres round
+// trip, log appends for the common writes, and the startup/compaction work
+// that buys them. Runs in a scratch directory; no database needed.
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "BenchUtil.hpp"
+#include "LogStore.hpp"
+
+static double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    char scratch[] = "/tmp/habbo_storage_bench.XXXXXX";
+    if (!mkdtemp(scratch)) return 1;
+    const std::string directory = scratch;
+
+    const int kRooms = 200;
+    const int kObjectsPerRoom = 500;
+    {
+        LogStore store(directory);
+        Storage& db = store;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < kRooms; r++) {
+            int roomId = db.createRoomFromTemplate(1, 1, "Room " + std::to_string(r));
+            for (int i = 0; i < kObjectsPerRoom; i++) {
+                db.addRoomObject(roomId, "B_table_long", "furniture/tables/B_table_long.png", (float)(i % 32), (float)(i / 32), 90);
+            }
+        }
+        std::printf("populate: %d rooms x %d objects                  %10.1f ms\n\n", kRooms, kObjectsPerRoom, millisSince(start));
+
+        std::printf("-- reads (memory lookups under a shared lock) --\n");
+        runBench("loadRoomObjects, 500 items", [&] { doNotOptimize(db.loadRoomObjects(57)->size()); });
+        runBench("getPublicRoomByName", [&] { doNotOptimize(db.getPublicRoomByName("Room 57")->id); });
+        runBench("getRoomTemplateById", [&] { doNotOptimize(db.getRoomTemplateById(1)->id); });
+        runBench("getRecentChat, empty room", [&] { doNotOptimize(db.getRecentChat(57, 50)->size()); });
+
+        std::printf("\n-- writes (one log append each; fsync is batched in the background) --\n");
+        float x = 0;
+        runBench("updateRoomObject", [&] { db.updateRoomObject(1000, x += 1, 3, 180); });
+        std::vector<ChatLine> chatBatch(100, ChatLine{57, "swarm_user_42", "hello everyone, anyone up for a game?!!"});
+        runBench("insertChatMessages, batch of 100", [&] { db.insertChatMessages(chatBatch); });
+        PositionBatch positions;
+        for (int u = 0; u < 500; u++) positions.push(u + 1, 57, 4.5f, 7.0f, "se");
+        runBench("upsertPlayerPositions, 500 rows", [&] { db.upsertPlayerPositions(positions); });
+
+        std::printf("\n");
+        auto stats = store.stats();
+        std::printf("log before compaction: %llu records, %.1f MiB\n", (unsigned long long)stats.records, stats.walBytes / 1048576.0);
+        start = std::chrono::steady_clock::now();
+        store.compact();
+        std::printf("compact (snapshot + new log)                      %10.1f ms\n", millisSince(start));
+    }
+
+    // A restart: snapshot load plus whatever the log gained since
+    auto start = std::chrono::steady_clock::now();
+    {
+        LogStore store(directory);
+        doNotOptimize(store.stats().roomObjects);
+    }
+    std::printf("reopen from snapshot                              %10.1f ms\n", millisSince(start));
+
+    std::filesystem::remove_all(directory);
+    return 0;
+}
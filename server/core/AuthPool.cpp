@@ -0,0 +1,57 @@
+#include "AuthPool.hpp"
+#include <iostream>
+
+AuthPool::AuthPool(size_t workerCount, size_t queueCapacity, size_t perAddressLimit)
+    : perAddressLimit(perAddressLimit), jobs("Auth pool", queueCapacity, WorkerQueue::OnStop::Discard) {
+    if (workerCount == 0) workerCount = 1;
+    jobs.start(workerCount);
+    std::cout << "✅ Auth pool started with " << workerCount << " workers" << std::endl;
+}
+
+AuthPool::~AuthPool() {
+    stop();
+}
+
+void AuthPool::stop() {
+    jobs.stop();
+}
+
+AuthPool::Slot AuthPool::admit(const std::string& address) {
+    {
+        std::lock_guard<std::mutex> lk(addressMutex);
+        size_t& count = inFlight[address];
+        if (perAddressLimit && count >= perAddressLimit) {
+            throttled.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        count++;
+    }
+    // The deleter only needs the address; the pointer itself is a dummy
+    return Slot(this, [address](AuthPool* pool) { pool->release(address); });
+}
+
+void AuthPool::release(const std::string& address) {
+    std::lock_guard<std::mutex> lk(addressMutex);
+    auto it = inFlight.find(address);
+    if (it == inFlight.end()) return;
+    if (--it->second == 0) inFlight.erase(it);
+}
+
+AuthPoolStats AuthPool::stats() const {
+    WorkerQueueStats q = jobs.stats();
+    AuthPoolStats s;
+    s.workers = q.workers;
+    s.queueDepth = q.queueDepth;
+    s.queueCapacity = q.queueCapacity;
+    s.submitted = q.submitted;
+    s.completed = q.completed;
+    s.rejected = q.rejected;
+    s.throttled = throttled.load(std::memory_order_relaxed);
+    s.avgWaitMs = q.avgWaitMs;
+    s.avgRunMs = q.avgRunMs;
+    {
+        std::lock_guard<std::mutex> lk(addressMutex);
+        s.addressesInFlight = inFlight.size();
+    }
+    return s;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <uWebSockets/App.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include "WorkerQueue.hpp"
+
+// ---------- Auth Pool Stats ----------
+struct AuthPoolStats {
+    size_t workers = 0;
+    size_t queueDepth = 0;
+    size_t queueCapacity = 0;
+    size_t addressesInFlight = 0;
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    uint64_t rejected = 0;      // queue full
+    uint64_t throttled = 0;     // per-address limit hit
+    double avgWaitMs = 0;
+    double avgRunMs = 0;        // time spent hashing
+};
+
+// ---------- Auth Pool ----------
+// bcrypt is slow on purpose, so it gets its own small set of threads: a
+// login storm then queues here instead of stalling the loops or holding
+// DB connections. Same WorkerQueue as DatabasePool, except that logins
+// still queued at shutdown are dropped (their loops are gone). admit()
+// caps the logins one address may have in flight.
+class AuthPool {
+public:
+    // Held for the duration of one login; the address's slot is released when
+    // the last copy goes away, on whichever thread that happens
+    using Slot = std::shared_ptr<void>;
+
+    // perAddressLimit 0 lifts the cap (load tests run every user from one address)
+    AuthPool(size_t workerCount = 2, size_t queueCapacity = 512, size_t perAddressLimit = 2);
+    ~AuthPool();
+
+    AuthPool(const AuthPool&) = delete;
+    AuthPool& operator=(const AuthPool&) = delete;
+
+    // Any thread. nullptr when `address` is at its limit.
+    Slot admit(const std::string& address);
+
+    // Runs `work()` on an auth thread, then `done(result)` on the calling
+    // thread's uWS loop. Returns false if the queue is full.
+    template <typename Work, typename Done>
+    bool submit(Work work, Done done) {
+        uWS::Loop* loop = uWS::Loop::get();
+        using Result = std::invoke_result_t<Work&>;
+        return jobs.push([loop, work = std::move(work), done = std::move(done)](size_t) mutable {
+            Result result = work();
+            loop->defer([done, result = std::move(result)]() mutable { done(std::move(result)); });
+        });
+    }
+
+    AuthPoolStats stats() const;
+    void stop();
+
+private:
+    void release(const std::string& address);
+
+    const size_t perAddressLimit;
+    mutable std::mutex addressMutex;
+    std::unordered_map<std::string, size_t> inFlight;
+    std::atomic<uint64_t> throttled{0};
+
+    // Last, so it goes first: dropped logins release their Slot into the map above
+    WorkerQueue jobs;
+};
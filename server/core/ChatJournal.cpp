@@ -0,0 +1,184 @@
+#include "ChatJournal.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "Utils.hpp"
+
+static size_t lineBytes(const ChatLine& line) {
+    return sizeof(ChatLine) + line.username.size() + line.message.size();
+}
+
+ChatJournal::ChatJournal(const StorageFactory& openStorage, size_t maxPendingLines, size_t maxPendingBytes,
+                         size_t maxBatch, int flushIntervalMs)
+    : db(openStorage()),
+      maxPendingLines(maxPendingLines),
+      maxPendingBytes(maxPendingBytes),
+      maxBatch(maxBatch == 0 ? 1 : maxBatch),
+      flushIntervalMs(flushIntervalMs) {
+    flusher = std::thread([this] { flusherLoop(); });
+}
+
+ChatJournal::~ChatJournal() {
+    stop();
+}
+
+bool ChatJournal::append(int roomId, const std::string& username, const std::string& message) {
+    ChatLine line{roomId, username, message};
+    size_t bytes = lineBytes(line);
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (stopping ||
+            pending.size() + inflightLines >= maxPendingLines ||
+            pendingBytes + bytes > maxPendingBytes) {
+            rejected++;
+            return false;
+        }
+        pending.push_back(std::move(line));
+        pendingBytes += bytes;
+        appended++;
+        wake = pending.size() >= maxBatch;
+    }
+    if (wake) cv.notify_one();
+    return true;
+}
+
+void ChatJournal::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    cv.notify_one();
+    if (flusher.joinable()) flusher.join();
+}
+
+void ChatJournal::writeIsolating(std::vector<ChatLine>& lines, size_t begin, size_t end, size_t& written,
+                                 std::vector<ChatLine>& poisonedLines, std::vector<ChatLine>& unwritten) {
+    if (begin == end) return;
+    if (!unwritten.empty()) {
+        for (size_t i = begin; i < end; i++) unwritten.push_back(std::move(lines[i]));
+        return;
+    }
+    std::vector<ChatLine> slice(std::make_move_iterator(lines.begin() + begin), std::make_move_iterator(lines.begin() + end));
+    if (db->insertChatMessages(slice)) {
+        written += slice.size();
+        return;
+    }
+    if (slice.size() > 1) {
+        std::move(slice.begin(), slice.end(), lines.begin() + begin);
+        size_t middle = begin + (end - begin) / 2;
+        writeIsolating(lines, begin, middle, written, poisonedLines, unwritten);
+        writeIsolating(lines, middle, end, written, poisonedLines, unwritten);
+        return;
+    }
+    // One line left: the line is at fault only if the store itself is up
+    if (db->getRecentChat(slice[0].roomId, 1).has_value()) poisonedLines.push_back(std::move(slice[0]));
+    else unwritten.push_back(std::move(slice[0]));
+}
+
+void ChatJournal::flusherLoop() {
+    const int maxShutdownRetries = 3;
+    const int isolateAfterFailures = 3;
+    int shutdownRetries = 0;
+    int batchFailures = 0;
+    std::vector<ChatLine> batch;
+    batch.reserve(maxBatch);
+    std::vector<ChatLine> poisonedLines;
+    std::vector<ChatLine> unwritten;
+
+    std::unique_lock<std::mutex> lk(mutex);
+    for (;;) {
+        cv.wait_for(lk, std::chrono::milliseconds(flushIntervalMs),
+                    [this] { return stopping || pending.size() >= maxBatch; });
+
+        if (pending.empty()) {
+            if (stopping) break;
+            continue;
+        }
+
+        size_t n = std::min(maxBatch, pending.size());
+        size_t batchBytes = 0;
+        for (size_t i = 0; i < n; i++) {
+            batchBytes += lineBytes(pending.front());
+            batch.push_back(std::move(pending.front()));
+            pending.pop_front();
+        }
+        inflightLines = n;
+        lk.unlock();
+
+        uint64_t start = steadyNowNs();
+        bool ok = db->insertChatMessages(batch);
+        uint64_t elapsed = steadyNowNs() - start;
+
+        // The same lines failing again and again: find the ones at fault
+        size_t written = ok ? n : 0;
+        size_t retryBytes = ok ? 0 : batchBytes;
+        if (!ok && ++batchFailures >= isolateAfterFailures) {
+            writeIsolating(batch, 0, n, written, poisonedLines, unwritten);
+            for (const ChatLine& line : poisonedLines) {
+                std::cerr << "❌ ChatJournal: dropping a chat line the store refuses (room " << line.roomId
+                          << ", " << line.username << ", " << line.message.size() << " bytes)" << std::endl;
+            }
+            batch = std::move(unwritten);
+            unwritten.clear();
+            retryBytes = 0;
+            for (const ChatLine& line : batch) retryBytes += lineBytes(line);
+            ok = batch.empty();
+        }
+
+        lk.lock();
+        inflightLines = 0;
+        pendingBytes -= batchBytes - retryBytes;
+        if (written > 0) {
+            flushed += written;
+            batches++;
+            totalFlushNs += elapsed;
+        }
+        if (ok || written > 0 || !poisonedLines.empty()) batchFailures = 0;
+        poisoned += poisonedLines.size();
+        poisonedLines.clear();
+        if (ok) {
+            batch.clear();
+            continue;
+        }
+
+        // Put the batch back in order; the bytes are still accounted for, so
+        // append() keeps refusing work while Postgres is behind.
+        failures++;
+        for (size_t i = batch.size(); i-- > 0;) pending.push_front(std::move(batch[i]));
+        batch.clear();
+
+        if (stopping && ++shutdownRetries > maxShutdownRetries) {
+            dropped += pending.size();
+            std::cerr << "❌ ChatJournal: dropping " << pending.size() << " unflushed chat lines at shutdown" << std::endl;
+            pending.clear();
+            pendingBytes = 0;
+            break;
+        }
+
+        // Back off before retrying so a dead database is not hammered
+        lk.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::max(flushIntervalMs * 4, 100)));
+        lk.lock();
+    }
+}
+
+ChatJournalStats ChatJournal::stats() const {
+    std::lock_guard<std::mutex> lk(mutex);
+    ChatJournalStats s;
+    s.pendingLines = pending.size() + inflightLines;
+    s.pendingBytes = pendingBytes;
+    s.appended = appended;
+    s.rejected = rejected;
+    s.flushed = flushed;
+    s.batches = batches;
+    s.failures = failures;
+    s.dropped = dropped;
+    s.poisoned = poisoned;
+    if (batches > 0) {
+        s.avgBatchSize = (double)flushed / batches;
+        s.avgFlushMs = totalFlushNs / 1e6 / batches;
+    }
+    return s;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Storage.hpp"
+
+// ---------- Journal Stats ----------
+struct ChatJournalStats {
+    size_t pendingLines = 0;
+    size_t pendingBytes = 0;
+    uint64_t appended = 0;
+    uint64_t rejected = 0;   // refused because the buffer was full (backpressure)
+    uint64_t flushed = 0;
+    uint64_t batches = 0;
+    uint64_t failures = 0;
+    uint64_t dropped = 0;    // lost at shutdown after retries
+    uint64_t poisoned = 0;   // refused by the store on their own while it was up; dropped
+    double avgBatchSize = 0;
+    double avgFlushMs = 0;
+};
+
+// ---------- Write-behind Chat Journal ----------
+// Chat lines are buffered in memory and written to room_chat by a single
+// flusher thread with its own Storage, one insertChatMessages per batch.
+// A batch is flushed every flushIntervalMs or as soon as maxBatch lines are
+// waiting. Memory is bounded: once maxPendingLines / maxPendingBytes are
+// reached (e.g. Postgres is slow or down) append() refuses new lines.
+// A batch that keeps failing is split until the lines the store refuses on
+// their own (a NUL byte, a room that no longer exists) are found; those are
+// logged and dropped so one bad line cannot stall every room's chat.
+class ChatJournal {
+public:
+    ChatJournal(const StorageFactory& openStorage,
+                size_t maxPendingLines = 20000,
+                size_t maxPendingBytes = 8 * 1024 * 1024,
+                size_t maxBatch = 500,
+                int flushIntervalMs = 25);
+    ~ChatJournal();
+
+    ChatJournal(const ChatJournal&) = delete;
+    ChatJournal& operator=(const ChatJournal&) = delete;
+
+    // Never blocks on the database. Returns false when the buffer is full.
+    bool append(int roomId, const std::string& username, const std::string& message);
+
+    // Flushes everything still buffered, then joins the flusher.
+    void stop();
+
+    ChatJournalStats stats() const;
+
+private:
+    void flusherLoop();
+    // Writes lines[begin, end) in halves down to single lines. A single line
+    // that fails while the store still answers reads goes to `poisonedLines`;
+    // once it does not answer, the rest goes to `unwritten`, in order.
+    void writeIsolating(std::vector<ChatLine>& lines, size_t begin, size_t end, size_t& written,
+                        std::vector<ChatLine>& poisonedLines, std::vector<ChatLine>& unwritten);
+
+    std::shared_ptr<Storage> db;
+    const size_t maxPendingLines;
+    const size_t maxPendingBytes;
+    const size_t maxBatch;
+    const int flushIntervalMs;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<ChatLine> pending;
+    size_t pendingBytes = 0;   // includes the batch currently being written
+    size_t inflightLines = 0;
+    bool stopping = false;
+    std::thread flusher;
+
+    uint64_t appended = 0;
+    uint64_t rejected = 0;
+    uint64_t flushed = 0;
+    uint64_t batches = 0;
+    uint64_t failures = 0;
+    uint64_t dropped = 0;
+    uint64_t poisoned = 0;
+    uint64_t totalFlushNs = 0;
+};
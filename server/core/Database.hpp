@@ -1,65 +1,21 @@
 #pragma once
 #include <pqxx/pqxx>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <unordered_set>
 #include <vector>
 #include <iostream>
 #include "bcrypt.h"
+#include "Metrics.hpp"
+#include "Records.hpp"
+#include "Storage.hpp"
 
 using namespace std;
 
-// ---------- Room-Related Structs ----------
-struct RoomInfo {
-    int id;
-    string name;
-    int ownerId;
-    bool isPublic;
-    optional<string> pinCode;
-    int playerCount;
-    string layoutJson;
-};
-
-struct RoomMetadata {
-    int id;
-    string name;
-    float width;
-    float height;
-    float skewAngle;
-    string texturePath;
-    bool editable;
-};
-
-struct RoomObject {
-    int id;
-    string name;
-    string spritePath;
-    float x, y, rotation, scale;
-    bool interactable;
-};
-
-struct RoomTemplate {
-    int id;
-    string name;
-    float width;
-    float height;
-    float skewAngle;
-    string texturePath;
-    string defaultLayoutJson;
-    bool editable;
-};
-
-
-// ---------- Player Position Struct ----------
-struct PlayerPosition {
-    int userId;
-    int roomId;
-    float x, y;
-    string direction;
-};
-
 // ---------- Database Class ----------
-class Database {
+// Postgres backend for Storage; one connection per instance
+class Database : public Storage {
 public:
     Database(const string& connStr) {
         try {
@@ -67,17 +23,41 @@ public:
             if (conn->is_open()) {
                 cout << "✅ Connected to database: " << conn->dbname() << endl;
 
-                // Prepare common statements
-                conn->prepare("get_user", "SELECT id, password_hash FROM users WHERE username=$1");
-                conn->prepare("create_user", "INSERT INTO users(username, email, password_hash, role) VALUES($1, $2, $3, $4)");
-                conn->prepare("get_room", "SELECT * FROM rooms WHERE name=$1");
-                conn->prepare("get_room_by_owner", "SELECT * FROM rooms WHERE name=$1 AND owner_id=$2");
-                conn->prepare("get_public_room_by_name", "SELECT * FROM rooms WHERE name=$1 AND is_public=true");
-                conn->prepare("create_room", "INSERT INTO rooms(name, owner_id, is_public, pin_code, layout_json, editable, width, height, skew_angle, texture_path) " "VALUES ($1, $2, $3, NULLIF($4, ''), $5, $6, $7, $8, $9, $10) " "ON CONFLICT (name) DO NOTHING");
-                conn->prepare("insert_furniture", "INSERT INTO room_objects(room_id, name, sprite_path, x, y, rotation, scale, interactable) " "VALUES ($1, $2, $3, $4, $5, $6, $7, $8)");
-                conn->prepare("get_furniture_by_room", "SELECT * FROM room_objects WHERE room_id=$1");
-                conn->prepare("update_player_position", "INSERT INTO player_positions(user_id, room_id, x, y, direction) " "VALUES ($1, $2, $3, $4, $5) " "ON CONFLICT (user_id) DO UPDATE " "SET room_id=EXCLUDED.room_id, x=EXCLUDED.x, y=EXCLUDED.y, direction=EXCLUDED.direction, last_updated=NOW()");
-                conn->prepare("get_player_position", "SELECT * FROM player_positions WHERE user_id=$1");
+                // Every statement is prepared here, once per connection, so
+                // Postgres plans it once. The ones in kPipelinedStatements are
+                // also PREPAREd in SQL for the pipelines (see prepare()).
+                prepare("get_user", "SELECT id, password_hash FROM users WHERE username=$1");
+                prepare("create_user", "INSERT INTO users(username, email, password_hash, role) VALUES($1, $2, $3, $4)");
+                prepare("get_room", "SELECT * FROM rooms WHERE name=$1");
+                prepare("get_room_by_owner", "SELECT * FROM rooms WHERE name=$1 AND owner_id=$2");
+                prepare("get_public_room_by_name", "SELECT * FROM rooms WHERE name=$1 AND is_public=true");
+                prepare("create_room", "INSERT INTO rooms(name, owner_id, is_public, pin_code, layout_json, editable, width, height, skew_angle, texture_path) " "VALUES ($1, $2, $3, NULLIF($4, ''), $5, $6, $7, $8, $9, $10) " "ON CONFLICT (name) DO NOTHING");
+                prepare("insert_furniture", "INSERT INTO room_objects(room_id, name, sprite_path, x, y, rotation, scale, interactable) " "VALUES ($1, $2, $3, $4, $5, $6, $7, $8) RETURNING id");
+                prepare("update_furniture", "UPDATE room_objects SET x=$2, y=$3, rotation=$4 WHERE id=$1");
+                prepare("delete_furniture", "DELETE FROM room_objects WHERE id=$1 AND room_id=$2");
+                prepare("get_furniture_by_room", "SELECT * FROM room_objects WHERE room_id=$1");
+                prepare("update_player_position", "INSERT INTO player_positions(user_id, room_id, x, y, direction) " "VALUES ($1, $2, $3, $4, $5) " "ON CONFLICT (user_id) DO UPDATE " "SET room_id=EXCLUDED.room_id, x=EXCLUDED.x, y=EXCLUDED.y, direction=EXCLUDED.direction, last_updated=NOW()");
+                prepare("get_player_position", "SELECT * FROM player_positions WHERE user_id=$1");
+                prepare("get_recent_chat", "SELECT username, message FROM (" "SELECT id, username, message FROM room_chat WHERE room_id=$1 ORDER BY id DESC LIMIT $2" ") recent ORDER BY id");
+                prepare("update_room_player_counts", "UPDATE rooms r SET player_count = c.count " "FROM UNNEST($1::int[], $2::int[]) AS c(id, count) " "WHERE r.id = c.id AND r.player_count IS DISTINCT FROM c.count");
+                prepare("upsert_player_positions", "INSERT INTO player_positions(user_id, room_id, x, y, direction) " "SELECT DISTINCT ON (user_id) user_id, room_id, x, y, direction " "FROM UNNEST($1::int[], $2::int[], $3::real[], $4::real[], $5::text[]) WITH ORDINALITY AS t(user_id, room_id, x, y, direction, ord) " "ORDER BY user_id, ord DESC " "ON CONFLICT (user_id) DO UPDATE " "SET room_id=EXCLUDED.room_id, x=EXCLUDED.x, y=EXCLUDED.y, direction=EXCLUDED.direction, last_updated=NOW()");
+                prepare("email_registered", "SELECT 1 FROM users WHERE email=$1");
+                prepare("username_registered", "SELECT 1 FROM users WHERE username=$1");
+                prepare("login_roles", "SELECT r.name FROM roles r " "JOIN user_roles ur ON r.id = ur.role_id JOIN users u ON u.id = ur.user_id " "WHERE u.username=$1");
+                prepare("login_inventory", "SELECT i.item_name FROM inventory i JOIN users u ON u.id = i.user_id WHERE u.username=$1");
+                prepare("login_position", "SELECT p.* FROM player_positions p JOIN users u ON u.id = p.user_id WHERE u.username=$1");
+                prepare("get_user_roles", "SELECT r.name FROM roles r JOIN user_roles ur ON r.id = ur.role_id WHERE ur.user_id=$1");
+                prepare("get_user_inventory", "SELECT item_name FROM inventory WHERE user_id=$1");
+                prepare("get_room_layout", "SELECT layout_json FROM rooms WHERE id=$1");
+                prepare("update_room_layout", "UPDATE rooms SET layout_json=$2 WHERE id=$1");
+                prepare("get_room_metadata", "SELECT id, name, width, height, skew_angle, texture_path, editable FROM rooms WHERE id=$1");
+                prepare("get_rooms_by_players", "SELECT * FROM rooms ORDER BY player_count DESC");
+                prepare("reset_presence", "UPDATE rooms SET player_count = 0, players_connected = '[]'::jsonb " "WHERE player_count <> 0 OR players_connected <> '[]'::jsonb");
+                prepare("get_room_templates", "SELECT * FROM room_templates ORDER BY name ASC");
+                prepare("get_room_template", "SELECT * FROM room_templates WHERE id=$1");
+                prepare("clear_furniture", "DELETE FROM room_objects WHERE room_id=$1");
+                prepare("insert_chat_message", "INSERT INTO room_chat (room_id, username, message) VALUES ($1, $2, $3)");
+                prepare("insert_chat_messages", "INSERT INTO room_chat (room_id, username, message) " "SELECT room_id, username, message " "FROM UNNEST($1::int[], $2::text[], $3::text[]) WITH ORDINALITY AS t(room_id, username, message, ord) " "ORDER BY ord");
             }
         } catch (const exception &e) {
             cerr << "❌ DB connection failed: " << e.what() << endl;
@@ -85,7 +65,7 @@ public:
         }
     }
 
-    ~Database() {
+    ~Database() override {
         if (conn) {
             conn->disconnect();
             delete conn;
@@ -95,11 +75,11 @@ public:
     // ----------------------
     // User authentication
     // ----------------------
-    optional<int> authenticateUser(const string& username, const string& password) {
+    optional<int> authenticateUser(const string& username, const string& password) override {
+        QueryTimer timer("authenticateUser");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec_prepared("get_user", username);
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_user", username);
 
             if (R.size() != 1) return nullopt;
 
@@ -114,12 +94,45 @@ public:
         }
     }
 
+    // Pipelines the credential, role, inventory and position lookups: one
+    // round trip instead of four sequential queries. nullopt for unknown users.
+    optional<LoginRecord> loadLogin(const string& username) override {
+        QueryTimer timer("loadLogin");
+        try {
+            pqxx::nontransaction N(*conn);
+            pqxx::pipeline P(N);
+            auto credentials = P.insert(execute(N, "get_user", username));
+            auto roles = P.insert(execute(N, "login_roles", username));
+            auto items = P.insert(execute(N, "login_inventory", username));
+            auto position = P.insert(execute(N, "login_position", username));
+            P.complete();
+
+            pqxx::result R = P.retrieve(credentials);
+            if (R.size() != 1) return nullopt;
+            LoginRecord record;
+            record.userId = R[0]["id"].as<int>();
+            record.passwordHash = R[0]["password_hash"].c_str();
+            for (auto row : P.retrieve(roles)) record.roles.insert(row["name"].c_str());
+            for (auto row : P.retrieve(items)) record.inventory.push_back(row["item_name"].c_str());
+            pqxx::result pos = P.retrieve(position);
+            if (!pos.empty()) record.position = rowToPlayerPosition(pos[0]);
+            return record;
+        } catch (const exception &e) {
+            cerr << "DB error (loadLogin): " << e.what() << endl;
+            return nullopt;
+        }
+    }
+
     bool createUser(const string& username, const string& email, const string& password, string role = "user") {
+        return createUserWithHash(username, email, bcrypt::generateHash(password), role);
+    }
+
+    // For callers that hashed the password elsewhere (AuthPool)
+    bool createUserWithHash(const string& username, const string& email, const string& hashed, string role) override {
+        QueryTimer timer("createUserWithHash");
         try {
-            string hashed = bcrypt::generateHash(password);
-            pqxx::work W(*conn);
-            W.exec_prepared("create_user", username, email, hashed, role);
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("create_user", username, email, hashed, role);
             return true;
         } catch (const exception &e) {
             cerr << "DB error (createUser): " << e.what() << endl;
@@ -127,11 +140,11 @@ public:
         }
     }
 
-    bool isEmailRegistered(const string& email) {
+    bool isEmailRegistered(const string& email) override {
+        QueryTimer timer("isEmailRegistered");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec("SELECT 1 FROM users WHERE email=" + W.quote(email));
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("email_registered", email);
             return !R.empty();
         } catch (const exception &e) {
             cerr << "DB error (isEmailRegistered): " << e.what() << endl;
@@ -139,11 +152,11 @@ public:
         }
     }
 
-    bool isUsernameRegistered(const string& username) {
+    bool isUsernameRegistered(const string& username) override {
+        QueryTimer timer("isUsernameRegistered");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec("SELECT 1 FROM users WHERE username=" + W.quote(username));
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("username_registered", username);
             return !R.empty();
         } catch (const exception &e) {
             cerr << "DB error (isUsernameRegistered): " << e.what() << endl;
@@ -154,30 +167,24 @@ public:
     // ----------------------
     // Room management
     // ----------------------
-    int createRoom(const string& roomName, int ownerId, bool isPublic = true, const optional<string>& pinCode = nullopt, const string& layoutJson = "{}", bool editable = true, int width = 10, int height = 10, int skewAngle = 30, const string& texturePath = "") {
+    int createRoom(const string& roomName, int ownerId, bool isPublic, const optional<string>& pinCode, const string& layoutJson, bool editable, int width, int height, int skewAngle, const string& texturePath) override {
+        QueryTimer timer("createRoom");
         try {
-            pqxx::work W(*conn);
+            pqxx::nontransaction N(*conn);
             string pinValue = pinCode.has_value() ? pinCode.value() : "";
-            W.exec_prepared("create_room", roomName, ownerId, isPublic, pinValue, layoutJson, editable, width, height, skewAngle, texturePath);
-            W.commit();
+            N.exec_prepared("create_room", roomName, ownerId, isPublic, pinValue, layoutJson, editable, width, height, skewAngle, texturePath);
             return getRoomIdByOwner(roomName, ownerId, pinCode);
         } catch (const exception &e) {
             cerr << "DB error (createRoom): " << e.what() << endl;
             return -1;
         }
     }
-    int createRoomFromTemplate(int ownerId, int templateId, const string& roomName, const optional<string>& pinCode = nullopt) {
-        auto tplOpt = getRoomTemplateById(templateId);
-        if (!tplOpt.has_value()) return -1;
-        RoomTemplate tpl = tplOpt.value();
-        return createRoom(roomName, ownerId, true, pinCode, tpl.defaultLayoutJson, tpl.editable, tpl.width, tpl.height, tpl.skewAngle, tpl.texturePath);
-}
 
-    optional<string> getRoomLayout(int roomId) {
+    optional<string> getRoomLayout(int roomId) override {
+        QueryTimer timer("getRoomLayout");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec("SELECT layout_json FROM rooms WHERE id=" + to_string(roomId));
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_room_layout", roomId);
             if (!R.empty()) return R[0]["layout_json"].c_str();
             return nullopt;
         } catch (const exception &e) {
@@ -186,21 +193,21 @@ public:
         }
     }
 
-    void updateRoomLayout(int roomId, const string& layoutJson) {
+    void updateRoomLayout(int roomId, const string& layoutJson) override {
+        QueryTimer timer("updateRoomLayout");
         try {
-            pqxx::work W(*conn);
-            W.exec("UPDATE rooms SET layout_json=" + W.quote(layoutJson) + " WHERE id=" + to_string(roomId));
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("update_room_layout", roomId, layoutJson);
         } catch (const exception &e) {
             cerr << "DB error (updateRoomLayout): " << e.what() << endl;
         }
     }
 
-    int getRoomIdByOwner(const string& roomName, int ownerId, const optional<string>& pinCode = nullopt) {
+    int getRoomIdByOwner(const string& roomName, int ownerId, const optional<string>& pinCode) override {
+        QueryTimer timer("getRoomIdByOwner");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec_prepared("get_room_by_owner", roomName, ownerId);
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_room_by_owner", roomName, ownerId);
 
             if (R.size() != 1) return -1;
 
@@ -216,11 +223,11 @@ public:
         }
     }
 
-    int getPublicRoomIdByName(const string& roomName) {
+    int getPublicRoomIdByName(const string& roomName) override {
+        QueryTimer timer("getPublicRoomIdByName");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec_prepared("get_public_room_by_name", roomName);
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_public_room_by_name", roomName);
             if (R.size() == 1) return R[0]["id"].as<int>();
             return -1;
         } catch (const exception &e) {
@@ -229,22 +236,41 @@ public:
         }
     }
 
-    vector<RoomInfo> getAllRoomsOrderedByPlayers() {
+    // Full room row for the in-memory registry (pin is checked by the caller)
+    optional<RoomInfo> getPublicRoomByName(const string& roomName) override {
+        QueryTimer timer("getPublicRoomByName");
+        try {
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_public_room_by_name", roomName);
+            if (R.size() == 1) return rowToRoomInfo(R[0]);
+            return nullopt;
+        } catch (const exception &e) {
+            cerr << "DB error (getPublicRoomByName): " << e.what() << endl;
+            return nullopt;
+        }
+    }
+
+    optional<RoomInfo> getRoomByOwner(const string& roomName, int ownerId) override {
+        QueryTimer timer("getRoomByOwner");
+        try {
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_room_by_owner", roomName, ownerId);
+            if (R.size() == 1) return rowToRoomInfo(R[0]);
+            return nullopt;
+        } catch (const exception &e) {
+            cerr << "DB error (getRoomByOwner): " << e.what() << endl;
+            return nullopt;
+        }
+    }
+
+    vector<RoomInfo> getAllRoomsOrderedByPlayers() override {
         vector<RoomInfo> rooms;
+        QueryTimer timer("getAllRoomsOrderedByPlayers");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec("SELECT * FROM rooms ORDER BY player_count DESC");
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_rooms_by_players");
             for (auto row : R) {
-                RoomInfo r;
-                r.id = row["id"].as<int>();
-                r.name = row["name"].c_str();
-                r.ownerId = row["owner_id"].as<int>();
-                r.isPublic = row["is_public"].as<bool>();
-                r.pinCode = row["pin_code"].is_null() ? nullopt : optional<string>{row["pin_code"].c_str()};
-                r.playerCount = row["player_count"].as<int>();
-                r.layoutJson = row["layout_json"].c_str();
-                rooms.push_back(r);
+                rooms.push_back(rowToRoomInfo(row));
             }
         } catch (const exception &e) {
             cerr << "DB error (getAllRoomsOrderedByPlayers): " << e.what() << endl;
@@ -255,48 +281,26 @@ public:
 // ----------------------
 // Room Templates (Default Layouts)
 // ----------------------
-vector<RoomTemplate> getAllRoomTemplates() {
+vector<RoomTemplate> getAllRoomTemplates() override {
     vector<RoomTemplate> templates;
+    QueryTimer timer("getAllRoomTemplates");
     try {
-        pqxx::work W(*conn);
-        pqxx::result R = W.exec("SELECT * FROM room_templates ORDER BY name ASC");
-        W.commit();
-
-        for (auto row : R) {
-            RoomTemplate t;
-            t.id = row["id"].as<int>();
-            t.name = row["name"].c_str();
-            t.width = row["width"].as<float>();
-            t.height = row["height"].as<float>();
-            t.skewAngle = row["skew_angle"].as<float>();
-            t.texturePath = row["texture_path"].c_str();
-            t.defaultLayoutJson = row["default_layout_json"].c_str();
-            t.editable = row["editable"].as<bool>();
-            templates.push_back(t);
-        }
+        pqxx::nontransaction N(*conn);
+        pqxx::result R = N.exec_prepared("get_room_templates");
+        for (auto row : R) templates.push_back(rowToRoomTemplate(row));
     } catch (const exception &e) {
         cerr << "DB error (getAllRoomTemplates): " << e.what() << endl;
     }
     return templates;
 }
 
-optional<RoomTemplate> getRoomTemplateById(int templateId) {
+optional<RoomTemplate> getRoomTemplateById(int templateId) override {
+    QueryTimer timer("getRoomTemplateById");
     try {
-        pqxx::work W(*conn);
-        pqxx::result R = W.exec("SELECT * FROM room_templates WHERE id=" + W.quote(templateId));
-        W.commit();
+        pqxx::nontransaction N(*conn);
+        pqxx::result R = N.exec_prepared("get_room_template", templateId);
         if (R.empty()) return nullopt;
-
-        RoomTemplate t;
-        t.id = R[0]["id"].as<int>();
-        t.name = R[0]["name"].c_str();
-        t.width = R[0]["width"].as<float>();
-        t.height = R[0]["height"].as<float>();
-        t.skewAngle = R[0]["skew_angle"].as<float>();
-        t.texturePath = R[0]["texture_path"].c_str();
-        t.defaultLayoutJson = R[0]["default_layout_json"].c_str();
-        t.editable = R[0]["editable"].as<bool>();
-        return t;
+        return rowToRoomTemplate(R[0]);
     } catch (const exception &e) {
         cerr << "DB error (getRoomTemplateById): " << e.what() << endl;
         return nullopt;
@@ -305,48 +309,88 @@ optional<RoomTemplate> getRoomTemplateById(int templateId) {
     // ----------------------
     // Room Objects (Furniture)
     // ----------------------
-    vector<RoomObject> getRoomObjects(int roomId) {
+    // Like getRoomObjects, but tells "no furniture" apart from a failed query
+    optional<vector<RoomObject>> loadRoomObjects(int roomId) override {
         vector<RoomObject> objects;
+        QueryTimer timer("loadRoomObjects");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec_prepared("get_furniture_by_room", roomId);
-            W.commit();
-            for (auto row : R) {
-                RoomObject o;
-                o.id = row["id"].as<int>();
-                o.name = row["name"].c_str();
-                o.spritePath = row["sprite_path"].c_str();
-                o.x = row["x"].as<float>();
-                o.y = row["y"].as<float>();
-                o.rotation = row["rotation"].as<float>();
-                o.scale = row["scale"].as<float>();
-                o.interactable = row["interactable"].as<bool>();
-                objects.push_back(o);
-            }
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_furniture_by_room", roomId);
+            for (auto row : R) objects.push_back(rowToRoomObject(row));
         } catch (const exception &e) {
             cerr << "DB error (getRoomObjects): " << e.what() << endl;
+            return nullopt;
         }
         return objects;
     }
 
-    bool addRoomObject(int roomId, const string& name, const string& spritePath,
-                       float x, float y, float rotation = 0, float scale = 1.0, bool interactable = false) {
+    // Furniture and chat backlog pipelined: one round trip for a cold join
+    RoomLoad loadRoom(int roomId, int chatLimit) override {
+        QueryTimer timer("loadRoom");
+        RoomLoad load;
         try {
-            pqxx::work W(*conn);
-            W.exec_prepared("insert_furniture", roomId, name, spritePath, x, y, rotation, scale, interactable);
-            W.commit();
-            return true;
+            pqxx::nontransaction N(*conn);
+            pqxx::pipeline P(N);
+            auto furniture = P.insert(execute(N, "get_furniture_by_room", roomId));
+            auto chat = P.insert(execute(N, "get_recent_chat", roomId, chatLimit));
+            P.complete();
+
+            vector<RoomObject> objects;
+            for (auto row : P.retrieve(furniture)) objects.push_back(rowToRoomObject(row));
+            load.objects = std::move(objects);
+            vector<ChatLine> lines;
+            for (auto row : P.retrieve(chat)) lines.push_back(ChatLine{roomId, row["username"].c_str(), row["message"].c_str()});
+            load.chat = std::move(lines);
+        } catch (const exception &e) {
+            cerr << "DB error (loadRoom): " << e.what() << endl;
+        }
+        return load;
+    }
+
+    // Returns the new object's id, or -1 on failure
+    int addRoomObject(int roomId, const string& name, const string& spritePath,
+                      float x, float y, float rotation, float scale, bool interactable) override {
+        QueryTimer timer("addRoomObject");
+        try {
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("insert_furniture", roomId, name, spritePath, x, y, rotation, scale, interactable);
+            if (R.size() != 1) return -1;
+            return R[0]["id"].as<int>();
         } catch (const exception &e) {
             cerr << "DB error (addRoomObject): " << e.what() << endl;
+            return -1;
+        }
+    }
+
+    bool updateRoomObject(int objectId, float x, float y, float rotation) override {
+        QueryTimer timer("updateRoomObject");
+        try {
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("update_furniture", objectId, x, y, rotation);
+            return true;
+        } catch (const exception &e) {
+            cerr << "DB error (updateRoomObject): " << e.what() << endl;
+            return false;
+        }
+    }
+
+    bool removeRoomObject(int objectId, int roomId) override {
+        QueryTimer timer("removeRoomObject");
+        try {
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("delete_furniture", objectId, roomId);
+            return true;
+        } catch (const exception &e) {
+            cerr << "DB error (removeRoomObject): " << e.what() << endl;
             return false;
         }
     }
 
-    void clearRoomObjects(int roomId) {
+    void clearRoomObjects(int roomId) override {
+        QueryTimer timer("clearRoomObjects");
         try {
-            pqxx::work W(*conn);
-            W.exec("DELETE FROM room_objects WHERE room_id=" + W.quote(roomId));
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("clear_furniture", roomId);
         } catch (const exception &e) {
             cerr << "DB error (clearRoomObjects): " << e.what() << endl;
         }
@@ -354,13 +398,11 @@ optional<RoomTemplate> getRoomTemplateById(int templateId) {
     // ----------------------
     // Room Metadata
     // ----------------------
-    optional<RoomMetadata> getRoomMetadata(int roomId) {
+    optional<RoomMetadata> getRoomMetadata(int roomId) override {
+        QueryTimer timer("getRoomMetadata");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec(
-                "SELECT id, name, width, height, skew_angle, texture_path, editable FROM rooms WHERE id=" + W.quote(roomId)
-            );
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_room_metadata", roomId);
 
             if (R.empty()) return nullopt;
 
@@ -382,30 +424,37 @@ optional<RoomTemplate> getRoomTemplateById(int templateId) {
     // ----------------------
     // Player Position
     // ----------------------
-    void updatePlayerPosition(int userId, int roomId, float x, float y, const string& direction) {
+    void updatePlayerPosition(int userId, int roomId, float x, float y, const string& direction) override {
+        QueryTimer timer("updatePlayerPosition");
         try {
-            pqxx::work W(*conn);
-            W.exec_prepared("update_player_position", userId, roomId, x, y, direction);
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("update_player_position", userId, roomId, x, y, direction);
         } catch (const exception &e) {
             cerr << "DB error (updatePlayerPosition): " << e.what() << endl;
         }
     }
 
-    optional<PlayerPosition> getPlayerPosition(int userId) {
+    // Any number of rows in one statement: each column travels as an array and
+    // UNNEST zips them back into rows. The last row wins for a repeated user.
+    void upsertPlayerPositions(const PositionBatch& batch) override {
+        if (batch.empty()) return;
+        QueryTimer timer("upsertPlayerPositions");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec_prepared("get_player_position", userId);
-            W.commit();
-            if (R.empty()) return nullopt;
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("upsert_player_positions", arrayLiteral(batch.userIds), arrayLiteral(batch.roomIds),
+                            arrayLiteral(batch.xs), arrayLiteral(batch.ys), arrayLiteral(batch.directions));
+        } catch (const exception &e) {
+            cerr << "DB error (upsertPlayerPositions): " << e.what() << endl;
+        }
+    }
 
-            PlayerPosition pp;
-            pp.userId = R[0]["user_id"].as<int>();
-            pp.roomId = R[0]["room_id"].as<int>();
-            pp.x = R[0]["x"].as<float>();
-            pp.y = R[0]["y"].as<float>();
-            pp.direction = R[0]["direction"].c_str();
-            return pp;
+    optional<PlayerPosition> getPlayerPosition(int userId) override {
+        QueryTimer timer("getPlayerPosition");
+        try {
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_player_position", userId);
+            if (R.empty()) return nullopt;
+            return rowToPlayerPosition(R[0]);
         } catch (const exception &e) {
             cerr << "DB error (getPlayerPosition): " << e.what() << endl;
             return nullopt;
@@ -414,76 +463,43 @@ optional<RoomTemplate> getRoomTemplateById(int templateId) {
 
     // ----------------------
     // Player management
+    // Who is where lives in memory (PresenceRegistry); the database only
+    // gets periodic player_count snapshots for room listings.
     // ----------------------
-    void addPlayerToRoom(int userId, int roomId) {
-        try {
-            pqxx::work W(*conn);
-            string checkSql = "SELECT (players_connected @> to_jsonb(ARRAY[" + to_string(userId) + "]::int[])) AS exists "
-                              "FROM rooms WHERE id = " + to_string(roomId) + ";";
-            pqxx::result checkR = W.exec(checkSql);
-            bool already = !checkR.empty() && checkR[0]["exists"].as<bool>();
-
-            if (!already) {
-                string updateSql =
-                    "UPDATE rooms SET "
-                    "players_connected = players_connected || to_jsonb(ARRAY[" + to_string(userId) + "]::int[]), "
-                    "player_count = jsonb_array_length(players_connected || to_jsonb(ARRAY[" + to_string(userId) + "]::int[])) "
-                    "WHERE id = " + to_string(roomId) + ";";
-                W.exec(updateSql);
-            }
 
-            W.commit();
-        } catch (const exception &e) {
-            cerr << "DB error (addPlayerToRoom): " << e.what() << endl;
-        }
-    }
-
-    void removePlayerFromRoom(int userId, int roomId) {
+    // One statement for any number of rooms; unchanged rows are not rewritten
+    void updateRoomPlayerCounts(const vector<int>& roomIds, const vector<int>& counts) override {
+        if (roomIds.empty()) return;
+        QueryTimer timer("updateRoomPlayerCounts");
         try {
-            pqxx::work W(*conn);
-            string updateSql =
-                "UPDATE rooms SET "
-                "players_connected = (SELECT COALESCE(jsonb_agg(elem), '[]'::jsonb) "
-                "FROM jsonb_array_elements(players_connected) AS elems(elem) WHERE elem <> to_jsonb(" + to_string(userId) + ")), "
-                "player_count = (SELECT jsonb_array_length(COALESCE(jsonb_agg(elem), '[]'::jsonb)) "
-                "FROM jsonb_array_elements(players_connected) AS elems(elem) WHERE elem <> to_jsonb(" + to_string(userId) + ")) "
-                "WHERE id = " + to_string(roomId) + ";";
-            W.exec(updateSql);
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("update_room_player_counts", arrayLiteral(roomIds), arrayLiteral(counts));
         } catch (const exception &e) {
-            cerr << "DB error (removePlayerFromRoom): " << e.what() << endl;
+            cerr << "DB error (updateRoomPlayerCounts): " << e.what() << endl;
         }
     }
 
-    vector<int> getPlayersInRoom(int roomId) {
-        vector<int> users;
+    // At startup nobody is connected yet, whatever a previous run left behind
+    void resetPresence() override {
+        QueryTimer timer("resetPresence");
         try {
-            pqxx::work W(*conn);
-            string q = "SELECT jsonb_array_elements_text(players_connected) AS uid FROM rooms WHERE id = " + to_string(roomId) + ";";
-            pqxx::result R = W.exec(q);
-            W.commit();
-            for (auto row : R) {
-                try { users.push_back(stoi(row["uid"].c_str())); } catch (...) {}
-            }
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("reset_presence");
+            if (R.affected_rows() > 0) cout << "🧹 Cleared stale presence in " << R.affected_rows() << " room(s)" << endl;
         } catch (const exception &e) {
-            cerr << "DB error (getPlayersInRoom): " << e.what() << endl;
+            cerr << "DB error (resetPresence): " << e.what() << endl;
         }
-        return users;
     }
 
     // ----------------------
     // Roles & Inventory
     // ----------------------
-    unordered_set<string> getUserRoles(int userId) {
+    unordered_set<string> getUserRoles(int userId) override {
         unordered_set<string> roles;
+        QueryTimer timer("getUserRoles");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec(
-                "SELECT r.name FROM roles r "
-                "JOIN user_roles ur ON r.id = ur.role_id "
-                "WHERE ur.user_id=" + W.quote(userId) + ";"
-            );
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_user_roles", userId);
 
             for (auto row : R) roles.insert(row["name"].c_str());
         } catch (const exception &e) {
@@ -492,14 +508,12 @@ optional<RoomTemplate> getRoomTemplateById(int templateId) {
         return roles;
     }
 
-    vector<string> getUserInventory(int userId) {
+    vector<string> getUserInventory(int userId) override {
         vector<string> items;
+        QueryTimer timer("getUserInventory");
         try {
-            pqxx::work W(*conn);
-            pqxx::result R = W.exec(
-                "SELECT item_name FROM inventory WHERE user_id=" + W.quote(userId) + ";"
-            );
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_user_inventory", userId);
 
             for (auto row : R) items.push_back(row["item_name"].c_str());
         } catch (const exception &e) {
@@ -511,22 +525,163 @@ optional<RoomTemplate> getRoomTemplateById(int templateId) {
     // ----------------------
     // Chat messages
     // ----------------------
-    void insertChatMessage(int room_id, const std::string& username, const std::string& message) {
+    void insertChatMessage(int room_id, const std::string& username, const std::string& message) override {
+        QueryTimer timer("insertChatMessage");
         try {
-            pqxx::work W(*conn);
-            W.exec_params(
-                "INSERT INTO room_chat (room_id, username, message) VALUES ($1, $2, $3);",
-                room_id, username, message
-            );
-            W.commit();
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("insert_chat_message", room_id, username, message);
         } catch (const exception &e) {
             cerr << "DB error (insertChatMessage): " << e.what() << endl;
         }
     }
 
+    // The room's last `limit` lines, oldest first
+    optional<vector<ChatLine>> getRecentChat(int roomId, int limit) override {
+        QueryTimer timer("getRecentChat");
+        try {
+            pqxx::nontransaction N(*conn);
+            pqxx::result R = N.exec_prepared("get_recent_chat", roomId, limit);
+            vector<ChatLine> lines;
+            lines.reserve(R.size());
+            for (auto row : R) lines.push_back(ChatLine{roomId, row["username"].c_str(), row["message"].c_str()});
+            return lines;
+        } catch (const exception &e) {
+            cerr << "DB error (getRecentChat): " << e.what() << endl;
+            return nullopt;
+        }
+    }
 
-
+    // Group commit: the whole batch is one statement, so it lands all or nothing.
+    // Columns travel as arrays like upsertPlayerPositions; ORDER BY ord keeps
+    // the ids in the order the lines were said.
+    bool insertChatMessages(const vector<ChatLine>& lines) override {
+        if (lines.empty()) return true;
+        QueryTimer timer("insertChatMessages");
+        try {
+            vector<int> roomIds;
+            vector<string> usernames, messages;
+            roomIds.reserve(lines.size());
+            usernames.reserve(lines.size());
+            messages.reserve(lines.size());
+            for (const ChatLine& line : lines) {
+                roomIds.push_back(line.roomId);
+                usernames.push_back(line.username);
+                messages.push_back(line.message);
+            }
+            pqxx::nontransaction N(*conn);
+            N.exec_prepared("insert_chat_messages", arrayLiteral(roomIds), arrayLiteral(usernames), arrayLiteral(messages));
+            return true;
+        } catch (const exception &e) {
+            cerr << "DB error (insertChatMessages): " << e.what() << endl;
+            return false;
+        }
+    }
 
 private:
+    // Statements run through execute(); PREPAREd in SQL as pipelined_<name>
+    static constexpr const char* kPipelinedStatements[] = {
+        "get_user", "login_roles", "login_inventory", "login_position", "get_furniture_by_room", "get_recent_chat",
+    };
+
+    // Registers the statement with libpqxx for exec_prepared. Older libpqxx
+    // only sends that PREPARE on the first exec_prepared, so a pipelined
+    // EXECUTE could reach the server first; the pipelines get their own copy,
+    // PREPAREd here as SQL before any request runs.
+    void prepare(const char* name, const char* sql) {
+        conn->prepare(name, sql);
+        for (const char* pipelined : kPipelinedStatements) {
+            if (string_view(pipelined) != name) continue;
+            pqxx::nontransaction N(*conn);
+            N.exec(string("PREPARE pipelined_") + name + " AS " + sql);
+            return;
+        }
+    }
+
+    // EXECUTE of a prepared statement as SQL text. pqxx::pipeline only queues
+    // query strings; this keeps pipelined lookups on the prepared plans.
+    // `statement` must be listed in kPipelinedStatements.
+    template <typename... Args>
+    static string execute(pqxx::transaction_base& T, const char* statement, const Args&... args) {
+        string sql = "EXECUTE pipelined_";
+        sql += statement;
+        if constexpr (sizeof...(Args) > 0) {
+            const char* separator = "(";
+            ((sql += separator, sql += T.quote(args), separator = ","), ...);
+            sql += ')';
+        }
+        return sql;
+    }
+
+    // Postgres array literal, e.g. {1,2,3} or {"n","se"}
+    template <typename T>
+    static string arrayLiteral(const vector<T>& values) {
+        string out = "{";
+        for (size_t i = 0; i < values.size(); i++) {
+            if (i) out += ',';
+            if constexpr (is_same_v<T, string>) {
+                out += '"';
+                for (char c : values[i]) {
+                    if (c == '"' || c == '\\') out += '\\';
+                    out += c;
+                }
+                out += '"';
+            } else {
+                out += to_string(values[i]);
+            }
+        }
+        out += '}';
+        return out;
+    }
+
+    static PlayerPosition rowToPlayerPosition(const pqxx::row& row) {
+        PlayerPosition pp;
+        pp.userId = row["user_id"].as<int>();
+        pp.roomId = row["room_id"].as<int>();
+        pp.x = row["x"].as<float>();
+        pp.y = row["y"].as<float>();
+        pp.direction = row["direction"].c_str();
+        return pp;
+    }
+
+    static RoomObject rowToRoomObject(const pqxx::row& row) {
+        RoomObject o;
+        o.id = row["id"].as<int>();
+        o.name = row["name"].c_str();
+        o.spritePath = row["sprite_path"].c_str();
+        o.x = row["x"].as<float>();
+        o.y = row["y"].as<float>();
+        o.rotation = row["rotation"].as<float>();
+        o.scale = row["scale"].as<float>();
+        o.interactable = row["interactable"].as<bool>();
+        return o;
+    }
+
+    static RoomTemplate rowToRoomTemplate(const pqxx::row& row) {
+        RoomTemplate t;
+        t.id = row["id"].as<int>();
+        t.name = row["name"].c_str();
+        t.width = row["width"].as<float>();
+        t.height = row["height"].as<float>();
+        t.skewAngle = row["skew_angle"].as<float>();
+        t.texturePath = row["texture_path"].c_str();
+        t.defaultLayoutJson = row["default_layout_json"].c_str();
+        t.editable = row["editable"].as<bool>();
+        return t;
+    }
+
+    static RoomInfo rowToRoomInfo(const pqxx::row& row) {
+        RoomInfo r;
+        r.id = row["id"].as<int>();
+        r.name = row["name"].c_str();
+        r.ownerId = row["owner_id"].is_null() ? -1 : row["owner_id"].as<int>();
+        r.isPublic = row["is_public"].as<bool>();
+        r.pinCode = row["pin_code"].is_null() ? nullopt : optional<string>{row["pin_code"].c_str()};
+        r.playerCount = row["player_count"].as<int>();
+        r.layoutJson = row["layout_json"].c_str();
+        r.width = row["width"].is_null() ? 10 : (int)row["width"].as<double>();
+        r.height = row["height"].is_null() ? 10 : (int)row["height"].as<double>();
+        return r;
+    }
+
     pqxx::connection* conn;
 };
@@ -0,0 +1,65 @@
+#include "DatabasePool.hpp"
+#include <iostream>
+
+DatabasePool::DatabasePool(const StorageFactory& openStorage, size_t workerCount, size_t queueCapacity)
+    : jobs("DB pool", queueCapacity, WorkerQueue::OnStop::Drain) {
+    if (workerCount == 0) workerCount = 1;
+    // Connect up front so a bad connection string fails at startup, not on first use
+    for (size_t i = 0; i < workerCount; i++) {
+        connections.push_back(openStorage());
+    }
+    jobs.start(workerCount);
+    std::cout << "✅ Database pool started with " << workerCount << " workers" << std::endl;
+}
+
+DatabasePool::~DatabasePool() {
+    stop();
+}
+
+void DatabasePool::stop() {
+    jobs.stop();
+}
+
+bool DatabasePool::enqueueInOrder(std::function<void(Storage&)> fn) {
+    std::lock_guard<std::mutex> lk(orderedMutex);
+    if (ordered.size() >= jobs.capacity()) {
+        orderedRejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ordered.push_back(std::move(fn));
+    if (draining) return true;
+    // Nothing in flight, so `ordered` held only this job
+    if (!enqueue([this](Storage& db) { drainInOrder(db); })) {
+        ordered.pop_back();
+        return false;
+    }
+    draining = true;
+    return true;
+}
+
+void DatabasePool::drainInOrder(Storage& db) {
+    for (;;) {
+        std::function<void(Storage&)> fn;
+        {
+            std::lock_guard<std::mutex> lk(orderedMutex);
+            if (ordered.empty()) {
+                draining = false;
+                return;
+            }
+            fn = std::move(ordered.front());
+            ordered.pop_front();
+        }
+        // One failed job must not stall the ones behind it
+        try {
+            fn(db);
+        } catch (const std::exception& e) {
+            std::cerr << "❌ DB pool job failed: " << e.what() << std::endl;
+        }
+    }
+}
+
+DatabasePoolStats DatabasePool::stats() const {
+    DatabasePoolStats s = jobs.stats();
+    s.rejected += orderedRejected.load(std::memory_order_relaxed);
+    return s;
+}
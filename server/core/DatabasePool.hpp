@@ -0,0 +1,91 @@
+#pragma once
+#include <uWebSockets/App.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include "Storage.hpp"
+#include "WorkerQueue.hpp"
+
+// ---------- Pool Stats ----------
+using DatabasePoolStats = WorkerQueueStats;
+
+// ---------- Async Database Pool ----------
+// N worker threads, each with the Storage the factory hands it (for
+// Postgres its own connection with the prepared statements; the embedded
+// store is shared). Jobs go through a WorkerQueue; results are handed back
+// to the event loop that submitted them via uWS::Loop::defer, so handlers
+// never block on storage. Queued jobs still run at stop(), so writes land.
+class DatabasePool {
+public:
+    DatabasePool(const StorageFactory& openStorage, size_t workerCount = 4, size_t queueCapacity = 4096);
+    ~DatabasePool();
+
+    DatabasePool(const DatabasePool&) = delete;
+    DatabasePool& operator=(const DatabasePool&) = delete;
+
+    // Runs `work(Storage&)` on a worker, then `done(result)` on the
+    // calling thread's uWS loop. Returns false if the queue is full.
+    template <typename Work, typename Done>
+    bool submit(Work work, Done done) {
+        return enqueue(deferDone(std::move(work), std::move(done)));
+    }
+
+    // Fire-and-forget write; nothing is posted back to the loop.
+    template <typename Work>
+    bool submit(Work work) {
+        return enqueue([work = std::move(work)](Storage& db) mutable { work(db); });
+    }
+
+    // Like submit, but in-order jobs run one at a time, in the order they
+    // were submitted from any thread. For rows rewritten over and over
+    // (player_positions, room counts), where a later write must land last,
+    // and for reads that have to see those writes.
+    template <typename Work, typename Done>
+    bool submitInOrder(Work work, Done done) {
+        return enqueueInOrder(deferDone(std::move(work), std::move(done)));
+    }
+
+    template <typename Work>
+    bool submitInOrder(Work work) {
+        return enqueueInOrder([work = std::move(work)](Storage& db) mutable { work(db); });
+    }
+
+    DatabasePoolStats stats() const;
+    void stop();
+
+private:
+    // Runs work on the worker, then posts done(result) to the calling thread's loop
+    template <typename Work, typename Done>
+    static std::function<void(Storage&)> deferDone(Work work, Done done) {
+        uWS::Loop* loop = uWS::Loop::get();
+        using Result = std::invoke_result_t<Work&, Storage&>;
+        return [loop, work = std::move(work), done = std::move(done)](Storage& db) mutable {
+            if constexpr (std::is_void_v<Result>) {
+                work(db);
+                loop->defer([done]() mutable { done(); });
+            } else {
+                Result result = work(db);
+                loop->defer([done, result = std::move(result)]() mutable { done(std::move(result)); });
+            }
+        };
+    }
+
+    template <typename Fn>
+    bool enqueue(Fn fn) {
+        return jobs.push([this, fn = std::move(fn)](size_t worker) mutable { fn(*connections[worker]); });
+    }
+    // In-order jobs wait in `ordered`; one queued job at a time drains them
+    bool enqueueInOrder(std::function<void(Storage&)> fn);
+    void drainInOrder(Storage& db);
+
+    std::vector<std::shared_ptr<Storage>> connections;
+    WorkerQueue jobs;
+
+    std::mutex orderedMutex;
+    std::deque<std::function<void(Storage&)>> ordered;
+    bool draining = false;      // a drainInOrder job is queued or running
+    std::atomic<uint64_t> orderedRejected{0};
+};
@@ -0,0 +1,104 @@
+#include "JsonWriter.hpp"
+#include <cassert>
+#include <memory>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// ----------------------
+// Per-thread buffer stack
+// ----------------------
+namespace {
+
+// Buffers that grew past this (a huge ROOM_STATE) are released rather than
+// pinned per thread forever.
+constexpr size_t kMaxRetainedCapacity = 1 << 20;
+
+struct BufferStack {
+    std::vector<std::unique_ptr<std::string>> buffers;
+    size_t inUse = 0;
+};
+
+thread_local BufferStack bufferStack;
+
+} // namespace
+
+JsonWriter::JsonWriter() {
+    BufferStack& stack = bufferStack;
+    if (stack.inUse == stack.buffers.size()) {
+        stack.buffers.push_back(std::make_unique<std::string>());
+        stack.buffers.back()->reserve(4096);
+    }
+    buf = stack.buffers[stack.inUse++].get();
+    buf->clear();
+}
+
+JsonWriter::~JsonWriter() {
+    BufferStack& stack = bufferStack;
+    assert(stack.inUse > 0 && stack.buffers[stack.inUse - 1].get() == buf);
+    if (buf->capacity() > kMaxRetainedCapacity) std::string().swap(*buf);
+    stack.inUse--;
+}
+
+// ----------------------
+// String escaping
+// ----------------------
+static const char kHex[] = "0123456789abcdef";
+
+static void appendEscapedChar(std::string& out, unsigned char c) {
+    switch (c) {
+        case '"': out.append("\\\"", 2); return;
+        case '\\': out.append("\\\\", 2); return;
+        case '\b': out.append("\\b", 2); return;
+        case '\f': out.append("\\f", 2); return;
+        case '\n': out.append("\\n", 2); return;
+        case '\r': out.append("\\r", 2); return;
+        case '\t': out.append("\\t", 2); return;
+        default: {
+            char esc[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+            out.append(esc, 6);
+            return;
+        }
+    }
+}
+
+static inline bool needsEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+void appendJsonEscaped(std::string& out, std::string_view s) {
+    const char* p = s.data();
+    const char* end = p + s.size();
+    const char* run = p; // start of the pending clean run
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i controlMax = _mm_set1_epi8(0x1F);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // c <= 0x1F (unsigned) <=> max(c, 0x1F) == 0x1F
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, controlMax), controlMax));
+        int mask = _mm_movemask_epi8(special);
+        if (mask == 0) {
+            p += 16;
+            continue;
+        }
+        const char* hit = p + __builtin_ctz((unsigned)mask);
+        out.append(run, hit - run);
+        appendEscapedChar(out, (unsigned char)*hit);
+        p = run = hit + 1;
+    }
+#endif
+
+    for (; p < end; p++) {
+        if (!needsEscape((unsigned char)*p)) continue;
+        out.append(run, p - run);
+        appendEscapedChar(out, (unsigned char)*p);
+        run = p + 1;
+    }
+    out.append(run, end - run);
+}
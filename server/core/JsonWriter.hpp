@@ -0,0 +1,128 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Appends s to out with JSON string escaping (no surrounding quotes).
+// Clean runs are copied 16 bytes at a time on SSE2 targets.
+void appendJsonEscaped(std::string& out, std::string_view s);
+
+// ---------- Streaming JSON Writer ----------
+// Writes compact JSON into a per-thread buffer that keeps its capacity
+// between messages, so building a response does not allocate once the
+// buffer has warmed up. Writers nest (each takes the next free buffer), but
+// must be destroyed in reverse order, which stack scoping guarantees.
+// Commas are inserted automatically between keys and values.
+//
+//   JsonWriter w;
+//   w.beginObject().field("type", "ROOM_STATE").field("version", v);
+//   w.key("furniture").raw(cachedJson).endObject();
+//   ws->send(w.view(), opCode);
+//
+// view() is only valid while the writer is alive; use str() to keep a copy.
+class JsonWriter {
+public:
+    JsonWriter();
+    ~JsonWriter();
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& beginObject() { separate(); buf->push_back('{'); return *this; }
+    JsonWriter& endObject() { buf->push_back('}'); return *this; }
+    JsonWriter& beginArray() { separate(); buf->push_back('['); return *this; }
+    JsonWriter& endArray() { buf->push_back(']'); return *this; }
+
+    JsonWriter& key(std::string_view name) {
+        separate();
+        buf->push_back('"');
+        appendJsonEscaped(*buf, name);
+        buf->append("\":", 2);
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view s) {
+        separate();
+        buf->push_back('"');
+        appendJsonEscaped(*buf, s);
+        buf->push_back('"');
+        return *this;
+    }
+    JsonWriter& value(const char* s) { return value(std::string_view(s)); }
+    JsonWriter& value(const std::string& s) { return value(std::string_view(s)); }
+    JsonWriter& value(bool b) {
+        separate();
+        if (b) buf->append("true", 4);
+        else buf->append("false", 5);
+        return *this;
+    }
+    JsonWriter& value(float f) { return number(f); }
+    JsonWriter& value(double d) { return number(d); }
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    JsonWriter& value(T v) { return number(v); }
+
+    JsonWriter& null() {
+        separate();
+        buf->append("null", 4);
+        return *this;
+    }
+
+    // Already-serialized JSON value (cached snapshots, delta payloads)
+    JsonWriter& raw(std::string_view json) {
+        separate();
+        buf->append(json.data(), json.size());
+        return *this;
+    }
+
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& v) {
+        key(name);
+        return value(v);
+    }
+
+    // reqId is echoed back only when the client sent one
+    JsonWriter& optionalField(std::string_view name, std::string_view v) {
+        if (!v.empty()) field(name, v);
+        return *this;
+    }
+
+    std::string_view view() const { return *buf; }
+    std::string str() const { return *buf; }
+    size_t size() const { return buf->size(); }
+
+private:
+    // A comma is needed unless this is the first token or the previous one
+    // opened a container or ended a key.
+    void separate() {
+        if (buf->empty()) return;
+        char last = buf->back();
+        if (last != '{' && last != '[' && last != ':') buf->push_back(',');
+    }
+
+    template <typename T>
+    JsonWriter& number(T v) {
+        separate();
+        if constexpr (std::is_floating_point_v<T>) {
+            if (v != v || v - v != 0) { // NaN / infinity
+                buf->append("null", 4);
+                return *this;
+            }
+            // Tile coordinates, rotations and scales are usually whole numbers;
+            // integer formatting is much cheaper than shortest round-trip.
+            if (v > -1e15 && v < 1e15 && v == (T)(int64_t)v) {
+                char tmp[24];
+                auto res = std::to_chars(tmp, tmp + sizeof(tmp), (int64_t)v);
+                buf->append(tmp, res.ptr - tmp);
+                return *this;
+            }
+        }
+        char tmp[32];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        buf->append(tmp, res.ptr - tmp);
+        return *this;
+    }
+
+    std::string* buf;
+};
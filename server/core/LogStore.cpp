@@ -0,0 +1,1106 @@
+#include "LogStore.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include "Metrics.hpp"
+#include "Utils.hpp"
+#include "bcrypt.h"
+
+namespace fs = std::filesystem;
+
+// ----------------------
+// Record format
+// Log and snapshot files are a 16-byte header (8-byte magic, u64 sequence)
+// followed by frames: u32 payload size, u32 CRC-32 of the payload, payload.
+// A payload is one Op byte and its fields: zigzag varints for ints, varints
+// for counts, little-endian IEEE floats and length-prefixed strings.
+// ----------------------
+namespace {
+
+enum class Op : uint8_t {
+    PutUser = 1,          // id, username, email, hash, n roles, m items
+    PutRoom = 2,          // id, name, owner, flags, [pin], players, layout, width, height, skew, texture
+    SetRoomLayout = 3,    // id, layout
+    SetPlayerCounts = 4,  // n x (room, count)
+    PutTemplate = 5,      // id, name, width, height, skew, texture, layout, editable
+    PutObject = 6,        // room, id, name, sprite, x, y, rotation, scale, interactable
+    MoveObject = 7,       // id, x, y, rotation
+    RemoveObject = 8,     // id, room
+    ClearObjects = 9,     // room
+    PutPositions = 10,    // n x (user, room, x, y, direction)
+    AppendChat = 11,      // n x (room, username, message)
+    SetCounters = 12,     // next user, room and object ids (snapshots only)
+};
+
+constexpr uint8_t kRoomPublic = 0x01;
+constexpr uint8_t kRoomHasPin = 0x02;
+constexpr uint8_t kRoomEditable = 0x04;
+
+constexpr char kWalMagic[] = "HBLSWAL1";
+constexpr char kSnapshotMagic[] = "HBLSSNP1";
+constexpr size_t kHeaderBytes = 16;
+constexpr size_t kFrameBytes = 8;
+constexpr uint32_t kMaxRecordBytes = 64u << 20;
+constexpr size_t kRowsPerRecord = 4096;   // snapshot batching for positions and chat
+
+uint32_t crc32(std::string_view data) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xffffffffu;
+    for (unsigned char b : data) c = table[(c ^ b) & 0xff] ^ (c >> 8);
+    return c ^ 0xffffffffu;
+}
+
+void putU32(char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (char)(v >> (8 * i));
+}
+
+uint32_t getU32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)(uint8_t)p[i] << (8 * i);
+    return v;
+}
+
+std::string fileHeader(const char* magic, uint64_t sequence) {
+    std::string header(magic, 8);
+    for (int i = 0; i < 8; i++) header += (char)(sequence >> (8 * i));
+    return header;
+}
+
+// Starts a frame in `out` (header left blank until frame())
+class RecordWriter {
+public:
+    RecordWriter(std::string& out, Op op) : out(out) {
+        out.assign(kFrameBytes, '\0');
+        u8((uint8_t)op);
+    }
+
+    RecordWriter& u8(uint8_t v) {
+        out.push_back((char)v);
+        return *this;
+    }
+
+    RecordWriter& count(uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((char)v);
+        return *this;
+    }
+
+    RecordWriter& i32(int v) { return count(((uint64_t)(int64_t)v << 1) ^ (uint64_t)((int64_t)v >> 63)); }
+
+    RecordWriter& f32(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, 4);
+        char b[4];
+        putU32(b, bits);
+        out.append(b, 4);
+        return *this;
+    }
+
+    RecordWriter& str(std::string_view s) {
+        count(s.size());
+        out.append(s.data(), s.size());
+        return *this;
+    }
+
+    RecordWriter& boolean(bool b) { return u8(b ? 1 : 0); }
+
+private:
+    std::string& out;
+};
+
+// Fills in the size and checksum of a frame started by RecordWriter
+void frame(std::string& record) {
+    std::string_view payload(record.data() + kFrameBytes, record.size() - kFrameBytes);
+    putU32(&record[0], (uint32_t)payload.size());
+    putU32(&record[4], crc32(payload));
+}
+
+// Reads never run past the end; a short or malformed record flips ok()
+class RecordReader {
+public:
+    explicit RecordReader(std::string_view in) : p(in.data()), end(in.data() + in.size()) {}
+
+    bool ok() const { return !failed; }
+    bool done() const { return !failed && p == end; }
+
+    uint8_t u8() {
+        if (p >= end) return fail(), 0;
+        return (uint8_t)*p++;
+    }
+
+    uint64_t count() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) return fail(), 0;
+            uint8_t b = (uint8_t)*p++;
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        return fail(), 0;
+    }
+
+    int i32() {
+        uint64_t v = count();
+        return (int)(int64_t)((v >> 1) ^ (~(v & 1) + 1));
+    }
+
+    float f32() {
+        if (end - p < 4) return fail(), 0.0f;
+        uint32_t bits = getU32(p);
+        p += 4;
+        float v;
+        std::memcpy(&v, &bits, 4);
+        return v;
+    }
+
+    std::string str() {
+        uint64_t size = count();
+        if (failed || size > (uint64_t)(end - p)) return fail(), std::string();
+        std::string s(p, (size_t)size);
+        p += size;
+        return s;
+    }
+
+    bool boolean() { return u8() != 0; }
+
+    // Guards element counts against a record that is too short to hold them
+    uint64_t elements(size_t minBytesEach) {
+        uint64_t n = count();
+        if (n > (uint64_t)(end - p) / std::max<size_t>(minBytesEach, 1)) return fail(), 0;
+        return n;
+    }
+
+private:
+    void fail() { failed = true; }
+
+    const char* p;
+    const char* end;
+    bool failed = false;
+};
+
+bool writeAll(int fd, std::string_view bytes) {
+    while (!bytes.empty()) {
+        ssize_t n = ::write(fd, bytes.data(), bytes.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes.remove_prefix((size_t)n);
+    }
+    return true;
+}
+
+// Makes a rename or a new file in `directory` durable
+void syncDirectory(const std::string& directory) {
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+}
+
+// wal-<n>.log -> n, or 0 for anything else
+uint64_t walSequenceOf(const std::string& fileName) {
+    unsigned long long sequence = 0;
+    char tail = 0;
+    if (std::sscanf(fileName.c_str(), "wal-%llu.lo%c", &sequence, &tail) != 2 || tail != 'g') return 0;
+    return fileName == "wal-" + std::to_string(sequence) + ".log" ? sequence : 0;
+}
+
+}   // namespace
+
+// ----------------------
+// Lifecycle
+// ----------------------
+LogStore::LogStore(const std::string& directory, uint64_t compactBytes, int syncIntervalMs)
+    : directory(directory), compactBytes(compactBytes), syncIntervalMs(std::max(syncIntervalMs, 1)) {
+    open();
+    background = std::thread([this] { backgroundLoop(); });
+}
+
+LogStore::~LogStore() {
+    close();
+}
+
+void LogStore::close() {
+    {
+        std::lock_guard<std::mutex> lk(stopMutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    stopCv.notify_one();
+    if (background.joinable()) background.join();
+
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    if (walFd >= 0) {
+        ::fdatasync(walFd);
+        ::close(walFd);
+        walFd = -1;
+    }
+}
+
+std::string LogStore::walPath(uint64_t sequence) const {
+    return directory + "/wal-" + std::to_string(sequence) + ".log";
+}
+
+std::string LogStore::snapshotPath() const {
+    return directory + "/snapshot.bin";
+}
+
+void LogStore::open() {
+    uint64_t start = steadyNowNs();
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec) {
+        std::cerr << "❌ Store open failed: " << directory << ": " << ec.message() << std::endl;
+        exit(1);
+    }
+
+    uint64_t firstWal = 1;
+    uint64_t replayed = 0;
+    if (fs::exists(snapshotPath())) {
+        ReplayResult snapshot = replay(snapshotPath(), kSnapshotMagic);
+        if (!snapshot.readable || snapshot.validBytes != snapshot.fileBytes) {
+            std::cerr << "❌ Store open failed: " << snapshotPath() << " is damaged" << std::endl;
+            exit(1);
+        }
+        firstWal = std::max<uint64_t>(snapshot.header, 1);
+        replayed += snapshot.records;
+    }
+
+    // Logs the snapshot already covers are left over from a compaction that
+    // stopped before deleting them
+    std::vector<uint64_t> sequences;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        uint64_t sequence = walSequenceOf(entry.path().filename().string());
+        if (sequence == 0) continue;
+        if (sequence < firstWal) fs::remove(entry.path(), ec);
+        else sequences.push_back(sequence);
+    }
+    std::sort(sequences.begin(), sequences.end());
+
+    uint64_t current = firstWal;
+    for (uint64_t sequence : sequences) {
+        std::string path = walPath(sequence);
+        ReplayResult log = replay(path, kWalMagic);
+        if (!log.readable && log.fileBytes >= kHeaderBytes) {
+            std::cerr << "❌ Store open failed: " << path << " is not a log file" << std::endl;
+            exit(1);
+        }
+        replayed += log.records;
+        if (log.validBytes < log.fileBytes) {
+            // A crash mid-append leaves a partial frame; nothing after it was acknowledged
+            std::cerr << "⚠️ Store: dropping " << (log.fileBytes - log.validBytes) << " torn byte(s) at the end of "
+                      << path << std::endl;
+            if (::truncate(path.c_str(), (off_t)log.validBytes) != 0) {
+                std::cerr << "❌ Store open failed: cannot truncate " << path << ": " << std::strerror(errno) << std::endl;
+                exit(1);
+            }
+        }
+        current = sequence;
+    }
+
+    if (!openWal(current)) exit(1);
+    if (users.empty() && rooms.empty() && templates.empty()) seedDefaults();
+
+    size_t objectCount = objectRoom.size();
+    std::cout << "✅ Opened embedded store " << directory << ": " << rooms.size() << " rooms, " << objectCount
+              << " room objects, " << users.size() << " users (" << replayed << " records in "
+              << (steadyNowNs() - start) / 1000000 << " ms)" << std::endl;
+}
+
+LogStore::ReplayResult LogStore::replay(const std::string& path, const char* magic) {
+    ReplayResult result;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return result;
+    std::string bytes;
+    char buffer[1 << 16];
+    for (;;) {
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        bytes.append(buffer, (size_t)n);
+    }
+    ::close(fd);
+
+    result.fileBytes = bytes.size();
+    if (bytes.size() < kHeaderBytes || bytes.compare(0, 8, magic, 8) != 0) return result;
+    result.readable = true;
+    for (int i = 0; i < 8; i++) result.header |= (uint64_t)(uint8_t)bytes[8 + i] << (8 * i);
+
+    size_t offset = kHeaderBytes;
+    while (bytes.size() - offset >= kFrameBytes) {
+        uint32_t size = getU32(bytes.data() + offset);
+        uint32_t checksum = getU32(bytes.data() + offset + 4);
+        if (size > kMaxRecordBytes || bytes.size() - offset - kFrameBytes < size) break;
+        std::string_view payload(bytes.data() + offset + kFrameBytes, size);
+        if (crc32(payload) != checksum || !apply(payload)) break;
+        offset += kFrameBytes + size;
+        result.records++;
+    }
+    result.validBytes = offset;
+    return result;
+}
+
+bool LogStore::openWal(uint64_t sequence) {
+    std::string path = walPath(sequence);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    struct stat info{};
+    if (fd < 0 || ::fstat(fd, &info) != 0) {
+        std::cerr << "Store error (openWal): " << path << ": " << std::strerror(errno) << std::endl;
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    uint64_t size = (uint64_t)info.st_size;
+    if (size < kHeaderBytes) {
+        // New, or created by a run that died before the header was written
+        if (::ftruncate(fd, 0) != 0 || !writeAll(fd, fileHeader(kWalMagic, sequence))) {
+            std::cerr << "Store error (openWal): " << path << ": " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            return false;
+        }
+        size = kHeaderBytes;
+        syncDirectory(directory);
+    }
+    walFd = fd;
+    walSequence = sequence;
+    walBytes = size;
+    return true;
+}
+
+// Template rows normally come from seed data; a new store gets the three
+// the default rooms are built from
+void LogStore::seedDefaults() {
+    const RoomTemplate defaults[] = {
+        {1, "Lobby", 10, 10, 30, "", "{}", true},
+        {2, "Chill Zone", 12, 12, 30, "", "{}", true},
+        {3, "Gaming Room", 14, 14, 30, "", "{}", true},
+    };
+    for (const RoomTemplate& tpl : defaults) putRoomTemplate(tpl);
+    std::cout << "🌱 Seeded " << templates.size() << " room templates into a new store" << std::endl;
+}
+
+// ----------------------
+// Log
+// ----------------------
+bool LogStore::commit(const char* what) {
+    if (walFd < 0) {
+        std::cerr << "Store error (" << what << "): store is closed" << std::endl;
+        return false;
+    }
+    frame(recordBuffer);
+    if (!writeAll(walFd, recordBuffer)) {
+        std::cerr << "Store error (" << what << "): " << std::strerror(errno) << std::endl;
+        // Cut off a partial frame so later records are not lost behind it on replay
+        if (::ftruncate(walFd, (off_t)walBytes) != 0) {
+            std::cerr << "Store error (" << what << "): cannot roll back the log: " << std::strerror(errno) << std::endl;
+        }
+        return false;
+    }
+    walBytes += recordBuffer.size();
+    records++;
+    walDirty.store(true, std::memory_order_relaxed);
+    return apply(std::string_view(recordBuffer).substr(kFrameBytes));
+}
+
+void LogStore::syncWal() {
+    if (!walDirty.exchange(false)) return;
+    // A duplicate keeps the descriptor valid if compaction swaps logs meanwhile
+    int fd = -1;
+    {
+        std::shared_lock<std::shared_mutex> lock(tableMutex);
+        if (walFd >= 0) fd = ::dup(walFd);
+    }
+    if (fd < 0) return;
+    ::fdatasync(fd);
+    ::close(fd);
+}
+
+void LogStore::backgroundLoop() {
+    std::unique_lock<std::mutex> lk(stopMutex);
+    while (!stopping) {
+        stopCv.wait_for(lk, std::chrono::milliseconds(syncIntervalMs), [this] { return stopping; });
+        lk.unlock();
+        syncWal();
+        uint64_t logBytes;
+        {
+            std::shared_lock<std::shared_mutex> lock(tableMutex);
+            logBytes = walBytes;
+        }
+        if (logBytes >= compactBytes) compact();
+        lk.lock();
+    }
+}
+
+// ----------------------
+// Compaction
+// ----------------------
+bool LogStore::compact() {
+    std::lock_guard<std::mutex> compactLock(compactMutex);
+    uint64_t start = steadyNowNs();
+    std::string bytes;
+    uint64_t covered;
+    {
+        // Writers wait only for the switch to a new log and the in-memory encode
+        std::unique_lock<std::shared_mutex> lock(tableMutex);
+        if (walFd < 0) return false;
+        int previous = walFd;
+        if (!openWal(walSequence + 1)) return false;
+        ::fdatasync(previous);
+        ::close(previous);
+        covered = walSequence;
+        bytes = encodeSnapshot();
+    }
+
+    std::string temporary = snapshotPath() + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0 && writeAll(fd, bytes) && ::fsync(fd) == 0;
+    if (fd >= 0) ::close(fd);
+    ok = ok && ::rename(temporary.c_str(), snapshotPath().c_str()) == 0;
+    if (!ok) {
+        // The logs are still all there, so nothing is lost; the next attempt retries
+        std::cerr << "Store error (compact): " << std::strerror(errno) << std::endl;
+        ::unlink(temporary.c_str());
+        return false;
+    }
+    syncDirectory(directory);
+
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        uint64_t sequence = walSequenceOf(entry.path().filename().string());
+        if (sequence != 0 && sequence < covered) fs::remove(entry.path(), ec);
+    }
+    snapshots.fetch_add(1, std::memory_order_relaxed);
+    lastSnapshotNs.store(steadyNowNs() - start, std::memory_order_relaxed);
+    return true;
+}
+
+// The whole state as records; the caller holds the lock
+std::string LogStore::encodeSnapshot() const {
+    std::string out = fileHeader(kSnapshotMagic, walSequence);
+    std::string record;
+    auto flush = [&] {
+        frame(record);
+        out += record;
+    };
+
+    RecordWriter(record, Op::SetCounters).i32(nextUserId).i32(nextRoomId).i32(nextObjectId);
+    flush();
+    for (const auto& [id, tpl] : templates) {
+        RecordWriter(record, Op::PutTemplate).i32(id).str(tpl.name).f32(tpl.width).f32(tpl.height).f32(tpl.skewAngle)
+            .str(tpl.texturePath).str(tpl.defaultLayoutJson).boolean(tpl.editable);
+        flush();
+    }
+    for (const auto& [id, user] : users) {
+        RecordWriter w(record, Op::PutUser);
+        w.i32(id).str(user.username).str(user.email).str(user.passwordHash);
+        w.count(user.roles.size());
+        for (const std::string& role : user.roles) w.str(role);
+        w.count(user.inventory.size());
+        for (const std::string& item : user.inventory) w.str(item);
+        flush();
+    }
+    for (const auto& [id, room] : rooms) {
+        const RoomInfo& info = room.info;
+        uint8_t flags = (info.isPublic ? kRoomPublic : 0) | (info.pinCode ? kRoomHasPin : 0) | (room.editable ? kRoomEditable : 0);
+        RecordWriter w(record, Op::PutRoom);
+        w.i32(id).str(info.name).i32(info.ownerId).u8(flags);
+        if (info.pinCode) w.str(*info.pinCode);
+        w.i32(info.playerCount).str(info.layoutJson).i32(info.width).i32(info.height).f32(room.skewAngle).str(room.texturePath);
+        flush();
+    }
+    for (const auto& [roomId, byId] : objectsByRoom) {
+        for (const auto& [id, o] : byId) {
+            RecordWriter(record, Op::PutObject).i32(roomId).i32(id).str(o.name).str(o.spritePath).f32(o.x).f32(o.y)
+                .f32(o.rotation).f32(o.scale).boolean(o.interactable);
+            flush();
+        }
+    }
+
+    size_t n = 0;
+    auto position = positions.begin();
+    while (position != positions.end()) {
+        n = std::min(kRowsPerRecord, (size_t)std::distance(position, positions.end()));
+        RecordWriter w(record, Op::PutPositions);
+        w.count(n);
+        for (size_t i = 0; i < n; i++, ++position) {
+            const PlayerPosition& p = position->second;
+            w.i32(p.userId).i32(p.roomId).f32(p.x).f32(p.y).str(p.direction);
+        }
+        flush();
+    }
+    for (const auto& [roomId, lines] : chat) {
+        for (size_t first = 0; first < lines.size(); first += kRowsPerRecord) {
+            n = std::min(kRowsPerRecord, lines.size() - first);
+            RecordWriter w(record, Op::AppendChat);
+            w.count(n);
+            for (size_t i = first; i < first + n; i++) w.i32(roomId).str(lines[i].username).str(lines[i].message);
+            flush();
+        }
+    }
+    return out;
+}
+
+// ----------------------
+// Applying records
+// Every field is decoded before anything changes, so a bad record leaves
+// the tables as they were.
+// ----------------------
+bool LogStore::apply(std::string_view payload) {
+    RecordReader r(payload);
+    switch ((Op)r.u8()) {
+        case Op::PutUser: {
+            UserRow user;
+            user.id = r.i32();
+            user.username = r.str();
+            user.email = r.str();
+            user.passwordHash = r.str();
+            for (uint64_t n = r.elements(1); n > 0; n--) user.roles.insert(r.str());
+            for (uint64_t n = r.elements(1); n > 0; n--) user.inventory.push_back(r.str());
+            if (!r.done()) return false;
+            auto existing = users.find(user.id);
+            if (existing != users.end()) {
+                userIdByName.erase(existing->second.username);
+                emails.erase(existing->second.email);
+            }
+            userIdByName[user.username] = user.id;
+            emails.insert(user.email);
+            nextUserId = std::max(nextUserId, user.id + 1);
+            users[user.id] = std::move(user);
+            return true;
+        }
+        case Op::PutRoom: {
+            RoomRow room;
+            RoomInfo& info = room.info;
+            info.id = r.i32();
+            info.name = r.str();
+            info.ownerId = r.i32();
+            uint8_t flags = r.u8();
+            info.isPublic = flags & kRoomPublic;
+            if (flags & kRoomHasPin) info.pinCode = r.str();
+            room.editable = flags & kRoomEditable;
+            info.playerCount = r.i32();
+            info.layoutJson = r.str();
+            info.width = r.i32();
+            info.height = r.i32();
+            room.skewAngle = r.f32();
+            room.texturePath = r.str();
+            if (!r.done()) return false;
+            roomIdByName[info.name] = info.id;
+            nextRoomId = std::max(nextRoomId, info.id + 1);
+            rooms[info.id] = std::move(room);
+            return true;
+        }
+        case Op::SetRoomLayout: {
+            int id = r.i32();
+            std::string layout = r.str();
+            if (!r.done()) return false;
+            auto it = rooms.find(id);
+            if (it != rooms.end()) it->second.info.layoutJson = std::move(layout);
+            return true;
+        }
+        case Op::SetPlayerCounts: {
+            std::vector<std::pair<int, int>> counts(r.elements(2));
+            for (auto& [id, count] : counts) {
+                id = r.i32();
+                count = r.i32();
+            }
+            if (!r.done()) return false;
+            for (const auto& [id, count] : counts) {
+                auto it = rooms.find(id);
+                if (it != rooms.end()) it->second.info.playerCount = count;
+            }
+            return true;
+        }
+        case Op::PutTemplate: {
+            RoomTemplate tpl;
+            tpl.id = r.i32();
+            tpl.name = r.str();
+            tpl.width = r.f32();
+            tpl.height = r.f32();
+            tpl.skewAngle = r.f32();
+            tpl.texturePath = r.str();
+            tpl.defaultLayoutJson = r.str();
+            tpl.editable = r.boolean();
+            if (!r.done()) return false;
+            templates[tpl.id] = std::move(tpl);
+            return true;
+        }
+        case Op::PutObject: {
+            int roomId = r.i32();
+            RoomObject o;
+            o.id = r.i32();
+            o.name = r.str();
+            o.spritePath = r.str();
+            o.x = r.f32();
+            o.y = r.f32();
+            o.rotation = r.f32();
+            o.scale = r.f32();
+            o.interactable = r.boolean();
+            if (!r.done()) return false;
+            objectRoom[o.id] = roomId;
+            nextObjectId = std::max(nextObjectId, o.id + 1);
+            objectsByRoom[roomId][o.id] = std::move(o);
+            return true;
+        }
+        case Op::MoveObject: {
+            int id = r.i32();
+            float x = r.f32(), y = r.f32(), rotation = r.f32();
+            if (!r.done()) return false;
+            auto room = objectRoom.find(id);
+            if (room == objectRoom.end()) return true;
+            RoomObject& o = objectsByRoom[room->second][id];
+            o.x = x;
+            o.y = y;
+            o.rotation = rotation;
+            return true;
+        }
+        case Op::RemoveObject: {
+            int id = r.i32();
+            int roomId = r.i32();
+            if (!r.done()) return false;
+            auto room = objectRoom.find(id);
+            if (room == objectRoom.end() || room->second != roomId) return true;
+            objectRoom.erase(room);
+            auto byId = objectsByRoom.find(roomId);
+            byId->second.erase(id);
+            if (byId->second.empty()) objectsByRoom.erase(byId);
+            return true;
+        }
+        case Op::ClearObjects: {
+            int roomId = r.i32();
+            if (!r.done()) return false;
+            auto byId = objectsByRoom.find(roomId);
+            if (byId == objectsByRoom.end()) return true;
+            for (const auto& entry : byId->second) objectRoom.erase(entry.first);
+            objectsByRoom.erase(byId);
+            return true;
+        }
+        case Op::PutPositions: {
+            std::vector<PlayerPosition> rows(r.elements(12));
+            for (PlayerPosition& p : rows) {
+                p.userId = r.i32();
+                p.roomId = r.i32();
+                p.x = r.f32();
+                p.y = r.f32();
+                p.direction = r.str();
+            }
+            if (!r.done()) return false;
+            for (PlayerPosition& p : rows) positions[p.userId] = std::move(p);
+            return true;
+        }
+        case Op::AppendChat: {
+            std::vector<ChatLine> lines(r.elements(3));
+            for (ChatLine& line : lines) {
+                line.roomId = r.i32();
+                line.username = r.str();
+                line.message = r.str();
+            }
+            if (!r.done()) return false;
+            for (ChatLine& line : lines) {
+                std::deque<ChatLine>& recent = chat[line.roomId];
+                recent.push_back(std::move(line));
+                if (recent.size() > kChatRetention) recent.pop_front();
+            }
+            return true;
+        }
+        case Op::SetCounters: {
+            int user = r.i32(), room = r.i32(), object = r.i32();
+            if (!r.done()) return false;
+            nextUserId = std::max(nextUserId, user);
+            nextRoomId = std::max(nextRoomId, room);
+            nextObjectId = std::max(nextObjectId, object);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------
+// Users
+// ----------------------
+std::optional<int> LogStore::authenticateUser(const std::string& username, const std::string& password) {
+    QueryTimer timer("authenticateUser");
+    int id;
+    std::string hash;
+    {
+        std::shared_lock<std::shared_mutex> lock(tableMutex);
+        auto it = userIdByName.find(username);
+        if (it == userIdByName.end()) return std::nullopt;
+        id = it->second;
+        hash = users.at(id).passwordHash;
+    }
+    if (bcrypt::validatePassword(password, hash)) return id;
+    return std::nullopt;
+}
+
+std::optional<LoginRecord> LogStore::loadLogin(const std::string& username) {
+    QueryTimer timer("loadLogin");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = userIdByName.find(username);
+    if (it == userIdByName.end()) return std::nullopt;
+    const UserRow& user = users.at(it->second);
+    LoginRecord record;
+    record.userId = user.id;
+    record.passwordHash = user.passwordHash;
+    record.roles = user.roles;
+    record.inventory = user.inventory;
+    auto position = positions.find(user.id);
+    if (position != positions.end()) record.position = position->second;
+    return record;
+}
+
+bool LogStore::createUserWithHash(const std::string& username, const std::string& email, const std::string& hashed,
+                                  std::string role) {
+    QueryTimer timer("createUserWithHash");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    if (userIdByName.count(username) || emails.count(email)) {
+        std::cerr << "Store error (createUser): username or email already registered" << std::endl;
+        return false;
+    }
+    RecordWriter w(recordBuffer, Op::PutUser);
+    w.i32(nextUserId).str(username).str(email).str(hashed);
+    w.count(1).str(role);
+    w.count(0);
+    return commit("createUser");
+}
+
+bool LogStore::isEmailRegistered(const std::string& email) {
+    QueryTimer timer("isEmailRegistered");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    return emails.count(email) > 0;
+}
+
+bool LogStore::isUsernameRegistered(const std::string& username) {
+    QueryTimer timer("isUsernameRegistered");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    return userIdByName.count(username) > 0;
+}
+
+std::unordered_set<std::string> LogStore::getUserRoles(int userId) {
+    QueryTimer timer("getUserRoles");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = users.find(userId);
+    return it != users.end() ? it->second.roles : std::unordered_set<std::string>{};
+}
+
+std::vector<std::string> LogStore::getUserInventory(int userId) {
+    QueryTimer timer("getUserInventory");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = users.find(userId);
+    return it != users.end() ? it->second.inventory : std::vector<std::string>{};
+}
+
+// ----------------------
+// Rooms
+// ----------------------
+int LogStore::createRoom(const std::string& roomName, int ownerId, bool isPublic,
+                         const std::optional<std::string>& pinCode, const std::string& layoutJson, bool editable,
+                         int width, int height, int skewAngle, const std::string& texturePath) {
+    QueryTimer timer("createRoom");
+    {
+        std::unique_lock<std::shared_mutex> lock(tableMutex);
+        // Same as ON CONFLICT (name) DO NOTHING: an existing room is looked up below
+        if (!roomIdByName.count(roomName)) {
+            bool hasPin = pinCode.has_value() && !pinCode->empty();
+            uint8_t flags = (isPublic ? kRoomPublic : 0) | (hasPin ? kRoomHasPin : 0) | (editable ? kRoomEditable : 0);
+            RecordWriter w(recordBuffer, Op::PutRoom);
+            w.i32(nextRoomId).str(roomName).i32(ownerId).u8(flags);
+            if (hasPin) w.str(*pinCode);
+            w.i32(0).str(layoutJson).i32(width).i32(height).f32((float)skewAngle).str(texturePath);
+            if (!commit("createRoom")) return -1;
+        }
+    }
+    return getRoomIdByOwner(roomName, ownerId, pinCode);
+}
+
+std::optional<std::string> LogStore::getRoomLayout(int roomId) {
+    QueryTimer timer("getRoomLayout");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = rooms.find(roomId);
+    if (it == rooms.end()) return std::nullopt;
+    return it->second.info.layoutJson;
+}
+
+void LogStore::updateRoomLayout(int roomId, const std::string& layoutJson) {
+    QueryTimer timer("updateRoomLayout");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    if (!rooms.count(roomId)) return;
+    RecordWriter(recordBuffer, Op::SetRoomLayout).i32(roomId).str(layoutJson);
+    commit("updateRoomLayout");
+}
+
+int LogStore::getRoomIdByOwner(const std::string& roomName, int ownerId, const std::optional<std::string>& pinCode) {
+    QueryTimer timer("getRoomIdByOwner");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = roomIdByName.find(roomName);
+    if (it == roomIdByName.end()) return -1;
+    const RoomInfo& info = rooms.at(it->second).info;
+    if (info.ownerId != ownerId) return -1;
+    if (info.pinCode.has_value() && (!pinCode.has_value() || *pinCode != *info.pinCode)) return -1;
+    return info.id;
+}
+
+int LogStore::getPublicRoomIdByName(const std::string& roomName) {
+    QueryTimer timer("getPublicRoomIdByName");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = roomIdByName.find(roomName);
+    if (it == roomIdByName.end() || !rooms.at(it->second).info.isPublic) return -1;
+    return it->second;
+}
+
+std::optional<RoomInfo> LogStore::getPublicRoomByName(const std::string& roomName) {
+    QueryTimer timer("getPublicRoomByName");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = roomIdByName.find(roomName);
+    if (it == roomIdByName.end()) return std::nullopt;
+    const RoomInfo& info = rooms.at(it->second).info;
+    if (!info.isPublic) return std::nullopt;
+    return info;
+}
+
+std::optional<RoomInfo> LogStore::getRoomByOwner(const std::string& roomName, int ownerId) {
+    QueryTimer timer("getRoomByOwner");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = roomIdByName.find(roomName);
+    if (it == roomIdByName.end()) return std::nullopt;
+    const RoomInfo& info = rooms.at(it->second).info;
+    if (info.ownerId != ownerId) return std::nullopt;
+    return info;
+}
+
+std::vector<RoomInfo> LogStore::getAllRoomsOrderedByPlayers() {
+    QueryTimer timer("getAllRoomsOrderedByPlayers");
+    std::vector<RoomInfo> result;
+    {
+        std::shared_lock<std::shared_mutex> lock(tableMutex);
+        result.reserve(rooms.size());
+        for (const auto& entry : rooms) result.push_back(entry.second.info);
+    }
+    std::sort(result.begin(), result.end(), [](const RoomInfo& a, const RoomInfo& b) {
+        return a.playerCount != b.playerCount ? a.playerCount > b.playerCount : a.id < b.id;
+    });
+    return result;
+}
+
+std::optional<RoomMetadata> LogStore::getRoomMetadata(int roomId) {
+    QueryTimer timer("getRoomMetadata");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = rooms.find(roomId);
+    if (it == rooms.end()) return std::nullopt;
+    const RoomRow& room = it->second;
+    return RoomMetadata{room.info.id, room.info.name, (float)room.info.width, (float)room.info.height,
+                        room.skewAngle, room.texturePath, room.editable};
+}
+
+// ----------------------
+// Room templates
+// ----------------------
+std::vector<RoomTemplate> LogStore::getAllRoomTemplates() {
+    QueryTimer timer("getAllRoomTemplates");
+    std::vector<RoomTemplate> result;
+    {
+        std::shared_lock<std::shared_mutex> lock(tableMutex);
+        result.reserve(templates.size());
+        for (const auto& entry : templates) result.push_back(entry.second);
+    }
+    std::stable_sort(result.begin(), result.end(), [](const RoomTemplate& a, const RoomTemplate& b) { return a.name < b.name; });
+    return result;
+}
+
+std::optional<RoomTemplate> LogStore::getRoomTemplateById(int templateId) {
+    QueryTimer timer("getRoomTemplateById");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = templates.find(templateId);
+    if (it == templates.end()) return std::nullopt;
+    return it->second;
+}
+
+bool LogStore::putRoomTemplate(const RoomTemplate& tpl) {
+    QueryTimer timer("putRoomTemplate");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    RecordWriter(recordBuffer, Op::PutTemplate).i32(tpl.id).str(tpl.name).f32(tpl.width).f32(tpl.height).f32(tpl.skewAngle)
+        .str(tpl.texturePath).str(tpl.defaultLayoutJson).boolean(tpl.editable);
+    return commit("putRoomTemplate");
+}
+
+// ----------------------
+// Room objects (furniture)
+// ----------------------
+std::optional<std::vector<RoomObject>> LogStore::loadRoomObjects(int roomId) {
+    QueryTimer timer("loadRoomObjects");
+    std::vector<RoomObject> result;
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = objectsByRoom.find(roomId);
+    if (it == objectsByRoom.end()) return result;
+    result.reserve(it->second.size());
+    for (const auto& entry : it->second) result.push_back(entry.second);
+    return result;
+}
+
+int LogStore::addRoomObject(int roomId, const std::string& name, const std::string& spritePath, float x, float y,
+                            float rotation, float scale, bool interactable) {
+    QueryTimer timer("addRoomObject");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    if (!rooms.count(roomId)) {
+        std::cerr << "Store error (addRoomObject): no room " << roomId << std::endl;
+        return -1;
+    }
+    int id = nextObjectId;
+    RecordWriter(recordBuffer, Op::PutObject).i32(roomId).i32(id).str(name).str(spritePath).f32(x).f32(y).f32(rotation)
+        .f32(scale).boolean(interactable);
+    return commit("addRoomObject") ? id : -1;
+}
+
+bool LogStore::updateRoomObject(int objectId, float x, float y, float rotation) {
+    QueryTimer timer("updateRoomObject");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    if (!objectRoom.count(objectId)) return true;   // like an UPDATE that matched no row
+    RecordWriter(recordBuffer, Op::MoveObject).i32(objectId).f32(x).f32(y).f32(rotation);
+    return commit("updateRoomObject");
+}
+
+bool LogStore::removeRoomObject(int objectId, int roomId) {
+    QueryTimer timer("removeRoomObject");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    auto it = objectRoom.find(objectId);
+    if (it == objectRoom.end() || it->second != roomId) return true;
+    RecordWriter(recordBuffer, Op::RemoveObject).i32(objectId).i32(roomId);
+    return commit("removeRoomObject");
+}
+
+void LogStore::clearRoomObjects(int roomId) {
+    QueryTimer timer("clearRoomObjects");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    if (!objectsByRoom.count(roomId)) return;
+    RecordWriter(recordBuffer, Op::ClearObjects).i32(roomId);
+    commit("clearRoomObjects");
+}
+
+// ----------------------
+// Player positions and presence
+// ----------------------
+void LogStore::updatePlayerPosition(int userId, int roomId, float x, float y, const std::string& direction) {
+    QueryTimer timer("updatePlayerPosition");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    RecordWriter(recordBuffer, Op::PutPositions).count(1).i32(userId).i32(roomId).f32(x).f32(y).str(direction);
+    commit("updatePlayerPosition");
+}
+
+void LogStore::upsertPlayerPositions(const PositionBatch& batch) {
+    if (batch.empty()) return;
+    QueryTimer timer("upsertPlayerPositions");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    RecordWriter w(recordBuffer, Op::PutPositions);
+    w.count(batch.userIds.size());
+    for (size_t i = 0; i < batch.userIds.size(); i++) {
+        w.i32(batch.userIds[i]).i32(batch.roomIds[i]).f32(batch.xs[i]).f32(batch.ys[i]).str(batch.directions[i]);
+    }
+    commit("upsertPlayerPositions");
+}
+
+std::optional<PlayerPosition> LogStore::getPlayerPosition(int userId) {
+    QueryTimer timer("getPlayerPosition");
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = positions.find(userId);
+    if (it == positions.end()) return std::nullopt;
+    return it->second;
+}
+
+void LogStore::updateRoomPlayerCounts(const std::vector<int>& roomIds, const std::vector<int>& counts) {
+    if (roomIds.empty()) return;
+    QueryTimer timer("updateRoomPlayerCounts");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    // Unchanged rooms are left out, so an idle server writes nothing
+    std::vector<std::pair<int, int>> changed;
+    for (size_t i = 0; i < roomIds.size() && i < counts.size(); i++) {
+        auto it = rooms.find(roomIds[i]);
+        if (it != rooms.end() && it->second.info.playerCount != counts[i]) changed.emplace_back(roomIds[i], counts[i]);
+    }
+    if (changed.empty()) return;
+    RecordWriter w(recordBuffer, Op::SetPlayerCounts);
+    w.count(changed.size());
+    for (const auto& [id, count] : changed) w.i32(id).i32(count);
+    commit("updateRoomPlayerCounts");
+}
+
+void LogStore::resetPresence() {
+    QueryTimer timer("resetPresence");
+    std::vector<int> roomIds;
+    {
+        std::shared_lock<std::shared_mutex> lock(tableMutex);
+        for (const auto& [id, room] : rooms) {
+            if (room.info.playerCount != 0) roomIds.push_back(id);
+        }
+    }
+    if (roomIds.empty()) return;
+    updateRoomPlayerCounts(roomIds, std::vector<int>(roomIds.size(), 0));
+    std::cout << "🧹 Cleared stale presence in " << roomIds.size() << " room(s)" << std::endl;
+}
+
+// ----------------------
+// Chat
+// ----------------------
+void LogStore::insertChatMessage(int roomId, const std::string& username, const std::string& message) {
+    QueryTimer timer("insertChatMessage");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    RecordWriter(recordBuffer, Op::AppendChat).count(1).i32(roomId).str(username).str(message);
+    commit("insertChatMessage");
+}
+
+std::optional<std::vector<ChatLine>> LogStore::getRecentChat(int roomId, int limit) {
+    QueryTimer timer("getRecentChat");
+    std::vector<ChatLine> lines;
+    std::shared_lock<std::shared_mutex> lock(tableMutex);
+    auto it = chat.find(roomId);
+    if (it == chat.end() || limit <= 0) return lines;
+    size_t n = std::min(it->second.size(), (size_t)limit);
+    lines.assign(it->second.end() - (std::ptrdiff_t)n, it->second.end());
+    return lines;
+}
+
+// One record for the batch: it is either all in the log or not at all
+bool LogStore::insertChatMessages(const std::vector<ChatLine>& lines) {
+    if (lines.empty()) return true;
+    QueryTimer timer("insertChatMessages");
+    std::unique_lock<std::shared_mutex> lock(tableMutex);
+    RecordWriter w(recordBuffer, Op::AppendChat);
+    w.count(lines.size());
+    for (const ChatLine& line : lines) w.i32(line.roomId).str(line.username).str(line.message);
+    return commit("insertChatMessages");
+}
+
+LogStoreStats LogStore::stats() const {
+    LogStoreStats s;
+    {
+        std::shared_lock<std::shared_mutex> lock(tableMutex);
+        s.users = users.size();
+        s.rooms = rooms.size();
+        s.templates = templates.size();
+        s.roomObjects = objectRoom.size();
+        s.positions = positions.size();
+        s.walSequence = walSequence;
+        s.walBytes = walBytes;
+        s.records = records;
+    }
+    s.snapshots = snapshots.load(std::memory_order_relaxed);
+    s.lastSnapshotMs = lastSnapshotNs.load(std::memory_order_relaxed) / 1e6;
+    return s;
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include "Storage.hpp"
+
+// ---------- Store Stats ----------
+struct LogStoreStats {
+    size_t users = 0;
+    size_t rooms = 0;
+    size_t templates = 0;
+    size_t roomObjects = 0;
+    size_t positions = 0;
+    uint64_t walSequence = 0;
+    uint64_t walBytes = 0;      // current log only
+    uint64_t records = 0;       // appended since open
+    uint64_t snapshots = 0;
+    double lastSnapshotMs = 0;
+};
+
+// ---------- Embedded log-structured store ----------
+// Storage without a database server, for single-node deployments and
+// benchmarks. All tables live in memory and reads are lookups under a shared
+// lock. Each write is encoded as one record, appended to the write-ahead log
+// (wal-<n>.log) and then applied to the tables through the same code that
+// replays the log, so a restart rebuilds exactly what was served.
+//
+// A background thread fsyncs the log every syncIntervalMs (a crash of the
+// machine, not the process, can lose that much) and, once the log outgrows
+// compactBytes, writes snapshot.bin: the whole state as records, tagged with
+// the first log it does not cover. Opening loads the snapshot, replays the
+// logs after it and truncates a torn tail.
+//
+// Chat keeps the last kChatRetention lines per room; older lines go at the
+// next snapshot.
+class LogStore : public Storage {
+public:
+    static constexpr size_t kChatRetention = 1000;
+
+    // Creates the directory if needed; exits when existing data cannot be read
+    explicit LogStore(const std::string& directory, uint64_t compactBytes = 64ull << 20, int syncIntervalMs = 200);
+    ~LogStore() override;
+
+    LogStore(const LogStore&) = delete;
+    LogStore& operator=(const LogStore&) = delete;
+
+    std::optional<int> authenticateUser(const std::string& username, const std::string& password) override;
+    std::optional<LoginRecord> loadLogin(const std::string& username) override;
+    bool createUserWithHash(const std::string& username, const std::string& email, const std::string& hashed,
+                            std::string role) override;
+    bool isEmailRegistered(const std::string& email) override;
+    bool isUsernameRegistered(const std::string& username) override;
+    std::unordered_set<std::string> getUserRoles(int userId) override;
+    std::vector<std::string> getUserInventory(int userId) override;
+
+    int createRoom(const std::string& roomName, int ownerId, bool isPublic, const std::optional<std::string>& pinCode,
+                   const std::string& layoutJson, bool editable, int width, int height, int skewAngle,
+                   const std::string& texturePath) override;
+    std::optional<std::string> getRoomLayout(int roomId) override;
+    void updateRoomLayout(int roomId, const std::string& layoutJson) override;
+    int getRoomIdByOwner(const std::string& roomName, int ownerId, const std::optional<std::string>& pinCode) override;
+    int getPublicRoomIdByName(const std::string& roomName) override;
+    std::optional<RoomInfo> getPublicRoomByName(const std::string& roomName) override;
+    std::optional<RoomInfo> getRoomByOwner(const std::string& roomName, int ownerId) override;
+    std::vector<RoomInfo> getAllRoomsOrderedByPlayers() override;
+    std::optional<RoomMetadata> getRoomMetadata(int roomId) override;
+
+    std::vector<RoomTemplate> getAllRoomTemplates() override;
+    std::optional<RoomTemplate> getRoomTemplateById(int templateId) override;
+    // Storage has no template writes (Postgres gets them from seed data);
+    // this is how an embedded store is seeded. Replaces a template with the same id.
+    bool putRoomTemplate(const RoomTemplate& tpl);
+
+    std::optional<std::vector<RoomObject>> loadRoomObjects(int roomId) override;
+    int addRoomObject(int roomId, const std::string& name, const std::string& spritePath, float x, float y,
+                      float rotation, float scale, bool interactable) override;
+    bool updateRoomObject(int objectId, float x, float y, float rotation) override;
+    bool removeRoomObject(int objectId, int roomId) override;
+    void clearRoomObjects(int roomId) override;
+
+    void updatePlayerPosition(int userId, int roomId, float x, float y, const std::string& direction) override;
+    void upsertPlayerPositions(const PositionBatch& batch) override;
+    std::optional<PlayerPosition> getPlayerPosition(int userId) override;
+    void updateRoomPlayerCounts(const std::vector<int>& roomIds, const std::vector<int>& counts) override;
+    void resetPresence() override;
+
+    void insertChatMessage(int roomId, const std::string& username, const std::string& message) override;
+    std::optional<std::vector<ChatLine>> getRecentChat(int roomId, int limit) override;
+    bool insertChatMessages(const std::vector<ChatLine>& lines) override;
+
+    // Writes a snapshot now and starts a new log; false if the snapshot
+    // could not be written (the old logs are then kept)
+    bool compact();
+
+    // Stops the background thread and syncs the log. Called by the destructor.
+    void close();
+
+    LogStoreStats stats() const;
+
+private:
+    struct UserRow {
+        int id = 0;
+        std::string username;
+        std::string email;
+        std::string passwordHash;
+        std::unordered_set<std::string> roles;
+        std::vector<std::string> inventory;
+    };
+
+    // RoomInfo plus the columns only RoomMetadata exposes
+    struct RoomRow {
+        RoomInfo info;
+        float skewAngle = 30;
+        std::string texturePath;
+        bool editable = true;
+    };
+
+    struct ReplayResult {
+        bool readable = false;      // header present and matching
+        uint64_t header = 0;        // log sequence, or the first log a snapshot does not cover
+        uint64_t validBytes = 0;    // up to the last record that checked out
+        uint64_t fileBytes = 0;
+        uint64_t records = 0;
+    };
+
+    // Appends the record built in recordBuffer to the log and applies it;
+    // the caller holds the write lock
+    bool commit(const char* what);
+    // Applies one record payload to the tables; false when it does not decode
+    bool apply(std::string_view payload);
+
+    void open();
+    // Applies every intact record of a snapshot or log file
+    ReplayResult replay(const std::string& path, const char* magic);
+    // Opens (creating if needed) wal-<sequence>.log as the current log
+    bool openWal(uint64_t sequence);
+    std::string encodeSnapshot() const;
+    void seedDefaults();
+    void syncWal();
+    void backgroundLoop();
+
+    std::string walPath(uint64_t sequence) const;
+    std::string snapshotPath() const;
+
+    const std::string directory;
+    const uint64_t compactBytes;
+    const int syncIntervalMs;
+
+    // Tables and log position; shared for reads, exclusive for writes
+    mutable std::shared_mutex tableMutex;
+    std::unordered_map<int, UserRow> users;
+    std::unordered_map<std::string, int> userIdByName;
+    std::unordered_set<std::string> emails;
+    std::unordered_map<int, RoomRow> rooms;
+    std::unordered_map<std::string, int> roomIdByName;
+    std::map<int, RoomTemplate> templates;
+    std::unordered_map<int, std::map<int, RoomObject>> objectsByRoom;   // ordered by id
+    std::unordered_map<int, int> objectRoom;                            // object id -> room id
+    std::unordered_map<int, PlayerPosition> positions;
+    std::unordered_map<int, std::deque<ChatLine>> chat;
+    int nextUserId = 1;
+    int nextRoomId = 1;
+    int nextObjectId = 1;
+    int walFd = -1;
+    uint64_t walSequence = 1;
+    uint64_t walBytes = 0;
+    uint64_t records = 0;
+    std::string recordBuffer;   // frame being committed, under tableMutex
+
+    // Only one compaction at a time (background thread or compact())
+    std::mutex compactMutex;
+    std::atomic<uint64_t> snapshots{0};
+    std::atomic<uint64_t> lastSnapshotNs{0};
+
+    std::mutex stopMutex;
+    std::condition_variable stopCv;
+    bool stopping = false;
+    std::atomic<bool> walDirty{false};
+    std::thread background;
+};
@@ -0,0 +1,269 @@
+#include "Metrics.hpp"
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// ----------------------
+// ValueHistogram
+// ----------------------
+int ValueHistogram::bucketOf(uint64_t value) {
+    if (value < (uint64_t)kSubBuckets) return (int)value;
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > kMaxExponent) return kBuckets - 1;
+    int sub = (int)((value >> (exponent - 2)) & (kSubBuckets - 1));
+    return kSubBuckets + (exponent - 2) * kSubBuckets + sub;
+}
+
+uint64_t ValueHistogram::bucketLimit(int bucket) {
+    if (bucket < kSubBuckets) return (uint64_t)bucket + 1;
+    int exponent = (bucket - kSubBuckets) / kSubBuckets + 2;
+    int sub = (bucket - kSubBuckets) % kSubBuckets;
+    return (uint64_t)(kSubBuckets + sub + 1) << (exponent - 2);
+}
+
+void ValueHistogram::addTo(Snapshot& out) const {
+    for (int i = 0; i < kBuckets; i++) {
+        uint64_t n = buckets[i].load(std::memory_order_relaxed);
+        out.buckets[i] += n;
+        out.count += n;
+    }
+    out.sum += sum.load(std::memory_order_relaxed);
+}
+
+// ----------------------
+// Registry
+// Each thread owns a ThreadSeries. Only the owner adds series to it, always
+// under the registry lock; the owner's lookups go through its index without
+// locking. A scrape takes the same lock and only walks the deques, whose
+// elements never move.
+// ----------------------
+namespace {
+
+enum class Kind : uint8_t { Histogram, Counter, Gauge };
+
+struct FamilyInfo {
+    const char* name;
+    const char* help;
+    Kind kind;
+    const char* labelName;  // nullptr: unlabelled
+    bool micros;            // histogram values are microseconds, rendered as seconds
+};
+
+const FamilyInfo kFamilies[(size_t)MetricFamily::Count] = {
+    {"habbo_message_duration_seconds", "Time spent handling one inbound message on its loop thread", Kind::Histogram, "type", true},
+    {"habbo_db_query_duration_seconds", "Duration of one Database call on a DB thread", Kind::Histogram, "query", true},
+    {"habbo_room_fanout_recipients", "Recipients of one room publish", Kind::Histogram, nullptr, false},
+    {"habbo_messages_received_total", "Inbound WebSocket messages", Kind::Counter, "type", false},
+    {"habbo_received_bytes_total", "Inbound WebSocket payload bytes", Kind::Counter, nullptr, false},
+    {"habbo_room_publishes_total", "Room publishes (one payload for many recipients)", Kind::Counter, nullptr, false},
+    {"habbo_room_published_bytes_total", "Room publish payload bytes times recipients", Kind::Counter, nullptr, false},
+    {"habbo_direct_sends_total", "Frames sent to a single socket", Kind::Counter, nullptr, false},
+    {"habbo_direct_sent_bytes_total", "Payload bytes sent to single sockets", Kind::Counter, nullptr, false},
+    {"habbo_connections", "Open WebSocket connections", Kind::Gauge, nullptr, false},
+    {"habbo_rooms_occupied", "Rooms with at least one session in them", Kind::Gauge, nullptr, false},
+    {"habbo_room_members", "Sessions in rooms", Kind::Gauge, nullptr, false},
+};
+
+struct SeriesKey {
+    MetricFamily family;
+    const char* label;      // by address: labels are static strings
+    size_t length;
+
+    bool operator==(const SeriesKey& other) const {
+        return family == other.family && label == other.label && length == other.length;
+    }
+};
+
+struct SeriesKeyHash {
+    size_t operator()(const SeriesKey& key) const {
+        return std::hash<const void*>()(key.label) ^ ((size_t)key.family << 1) ^ (key.length << 8);
+    }
+};
+
+template <typename T>
+struct Series {
+    MetricFamily family;
+    std::string_view label;
+    T value;
+};
+
+template <typename T>
+struct SeriesList {
+    std::deque<Series<T>> series;
+    std::unordered_map<SeriesKey, T*, SeriesKeyHash> index;     // owner thread only
+};
+
+struct ThreadSeries {
+    SeriesList<ValueHistogram> histograms;
+    SeriesList<MetricCounter> counters;
+    SeriesList<MetricGauge> gauges;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadSeries>> threads;    // kept after their threads exit
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadSeries& localSeries() {
+    thread_local ThreadSeries* series = [] {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.push_back(std::make_unique<ThreadSeries>());
+        return r.threads.back().get();
+    }();
+    return *series;
+}
+
+template <typename T>
+T& find(SeriesList<T>& list, MetricFamily family, std::string_view label) {
+    SeriesKey key{family, label.data(), label.size()};
+    auto it = list.index.find(key);
+    if (it != list.index.end()) return *it->second;
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    Series<T>& added = list.series.emplace_back();
+    added.family = family;
+    added.label = label;
+    list.index.emplace(key, &added.value);
+    return added.value;
+}
+
+// name="value"; Prometheus label values escape backslash, quote and newline
+void appendLabel(std::string& out, const char* name, std::string_view value) {
+    out += name;
+    out += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+void appendNumber(std::string& out, double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    out += buf;
+}
+
+void appendHeader(std::string& out, const FamilyInfo& info) {
+    static const char* const kTypeNames[] = {"histogram", "counter", "gauge"};
+    out += "# HELP ";
+    out += info.name;
+    out += ' ';
+    out += info.help;
+    out += "\n# TYPE ";
+    out += info.name;
+    out += ' ';
+    out += kTypeNames[(size_t)info.kind];
+    out += '\n';
+}
+
+// One sample line: name[suffix]{labels} value
+void appendSample(std::string& out, const FamilyInfo& info, const char* suffix, const std::string& labels, double value) {
+    out += info.name;
+    out += suffix;
+    out += labels;
+    out += ' ';
+    appendNumber(out, value);
+    out += '\n';
+}
+
+std::string labelsFor(const FamilyInfo& info, const std::string& label) {
+    if (!info.labelName) return {};
+    std::string out = "{";
+    appendLabel(out, info.labelName, label);
+    out += '}';
+    return out;
+}
+
+// Cumulative buckets up to the last one that has seen a value (inclusive
+// upper bounds, so `le` is the bucket's limit minus one), then +Inf
+void appendHistogram(std::string& out, const FamilyInfo& info, const std::string& label, const ValueHistogram::Snapshot& h) {
+    double scale = info.micros ? 1e-6 : 1.0;
+    int last = -1;
+    for (int i = 0; i < ValueHistogram::kBuckets; i++) {
+        if (h.buckets[i]) last = i;
+    }
+    std::string open = "{";
+    if (info.labelName) {
+        appendLabel(open, info.labelName, label);
+        open += ',';
+    }
+    uint64_t cumulative = 0;
+    char le[32];
+    for (int i = 0; i <= last; i++) {
+        cumulative += h.buckets[i];
+        std::snprintf(le, sizeof(le), "%.9g", (double)(ValueHistogram::bucketLimit(i) - 1) * scale);
+        appendSample(out, info, "_bucket", open + "le=\"" + le + "\"}", (double)cumulative);
+    }
+    appendSample(out, info, "_bucket", open + "le=\"+Inf\"}", (double)h.count);
+    std::string labels = labelsFor(info, label);
+    appendSample(out, info, "_sum", labels, (double)h.sum * scale);
+    appendSample(out, info, "_count", labels, (double)h.count);
+}
+
+} // namespace
+
+// ----------------------
+// Metrics
+// ----------------------
+ValueHistogram& Metrics::histogram(MetricFamily family, std::string_view label) {
+    return find(localSeries().histograms, family, label);
+}
+
+MetricCounter& Metrics::counter(MetricFamily family, std::string_view label) {
+    return find(localSeries().counters, family, label);
+}
+
+MetricGauge& Metrics::gauge(MetricFamily family) {
+    return find(localSeries().gauges, family, {});
+}
+
+std::string Metrics::render() {
+    // Summed per family and label text: the same label may sit at different
+    // addresses on different threads (one copy per translation unit)
+    std::map<std::string, ValueHistogram::Snapshot> histograms[(size_t)MetricFamily::Count];
+    std::map<std::string, uint64_t> counters[(size_t)MetricFamily::Count];
+    int64_t gauges[(size_t)MetricFamily::Count] = {};
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto& thread : r.threads) {
+            for (const auto& s : thread->histograms.series) s.value.addTo(histograms[(size_t)s.family][std::string(s.label)]);
+            for (const auto& s : thread->counters.series) counters[(size_t)s.family][std::string(s.label)] += s.value.get();
+            for (const auto& s : thread->gauges.series) gauges[(size_t)s.family] += s.value.get();
+        }
+    }
+
+    std::string out;
+    out.reserve(16 * 1024);
+    for (size_t f = 0; f < (size_t)MetricFamily::Count; f++) {
+        const FamilyInfo& info = kFamilies[f];
+        appendHeader(out, info);
+        switch (info.kind) {
+            case Kind::Histogram:
+                for (const auto& [label, snapshot] : histograms[f]) appendHistogram(out, info, label, snapshot);
+                break;
+            case Kind::Counter:
+                if (counters[f].empty() && !info.labelName) appendSample(out, info, "", "", 0);
+                for (const auto& [label, value] : counters[f]) appendSample(out, info, "", labelsFor(info, label), (double)value);
+                break;
+            case Kind::Gauge:
+                appendSample(out, info, "", "", (double)gauges[f]);
+                break;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// ----------------------
+// Metrics
+// Every thread records into its own series (one relaxed load and store per
+// update, no shared cache lines, no locks); a scrape walks every thread's
+// series, sums them by name and label and renders the Prometheus text format.
+// Nothing is aggregated until someone asks for /metrics.
+// ----------------------
+
+// Log-linear buckets, HDR-style: exact below 4, then 4 sub-buckets per power
+// of two (relative error under 25%) up to 2^38, past which everything lands
+// in the last bucket. Values are microseconds for latencies and plain counts
+// for sizes.
+class ValueHistogram {
+public:
+    static constexpr int kSubBuckets = 4;
+    static constexpr int kMaxExponent = 37;
+    static constexpr int kBuckets = kSubBuckets + (kMaxExponent - 1) * kSubBuckets; // exact range + [2^2, 2^38)
+
+    static int bucketOf(uint64_t value);
+    // Smallest value that no longer falls into `bucket`
+    static uint64_t bucketLimit(int bucket);
+
+    // Owner thread only; other threads may only read (addTo)
+    void record(uint64_t value) {
+        bump(buckets[bucketOf(value)], 1);
+        bump(sum, value);
+    }
+
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> buckets{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+    };
+    // The count is the sum of the buckets, so a scrape racing a record()
+    // still renders a consistent histogram
+    void addTo(Snapshot& out) const;
+
+private:
+    static void bump(std::atomic<uint64_t>& cell, uint64_t by) {
+        cell.store(cell.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    std::atomic<uint64_t> sum{0};
+};
+
+// Monotonic per-thread counter; scrapes report the sum over threads
+class MetricCounter {
+public:
+    void add(uint64_t by = 1) { value.store(value.load(std::memory_order_relaxed) + by, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+// Per-thread gauge (e.g. a shard's connections); scrapes report the sum
+class MetricGauge {
+public:
+    void set(int64_t v) { value.store(v, std::memory_order_relaxed); }
+    int64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value{0};
+};
+
+// Metric families. Each knows its Prometheus name, help text and whether
+// its histogram values are microseconds (rendered as seconds).
+enum class MetricFamily : uint8_t {
+    MessageDuration,    // histogram, label "type": handling one inbound message on its loop
+    QueryDuration,      // histogram, label "query": one Database method, connection time included
+    RoomFanout,         // histogram: recipients of one room publish
+    MessagesReceived,   // counter, label "type"
+    ReceivedBytes,      // counter
+    Publishes,          // counter: room publishes (one payload, many recipients)
+    PublishedBytes,     // counter: payload bytes times recipients
+    DirectSends,        // counter: frames sent to one socket
+    DirectSentBytes,    // counter
+    Connections,        // gauge
+    RoomsOccupied,      // gauge: rooms with at least one avatar
+    RoomMembers,        // gauge: avatars over all rooms
+    Count
+};
+
+class Metrics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // The calling thread's series. `label` must outlive the process (string
+    // literals, kEventTypeNames): it is cached by address. The first use per
+    // thread and label takes the registry lock; later ones are a hash lookup.
+    static ValueHistogram& histogram(MetricFamily family, std::string_view label = {});
+    static MetricCounter& counter(MetricFamily family, std::string_view label = {});
+    static MetricGauge& gauge(MetricFamily family);
+
+    static uint64_t microsSince(Clock::time_point start) {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    }
+
+    // Prometheus text exposition format (version 0.0.4)
+    static std::string render();
+};
+
+// Records its lifetime into a latency histogram
+class ScopedTimer {
+public:
+    ScopedTimer(MetricFamily family, std::string_view label) : family(family), label(label), start(Metrics::Clock::now()) {}
+    ~ScopedTimer() {
+        if (!label.empty()) Metrics::histogram(family, label).record(Metrics::microsSince(start));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    // The label is often only known part-way through (e.g. after parsing);
+    // an empty label records nothing
+    void relabel(std::string_view newLabel) { label = newLabel; }
+
+private:
+    MetricFamily family;
+    std::string_view label;
+    Metrics::Clock::time_point start;
+};
+
+// One Database method call
+class QueryTimer : public ScopedTimer {
+public:
+    explicit QueryTimer(std::string_view query) : ScopedTimer(MetricFamily::QueryDuration, query) {}
+};
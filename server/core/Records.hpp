@@ -0,0 +1,107 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// ---------- Storage records ----------
+// Plain rows as the Database hands them out. Kept apart from Database.hpp so
+// code that only serializes or caches them (catalogues, benchmarks) does not
+// need libpqxx.
+
+// ---------- Room-Related Structs ----------
+struct RoomInfo {
+    int id;
+    std::string name;
+    int ownerId;
+    bool isPublic;
+    std::optional<std::string> pinCode;
+    int playerCount;
+    std::string layoutJson;
+    int width = 10;
+    int height = 10;
+};
+
+struct RoomMetadata {
+    int id;
+    std::string name;
+    float width;
+    float height;
+    float skewAngle;
+    std::string texturePath;
+    bool editable;
+};
+
+// What happened to an item, in snapshot deltas and furniture events
+enum class FurnitureChange { Added, Updated, Removed };
+
+struct RoomObject {
+    int id;
+    std::string name;
+    std::string spritePath;
+    float x, y, rotation, scale;
+    bool interactable;
+};
+
+struct RoomTemplate {
+    int id;
+    std::string name;
+    float width;
+    float height;
+    float skewAngle;
+    std::string texturePath;
+    std::string defaultLayoutJson;
+    bool editable;
+};
+
+
+// ---------- Chat Struct ----------
+struct ChatLine {
+    int roomId;
+    std::string username;
+    std::string message;
+};
+
+// ---------- Player Position Struct ----------
+struct PlayerPosition {
+    int userId;
+    int roomId;
+    float x, y;
+    std::string direction;
+};
+
+// Everything a session needs after login, loaded in one round trip (loadLogin).
+// The password is checked afterwards, off the DB worker (see AuthPool).
+struct LoginRecord {
+    int userId = -1;
+    std::string passwordHash;
+    std::unordered_set<std::string> roles;
+    std::vector<std::string> inventory;
+    std::optional<PlayerPosition> position;
+};
+
+// Rows for one bulk upsert, one vector per column (see upsertPlayerPositions)
+struct PositionBatch {
+    std::vector<int> userIds;
+    std::vector<int> roomIds;
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<std::string> directions;
+
+    void push(int userId, int roomId, float x, float y, const std::string& direction) {
+        userIds.push_back(userId);
+        roomIds.push_back(roomId);
+        xs.push_back(x);
+        ys.push_back(y);
+        directions.push_back(direction);
+    }
+    size_t size() const { return userIds.size(); }
+    bool empty() const { return userIds.empty(); }
+};
+
+// What opening a room needs from storage, loaded together (loadRoom).
+// Each part is nullopt on its own when its query failed.
+struct RoomLoad {
+    std::optional<std::vector<RoomObject>> objects;
+    std::optional<std::vector<ChatLine>> chat;
+};
@@ -0,0 +1,58 @@
+#include "RoomJson.hpp"
+
+void writeRoomObject(JsonWriter& w, const RoomObject& o, std::string_view uid) {
+    w.beginObject();
+    w.field("id", o.id);
+    w.optionalField("uid", uid);
+    w.field("name", o.name);
+    w.field("sprite_path", o.spritePath);
+    // we store tx/ty as x/y
+    w.field("tx", o.x);
+    w.field("ty", o.y);
+    w.field("rotation", o.rotation);
+    w.field("scale", o.scale);
+    w.field("interactable", o.interactable);
+    w.endObject();
+}
+
+void writeRoomTemplate(JsonWriter& w, const RoomTemplate& t) {
+    w.beginObject();
+    w.field("id", t.id);
+    w.field("name", t.name);
+    w.field("width", t.width);
+    w.field("height", t.height);
+    w.field("skew_angle", t.skewAngle);
+    w.field("texture_path", t.texturePath);
+    // defaultLayoutJson stored as string (may already be JSON). We will include as string.
+    w.field("default_layout_json", t.defaultLayoutJson);
+    w.field("editable", t.editable);
+    w.endObject();
+}
+
+const char* furnitureChangeName(FurnitureChange change) {
+    switch (change) {
+        case FurnitureChange::Added: return "added";
+        case FurnitureChange::Updated: return "updated";
+        case FurnitureChange::Removed: return "removed";
+    }
+    return "updated";
+}
+
+static const char* furnitureEventType(FurnitureChange change) {
+    switch (change) {
+        case FurnitureChange::Added: return "FURNITURE_ADDED";
+        case FurnitureChange::Updated: return "FURNITURE_UPDATED";
+        case FurnitureChange::Removed: return "FURNITURE_REMOVED";
+    }
+    return "FURNITURE_UPDATED";
+}
+
+void writeFurnitureEvent(JsonWriter& w, FurnitureChange change, std::string_view room, uint64_t version,
+                         std::string_view objectJson) {
+    w.beginObject();
+    w.field("type", furnitureEventType(change));
+    w.field("room", room);
+    if (version) w.field("version", version);
+    w.key("furniture").raw(objectJson);
+    w.endObject();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include "JsonWriter.hpp"
+#include "Records.hpp"
+
+// ---------- Record serializers ----------
+// The JSON shapes clients get for furniture and room templates, shared by
+// the handlers, the template catalogue and bench/hotpath_bench.
+
+// uid is the id clients key furniture by (creator's local uid or dbid_<id>);
+// empty leaves it out
+void writeRoomObject(JsonWriter& w, const RoomObject& o, std::string_view uid);
+
+void writeRoomTemplate(JsonWriter& w, const RoomTemplate& t);
+
+// "added" / "updated" / "removed", as FURNITURE_DELTAS lists them
+const char* furnitureChangeName(FurnitureChange change);
+
+// FURNITURE_ADDED/UPDATED/REMOVED around an object already serialized by
+// writeRoomObject; version 0 (snapshot still loading) is left out. The binary
+// form is writeFurnitureEventBinary in network/Protocol.hpp.
+void writeFurnitureEvent(JsonWriter& w, FurnitureChange change, std::string_view room, uint64_t version,
+                         std::string_view objectJson);
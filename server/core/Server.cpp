@@ -0,0 +1,111 @@
+#include "Server.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static thread_local Shard* currentShard = nullptr;
+
+// ----------------------
+// ShardMailbox
+// ----------------------
+bool ShardMailbox::post(Task task) {
+    if (!queue.tryPush(std::move(task))) {
+        rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    postedCount.fetch_add(1, std::memory_order_relaxed);
+    if (!scheduled.exchange(true, std::memory_order_acq_rel)) {
+        loop->defer([this] { drain(); });
+    }
+    return true;
+}
+
+void ShardMailbox::drain() {
+    // Cleared before popping: a post racing with this drain either lands in
+    // the loop below or schedules the next drain itself
+    scheduled.exchange(false, std::memory_order_acq_rel);
+    Task task;
+    while (queue.tryPop(task)) task();
+}
+
+// ----------------------
+// ShardedServer
+// ----------------------
+ShardedServer::ShardedServer(size_t shardCount, int portBase) {
+    shardCount = std::max<size_t>(1, shardCount);
+    for (size_t i = 0; i < shardCount; i++) {
+        auto shard = std::make_unique<Shard>();
+        shard->index = i;
+        shard->port = portBase + (int)i;
+        shards.push_back(std::move(shard));
+    }
+}
+
+size_t ShardedServer::ownerOf(int roomId) const {
+    // splitmix64 finalizer so consecutive ids spread evenly
+    uint64_t x = (uint64_t)(uint32_t)roomId + 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return (size_t)(x % shards.size());
+}
+
+Shard* ShardedServer::current() {
+    return currentShard;
+}
+
+bool ShardedServer::post(size_t index, ShardMailbox::Task task) {
+    if (index >= shards.size()) return false;
+    return shards[index]->mailbox.post(std::move(task));
+}
+
+void ShardedServer::postOthers(const ShardMailbox::Task& task) {
+    for (auto& shard : shards) {
+        if (shard.get() != currentShard) shard->mailbox.post(task);
+    }
+}
+
+void ShardedServer::run(const ShardMain& shardMain, const AfterLoops& afterLoops) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t ready = 0;
+    size_t stopped = 0;
+    bool released = false;
+
+    auto start = [&](Shard& shard, bool holdLoop) {
+        shard.loop = uWS::Loop::get();
+        shard.mailbox.bind(shard.loop);
+        currentShard = &shard;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready++;
+            cv.notify_all();
+            cv.wait(lock, [&] { return ready == shards.size(); });
+        }
+        shardMain(shard);
+        currentShard = nullptr;
+        std::unique_lock<std::mutex> lock(mutex);
+        stopped++;
+        cv.notify_all();
+        // Keeps this thread, and with it its Loop, alive through afterLoops
+        if (holdLoop) cv.wait(lock, [&] { return released; });
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < shards.size(); i++) {
+        threads.emplace_back([&start, shard = shards[i].get()] { start(*shard, true); });
+    }
+    start(*shards[0], false);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return stopped == shards.size(); });
+    }
+    if (afterLoops) afterLoops();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released = true;
+    }
+    cv.notify_all();
+    for (auto& t : threads) t.join();
+}
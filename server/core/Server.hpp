@@ -0,0 +1,88 @@
+#pragma once
+#include <uWebSockets/App.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Utils.hpp"
+
+// ---------- Shard Mailbox ----------
+// Work posted to a shard from other threads. The queue itself is lock-free;
+// only the first post into an empty mailbox wakes the shard's loop (one
+// Loop::defer), everything posted before the drain runs rides along.
+class ShardMailbox {
+public:
+    using Task = std::function<void()>;
+
+    explicit ShardMailbox(size_t capacity = 8192) : queue(capacity) {}
+
+    ShardMailbox(const ShardMailbox&) = delete;
+    ShardMailbox& operator=(const ShardMailbox&) = delete;
+
+    void bind(uWS::Loop* owner) { loop = owner; }
+
+    // Any thread. False when the mailbox is full (the task is dropped).
+    bool post(Task task);
+
+    size_t depth() const { return queue.sizeApprox(); }
+    uint64_t posted() const { return postedCount.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejectedCount.load(std::memory_order_relaxed); }
+
+private:
+    void drain();
+
+    MpmcQueue<Task> queue;
+    uWS::Loop* loop = nullptr;
+    std::atomic<bool> scheduled{false};
+    std::atomic<uint64_t> postedCount{0};
+    std::atomic<uint64_t> rejectedCount{0};
+};
+
+// ---------- Shard ----------
+struct Shard {
+    size_t index = 0;
+    int port = 0;                   // shard-private port; handed-over sessions reconnect here
+    uWS::Loop* loop = nullptr;
+    ShardMailbox mailbox;
+};
+
+// ---------- Sharded Server ----------
+// One uWS loop per thread. Every shard listens on the shared public port
+// (uSockets binds with SO_REUSEPORT, so the kernel spreads new connections
+// across the shards) and on its own port, portBase + index. Each room is
+// owned by exactly one shard, picked by hashing the room id; loop-thread
+// state (registry, broadcaster, simulation) is per shard and other shards
+// only ever reach it through the mailbox.
+class ShardedServer {
+public:
+    using ShardMain = std::function<void(Shard&)>;
+    using AfterLoops = std::function<void()>;
+
+    ShardedServer(size_t shardCount, int portBase);
+
+    size_t size() const { return shards.size(); }
+    Shard& shard(size_t index) { return *shards[index]; }
+
+    // Stable for a given shard count
+    size_t ownerOf(int roomId) const;
+
+    // The shard running on the calling thread; nullptr off the loops
+    static Shard* current();
+
+    bool post(size_t index, ShardMailbox::Task task);
+    // Every shard but the caller's
+    void postOthers(const ShardMailbox::Task& task);
+
+    // Runs shardMain on one thread per shard (shard 0 on the calling thread)
+    // and returns once every loop has exited. All loops are bound to their
+    // mailboxes before any shardMain starts, so posting is safe from the start.
+    // afterLoops runs on the calling thread once every shardMain has returned
+    // but before any shard thread ends: uWS frees a thread's Loop when the
+    // thread exits, and worker jobs still queued defer onto those loops, so
+    // the pools have to be stopped there.
+    void run(const ShardMain& shardMain, const AfterLoops& afterLoops = {});
+
+private:
+    std::vector<std::unique_ptr<Shard>> shards;
+};
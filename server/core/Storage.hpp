@@ -0,0 +1,117 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "Records.hpp"
+
+// ---------- Storage interface ----------
+// Everything the server persists, independent of where it goes. Two
+// backends: Database (Postgres, one connection per instance) and LogStore
+// (embedded, in-process, one instance shared by every thread).
+// Failures are reported the same way by both: nullopt / -1 / false / empty,
+// with the error logged.
+class Storage {
+public:
+    virtual ~Storage() = default;
+
+    // ----------------------
+    // Users
+    // ----------------------
+    virtual std::optional<int> authenticateUser(const std::string& username, const std::string& password) = 0;
+    // Credentials, roles, inventory and last position; nullopt for unknown users
+    virtual std::optional<LoginRecord> loadLogin(const std::string& username) = 0;
+    virtual bool createUserWithHash(const std::string& username, const std::string& email, const std::string& hashed,
+                                    std::string role = "user") = 0;
+    virtual bool isEmailRegistered(const std::string& email) = 0;
+    virtual bool isUsernameRegistered(const std::string& username) = 0;
+    virtual std::unordered_set<std::string> getUserRoles(int userId) = 0;
+    virtual std::vector<std::string> getUserInventory(int userId) = 0;
+
+    // ----------------------
+    // Rooms
+    // ----------------------
+    // Returns the room id, or -1 (also when the name is taken)
+    virtual int createRoom(const std::string& roomName, int ownerId, bool isPublic = true,
+                           const std::optional<std::string>& pinCode = std::nullopt, const std::string& layoutJson = "{}",
+                           bool editable = true, int width = 10, int height = 10, int skewAngle = 30,
+                           const std::string& texturePath = "") = 0;
+    virtual std::optional<std::string> getRoomLayout(int roomId) = 0;
+    virtual void updateRoomLayout(int roomId, const std::string& layoutJson) = 0;
+    virtual int getRoomIdByOwner(const std::string& roomName, int ownerId,
+                                 const std::optional<std::string>& pinCode = std::nullopt) = 0;
+    virtual int getPublicRoomIdByName(const std::string& roomName) = 0;
+    // Full room row for the in-memory registry (pin is checked by the caller)
+    virtual std::optional<RoomInfo> getPublicRoomByName(const std::string& roomName) = 0;
+    virtual std::optional<RoomInfo> getRoomByOwner(const std::string& roomName, int ownerId) = 0;
+    virtual std::vector<RoomInfo> getAllRoomsOrderedByPlayers() = 0;
+    virtual std::optional<RoomMetadata> getRoomMetadata(int roomId) = 0;
+
+    int createRoomFromTemplate(int ownerId, int templateId, const std::string& roomName,
+                               const std::optional<std::string>& pinCode = std::nullopt) {
+        auto tplOpt = getRoomTemplateById(templateId);
+        if (!tplOpt.has_value()) return -1;
+        return createRoomFromTemplate(ownerId, tplOpt.value(), roomName, pinCode);
+    }
+
+    // For callers that already hold the template (TemplateCatalogue)
+    int createRoomFromTemplate(int ownerId, const RoomTemplate& tpl, const std::string& roomName,
+                               const std::optional<std::string>& pinCode = std::nullopt) {
+        return createRoom(roomName, ownerId, true, pinCode, tpl.defaultLayoutJson, tpl.editable, (int)tpl.width,
+                          (int)tpl.height, (int)tpl.skewAngle, tpl.texturePath);
+    }
+
+    // ----------------------
+    // Room templates
+    // ----------------------
+    // Ordered by name
+    virtual std::vector<RoomTemplate> getAllRoomTemplates() = 0;
+    virtual std::optional<RoomTemplate> getRoomTemplateById(int templateId) = 0;
+
+    // ----------------------
+    // Room objects (furniture)
+    // ----------------------
+    // Like getRoomObjects, but tells "no furniture" apart from a failed read
+    virtual std::optional<std::vector<RoomObject>> loadRoomObjects(int roomId) = 0;
+    std::vector<RoomObject> getRoomObjects(int roomId) {
+        return loadRoomObjects(roomId).value_or(std::vector<RoomObject>{});
+    }
+    // Furniture plus the last `chatLimit` chat lines, for a room nobody has
+    // open yet; backends that can fetch both at once override this
+    virtual RoomLoad loadRoom(int roomId, int chatLimit) {
+        return RoomLoad{loadRoomObjects(roomId), getRecentChat(roomId, chatLimit)};
+    }
+    // Returns the new object's id, or -1 on failure
+    virtual int addRoomObject(int roomId, const std::string& name, const std::string& spritePath, float x, float y,
+                              float rotation = 0, float scale = 1.0, bool interactable = false) = 0;
+    virtual bool updateRoomObject(int objectId, float x, float y, float rotation) = 0;
+    virtual bool removeRoomObject(int objectId, int roomId) = 0;
+    virtual void clearRoomObjects(int roomId) = 0;
+
+    // ----------------------
+    // Player positions and presence
+    // ----------------------
+    virtual void updatePlayerPosition(int userId, int roomId, float x, float y, const std::string& direction) = 0;
+    // Any number of rows at once; the last row wins for a repeated user
+    virtual void upsertPlayerPositions(const PositionBatch& batch) = 0;
+    virtual std::optional<PlayerPosition> getPlayerPosition(int userId) = 0;
+    // Snapshot of the in-memory PresenceRegistry counts, for room listings
+    virtual void updateRoomPlayerCounts(const std::vector<int>& roomIds, const std::vector<int>& counts) = 0;
+    // At startup nobody is connected yet, whatever a previous run left behind
+    virtual void resetPresence() = 0;
+
+    // ----------------------
+    // Chat
+    // ----------------------
+    virtual void insertChatMessage(int roomId, const std::string& username, const std::string& message) = 0;
+    // The room's last `limit` lines, oldest first
+    virtual std::optional<std::vector<ChatLine>> getRecentChat(int roomId, int limit) = 0;
+    // All lines or none
+    virtual bool insertChatMessages(const std::vector<ChatLine>& lines) = 0;
+};
+
+// Hands a thread its Storage: a new Postgres connection per call, or the
+// one embedded store every call
+using StorageFactory = std::function<std::shared_ptr<Storage>()>;
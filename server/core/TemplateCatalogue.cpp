@@ -0,0 +1,62 @@
+#include "TemplateCatalogue.hpp"
+#include <atomic>
+#include <cstdio>
+#include "RoomJson.hpp"
+
+// FNV-1a; only has to change when the bytes do
+static std::string contentHash(const std::string& bytes) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : bytes) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+    return hex;
+}
+
+// ----------------------
+// TemplateSnapshot
+// ----------------------
+const RoomTemplate* TemplateSnapshot::find(int templateId) const {
+    auto it = indexById.find(templateId);
+    return it == indexById.end() ? nullptr : &templates[it->second];
+}
+
+const std::string* TemplateSnapshot::findJson(int templateId) const {
+    auto it = indexById.find(templateId);
+    return it == indexById.end() ? nullptr : &itemJson[it->second];
+}
+
+// ----------------------
+// TemplateCatalogue
+// ----------------------
+std::shared_ptr<const TemplateSnapshot> TemplateCatalogue::build(std::vector<RoomTemplate> templates) {
+    auto snapshot = std::make_shared<TemplateSnapshot>();
+    snapshot->templates = std::move(templates);
+    snapshot->itemJson.reserve(snapshot->templates.size());
+    {
+        JsonWriter list;
+        list.beginArray();
+        for (size_t i = 0; i < snapshot->templates.size(); i++) {
+            const RoomTemplate& t = snapshot->templates[i];
+            JsonWriter item;
+            writeRoomTemplate(item, t);
+            snapshot->itemJson.push_back(item.str());
+            list.raw(item.view());
+            snapshot->indexById[t.id] = i;
+        }
+        list.endArray();
+        snapshot->listJson = list.str();
+    }
+    snapshot->version = contentHash(snapshot->listJson);
+    return snapshot;
+}
+
+std::shared_ptr<const TemplateSnapshot> TemplateCatalogue::current() const {
+    return std::atomic_load(&snapshot);
+}
+
+void TemplateCatalogue::publish(std::vector<RoomTemplate> templates) {
+    std::atomic_store(&snapshot, build(std::move(templates)));
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Records.hpp"
+
+// ---------- Template Snapshot ----------
+// One immutable generation of the room templates together with the JSON
+// the handlers send for it, serialized once when the snapshot is built.
+struct TemplateSnapshot {
+    std::vector<RoomTemplate> templates;        // ordered by name, as loaded
+    std::string version;                        // content hash of listJson
+    std::string listJson;                       // the "data" array of ROOM_TEMPLATES
+    std::vector<std::string> itemJson;          // one object per template, same order
+
+    const RoomTemplate* find(int templateId) const;
+    // nullptr for unknown ids
+    const std::string* findJson(int templateId) const;
+
+private:
+    friend class TemplateCatalogue;
+    std::unordered_map<int, size_t> indexById;
+};
+
+// ---------- Template Catalogue ----------
+// Read by every shard without locking: current() hands out the snapshot
+// that was live at the time, and publish() swaps in a new one atomically.
+// Old snapshots go away with their last reader.
+class TemplateCatalogue {
+public:
+    std::shared_ptr<const TemplateSnapshot> current() const;
+    void publish(std::vector<RoomTemplate> templates);
+
+    static std::shared_ptr<const TemplateSnapshot> build(std::vector<RoomTemplate> templates);
+
+private:
+    std::shared_ptr<const TemplateSnapshot> snapshot = build({});   // std::atomic_load/store only
+};
@@ -0,0 +1,105 @@
+#include "WorkerQueue.hpp"
+#include <iostream>
+
+WorkerQueue::WorkerQueue(std::string name, size_t capacity, OnStop onStop)
+    : name(std::move(name)), onStop(onStop), queue(capacity) {}
+
+WorkerQueue::~WorkerQueue() {
+    stop();
+}
+
+void WorkerQueue::start(size_t workerCount) {
+    if (workerCount == 0) workerCount = 1;
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+void WorkerQueue::stop() {
+    if (stopping.exchange(true)) return;
+    {
+        std::lock_guard<std::mutex> lk(idleMutex);
+    }
+    idleCv.notify_all();
+    for (auto& t : workers) {
+        if (t.joinable()) t.join();
+    }
+}
+
+bool WorkerQueue::push(Job job) {
+    if (stopping.load()) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (!queue.tryPush(Entry{std::move(job), steadyNowNs()})) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    submitted.fetch_add(1, std::memory_order_relaxed);
+    ready.fetch_add(1);
+
+    // A worker that registered as a sleeper has either already seen ready > 0
+    // or is parked on the cv; taking the mutex orders us after its wait().
+    if (sleepers.load() > 0) {
+        { std::lock_guard<std::mutex> lk(idleMutex); }
+        idleCv.notify_one();
+    }
+    return true;
+}
+
+// Takes one of the ready jobs; the entry is then this worker's to pop
+bool WorkerQueue::claim() {
+    size_t n = ready.load();
+    while (n > 0 && !ready.compare_exchange_weak(n, n - 1)) {}
+    return n > 0;
+}
+
+void WorkerQueue::workerLoop(size_t index) {
+    Entry entry;
+    for (;;) {
+        if (stopping.load() && onStop == OnStop::Discard) break;
+        if (claim()) {
+            // Only misses while an earlier slot's push is still being written
+            while (!queue.tryPop(entry)) std::this_thread::yield();
+            uint64_t start = steadyNowNs();
+            uint64_t wait = start - entry.enqueuedAtNs;
+            totalWaitNs.fetch_add(wait, std::memory_order_relaxed);
+            uint64_t prevMax = maxWaitNs.load(std::memory_order_relaxed);
+            while (wait > prevMax && !maxWaitNs.compare_exchange_weak(prevMax, wait, std::memory_order_relaxed)) {}
+
+            try {
+                entry.run(index);
+            } catch (const std::exception& e) {
+                std::cerr << "❌ " << name << " job failed: " << e.what() << std::endl;
+            }
+            entry.run = nullptr;
+
+            totalRunNs.fetch_add(steadyNowNs() - start, std::memory_order_relaxed);
+            completed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (stopping.load()) break;
+
+        std::unique_lock<std::mutex> lk(idleMutex);
+        sleepers.fetch_add(1);
+        idleCv.wait(lk, [this] { return stopping.load() || ready.load() > 0; });
+        sleepers.fetch_sub(1);
+    }
+}
+
+WorkerQueueStats WorkerQueue::stats() const {
+    WorkerQueueStats s;
+    s.workers = workers.size();
+    s.queueDepth = queue.sizeApprox();
+    s.queueCapacity = queue.capacity();
+    s.submitted = submitted.load(std::memory_order_relaxed);
+    s.completed = completed.load(std::memory_order_relaxed);
+    s.rejected = rejected.load(std::memory_order_relaxed);
+    if (s.completed > 0) {
+        s.avgWaitMs = totalWaitNs.load(std::memory_order_relaxed) / 1e6 / s.completed;
+        s.avgRunMs = totalRunNs.load(std::memory_order_relaxed) / 1e6 / s.completed;
+    }
+    s.maxWaitMs = maxWaitNs.load(std::memory_order_relaxed) / 1e6;
+    return s;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Utils.hpp"
+
+// ---------- Worker Queue Stats ----------
+struct WorkerQueueStats {
+    size_t workers = 0;
+    size_t queueDepth = 0;
+    size_t queueCapacity = 0;
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    uint64_t rejected = 0;
+    double avgWaitMs = 0;   // enqueue -> picked up by a worker
+    double maxWaitMs = 0;
+    double avgRunMs = 0;    // time spent inside the job itself
+};
+
+// ---------- Worker Queue ----------
+// The jobs and threads behind DatabasePool and AuthPool: a bounded lock-free
+// queue (MpmcQueue) and workers that park on a condition variable while it is
+// empty. Jobs get the index of the worker running them, so a pool can keep
+// per-worker state such as a connection.
+//
+// A worker only goes for the queue once it has claimed one of the `ready`
+// jobs, which are counted after their push has landed, so an idle worker
+// never spins on a queue that only looks non-empty.
+class WorkerQueue {
+public:
+    using Job = std::function<void(size_t worker)>;
+    // Drain: stop() returns once every queued job has run.
+    // Discard: queued jobs are dropped, only running ones finish.
+    enum class OnStop { Drain, Discard };
+
+    // `name` prefixes the log line of a job that throws, e.g. "DB pool"
+    WorkerQueue(std::string name, size_t capacity, OnStop onStop);
+    ~WorkerQueue();
+
+    WorkerQueue(const WorkerQueue&) = delete;
+    WorkerQueue& operator=(const WorkerQueue&) = delete;
+
+    // Once, after whatever the jobs need per worker is in place
+    void start(size_t workerCount);
+    // Any thread. False if the queue is full or stopping.
+    bool push(Job job);
+    void stop();
+
+    WorkerQueueStats stats() const;
+    size_t capacity() const { return queue.capacity(); }
+
+private:
+    struct Entry {
+        Job run;
+        uint64_t enqueuedAtNs = 0;
+    };
+
+    bool claim();
+    void workerLoop(size_t index);
+
+    const std::string name;
+    const OnStop onStop;
+    std::vector<std::thread> workers;
+    MpmcQueue<Entry> queue;
+
+    // Only used to park idle workers; the queue itself is lock-free.
+    std::mutex idleMutex;
+    std::condition_variable idleCv;
+    std::atomic<size_t> sleepers{0};
+    std::atomic<size_t> ready{0};       // pushed and not yet claimed
+    std::atomic<bool> stopping{false};
+
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> totalWaitNs{0};
+    std::atomic<uint64_t> maxWaitNs{0};
+    std::atomic<uint64_t> totalRunNs{0};
+};
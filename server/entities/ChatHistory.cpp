@@ -0,0 +1,48 @@
+#include "ChatHistory.hpp"
+#include <algorithm>
+
+void ChatHistory::push(const std::string& username, const std::string& message) {
+    if (ring.empty()) ring.resize(kCapacity);
+    size_t slot = (head + count) % ring.size();
+    if (count == ring.size()) {
+        byteCount -= ring[slot].username.size() + ring[slot].message.size();
+        head = (head + 1) % ring.size();
+    } else {
+        count++;
+    }
+    Entry& e = ring[slot];
+    e.username = username;
+    e.message.assign(message, 0, std::min(message.size(), kMaxMessageBytes));
+    byteCount += e.username.size() + e.message.size();
+}
+
+void ChatHistory::finishWarm(std::vector<ChatLine> older) {
+    std::vector<Entry> live;
+    live.reserve(count);
+    forEach([&live](const std::string& username, const std::string& message) { live.push_back(Entry{username, message}); });
+
+    // The journal may have flushed the first live lines before the query ran
+    size_t overlap = std::min(older.size(), live.size());
+    for (; overlap > 0; overlap--) {
+        bool same = true;
+        for (size_t i = 0; i < overlap && same; i++) {
+            const ChatLine& row = older[older.size() - overlap + i];
+            same = row.username == live[i].username && row.message.compare(0, kMaxMessageBytes, live[i].message) == 0;
+        }
+        if (same) break;
+    }
+    older.resize(older.size() - overlap);
+
+    head = count = byteCount = 0;
+    size_t total = older.size() + live.size();
+    size_t skip = total > kCapacity ? total - kCapacity : 0;
+    for (size_t i = skip; i < older.size(); i++) push(older[i].username, older[i].message);
+    for (size_t i = skip > older.size() ? skip - older.size() : 0; i < live.size(); i++) push(live[i].username, live[i].message);
+    current = State::Warm;
+}
+
+void ChatHistory::evict() {
+    std::vector<Entry>().swap(ring);
+    head = count = byteCount = 0;
+    current = State::Cold;
+}
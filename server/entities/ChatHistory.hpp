@@ -0,0 +1,64 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Records.hpp"
+
+// ---------- Chat History ----------
+// The last kCapacity chat lines of a room, kept in a fixed ring so a joining
+// session gets the backlog without a query. Warmed from room_chat the first
+// time someone joins; lines said while that query runs are kept and end up
+// newest. A room nobody is in gives its buffer back (evict) and warms again
+// on the next join, so memory follows the rooms in use, not the rooms known.
+class ChatHistory {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t kCapacity = 50;
+    static constexpr size_t kMaxMessageBytes = 512;     // longer lines are kept truncated
+
+    enum class State { Cold, Warming, Warm };
+
+    State state() const { return current; }
+    size_t size() const { return count; }
+    size_t bytes() const { return byteCount; }
+
+    void beginWarm() { current = State::Warming; }
+    // `older` oldest first. Rows the journal already wrote for lines pushed
+    // meanwhile are recognised and not repeated.
+    void finishWarm(std::vector<ChatLine> older);
+    void abortWarm() { current = State::Cold; }
+
+    void push(const std::string& username, const std::string& message);
+
+    // Oldest first
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < count; i++) {
+            const Entry& e = ring[(head + i) % ring.size()];
+            fn(e.username, e.message);
+        }
+    }
+
+    // Back to cold with the memory released
+    void evict();
+
+    Clock::time_point lastUsed() const { return used; }
+    void touch() { used = Clock::now(); }
+
+    std::vector<std::function<void(bool)>> waiters;    // run with `warm` once the warm-up completes
+
+private:
+    struct Entry {
+        std::string username;
+        std::string message;
+    };
+
+    State current = State::Cold;
+    std::vector<Entry> ring;        // allocated on first push, kCapacity slots
+    size_t head = 0;                // oldest line
+    size_t count = 0;
+    size_t byteCount = 0;
+    Clock::time_point used;
+};
@@ -0,0 +1,92 @@
+#include "FurnitureCatalog.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static constexpr int kMaxFootprintSide = 32;
+
+namespace {
+
+// Just enough JSON for the metadata files: an object of flat objects whose
+// values are strings or numbers
+struct MetadataReader {
+    std::string_view s;
+    size_t pos = 0;
+
+    void skipWs() {
+        while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\n' || s[pos] == '\r' || s[pos] == '\t')) pos++;
+    }
+    bool consume(char c) {
+        skipWs();
+        if (pos >= s.size() || s[pos] != c) return false;
+        pos++;
+        return true;
+    }
+    bool peek(char c) {
+        skipWs();
+        return pos < s.size() && s[pos] == c;
+    }
+    bool string(std::string& out) {
+        if (!consume('"')) return false;
+        out.clear();
+        while (pos < s.size() && s[pos] != '"') {
+            if (s[pos] == '\\' && pos + 1 < s.size()) pos++;
+            out.push_back(s[pos++]);
+        }
+        return consume('"');
+    }
+    bool number(double& out) {
+        skipWs();
+        const char* begin = s.data() + pos;
+        char* end = nullptr;
+        out = std::strtod(begin, &end);
+        if (end == begin) return false;
+        pos += (size_t)(end - begin);
+        return true;
+    }
+};
+
+} // namespace
+
+int FurnitureCatalog::loadFile(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return -1;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    MetadataReader r{text};
+    if (!r.consume('{')) return -1;
+    int added = 0;
+    std::string proto, key, ignored;
+    while (!r.peek('}')) {
+        if (!r.string(proto) || !r.consume(':') || !r.consume('{')) return -1;
+        FurnitureFootprint fp;
+        while (!r.peek('}')) {
+            if (!r.string(key) || !r.consume(':')) return -1;
+            if (r.peek('"')) {
+                if (!r.string(ignored)) return -1;
+            } else {
+                double value = 0;
+                if (!r.number(value)) return -1;
+                if (key == "tileWidth") fp.width = std::clamp((int)value, 1, kMaxFootprintSide);
+                else if (key == "tileHeight") fp.depth = std::clamp((int)value, 1, kMaxFootprintSide);
+                else if (key == "depth") fp.stackHeight = std::max(0.0f, (float)value);
+            }
+            r.consume(',');
+        }
+        r.consume('}');
+        r.consume(',');
+        byProto[proto] = fp;
+        added++;
+    }
+    return added;
+}
+
+const FurnitureFootprint& FurnitureCatalog::footprint(std::string_view protoId) const {
+    static const FurnitureFootprint kDefault;
+    auto it = byProto.find(std::string(protoId));
+    return it == byProto.end() ? kDefault : it->second;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Tiles an item covers when unrotated (x by y) and how much height it adds
+// to a stack; 0 means nothing can be placed on top of it
+struct FurnitureFootprint {
+    int width = 1;
+    int depth = 1;
+    float stackHeight = 0;
+};
+
+// ---------- Furniture Catalog ----------
+// Footprints by proto id, read from the client's metadata files
+// (client/game/metadata/*.json: {"<proto_id>": {"tileWidth":..,
+// "tileHeight":.., "depth":..}, ..}). Loaded once before the shards start
+// and read-only afterwards, so every shard shares it without locking.
+// Unknown protos are 1x1 and not stackable.
+class FurnitureCatalog {
+public:
+    // Adds every entry in one metadata file; -1 if it can't be read or parsed
+    int loadFile(const std::string& path);
+
+    const FurnitureFootprint& footprint(std::string_view protoId) const;
+    size_t size() const { return byProto.size(); }
+
+private:
+    std::unordered_map<std::string, FurnitureFootprint> byProto;
+};
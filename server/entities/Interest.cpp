@@ -0,0 +1,61 @@
+#include "Interest.hpp"
+#include <algorithm>
+
+void InterestGrid::resize(int widthTiles, int heightTiles) {
+    cols = std::max(0, (widthTiles + kCellTiles - 1) / kCellTiles);
+    rowCount = std::max(0, (heightTiles + kCellTiles - 1) / kCellTiles);
+    buckets.assign((size_t)cols * rowCount, {});
+    frameIndex.assign((size_t)cols * rowCount, -1);
+    cellById.clear();
+}
+
+void InterestGrid::release() {
+    cols = rowCount = 0;
+    decltype(buckets)().swap(buckets);
+    decltype(frameIndex)().swap(frameIndex);
+    decltype(cellById)().swap(cellById);
+}
+
+ViewCell InterestGrid::cellOf(Tile tile) const {
+    if (cols == 0 || rowCount == 0) return ViewCell{};
+    return ViewCell{std::clamp(tile.x / kCellTiles, 0, cols - 1), std::clamp(tile.y / kCellTiles, 0, rowCount - 1)};
+}
+
+ViewCell InterestGrid::placed(uint32_t avatarId) const {
+    auto it = cellById.find(avatarId);
+    return it == cellById.end() ? ViewCell{} : it->second;
+}
+
+const std::vector<std::pair<uint32_t, const void*>>& InterestGrid::avatarsIn(ViewCell cell) const {
+    static const std::vector<std::pair<uint32_t, const void*>> kEmpty;
+    if (!cell.valid() || cell.x >= cols || cell.y >= rowCount) return kEmpty;
+    return buckets[index(cell)];
+}
+
+ViewFrame& InterestGrid::frameFor(ViewCell cell, std::vector<ViewFrame>& frames, size_t& used) {
+    int32_t& slot = frameIndex[index(cell)];
+    if (slot >= 0) return frames[slot];
+    if (used == frames.size()) frames.emplace_back();
+    ViewFrame& frame = frames[used];
+    frame.cell = cell;
+    frame.avatars.clear();
+    frame.left.clear();
+    slot = (int32_t)used++;
+    return frame;
+}
+
+void InterestGrid::place(uint32_t avatarId, const void* owner, ViewCell from, ViewCell to) {
+    if (from.valid()) remove(avatarId, from);
+    buckets[index(to)].emplace_back(avatarId, owner);
+    cellById[avatarId] = to;
+}
+
+void InterestGrid::remove(uint32_t avatarId, ViewCell from) {
+    auto& bucket = buckets[index(from)];
+    auto it = std::find_if(bucket.begin(), bucket.end(), [avatarId](const auto& e) { return e.first == avatarId; });
+    if (it != bucket.end()) {
+        *it = bucket.back();
+        bucket.pop_back();
+    }
+    cellById.erase(avatarId);
+}
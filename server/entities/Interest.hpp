@@ -0,0 +1,134 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "WalkGrid.hpp"
+
+// One cell of a room's interest grid; default-constructed = nowhere
+struct ViewCell {
+    int x = -1;
+    int y = -1;
+    bool valid() const { return x >= 0 && y >= 0; }
+    bool operator==(const ViewCell& o) const { return x == o.x && y == o.y; }
+    bool operator!=(const ViewCell& o) const { return !(*this == o); }
+};
+
+// What one view cell's subscribers get for a tick: indices into the roster of
+// avatars that changed in sight (named = first time these viewers see it)
+// and ids that went out of sight or left the room
+struct ViewFrame {
+    ViewCell cell;
+    std::vector<std::pair<size_t, bool>> avatars;
+    std::vector<uint32_t> left;
+};
+
+// A viewer's own avatar crossed into another cell this tick
+struct ViewMove {
+    const void* owner = nullptr;
+    ViewCell from;
+    ViewCell to;
+};
+
+// ---------- Interest Grid ----------
+// Coarse kCellTiles-square buckets over a room so that movement and furniture
+// events only reach the sessions that can see them. A session follows the
+// cell its own avatar stands in and sees every cell within kViewRadius of it;
+// each view cell is one pub/sub topic, so every viewer still gets exactly one
+// frame per tick. The grid remembers which cell each avatar was last
+// announced in, which is what decides who gets a name (it came into view)
+// and who gets a "left" (it went out of view) when an avatar crosses cells.
+// Rooms that fit in a single view window don't filter at all.
+class InterestGrid {
+public:
+    static constexpr int kCellTiles = 8;
+    static constexpr int kViewRadius = 1;     // cells around the viewer's own
+
+    // Forgets every placement
+    void resize(int widthTiles, int heightTiles);
+    // Back to the unsized state, memory freed; resize() again before use
+    void release();
+
+    int columns() const { return cols; }
+    int rows() const { return rowCount; }
+    bool filtering() const { return cols > 2 * kViewRadius + 1 || rowCount > 2 * kViewRadius + 1; }
+
+    // Clamped into the grid, so avatars on the rim still land somewhere
+    ViewCell cellOf(Tile tile) const;
+    static bool sees(ViewCell viewer, ViewCell cell) {
+        return viewer.valid() && cell.valid() && std::abs(viewer.x - cell.x) <= kViewRadius &&
+               std::abs(viewer.y - cell.y) <= kViewRadius;
+    }
+
+    // Where an avatar was last announced (invalid if never)
+    ViewCell placed(uint32_t avatarId) const;
+
+    // Owners of the avatars last announced in `cell`
+    const std::vector<std::pair<uint32_t, const void*>>& avatarsIn(ViewCell cell) const;
+
+    // Cells within the view radius of `center`, clipped to the room
+    template <typename Fn>
+    void forEachVisible(ViewCell center, Fn&& fn) const {
+        if (!center.valid()) return;
+        for (int y = std::max(0, center.y - kViewRadius); y <= std::min(rowCount - 1, center.y + kViewRadius); y++) {
+            for (int x = std::max(0, center.x - kViewRadius); x <= std::min(cols - 1, center.x + kViewRadius); x++) {
+                fn(ViewCell{x, y});
+            }
+        }
+    }
+
+    // Turns one tick of roster changes into per-view-cell frames and records
+    // the new placements. `Avatar` needs id, owner, tile, changed and joined
+    // (RoomAvatar). Frames are reused across calls; returns how many of
+    // `frames` belong to this tick.
+    template <typename Avatar>
+    size_t collect(const std::vector<Avatar>& avatars, const std::vector<uint32_t>& departed,
+                   std::vector<ViewFrame>& frames, std::vector<ViewMove>& moves);
+
+private:
+    int index(ViewCell cell) const { return cell.y * cols + cell.x; }
+    ViewFrame& frameFor(ViewCell cell, std::vector<ViewFrame>& frames, size_t& used);
+    void place(uint32_t avatarId, const void* owner, ViewCell from, ViewCell to);
+    void remove(uint32_t avatarId, ViewCell from);
+
+    int cols = 0;
+    int rowCount = 0;
+    std::vector<std::vector<std::pair<uint32_t, const void*>>> buckets;   // by cell index
+    std::unordered_map<uint32_t, ViewCell> cellById;
+    std::vector<int32_t> frameIndex;    // by cell index, into this tick's frames; -1 = none yet
+};
+
+template <typename Avatar>
+size_t InterestGrid::collect(const std::vector<Avatar>& avatars, const std::vector<uint32_t>& departed,
+                             std::vector<ViewFrame>& frames, std::vector<ViewMove>& moves) {
+    size_t used = 0;
+    moves.clear();
+    for (uint32_t id : departed) {
+        ViewCell from = placed(id);
+        if (!from.valid()) continue;
+        remove(id, from);
+        forEachVisible(from, [&](ViewCell v) { frameFor(v, frames, used).left.push_back(id); });
+    }
+    for (size_t i = 0; i < avatars.size(); i++) {
+        const Avatar& avatar = avatars[i];
+        if (!avatar.changed) continue;
+        ViewCell to = cellOf(avatar.tile);
+        ViewCell from = placed(avatar.id);
+        if (from != to) {
+            place(avatar.id, avatar.owner, from, to);
+            if (from.valid()) moves.push_back(ViewMove{avatar.owner, from, to});
+        }
+        forEachVisible(to, [&](ViewCell v) {
+            frameFor(v, frames, used).avatars.emplace_back(i, avatar.joined || !sees(v, from));
+        });
+        if (from != to) {
+            forEachVisible(from, [&](ViewCell v) {
+                if (!sees(v, to)) frameFor(v, frames, used).left.push_back(avatar.id);
+            });
+        }
+    }
+    for (size_t n = 0; n < used; n++) frameIndex[index(frames[n].cell)] = -1;
+    return used;
+}
@@ -0,0 +1,95 @@
+#include "Occupancy.hpp"
+#include <algorithm>
+#include <cmath>
+
+TileRect footprintAt(const FurnitureFootprint& fp, float x, float y, float rotation) {
+    long quarter = std::lround(rotation / 90.0f);
+    bool turned = (quarter % 2) != 0;
+    return TileRect{(int)std::lround(x), (int)std::lround(y), turned ? fp.depth : fp.width, turned ? fp.width : fp.depth};
+}
+
+const char* placementError(Placement p) {
+    switch (p) {
+        case Placement::Ok: return "";
+        case Placement::OutOfBounds: return "out_of_bounds";
+        case Placement::NotFloor: return "not_floor";
+        case Placement::Occupied: return "occupied";
+        case Placement::Uneven: return "uneven";
+    }
+    return "invalid_placement";
+}
+
+// ----------------------
+// OccupancyGrid
+// ----------------------
+void OccupancyGrid::resize(int width, int height) {
+    w = std::max(0, width);
+    h = std::max(0, height);
+    cells.assign((size_t)w * h, {});
+}
+
+void OccupancyGrid::clear() {
+    for (auto& cell : cells) cell.clear();
+}
+
+const OccupancyGrid::Entry* OccupancyGrid::topEntry(int x, int y, int ignoreId) const {
+    const auto& stack = cells[(size_t)y * w + x];
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+        if (it->objectId != ignoreId) return &*it;
+    }
+    return nullptr;
+}
+
+int OccupancyGrid::topAt(int x, int y) const {
+    if (!inside(x, y)) return -1;
+    const auto& stack = cells[(size_t)y * w + x];
+    return stack.empty() ? -1 : stack.back().objectId;
+}
+
+float OccupancyGrid::heightAt(int x, int y) const {
+    if (!inside(x, y)) return 0;
+    const auto& stack = cells[(size_t)y * w + x];
+    return stack.empty() ? 0 : stack.back().base + stack.back().stackHeight;
+}
+
+Placement OccupancyGrid::check(const WalkGrid& walk, const TileRect& rect, int ignoreId) const {
+    if (rect.x < 0 || rect.y < 0 || rect.x + rect.width > w || rect.y + rect.depth > h) return Placement::OutOfBounds;
+    bool first = true;
+    float base = 0;
+    for (int y = rect.y; y < rect.y + rect.depth; y++) {
+        for (int x = rect.x; x < rect.x + rect.width; x++) {
+            if (!walk.floor(x, y)) return Placement::NotFloor;
+            const Entry* top = topEntry(x, y, ignoreId);
+            if (top && top->stackHeight <= 0) return Placement::Occupied;
+            // Every tile under a stacked item has to be at the same height
+            float here = top ? top->base + top->stackHeight : 0;
+            if (first) base = here;
+            else if (here != base) return Placement::Uneven;
+            first = false;
+        }
+    }
+    return Placement::Ok;
+}
+
+void OccupancyGrid::place(int objectId, const TileRect& rect, float stackHeight) {
+    float base = 0;
+    for (int y = rect.y; y < rect.y + rect.depth; y++) {
+        for (int x = rect.x; x < rect.x + rect.width; x++) base = std::max(base, heightAt(x, y));
+    }
+    for (int y = rect.y; y < rect.y + rect.depth; y++) {
+        for (int x = rect.x; x < rect.x + rect.width; x++) {
+            if (inside(x, y)) cells[(size_t)y * w + x].push_back(Entry{objectId, base, stackHeight});
+        }
+    }
+}
+
+void OccupancyGrid::lift(int objectId, const TileRect& rect) {
+    for (int y = rect.y; y < rect.y + rect.depth; y++) {
+        for (int x = rect.x; x < rect.x + rect.width; x++) {
+            if (!inside(x, y)) continue;
+            auto& stack = cells[(size_t)y * w + x];
+            auto it = std::find_if(stack.begin(), stack.end(), [objectId](const Entry& e) { return e.objectId == objectId; });
+            if (it != stack.end()) stack.erase(it);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "FurnitureCatalog.hpp"
+#include "WalkGrid.hpp"
+
+// Tiles [x, x + width) x [y, y + depth)
+struct TileRect {
+    int x = 0;
+    int y = 0;
+    int width = 1;
+    int depth = 1;
+};
+
+// Footprint of an item anchored at (x, y); a quarter turn (rotation in
+// degrees, 90 or 270) swaps its width and depth
+TileRect footprintAt(const FurnitureFootprint& fp, float x, float y, float rotation);
+
+enum class Placement { Ok, OutOfBounds, NotFloor, Occupied, Uneven };
+const char* placementError(Placement p);   // wire name, e.g. "occupied"
+
+// ---------- Occupancy Grid ----------
+// What stands on each tile of a room: a short stack of items per tile,
+// bottom first, each recorded under its whole footprint. "What's on this
+// tile" and stack height are O(1); a placement check and an update cost one
+// visit per footprint tile. Kept current by the furniture snapshot together
+// with the walk grid, and sized from it.
+class OccupancyGrid {
+public:
+    void resize(int width, int height);
+    void clear();
+
+    void place(int objectId, const TileRect& rect, float stackHeight);
+    void lift(int objectId, const TileRect& rect);
+
+    // -1 when nothing is there (or outside the grid)
+    int topAt(int x, int y) const;
+    // Height a new item on this tile would stand at
+    float heightAt(int x, int y) const;
+
+    // Can an item cover `rect`? Floor comes from `walk`. `ignoreId` is the
+    // item being moved, which never blocks itself.
+    Placement check(const WalkGrid& walk, const TileRect& rect, int ignoreId = -1) const;
+
+private:
+    struct Entry {
+        int32_t objectId;
+        float base;          // height the item stands at
+        float stackHeight;   // what it adds; 0 = nothing may go on top
+    };
+
+    bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < w && y < h; }
+    const Entry* topEntry(int x, int y, int ignoreId) const;
+
+    int w = 0;
+    int h = 0;
+    std::vector<std::vector<Entry>> cells;
+};
@@ -0,0 +1,175 @@
+#include "Pathfinding.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+static constexpr uint32_t kStraightCost = 10;
+static constexpr uint32_t kDiagonalCost = 14;
+static constexpr uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+
+// ----------------------
+// PathSearch
+// ----------------------
+void PathSearch::start(const WalkGrid& grid, Tile from, Tile to) {
+    state = PathStatus::NoPath;
+    result.clear();
+    open.clear();
+    expanded = 0;
+    goal = to;
+    width = grid.width();
+    cells = grid.width() * grid.height();
+    if (!grid.inside(from.x, from.y) || !grid.walkable(to.x, to.y)) return;
+
+    startIndex = grid.index(from.x, from.y);
+    goalIndex = grid.index(to.x, to.y);
+    if (startIndex == goalIndex) {
+        state = PathStatus::Found;
+        return;
+    }
+    gScore.assign(cells, kUnvisited);
+    parent.assign(cells, -1);
+    closed.assign((cells + 63) / 64, 0);
+    gScore[startIndex] = 0;
+    open.push_back(Node{heuristic(startIndex), 0, startIndex});
+    state = PathStatus::Running;
+}
+
+uint32_t PathSearch::heuristic(int index) const {
+    uint32_t dx = (uint32_t)std::abs(index % width - goal.x);
+    uint32_t dy = (uint32_t)std::abs(index / width - goal.y);
+    return kStraightCost * std::max(dx, dy) + (kDiagonalCost - kStraightCost) * std::min(dx, dy);
+}
+
+void PathSearch::finish(int index) {
+    for (int i = index; i != startIndex; i = parent[i]) result.push_back(Tile{i % width, i / width});
+    std::reverse(result.begin(), result.end());
+    state = PathStatus::Found;
+}
+
+PathStatus PathSearch::step(const WalkGrid& grid, int& budget) {
+    if (state != PathStatus::Running) return state;
+    // The room layout was rebuilt under us; indices no longer line up
+    if (grid.width() != width || grid.width() * grid.height() != cells) {
+        state = PathStatus::NoPath;
+        return state;
+    }
+
+    static const int dx[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    static const int dy[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+    NodeOrder order;
+    while (budget > 0 && !open.empty()) {
+        std::pop_heap(open.begin(), open.end(), order);
+        Node node = open.back();
+        open.pop_back();
+        if (isClosed(node.index) || node.g != gScore[node.index]) continue; // stale entry
+        setClosed(node.index);
+        budget--;
+        expanded++;
+
+        if (node.index == goalIndex) {
+            finish(node.index);
+            return state;
+        }
+        int x = node.index % width;
+        int y = node.index / width;
+        for (int d = 0; d < 8; d++) {
+            int nx = x + dx[d];
+            int ny = y + dy[d];
+            if (!grid.walkable(nx, ny)) continue;
+            bool diagonal = d >= 4;
+            if (diagonal && (!grid.walkable(x + dx[d], y) || !grid.walkable(x, y + dy[d]))) continue;
+            int next = grid.index(nx, ny);
+            if (isClosed(next)) continue;
+            uint32_t g = node.g + (diagonal ? kDiagonalCost : kStraightCost);
+            if (g >= gScore[next]) continue;
+            gScore[next] = g;
+            parent[next] = node.index;
+            open.push_back(Node{g + heuristic(next), g, next});
+            std::push_heap(open.begin(), open.end(), order);
+        }
+    }
+    if (open.empty()) state = PathStatus::NoPath;
+    return state;
+}
+
+// ----------------------
+// PathService
+// ----------------------
+void PathService::request(const void* owner, RoomRegistry& rooms, RoomHandle room, Tile from, Tile goal, Done done) {
+    cancel(owner);
+    counters.requested++;
+
+    auto job = std::make_unique<Job>();
+    job->owner = owner;
+    job->room = room;
+    job->done = std::move(done);
+
+    Room* r = rooms.get(room);
+    if (!r || !r->walkGrid.built()) {
+        complete(*job);
+        return;
+    }
+    job->search.start(r->walkGrid, from, goal);
+    int budget = inlineExpansions;
+    PathStatus status = job->search.step(r->walkGrid, budget);
+    counters.expansions += inlineExpansions - budget;
+    if (status != PathStatus::Running) {
+        complete(*job);
+        return;
+    }
+    byOwner[owner] = job.get();
+    queue.push_back(std::move(job));
+}
+
+void PathService::cancel(const void* owner) {
+    auto it = byOwner.find(owner);
+    if (it == byOwner.end()) return;
+    it->second->cancelled = true;   // dropped from the queue on the next tick
+    byOwner.erase(it);
+    counters.superseded++;
+}
+
+void PathService::complete(Job& job) {
+    PathStatus status = job.search.status();
+    if (status == PathStatus::Found) counters.found++;
+    else counters.unreachable++;
+    static const std::vector<Tile> kNoPath;
+    job.done(status, status == PathStatus::Found ? job.search.path() : kNoPath);
+}
+
+void PathService::tick(RoomRegistry& rooms) {
+    int budget = expansionsPerTick;
+    // Each pass gives every live search an equal slice of what is left
+    while (budget > 0 && !queue.empty()) {
+        size_t live = queue.size();
+        int slice = std::max(64, budget / (int)live);
+        for (size_t n = 0; n < live && budget > 0; n++) {
+            std::unique_ptr<Job> job = std::move(queue.front());
+            queue.pop_front();
+            if (job->cancelled) continue;
+
+            Room* room = rooms.get(job->room);
+            PathStatus status = PathStatus::NoPath;
+            if (room && room->walkGrid.built()) {
+                int allowance = std::min(slice, budget);
+                int before = allowance;
+                status = job->search.step(room->walkGrid, allowance);
+                budget -= before - allowance;
+                counters.expansions += before - allowance;
+            }
+            if (status == PathStatus::Running) {
+                queue.push_back(std::move(job));
+                continue;
+            }
+            byOwner.erase(job->owner);
+            complete(*job);
+        }
+    }
+    if (!queue.empty()) counters.saturatedTicks++;
+}
+
+PathServiceStats PathService::stats() const {
+    PathServiceStats s = counters;
+    s.pending = byOwner.size();
+    return s;
+}
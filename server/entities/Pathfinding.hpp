@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Room.hpp"
+#include "WalkGrid.hpp"
+
+enum class PathStatus { Running, Found, NoPath };
+
+// ---------- Resumable A* ----------
+// 8-way movement with octile costs (10 straight, 14 diagonal); diagonals may
+// not cut the corner of a blocked tile. step() expands at most `budget`
+// nodes and can be called again later to continue the same search.
+class PathSearch {
+public:
+    void start(const WalkGrid& grid, Tile from, Tile goal);
+    PathStatus step(const WalkGrid& grid, int& budget);
+
+    PathStatus status() const { return state; }
+    // Tiles after the start up to and including the goal
+    const std::vector<Tile>& path() const { return result; }
+    int expansions() const { return expanded; }
+
+private:
+    struct Node {
+        uint32_t f;
+        uint32_t g;
+        int32_t index;
+    };
+    struct NodeOrder {
+        // min-heap on f; prefer deeper nodes on ties
+        bool operator()(const Node& a, const Node& b) const { return a.f != b.f ? a.f > b.f : a.g < b.g; }
+    };
+
+    uint32_t heuristic(int index) const;
+    void finish(int index);
+    bool isClosed(int i) const { return (closed[i >> 6] >> (i & 63)) & 1; }
+    void setClosed(int i) { closed[i >> 6] |= (uint64_t)1 << (i & 63); }
+
+    PathStatus state = PathStatus::NoPath;
+    int width = 0;
+    int cells = 0;
+    int startIndex = -1;
+    int goalIndex = -1;
+    Tile goal;
+    int expanded = 0;
+    std::vector<uint32_t> gScore;
+    std::vector<int32_t> parent;
+    std::vector<uint64_t> closed;
+    std::vector<Node> open;
+    std::vector<Tile> result;
+};
+
+// ---------- Path Service ----------
+struct PathServiceStats {
+    uint64_t requested = 0;
+    uint64_t found = 0;
+    uint64_t unreachable = 0;
+    uint64_t superseded = 0;        // replaced by a newer click or cancelled
+    uint64_t expansions = 0;
+    uint64_t saturatedTicks = 0;    // ticks that used the whole budget with work left
+    size_t pending = 0;
+};
+
+// Answers tile clicks on the loop thread without letting them stall it.
+// A search first gets a small inline budget (most clicks finish right
+// there); longer ones continue in tick(), which shares a fixed number of
+// node expansions per tick across everything pending. One search per
+// owner: a new click replaces the previous one.
+class PathService {
+public:
+    using Done = std::function<void(PathStatus, const std::vector<Tile>&)>;
+
+    explicit PathService(int expansionsPerTick = 20000, int inlineExpansions = 512)
+        : expansionsPerTick(expansionsPerTick), inlineExpansions(inlineExpansions) {}
+
+    // The room's walk grid must be built. `done` may run before this returns.
+    void request(const void* owner, RoomRegistry& rooms, RoomHandle room, Tile from, Tile goal, Done done);
+    void cancel(const void* owner);
+    void tick(RoomRegistry& rooms);
+
+    size_t pending() const { return byOwner.size(); }
+    PathServiceStats stats() const;
+
+private:
+    struct Job {
+        const void* owner;
+        RoomHandle room;
+        PathSearch search;
+        Done done;
+        bool cancelled = false;
+    };
+
+    void complete(Job& job);
+
+    const int expansionsPerTick;
+    const int inlineExpansions;
+    std::deque<std::unique_ptr<Job>> queue;
+    std::unordered_map<const void*, Job*> byOwner;
+    PathServiceStats counters;
+};
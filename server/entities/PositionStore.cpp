@@ -0,0 +1,88 @@
+#include "PositionStore.hpp"
+
+// Screen compass, y grows southwards. Indexed by (dy + 1) * 3 + (dx + 1).
+static const char* const kFacings[9] = {"nw", "n", "ne", "w", "s", "e", "sw", "s", "se"};
+static constexpr uint8_t kDefaultFacing = 4;
+
+static int sign(int v) {
+    return (v > 0) - (v < 0);
+}
+
+void PositionStore::markDirty(uint32_t slot) {
+    if (isDirty(slot)) return;
+    dirty[slot >> 6] |= (uint64_t)1 << (slot & 63);
+    dirtyRows++;
+}
+
+void PositionStore::set(int userId, Tile tile) {
+    auto it = slotByUser.find(userId);
+    if (it == slotByUser.end()) {
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            slot = (uint32_t)userIds.size();
+            userIds.push_back(-1);
+            xs.push_back(0);
+            ys.push_back(0);
+            facings.push_back(kDefaultFacing);
+            if (dirty.size() * 64 < userIds.size()) dirty.push_back(0);
+        }
+        userIds[slot] = userId;
+        xs[slot] = (int16_t)tile.x;
+        ys[slot] = (int16_t)tile.y;
+        facings[slot] = kDefaultFacing;
+        slotByUser[userId] = slot;
+        markDirty(slot);
+        return;
+    }
+
+    uint32_t slot = it->second;
+    int dx = sign(tile.x - xs[slot]);
+    int dy = sign(tile.y - ys[slot]);
+    if (dx == 0 && dy == 0) return;
+    xs[slot] = (int16_t)tile.x;
+    ys[slot] = (int16_t)tile.y;
+    facings[slot] = (uint8_t)((dy + 1) * 3 + (dx + 1));
+    markDirty(slot);
+}
+
+void PositionStore::appendRow(uint32_t slot, PositionBatch& out) const {
+    out.push(userIds[slot], roomId, (float)xs[slot], (float)ys[slot], kFacings[facings[slot]]);
+}
+
+void PositionStore::remove(int userId, PositionBatch& out) {
+    auto it = slotByUser.find(userId);
+    if (it == slotByUser.end()) return;
+    uint32_t slot = it->second;
+    slotByUser.erase(it);
+    if (isDirty(slot)) {
+        appendRow(slot, out);
+        clearDirty(slot);
+        dirtyRows--;
+    }
+    userIds[slot] = -1;
+    freeSlots.push_back(slot);
+}
+
+void PositionStore::takeDirty(PositionBatch& out) {
+    if (dirtyRows == 0) return;
+    for (size_t w = 0; w < dirty.size(); w++) {
+        uint64_t bits = dirty[w];
+        while (bits) {
+            uint32_t slot = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+            bits &= bits - 1;
+            appendRow(slot, out);
+        }
+        dirty[w] = 0;
+    }
+    dirtyRows = 0;
+}
+
+std::optional<PlayerPosition> PositionStore::find(int userId) const {
+    auto it = slotByUser.find(userId);
+    if (it == slotByUser.end()) return std::nullopt;
+    uint32_t slot = it->second;
+    return PlayerPosition{userId, roomId, (float)xs[slot], (float)ys[slot], kFacings[facings[slot]]};
+}
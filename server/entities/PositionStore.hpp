@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "Records.hpp"
+#include "WalkGrid.hpp"
+
+// ---------- Position Store ----------
+// Authoritative positions of the logged-in avatars in one room, kept as
+// parallel arrays (one slot per user) with a dirty bit per slot. Moves only
+// touch memory; takeDirty() hands the changed rows to the periodic bulk
+// upsert, and remove() hands over a departing user's last unsaved position.
+// Loop-thread only, owned by the room's AvatarRoster.
+class PositionStore {
+public:
+    void bindRoom(int id) { roomId = id; }
+
+    // Adds or moves a user; the facing follows the direction of travel
+    void set(int userId, Tile tile);
+    // Appends the user's position to `out` when it was never flushed
+    void remove(int userId, PositionBatch& out);
+    // Appends every dirty row to `out` and clears the dirty bits
+    void takeDirty(PositionBatch& out);
+
+    std::optional<PlayerPosition> find(int userId) const;
+    size_t size() const { return slotByUser.size(); }
+    size_t dirtyCount() const { return dirtyRows; }
+
+private:
+    void markDirty(uint32_t slot);
+    bool isDirty(uint32_t slot) const { return (dirty[slot >> 6] >> (slot & 63)) & 1; }
+    void clearDirty(uint32_t slot) { dirty[slot >> 6] &= ~((uint64_t)1 << (slot & 63)); }
+    void appendRow(uint32_t slot, PositionBatch& out) const;
+
+    int roomId = -1;
+    std::vector<int32_t> userIds;   // -1 marks a free slot
+    std::vector<int16_t> xs;
+    std::vector<int16_t> ys;
+    std::vector<uint8_t> facings;   // index into the compass table in PositionStore.cpp
+    std::vector<uint64_t> dirty;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<int, uint32_t> slotByUser;
+    size_t dirtyRows = 0;
+};
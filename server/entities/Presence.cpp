@@ -0,0 +1,60 @@
+#include "Presence.hpp"
+#include <algorithm>
+
+void PresenceRegistry::markChanged(int roomId, RoomPresence& room) {
+    if (room.changed) return;
+    room.changed = true;
+    changed.push_back(roomId);
+}
+
+void PresenceRegistry::enter(int roomId, const void* session, int userId) {
+    RoomPresence& room = byRoom[roomId];
+    for (const auto& m : room.members) {
+        if (m.session == session) return;
+    }
+    room.members.push_back(Member{session, userId});
+    sessionCount++;
+    markChanged(roomId, room);
+}
+
+void PresenceRegistry::leave(int roomId, const void* session) {
+    auto it = byRoom.find(roomId);
+    if (it == byRoom.end()) return;
+    auto& members = it->second.members;
+    for (size_t i = 0; i < members.size(); i++) {
+        if (members[i].session != session) continue;
+        members[i] = members.back();
+        members.pop_back();
+        sessionCount--;
+        markChanged(roomId, it->second);
+        return;
+    }
+}
+
+size_t PresenceRegistry::count(int roomId) const {
+    auto it = byRoom.find(roomId);
+    return it == byRoom.end() ? 0 : it->second.members.size();
+}
+
+std::vector<int> PresenceRegistry::usersIn(int roomId) const {
+    std::vector<int> users;
+    auto it = byRoom.find(roomId);
+    if (it == byRoom.end()) return users;
+    for (const auto& m : it->second.members) {
+        if (m.userId > 0) users.push_back(m.userId);
+    }
+    std::sort(users.begin(), users.end());
+    users.erase(std::unique(users.begin(), users.end()), users.end());
+    return users;
+}
+
+void PresenceRegistry::takeChangedCounts(std::vector<std::pair<int, int>>& out) {
+    for (int roomId : changed) {
+        auto it = byRoom.find(roomId);
+        if (it == byRoom.end()) continue;
+        it->second.changed = false;
+        out.emplace_back(roomId, (int)it->second.members.size());
+        if (it->second.members.empty()) byRoom.erase(it);
+    }
+    changed.clear();
+}
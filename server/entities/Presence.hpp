@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ---------- Presence Registry ----------
+// Who is in which room, for the rooms this shard owns. Authoritative: joins
+// and leaves never touch Postgres; rooms.player_count only receives the
+// counts of rooms that changed, in one batch per flush (takeChangedCounts).
+// One entry per session, so two tabs of the same user count twice, the same
+// way they show two avatars. Loop-thread only.
+class PresenceRegistry {
+public:
+    void enter(int roomId, const void* session, int userId);
+    void leave(int roomId, const void* session);
+
+    size_t count(int roomId) const;
+    // Distinct logged-in users
+    std::vector<int> usersIn(int roomId) const;
+
+    // (roomId, count) for every room whose count changed since the last call;
+    // rooms that emptied are reported with 0 and then forgotten
+    void takeChangedCounts(std::vector<std::pair<int, int>>& out);
+
+    size_t rooms() const { return byRoom.size(); }
+    size_t sessions() const { return sessionCount; }
+
+private:
+    struct Member {
+        const void* session;
+        int userId;
+    };
+    struct RoomPresence {
+        std::vector<Member> members;
+        bool changed = false;
+    };
+
+    void markChanged(int roomId, RoomPresence& room);
+
+    std::unordered_map<int, RoomPresence> byRoom;
+    std::vector<int> changed;
+    size_t sessionCount = 0;
+};
@@ -0,0 +1,570 @@
+#include "Room.hpp"
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+std::string RoomRegistry::privateKey(const std::string& name, int ownerId) {
+    return std::to_string(ownerId) + ":" + name;
+}
+
+RoomHandle RoomRegistry::findPublic(const std::string& name) const {
+    auto it = publicByName.find(name);
+    return it == publicByName.end() ? kNoRoom : it->second;
+}
+
+RoomHandle RoomRegistry::findPrivate(const std::string& name, int ownerId) const {
+    auto it = privateByOwner.find(privateKey(name, ownerId));
+    return it == privateByOwner.end() ? kNoRoom : it->second;
+}
+
+RoomHandle RoomRegistry::findById(int roomId) const {
+    auto it = byId.find(roomId);
+    if (it == byId.end() || !rooms[it->second].cached) return kNoRoom;
+    return it->second;
+}
+
+Room* RoomRegistry::get(RoomHandle handle) {
+    if (handle < 0 || (size_t)handle >= rooms.size()) return nullptr;
+    return &rooms[handle];
+}
+
+const Room* RoomRegistry::get(RoomHandle handle) const {
+    if (handle < 0 || (size_t)handle >= rooms.size()) return nullptr;
+    return &rooms[handle];
+}
+
+RoomHandle RoomRegistry::insert(const RoomInfo& info) {
+    RoomHandle handle;
+    auto it = byId.find(info.id);
+    if (it != byId.end()) {
+        handle = it->second;
+        unindex(rooms[handle]);
+    } else {
+        handle = (RoomHandle)rooms.size();
+        rooms.emplace_back();
+        rooms.back().furniture.attachCatalog(catalog);
+        rooms.back().furniture.attachGrid(&rooms.back().walkGrid);
+        rooms.back().avatars.positions().bindRoom(info.id);
+        byId[info.id] = handle;
+    }
+
+    Room& room = rooms[handle];
+    if (room.layoutJson != info.layoutJson || room.width != info.width || room.height != info.height) {
+        room.walkGrid.reset();   // rebuilt from the new layout on next use
+    }
+    room.handle = handle;
+    room.topic = "room/" + std::to_string(handle);
+    room.jsonTopic = room.topic + "/json";
+    room.binaryTopic = room.topic + "/bin";
+    room.id = info.id;
+    room.name = info.name;
+    room.ownerId = info.ownerId;
+    room.isPublic = info.isPublic;
+    room.pinCode = info.pinCode;
+    room.layoutJson = info.layoutJson;
+    room.width = info.width;
+    room.height = info.height;
+    room.cached = true;
+
+    if (room.isPublic) publicByName[room.name] = handle;
+    else privateByOwner[privateKey(room.name, room.ownerId)] = handle;
+    return handle;
+}
+
+void RoomRegistry::unindex(const Room& room) {
+    if (!room.cached) return;
+    auto pub = publicByName.find(room.name);
+    if (pub != publicByName.end() && pub->second == room.handle) publicByName.erase(pub);
+    auto priv = privateByOwner.find(privateKey(room.name, room.ownerId));
+    if (priv != privateByOwner.end() && priv->second == room.handle) privateByOwner.erase(priv);
+}
+
+void RoomRegistry::invalidate(RoomHandle handle) {
+    Room* room = get(handle);
+    if (!room) return;
+    unindex(*room);
+    room->cached = false;
+}
+
+void RoomRegistry::invalidateAll() {
+    publicByName.clear();
+    privateByOwner.clear();
+    for (auto& room : rooms) room.cached = false;
+}
+
+void RoomRegistry::setCatalog(const FurnitureCatalog* footprints) {
+    catalog = footprints;
+    for (auto& room : rooms) room.furniture.attachCatalog(catalog);
+}
+
+// ----------------------
+// FurnitureSnapshot
+// ----------------------
+void FurnitureSnapshot::finishLoad(std::vector<RoomObject> rows) {
+    objects = std::move(rows);
+    indexById.clear();
+    for (size_t i = 0; i < objects.size(); i++) indexById[objects[i].id] = i;
+
+    for (const auto& op : pendingOps) {
+        if (op.change == FurnitureChange::Removed) {
+            applyRemove(op.object.id);
+        } else {
+            applyUpsert(op.object);
+            if (!op.uid.empty()) {
+                idByUid[op.uid] = op.object.id;
+                uidById[op.object.id] = op.uid;
+            }
+        }
+    }
+    pendingOps.clear();
+    deltas.clear();
+
+    rebuildBlockers();
+
+    currentVersion = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    isLoaded = true;
+    isLoading = false;
+}
+
+void FurnitureSnapshot::reset() {
+    isLoaded = false;
+    isLoading = false;
+    objects.clear();
+    indexById.clear();
+    idByUid.clear();
+    uidById.clear();
+    deltas.clear();
+    pendingOps.clear();
+    json.clear();
+    cachedJsonVersion = 0;
+    if (grid) grid->clearBlockers();
+    occupied.clear();
+    reservations.clear();
+}
+
+void FurnitureSnapshot::release() {
+    reset();
+    // clear() keeps capacity and bucket arrays; swapping with empties frees them
+    decltype(objects)().swap(objects);
+    decltype(indexById)().swap(indexById);
+    decltype(idByUid)().swap(idByUid);
+    decltype(uidById)().swap(uidById);
+    decltype(deltas)().swap(deltas);
+    decltype(pendingOps)().swap(pendingOps);
+    decltype(reservations)().swap(reservations);
+    std::string().swap(json);
+    occupied = OccupancyGrid();
+}
+
+void FurnitureSnapshot::attachGrid(WalkGrid* walkGrid) {
+    grid = walkGrid;
+    rebuildBlockers();
+}
+
+void FurnitureSnapshot::attachCatalog(const FurnitureCatalog* footprints) {
+    catalog = footprints;
+    rebuildBlockers();
+}
+
+void FurnitureSnapshot::rebuildBlockers() {
+    if (!grid || !grid->built()) return;
+    grid->clearBlockers();
+    occupied.resize(grid->width(), grid->height());
+    for (const auto& object : objects) block(object);
+    for (const auto& [token, reservation] : reservations) occupied.place(token, reservation.rect, 0);
+}
+
+Placement FurnitureSnapshot::checkPlacement(const std::string& protoId, float x, float y, float rotation, int movingId) const {
+    if (!grid || !grid->built()) return Placement::OutOfBounds;
+    const FurnitureFootprint& fp = footprintFor(protoId);
+    return occupied.check(*grid, footprintAt(fp, x, y, rotation), movingId);
+}
+
+const FurnitureFootprint& FurnitureSnapshot::footprintFor(const std::string& protoId) const {
+    static const FurnitureFootprint kSingleTile;
+    return catalog ? catalog->footprint(protoId) : kSingleTile;
+}
+
+int FurnitureSnapshot::reserve(const std::string& protoId, float x, float y, float rotation,
+                               const std::string& uid, const void* creator) {
+    const FurnitureFootprint& fp = footprintFor(protoId);
+    int token = nextReservation--;
+    if (nextReservation > -2) nextReservation = -2;   // wrapped
+    TileRect rect = footprintAt(fp, x, y, rotation);
+    reservations[token] = PendingCreate{protoId, x, y, rotation, rect, uid, creator};
+    occupied.place(token, rect, 0);
+    return token;
+}
+
+void FurnitureSnapshot::release(int token) {
+    auto it = reservations.find(token);
+    if (it == reservations.end()) return;
+    occupied.lift(token, it->second.rect);
+    reservations.erase(it);
+}
+
+void FurnitureSnapshot::movePending(int token, float x, float y, float rotation) {
+    auto it = reservations.find(token);
+    if (it == reservations.end()) return;
+    PendingCreate& reservation = it->second;
+    occupied.lift(token, reservation.rect);
+    reservation.x = x;
+    reservation.y = y;
+    reservation.rotation = rotation;
+    reservation.rect = footprintAt(footprintFor(reservation.protoId), x, y, rotation);
+    occupied.place(token, reservation.rect, 0);
+}
+
+// Linear: a room only has the creates of the last DB round trip in flight
+int FurnitureSnapshot::findPending(const std::string& uid, const void* creator) const {
+    if (uid.empty() || !creator) return 0;
+    for (const auto& [token, reservation] : reservations) {
+        if (reservation.creator == creator && reservation.uid == uid) return token;
+    }
+    return 0;
+}
+
+const PendingCreate* FurnitureSnapshot::pending(int token) const {
+    auto it = reservations.find(token);
+    return it == reservations.end() ? nullptr : &it->second;
+}
+
+TileRect FurnitureSnapshot::footprintOf(const RoomObject& object) const {
+    const FurnitureFootprint& fp = footprintFor(object.name);
+    return footprintAt(fp, object.x, object.y, object.rotation);
+}
+
+// Items block every tile under their footprint
+void FurnitureSnapshot::block(const RoomObject& object) {
+    if (!grid) return;
+    TileRect rect = footprintOf(object);
+    for (int y = rect.y; y < rect.y + rect.depth; y++) {
+        for (int x = rect.x; x < rect.x + rect.width; x++) grid->addBlocker(x, y);
+    }
+    occupied.place(object.id, rect, footprintFor(object.name).stackHeight);
+}
+
+void FurnitureSnapshot::unblock(const RoomObject& object) {
+    if (!grid) return;
+    TileRect rect = footprintOf(object);
+    for (int y = rect.y; y < rect.y + rect.depth; y++) {
+        for (int x = rect.x; x < rect.x + rect.width; x++) grid->removeBlocker(x, y);
+    }
+    occupied.lift(object.id, rect);
+}
+
+const RoomObject* FurnitureSnapshot::find(int objectId) const {
+    auto it = indexById.find(objectId);
+    return it == indexById.end() ? nullptr : &objects[it->second];
+}
+
+int FurnitureSnapshot::resolveUid(const std::string& uid) const {
+    auto it = idByUid.find(uid);
+    if (it != idByUid.end()) return it->second;
+    if (uid.rfind("dbid_", 0) == 0) {
+        try { return std::stoi(uid.substr(5)); } catch (...) { return -1; }
+    }
+    return -1;
+}
+
+std::string FurnitureSnapshot::uidFor(int objectId) const {
+    auto it = uidById.find(objectId);
+    return it == uidById.end() ? "dbid_" + std::to_string(objectId) : it->second;
+}
+
+void FurnitureSnapshot::applyUpsert(const RoomObject& object) {
+    auto it = indexById.find(object.id);
+    if (it != indexById.end()) {
+        unblock(objects[it->second]);
+        objects[it->second] = object;
+        block(object);
+        return;
+    }
+    indexById[object.id] = objects.size();
+    objects.push_back(object);
+    block(object);
+}
+
+void FurnitureSnapshot::applyRemove(int objectId) {
+    auto it = indexById.find(objectId);
+    if (it == indexById.end()) return;
+    // swap-remove keeps the vector dense
+    size_t pos = it->second;
+    unblock(objects[pos]);
+    indexById.erase(it);
+    if (pos != objects.size() - 1) {
+        objects[pos] = std::move(objects.back());
+        indexById[objects[pos].id] = pos;
+    }
+    objects.pop_back();
+
+    auto uid = uidById.find(objectId);
+    if (uid != uidById.end()) {
+        idByUid.erase(uid->second);
+        uidById.erase(uid);
+    }
+}
+
+uint64_t FurnitureSnapshot::record(FurnitureChange change, std::string json) {
+    currentVersion++;
+    deltas.push_back(FurnitureDelta{currentVersion, change, std::move(json)});
+    if (deltas.size() > kMaxDeltas) deltas.pop_front();
+    return currentVersion;
+}
+
+uint64_t FurnitureSnapshot::add(const RoomObject& object, const std::string& uid, std::string json) {
+    if (isLoading) pendingOps.push_back(PendingOp{FurnitureChange::Added, object, uid});
+    if (!isLoaded) return 0;
+    applyUpsert(object);
+    if (!uid.empty()) {
+        idByUid[uid] = object.id;
+        uidById[object.id] = uid;
+    }
+    return record(FurnitureChange::Added, std::move(json));
+}
+
+uint64_t FurnitureSnapshot::update(const RoomObject& object, std::string json) {
+    if (isLoading) pendingOps.push_back(PendingOp{FurnitureChange::Updated, object, ""});
+    if (!isLoaded) return 0;
+    applyUpsert(object);
+    return record(FurnitureChange::Updated, std::move(json));
+}
+
+uint64_t FurnitureSnapshot::remove(int objectId, std::string json) {
+    if (isLoading) {
+        RoomObject gone{};
+        gone.id = objectId;
+        pendingOps.push_back(PendingOp{FurnitureChange::Removed, gone, ""});
+    }
+    if (!isLoaded) return 0;
+    applyRemove(objectId);
+    return record(FurnitureChange::Removed, std::move(json));
+}
+
+bool FurnitureSnapshot::deltasSince(uint64_t since, std::vector<const FurnitureDelta*>& out) const {
+    if (!isLoaded || since > currentVersion) return false;
+    if (since == currentVersion) return true;
+    // the log must contain since+1, otherwise something was evicted
+    if (deltas.empty() || deltas.front().version > since + 1) return false;
+    for (const auto& d : deltas) {
+        if (d.version > since) out.push_back(&d);
+    }
+    return true;
+}
+
+// ----------------------
+// AvatarRoster
+// ----------------------
+RoomAvatar* AvatarRoster::find(const void* owner) {
+    auto it = indexByOwner.find(owner);
+    return it == indexByOwner.end() ? nullptr : &avatars[it->second];
+}
+
+void AvatarRoster::markChanged(RoomAvatar& avatar) {
+    if (avatar.changed) return;
+    avatar.changed = true;
+    changes++;
+}
+
+void AvatarRoster::countWalker(bool wasWalking, bool isWalking) {
+    if (wasWalking == isWalking) return;
+    if (isWalking) walkers++;
+    else walkers--;
+}
+
+RoomAvatar& AvatarRoster::join(const void* owner, int userId, const std::string& username, Tile tile) {
+    if (RoomAvatar* existing = find(owner)) {
+        stop(owner);
+        existing->tile = tile;
+        if (existing->userId > 0) positionStore.set(existing->userId, tile);
+        markChanged(*existing);
+        return *existing;
+    }
+    RoomAvatar avatar;
+    avatar.owner = owner;
+    avatar.id = nextId++;
+    avatar.userId = userId;
+    avatar.username = username;
+    avatar.tile = tile;
+    avatar.joined = true;
+    if (userId > 0) positionStore.set(userId, tile);
+    indexByOwner[owner] = avatars.size();
+    avatars.push_back(std::move(avatar));
+    markChanged(avatars.back());
+    return avatars.back();
+}
+
+void AvatarRoster::leave(const void* owner, PositionBatch& lastPosition) {
+    auto it = indexByOwner.find(owner);
+    if (it == indexByOwner.end()) return;
+    size_t pos = it->second;
+    indexByOwner.erase(it);
+    RoomAvatar& avatar = avatars[pos];
+    countWalker(avatar.walking(), false);
+    if (avatar.changed) changes--;
+    left.push_back(avatar.id);
+    if (avatar.userId > 0) positionStore.remove(avatar.userId, lastPosition);
+
+    // swap-remove keeps the vector dense
+    if (pos != avatars.size() - 1) {
+        avatars[pos] = std::move(avatars.back());
+        indexByOwner[avatars[pos].owner] = pos;
+    }
+    avatars.pop_back();
+}
+
+void AvatarRoster::walk(const void* owner, std::vector<Tile> path) {
+    RoomAvatar* avatar = find(owner);
+    if (!avatar) return;
+    bool wasWalking = avatar->walking();
+    avatar->path = std::move(path);
+    avatar->nextStep = 0;
+    avatar->stepProgress = 1.0f;   // the first tile is taken on the very next step
+    countWalker(wasWalking, avatar->walking());
+    markChanged(*avatar);
+}
+
+void AvatarRoster::stop(const void* owner) {
+    RoomAvatar* avatar = find(owner);
+    if (!avatar || !avatar->walking()) return;
+    avatar->path.clear();
+    avatar->nextStep = 0;
+    avatar->stepProgress = 0;
+    countWalker(true, false);
+    markChanged(*avatar);
+}
+
+void AvatarRoster::advance(const WalkGrid& grid, float tiles) {
+    if (walkers == 0) return;
+    for (auto& avatar : avatars) {
+        if (!avatar.walking()) continue;
+        while (avatar.stepProgress >= 1.0f && avatar.walking()) {
+            const Tile& next = avatar.path[avatar.nextStep];
+            if (!grid.walkable(next.x, next.y)) {
+                avatar.nextStep = avatar.path.size();   // furniture moved into the way
+                break;
+            }
+            avatar.tile = next;
+            if (avatar.userId > 0) positionStore.set(avatar.userId, next);
+            avatar.nextStep++;
+            avatar.stepProgress -= 1.0f;
+            markChanged(avatar);
+        }
+        avatar.stepProgress += tiles;
+        if (!avatar.walking()) {
+            avatar.path.clear();
+            avatar.nextStep = 0;
+            avatar.stepProgress = 0;
+            countWalker(true, false);
+            markChanged(avatar);
+        }
+    }
+}
+
+void AvatarRoster::clearChanges() {
+    for (auto& avatar : avatars) {
+        avatar.changed = false;
+        avatar.joined = false;
+    }
+    changes = 0;
+    left.clear();
+}
+
+// ----------------------
+// RoomSimulation
+// ----------------------
+RoomSimulation::RoomSimulation(RoomRegistry& rooms, int tickHz, float walkTilesPerSecond)
+    : rooms(rooms), hz(std::clamp(tickHz, 1, 60)), walkSpeed(std::max(0.1f, walkTilesPerSecond)) {}
+
+void RoomSimulation::wake(Room& room) {
+    if (room.awake) return;
+    room.awake = true;
+    active.push_back(room.handle);
+}
+
+RoomAvatar* RoomSimulation::join(RoomHandle handle, const void* owner, int userId, const std::string& username, Tile tile) {
+    Room* room = rooms.get(handle);
+    if (!room) return nullptr;
+    RoomAvatar& avatar = room->avatars.join(owner, userId, username, tile);
+    wake(*room);
+    return &avatar;
+}
+
+void RoomSimulation::leave(RoomHandle handle, const void* owner, PositionBatch& lastPosition) {
+    Room* room = rooms.get(handle);
+    if (!room || !room->avatars.find(owner)) return;
+    room->avatars.leave(owner, lastPosition);
+    wake(*room);
+}
+
+void RoomSimulation::walk(RoomHandle handle, const void* owner, std::vector<Tile> path) {
+    Room* room = rooms.get(handle);
+    if (!room) return;
+    room->avatars.walk(owner, std::move(path));
+    wake(*room);
+}
+
+void RoomSimulation::stop(RoomHandle handle, const void* owner) {
+    Room* room = rooms.get(handle);
+    if (!room) return;
+    room->avatars.stop(owner);
+    wake(*room);
+}
+
+void RoomSimulation::tick(const Emit& emit) {
+    Clock::time_point start = Clock::now();
+    if (active.empty()) {
+        // Idle: keep the clock current so the next wake-up owes no catch-up
+        lastTick = start;
+        carrySeconds = 0;
+        return;
+    }
+
+    // Whole steps owed since the last tick; the half-step rounding keeps a
+    // timer that fires slightly early from skipping a step
+    const double dt = 1.0 / hz;
+    double elapsed = lastTick == Clock::time_point{} ? dt : std::chrono::duration<double>(start - lastTick).count();
+    lastTick = start;
+    carrySeconds += elapsed;
+    int steps = 0;
+    while (carrySeconds > dt / 2 && steps < kMaxCatchUpSteps) {
+        carrySeconds -= dt;
+        steps++;
+    }
+    if (carrySeconds > dt / 2) carrySeconds = 0;   // too far behind; drop it rather than spiral
+    tickNumber++;
+
+    const float tiles = walkSpeed / hz;
+    std::vector<RoomHandle> current;
+    current.swap(active);   // emit() may wake rooms; they land in the fresh list
+    for (RoomHandle handle : current) {
+        Room* room = rooms.get(handle);
+        if (!room) continue;
+        room->awake = false;
+        AvatarRoster& roster = room->avatars;
+        for (int i = 0; i < steps && roster.hasWalkers(); i++) roster.advance(room->walkGrid, tiles);
+        if (roster.hasChanges()) {
+            emit(*room, tickNumber);
+            roster.clearChanges();
+            counters.frames++;
+        }
+        if (roster.hasWalkers()) wake(*room);
+    }
+
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    counters.ticks++;
+    counters.steps += steps;
+    counters.activeRooms = current.size();
+    counters.lastTickUs = us;
+    counters.maxTickUs = std::max(counters.maxTickUs, us);
+    if (us > 1e6 / hz) counters.overruns++;
+    totalTickUs += us;
+}
+
+RoomTickStats RoomSimulation::stats() const {
+    RoomTickStats s = counters;
+    s.avgTickUs = s.ticks ? totalTickUs / s.ticks : 0;
+    s.budgetUs = 1e6 / hz;
+    return s;
+}
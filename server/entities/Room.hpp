@@ -0,0 +1,333 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ChatHistory.hpp"
+#include "Records.hpp"
+#include "FurnitureCatalog.hpp"
+#include "Interest.hpp"
+#include "Occupancy.hpp"
+#include "PositionStore.hpp"
+#include "Protocol.hpp"
+#include "WalkGrid.hpp"
+
+// Dense integer handle into RoomRegistry; stable for the lifetime of the process.
+using RoomHandle = int32_t;
+constexpr RoomHandle kNoRoom = -1;
+
+// ---------- Furniture Snapshot ----------
+// An item whose create is still on its way to the DB
+struct PendingCreate {
+    std::string protoId;
+    float x = 0, y = 0, rotation = 0;   // latest; the creator may move it before the insert lands
+    TileRect rect;
+    std::string uid;                // the creator's client id for it
+    const void* creator = nullptr;  // the session that sent the create
+};
+
+struct FurnitureDelta {
+    uint64_t version = 0;
+    FurnitureChange change = FurnitureChange::Updated;
+    std::string json;   // serialized furniture object, exactly as broadcast
+};
+
+// Authoritative in-memory copy of a room's furniture. Every mutation bumps
+// the version and is kept in a short delta log so a client that is behind can
+// catch up without a full ROOM_STATE. The base version is the load time in
+// microseconds, so versions keep increasing across restarts and a version
+// from a previous process never lines up with the current delta log.
+class FurnitureSnapshot {
+public:
+    static constexpr size_t kMaxDeltas = 256;
+
+    bool loaded() const { return isLoaded; }
+    bool loading() const { return isLoading; }
+    uint64_t version() const { return currentVersion; }
+    const std::vector<RoomObject>& items() const { return objects; }
+
+    // Mutations that complete while the initial load is in flight are queued
+    // and re-applied on top of the loaded rows (all operations are idempotent).
+    void beginLoad() { isLoading = true; }
+    void finishLoad(std::vector<RoomObject> rows);
+    void abortLoad() { isLoading = false; pendingOps.clear(); }
+    void reset();
+    // reset() that also frees the memory behind the items, delta log and
+    // occupancy; the next withFurniture loads the room again
+    void release();
+    // A load, waiters or creates in flight; release() would lose them
+    bool busy() const { return isLoading || !waiters.empty() || !reservations.empty(); }
+
+    // Keeps `grid` blocked under every item from now on (nullptr detaches)
+    void attachGrid(WalkGrid* grid);
+    // Footprints items cover; without one every item is a single tile
+    void attachCatalog(const FurnitureCatalog* footprints);
+    // Re-derives the grid's blockers and the occupancy from the current
+    // items, e.g. after a rebuild
+    void rebuildBlockers();
+
+    // Whether `protoId` fits at (x, y) with the items that stand there now;
+    // `movingId` is the item being moved, if any. Needs a built walk grid.
+    Placement checkPlacement(const std::string& protoId, float x, float y, float rotation, int movingId = -1) const;
+    const OccupancyGrid& occupancy() const { return occupied; }
+
+    // Holds the tiles of an item whose create is still on its way to the DB,
+    // so two creates can't both pass the check for the same spot. The token
+    // goes back to release() once the item is added (or the insert failed).
+    int reserve(const std::string& protoId, float x, float y, float rotation,
+                const std::string& uid = {}, const void* creator = nullptr);
+    void release(int token);
+    // Moves a reservation's tiles along with a relayed move of its item
+    void movePending(int token, float x, float y, float rotation);
+    // `creator`'s pending create with client id `uid`; 0 when there is none.
+    // The token doubles as the item id for checkPlacement's `movingId`.
+    int findPending(const std::string& uid, const void* creator) const;
+    const PendingCreate* pending(int token) const;
+
+    const RoomObject* find(int objectId) const;
+    // Client ids: "dbid_<id>" for persisted items, otherwise the creator's uid
+    int resolveUid(const std::string& uid) const;
+    std::string uidFor(int objectId) const;
+
+    // Each returns the new version (0 when not loaded; nothing to broadcast)
+    uint64_t add(const RoomObject& object, const std::string& uid, std::string json);
+    uint64_t update(const RoomObject& object, std::string json);
+    uint64_t remove(int objectId, std::string json);
+
+    // Deltas newer than `since`, oldest first. False if the log no longer
+    // reaches back that far (caller sends the full snapshot instead).
+    bool deltasSince(uint64_t since, std::vector<const FurnitureDelta*>& out) const;
+
+    // Serialized furniture array, rebuilt lazily when the version moves
+    bool hasCachedJson() const { return cachedJsonVersion == currentVersion && isLoaded; }
+    const std::string& cachedJson() const { return json; }
+    void setCachedJson(std::string serialized) { json = std::move(serialized); cachedJsonVersion = currentVersion; }
+
+    std::vector<std::function<void(bool)>> waiters;  // run with `loaded` once the load completes
+
+private:
+    struct PendingOp {
+        FurnitureChange change;
+        RoomObject object;
+        std::string uid;
+    };
+
+    void applyUpsert(const RoomObject& object);
+    void applyRemove(int objectId);
+    uint64_t record(FurnitureChange change, std::string json);
+    const FurnitureFootprint& footprintFor(const std::string& protoId) const;
+    TileRect footprintOf(const RoomObject& object) const;
+    void block(const RoomObject& object);
+    void unblock(const RoomObject& object);
+
+    bool isLoaded = false;
+    bool isLoading = false;
+    uint64_t currentVersion = 0;
+    std::vector<RoomObject> objects;
+    std::unordered_map<int, size_t> indexById;
+    std::unordered_map<std::string, int> idByUid;
+    std::unordered_map<int, std::string> uidById;
+    std::deque<FurnitureDelta> deltas;
+    std::vector<PendingOp> pendingOps;
+    std::string json;
+    uint64_t cachedJsonVersion = 0;
+    WalkGrid* grid = nullptr;
+    const FurnitureCatalog* catalog = nullptr;
+    OccupancyGrid occupied;
+    std::unordered_map<int, PendingCreate> reservations;   // by token; tokens are negative ids
+    int nextReservation = -2;
+};
+
+// ---------- Avatars ----------
+struct RoomAvatar {
+    const void* owner = nullptr;    // the session that controls it
+    uint32_t id = 0;                // per-room id clients key sprites by
+    int userId = -1;
+    std::string username;
+    Tile tile;
+    std::vector<Tile> path;         // planned steps; path[nextStep] is the next tile
+    size_t nextStep = 0;
+    float stepProgress = 0;         // fraction of the way to path[nextStep]
+    bool changed = false;           // moved or started/stopped walking this tick
+    bool joined = false;            // entered this tick (frames carry the name once)
+
+    bool walking() const { return nextStep < path.size(); }
+};
+
+// Who is in a room and where. All mutations only mark avatars changed; the
+// simulation tick turns the accumulated changes into one frame per room.
+class AvatarRoster {
+public:
+    RoomAvatar* find(const void* owner);
+    const std::vector<RoomAvatar>& all() const { return avatars; }
+    bool empty() const { return avatars.empty(); }
+
+    RoomAvatar& join(const void* owner, int userId, const std::string& username, Tile tile);
+    // The departing user's unsaved position, if any, is appended to `lastPosition`
+    void leave(const void* owner, PositionBatch& lastPosition);
+    void walk(const void* owner, std::vector<Tile> path);
+    void stop(const void* owner);
+
+    // One fixed step: walkers cover `tiles` of distance, moving whole tiles at
+    // a time and halting in front of tiles that stopped being walkable
+    void advance(const WalkGrid& grid, float tiles);
+
+    bool hasWalkers() const { return walkers > 0; }
+    bool hasChanges() const { return changes > 0 || !left.empty(); }
+    const std::vector<uint32_t>& departed() const { return left; }
+    void clearChanges();
+
+    // Where the room's logged-in avatars stand, for player_positions
+    PositionStore& positions() { return positionStore; }
+    const PositionStore& positions() const { return positionStore; }
+
+private:
+    void markChanged(RoomAvatar& avatar);
+    void countWalker(bool wasWalking, bool isWalking);
+
+    std::vector<RoomAvatar> avatars;
+    std::unordered_map<const void*, size_t> indexByOwner;
+    std::vector<uint32_t> left;     // ids that left since the last frame
+    uint32_t nextId = 1;
+    size_t walkers = 0;
+    size_t changes = 0;
+    PositionStore positionStore;
+};
+
+// ---------- Room ----------
+struct Room {
+    RoomHandle handle = kNoRoom;
+    int id = -1;                        // DB room ID
+    std::string name;
+    int ownerId = -1;
+    bool isPublic = true;
+    std::optional<std::string> pinCode;
+    std::string layoutJson;
+    int width = 10;                     // fallback floor size when layoutJson has no tiles
+    int height = 10;
+    bool cached = false;                // metadata valid; cleared by invalidate()
+
+    std::string topic;                  // uWS pub/sub topic for room-wide broadcasts (chat, notices)
+    std::string jsonTopic;              // structured room events for JSON clients
+    std::string binaryTopic;            // the same events, binary-encoded
+    FurnitureSnapshot furniture;
+    WalkGrid walkGrid;                  // built on first use; furniture keeps it current
+    InterestGrid interest;              // sized with the walk grid; who sees which events
+    AvatarRoster avatars;
+    ChatHistory chat;                   // recent lines for joiners; warmed on first join
+    bool awake = false;                 // queued in RoomSimulation's active list
+    std::chrono::steady_clock::time_point idleSince{};   // empty and unwatched since; zero while in use
+
+    const std::string& eventTopic(WireFormat format) const {
+        return format == WireFormat::Binary ? binaryTopic : jsonTopic;
+    }
+
+    // Private rooms without a pin accept any pin (matches getRoomIdByOwner)
+    bool pinMatches(const std::string& pin) const {
+        return !pinCode.has_value() || pinCode.value() == pin;
+    }
+};
+
+// ---------- Room Registry ----------
+// Resolves room names to handles once and caches their metadata so hot
+// paths (chat, furniture, subscriptions) never go back to the database.
+// Loop-thread only. Handles are never reused: invalidating a room only drops
+// its cached metadata and name index entries, subscribers stay attached and
+// the same handle is handed out again when the room is re-resolved. What a
+// room holds beyond its metadata (furniture, walk and interest grids, chat)
+// is released once it has been idle for a while and reloaded on the next join.
+class RoomRegistry {
+public:
+    // Cache lookups; kNoRoom on miss (caller resolves through the DB)
+    RoomHandle findPublic(const std::string& name) const;
+    RoomHandle findPrivate(const std::string& name, int ownerId) const;
+    RoomHandle findById(int roomId) const;
+
+    Room* get(RoomHandle handle);
+    const Room* get(RoomHandle handle) const;
+
+    // Caches (or refreshes) a room loaded from the DB and returns its handle
+    RoomHandle insert(const RoomInfo& info);
+
+    void invalidate(RoomHandle handle);
+    void invalidateAll();
+
+    // Furniture footprints for every room, current and future
+    void setCatalog(const FurnitureCatalog* footprints);
+
+    size_t size() const { return rooms.size(); }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        for (auto& room : rooms) fn(room);
+    }
+
+private:
+    static std::string privateKey(const std::string& name, int ownerId);
+    void unindex(const Room& room);
+
+    // indexed by handle; a deque so Room addresses never move (the furniture
+    // snapshot points at its sibling walk grid)
+    std::deque<Room> rooms;
+    const FurnitureCatalog* catalog = nullptr;
+    std::unordered_map<int, RoomHandle> byId;                 // survives invalidation
+    std::unordered_map<std::string, RoomHandle> publicByName;
+    std::unordered_map<std::string, RoomHandle> privateByOwner;
+};
+
+// ---------- Room Simulation ----------
+struct RoomTickStats {
+    uint64_t ticks = 0;             // timer callbacks that had awake rooms
+    uint64_t steps = 0;             // fixed simulation steps run
+    uint64_t frames = 0;            // aggregated room frames emitted
+    uint64_t overruns = 0;          // ticks slower than the tick interval
+    size_t activeRooms = 0;
+    double lastTickUs = 0;
+    double avgTickUs = 0;
+    double maxTickUs = 0;
+    double budgetUs = 0;            // the tick interval
+};
+
+// Fixed-timestep loop over the rooms that have something going on. The
+// timer fires at tickHz; late wake-ups are caught up with extra steps (up to
+// kMaxCatchUpSteps) so walking speed does not depend on timer jitter. Each
+// tick ends with at most one emit() per changed room. Rooms with no walkers
+// and no pending changes fall out of the active list until woken again.
+class RoomSimulation {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Emit = std::function<void(Room&, uint64_t tick)>;
+    static constexpr int kMaxCatchUpSteps = 4;
+
+    RoomSimulation(RoomRegistry& rooms, int tickHz, float walkTilesPerSecond);
+
+    int tickHz() const { return hz; }
+    int tickIntervalMs() const { return 1000 / hz; }
+    int stepMs() const { return (int)(1000.0f / walkSpeed); }   // time per tile for client tweens
+
+    // Roster changes go through here so the room gets ticked
+    RoomAvatar* join(RoomHandle handle, const void* owner, int userId, const std::string& username, Tile tile);
+    void leave(RoomHandle handle, const void* owner, PositionBatch& lastPosition);
+    void walk(RoomHandle handle, const void* owner, std::vector<Tile> path);
+    void stop(RoomHandle handle, const void* owner);
+
+    void tick(const Emit& emit);
+    RoomTickStats stats() const;
+
+private:
+    void wake(Room& room);
+
+    RoomRegistry& rooms;
+    const int hz;
+    const float walkSpeed;
+    std::vector<RoomHandle> active;
+    Clock::time_point lastTick{};
+    double carrySeconds = 0;        // simulated time owed from late ticks
+    uint64_t tickNumber = 0;
+    double totalTickUs = 0;
+    RoomTickStats counters;
+};
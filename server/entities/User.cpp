@@ -0,0 +1,83 @@
+#include "User.hpp"
+#include <mutex>
+
+// ----------------------
+// SessionDirectory
+// ----------------------
+std::string SessionDirectory::foldName(std::string_view username) {
+    std::string folded(username);
+    for (char& c : folded) {
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    }
+    return folded;
+}
+
+void SessionDirectory::eraseLocked(std::unordered_map<uint64_t, SessionRef>::iterator it) {
+    const SessionRef& ref = it->second;
+    auto user = byUser.find(ref.userId);
+    if (user != byUser.end() && user->second == ref.id) byUser.erase(user);
+    auto name = byName.find(foldName(ref.username));
+    if (name != byName.end() && name->second == ref.id) byName.erase(name);
+    byId.erase(it);
+}
+
+std::optional<SessionRef> SessionDirectory::add(int userId, const std::string& username, size_t shard, void* socket,
+                                                uint64_t& sessionId) {
+    std::optional<SessionRef> displaced;
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto previous = byUser.find(userId);
+    if (previous != byUser.end()) {
+        auto it = byId.find(previous->second);
+        if (it != byId.end()) {
+            displaced = it->second;
+            eraseLocked(it);
+        }
+    }
+    sessionId = nextId++;
+    byId[sessionId] = SessionRef{sessionId, userId, username, shard, socket};
+    byUser[userId] = sessionId;
+    byName[foldName(username)] = sessionId;
+    return displaced;
+}
+
+void SessionDirectory::remove(uint64_t id, const void* socket) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = byId.find(id);
+    if (it == byId.end() || it->second.socket != socket) return;
+    eraseLocked(it);
+}
+
+void SessionDirectory::park(uint64_t id) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = byId.find(id);
+    if (it != byId.end()) it->second.socket = nullptr;
+}
+
+bool SessionDirectory::resume(uint64_t id, size_t shard, void* socket) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = byId.find(id);
+    if (it == byId.end()) return false;
+    it->second.shard = shard;
+    it->second.socket = socket;
+    return true;
+}
+
+std::optional<SessionRef> SessionDirectory::findByUserId(int userId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto user = byUser.find(userId);
+    if (user == byUser.end()) return std::nullopt;
+    return byId.at(user->second);
+}
+
+std::optional<SessionRef> SessionDirectory::findByUsername(std::string_view username) const {
+    std::string folded = foldName(username);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto name = byName.find(folded);
+    if (name == byName.end()) return std::nullopt;
+    return byId.at(name->second);
+}
+
+size_t SessionDirectory::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return byId.size();
+}
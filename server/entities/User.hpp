@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Room.hpp"
+#include "Protocol.hpp"
+
+// ---------- User (per-connection session data) ----------
+struct User {
+    int id = -1;                           // DB user ID
+    uint64_t sessionId = 0;                // SessionDirectory entry; 0 until logged in
+    std::string username;
+    RoomHandle currentRoom = kNoRoom;      // handle into RoomRegistry
+    WireFormat wireFormat = WireFormat::Json; // negotiated at upgrade
+    std::unordered_set<std::string> roles; // e.g., admin, helper
+    std::vector<std::string> inventory;    // item names for now
+    std::string remoteAddress;             // login limits are per address
+    std::optional<PlayerPosition> savedPosition; // from login; spares the first room entry a lookup
+    std::shared_ptr<bool> alive;           // cleared on close; guards deferred DB callbacks
+
+    // Backpressure (network/Backpressure.hpp)
+    bool slow = false;                     // unsubscribed from room topics until drained
+    std::chrono::steady_clock::time_point slowSince;
+    uint64_t slowFurnitureVersion = 0;     // resync sends furniture changes after this
+    uint32_t chatSkipped = 0;
+    unsigned int peakBuffered = 0;
+
+    // Area of interest (entities/Interest.hpp)
+    ViewCell view;                         // view cell followed in the current room; invalid outside filtering rooms
+    uint64_t viewFurnitureVersion = 0;     // furniture version this session was last synced to
+};
+
+// ---------- Session Directory ----------
+// Every logged-in session on every shard, by user id and by case-folded
+// username. Shared by all shards behind a reader/writer lock; the socket is
+// only ever dereferenced on its own shard's loop, after checking that the
+// session still belongs to it (see withSession in main.cpp).
+struct SessionRef {
+    uint64_t id = 0;
+    int userId = -1;
+    std::string username;
+    size_t shard = 0;
+    void* socket = nullptr;                // nullptr while parked for a shard handover
+};
+
+class SessionDirectory {
+public:
+    // Registers a login. A session already logged in as the same user is
+    // dropped from the directory and returned so the caller can close it.
+    std::optional<SessionRef> add(int userId, const std::string& username, size_t shard, void* socket,
+                                  uint64_t& sessionId);
+    // No-op unless `id` is still attached to `socket`
+    void remove(uint64_t id, const void* socket);
+
+    // Handover: the session leaves its socket and waits for the reconnect
+    void park(uint64_t id);
+    // False if the session was removed or displaced in the meantime
+    bool resume(uint64_t id, size_t shard, void* socket);
+
+    std::optional<SessionRef> findByUserId(int userId) const;
+    std::optional<SessionRef> findByUsername(std::string_view username) const;
+    size_t size() const;
+
+    static std::string foldName(std::string_view username);
+
+private:
+    void eraseLocked(std::unordered_map<uint64_t, SessionRef>::iterator it);
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<uint64_t, SessionRef> byId;
+    std::unordered_map<int, uint64_t> byUser;
+    std::unordered_map<std::string, uint64_t> byName;
+    uint64_t nextId = 1;
+};
@@ -0,0 +1,102 @@
+#include "WalkGrid.hpp"
+#include <algorithm>
+
+// Largest layout accepted; keeps a bad layout_json from allocating a huge grid
+static constexpr int kMaxGridSide = 256;
+
+// Parses the "tiles" array of arrays; false when missing or malformed
+static bool parseLayoutTiles(std::string_view json, std::vector<std::vector<uint8_t>>& rows) {
+    size_t pos = json.find("\"tiles\"");
+    if (pos == std::string_view::npos) return false;
+    pos = json.find('[', pos);
+    if (pos == std::string_view::npos) return false;
+    pos++;
+
+    auto skip = [&] {
+        while (pos < json.size() && (json[pos] == ' ' || json[pos] == ',' || json[pos] == '\n' ||
+                                     json[pos] == '\r' || json[pos] == '\t')) pos++;
+    };
+    for (;;) {
+        skip();
+        if (pos >= json.size()) return false;
+        if (json[pos] == ']') return !rows.empty();
+        if (json[pos] != '[' || rows.size() >= (size_t)kMaxGridSide) return false;
+        pos++;
+        std::vector<uint8_t> row;
+        for (;;) {
+            skip();
+            if (pos >= json.size()) return false;
+            if (json[pos] == ']') {
+                pos++;
+                break;
+            }
+            if (json[pos] < '0' || json[pos] > '9' || row.size() >= (size_t)kMaxGridSide) return false;
+            int value = 0;
+            while (pos < json.size() && json[pos] >= '0' && json[pos] <= '9') value = value * 10 + (json[pos++] - '0');
+            row.push_back(value == 1 ? 1 : 0);
+        }
+        rows.push_back(std::move(row));
+    }
+}
+
+void WalkGrid::build(std::string_view layoutJson, int fallbackWidth, int fallbackHeight) {
+    std::vector<std::vector<uint8_t>> rows;
+    if (parseLayoutTiles(layoutJson, rows)) {
+        h = (int)rows.size();
+        w = 0;
+        for (const auto& row : rows) w = std::max(w, (int)row.size());
+    } else {
+        rows.clear();
+        w = std::clamp(fallbackWidth, 1, kMaxGridSide);
+        h = std::clamp(fallbackHeight, 1, kMaxGridSide);
+    }
+
+    size_t cells = (size_t)w * h;
+    floorBits.assign((cells + 63) / 64, 0);
+    blockers.assign(cells, 0);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            bool isFloor = rows.empty() || (x < (int)rows[y].size() && rows[y][x]);
+            setBit(floorBits, index(x, y), isFloor);
+        }
+    }
+    walkBits = floorBits;
+    isBuilt = true;
+}
+
+void WalkGrid::reset() {
+    isBuilt = false;
+    w = h = 0;
+    // Freed, not just cleared: rooms that went idle give the memory back
+    std::vector<uint64_t>().swap(floorBits);
+    std::vector<uint64_t>().swap(walkBits);
+    std::vector<uint16_t>().swap(blockers);
+}
+
+void WalkGrid::addBlocker(int x, int y) {
+    if (!isBuilt || !inside(x, y)) return;
+    int i = index(x, y);
+    if (blockers[i]++ == 0) setBit(walkBits, i, false);
+}
+
+void WalkGrid::removeBlocker(int x, int y) {
+    if (!isBuilt || !inside(x, y)) return;
+    int i = index(x, y);
+    if (blockers[i] == 0) return;
+    if (--blockers[i] == 0) setBit(walkBits, i, testBit(floorBits, i));
+}
+
+void WalkGrid::clearBlockers() {
+    std::fill(blockers.begin(), blockers.end(), 0);
+    walkBits = floorBits;
+}
+
+Tile WalkGrid::spawnTile(Tile preferred) const {
+    if (walkable(preferred.x, preferred.y)) return preferred;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            if (walkable(x, y)) return Tile{x, y};
+        }
+    }
+    return preferred;
+}
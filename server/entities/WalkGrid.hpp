@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Tile {
+    int x = 0;
+    int y = 0;
+    bool operator==(const Tile& o) const { return x == o.x && y == o.y; }
+    bool operator!=(const Tile& o) const { return !(*this == o); }
+};
+
+// ---------- Walkability Grid ----------
+// Per-room bitmap of tiles an avatar may stand on: floor tiles from the
+// room's layout_json ({"tiles":[[1,0,..],..]}, 1 = floor) minus tiles
+// covered by furniture. Built once per room and then kept current by the
+// furniture snapshot; blockers are counted per tile so overlapping items can
+// come and go in any order.
+class WalkGrid {
+public:
+    // Rooms without a usable layout fall back to a width x height open floor
+    void build(std::string_view layoutJson, int fallbackWidth, int fallbackHeight);
+    void reset();
+    bool built() const { return isBuilt; }
+
+    int width() const { return w; }
+    int height() const { return h; }
+    bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < w && y < h; }
+    int index(int x, int y) const { return y * w + x; }
+
+    bool floor(int x, int y) const { return inside(x, y) && testBit(floorBits, index(x, y)); }
+    bool walkable(int x, int y) const { return inside(x, y) && testBit(walkBits, index(x, y)); }
+
+    // Furniture standing on a tile; out-of-grid tiles are ignored
+    void addBlocker(int x, int y);
+    void removeBlocker(int x, int y);
+    void clearBlockers();
+
+    // Where avatars appear on entering: `preferred` if walkable, else the first walkable tile
+    Tile spawnTile(Tile preferred) const;
+
+private:
+    static bool testBit(const std::vector<uint64_t>& bits, int i) { return (bits[i >> 6] >> (i & 63)) & 1; }
+    static void setBit(std::vector<uint64_t>& bits, int i, bool on) {
+        if (on) bits[i >> 6] |= (uint64_t)1 << (i & 63);
+        else bits[i >> 6] &= ~((uint64_t)1 << (i & 63));
+    }
+
+    bool isBuilt = false;
+    int w = 0;
+    int h = 0;
+    std::vector<uint64_t> floorBits;
+    std::vector<uint64_t> walkBits;    // floor and not blocked
+    std::vector<uint16_t> blockers;
+};
@@ -0,0 +1,282 @@
+#include "WsClient.hpp"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <random>
+
+static std::string base64(const uint8_t* data, size_t size) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t chunk = (uint32_t)data[i] << 16;
+        if (i + 1 < size) chunk |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < size) chunk |= data[i + 2];
+        out += kAlphabet[(chunk >> 18) & 63];
+        out += kAlphabet[(chunk >> 12) & 63];
+        out += i + 1 < size ? kAlphabet[(chunk >> 6) & 63] : '=';
+        out += i + 2 < size ? kAlphabet[chunk & 63] : '=';
+    }
+    return out;
+}
+
+// ----------------------
+// WsConnection
+// ----------------------
+WsConnection::~WsConnection() {
+    close();
+}
+
+bool WsConnection::connect(const sockaddr_in& address, std::string_view host, std::string_view subprotocol) {
+    close();
+    socketFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socketFd < 0) return false;
+    int one = 1;
+    ::setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (::connect(socketFd, (const sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+        close();
+        return false;
+    }
+
+    static thread_local std::mt19937 rng{std::random_device{}()};
+    uint8_t key[16];
+    for (uint8_t& b : key) b = (uint8_t)rng();
+    maskState = rng() | 1;
+
+    char port[8];
+    std::snprintf(port, sizeof(port), "%u", (unsigned)ntohs(address.sin_port));
+    out.clear();
+    outOffset = 0;
+    out += "GET / HTTP/1.1\r\nHost: ";
+    out.append(host.data(), host.size());
+    out += ':';
+    out += port;
+    out += "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: ";
+    out += base64(key, sizeof(key));
+    if (!subprotocol.empty()) {
+        out += "\r\nSec-WebSocket-Protocol: ";
+        out.append(subprotocol.data(), subprotocol.size());
+    }
+    out += "\r\n\r\n";
+    currentState = State::Connecting;
+    return true;
+}
+
+void WsConnection::close() {
+    if (socketFd >= 0) ::close(socketFd);
+    socketFd = -1;
+    currentState = State::Closed;
+    out.clear();
+    outOffset = 0;
+    pending.clear();
+    in.clear();
+    fragments.clear();
+}
+
+void WsConnection::sendFrame(uint8_t opcode, std::string_view payload) {
+    if (currentState == State::Closed) return;
+    std::string& target = currentState == State::Open ? out : pending;
+    size_t size = payload.size();
+    target += (char)(0x80 | opcode);
+    if (size < 126) {
+        target += (char)(0x80 | size);
+    } else if (size <= 0xffff) {
+        target += (char)(0x80 | 126);
+        target += (char)(size >> 8);
+        target += (char)size;
+    } else {
+        target += (char)(0x80 | 127);
+        for (int shift = 56; shift >= 0; shift -= 8) target += (char)((uint64_t)size >> shift);
+    }
+    // xorshift keeps the masks varied without a syscall per frame
+    maskState ^= maskState << 13;
+    maskState ^= maskState >> 17;
+    maskState ^= maskState << 5;
+    uint8_t mask[4] = {(uint8_t)(maskState >> 24), (uint8_t)(maskState >> 16), (uint8_t)(maskState >> 8), (uint8_t)maskState};
+    target.append((const char*)mask, 4);
+    size_t start = target.size();
+    target.append(payload.data(), size);
+    for (size_t i = 0; i < size; i++) target[start + i] ^= (char)mask[i & 3];
+    if (currentState == State::Open) flush();
+}
+
+bool WsConnection::flush() {
+    while (outOffset < out.size()) {
+        ssize_t n = ::send(socketFd, out.data() + outOffset, out.size() - outOffset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            close();
+            return false;
+        }
+        outOffset += (size_t)n;
+        sentBytes += (uint64_t)n;
+    }
+    out.clear();
+    outOffset = 0;
+    return true;
+}
+
+bool WsConnection::onWritable() {
+    if (currentState == State::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        ::getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            close();
+            return false;
+        }
+        currentState = State::Handshake;
+    }
+    return flush();
+}
+
+bool WsConnection::onReadable(const MessageHandler& onMessage) {
+    char buffer[16384];
+    for (;;) {
+        ssize_t n = ::recv(socketFd, buffer, sizeof(buffer), 0);
+        if (n == 0) {
+            close();
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            close();
+            return false;
+        }
+        receivedBytes += (uint64_t)n;
+        in.append(buffer, (size_t)n);
+    }
+    if (currentState == State::Handshake && !parseHandshake()) return currentState != State::Closed;
+    return parseFrames(onMessage);
+}
+
+bool WsConnection::parseHandshake() {
+    size_t end = in.find("\r\n\r\n");
+    if (end == std::string::npos) return false;
+    if (in.compare(0, 12, "HTTP/1.1 101") != 0) {
+        close();
+        return false;
+    }
+    in.erase(0, end + 4);
+    currentState = State::Open;
+    out += pending;
+    pending.clear();
+    return flush();
+}
+
+bool WsConnection::parseFrames(const MessageHandler& onMessage) {
+    size_t offset = 0;
+    while (currentState == State::Open && in.size() - offset >= 2) {
+        const uint8_t* p = (const uint8_t*)in.data() + offset;
+        size_t available = in.size() - offset;
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0f;
+        bool masked = p[1] & 0x80;
+        uint64_t size = p[1] & 0x7f;
+        size_t header = 2;
+        if (size == 126) {
+            if (available < 4) break;
+            size = ((uint64_t)p[2] << 8) | p[3];
+            header = 4;
+        } else if (size == 127) {
+            if (available < 10) break;
+            size = 0;
+            for (int i = 0; i < 8; i++) size = (size << 8) | p[2 + i];
+            header = 10;
+        }
+        size_t maskAt = header;
+        if (masked) header += 4;
+        if (available < header + size) break;
+
+        std::string_view payload(in.data() + offset + header, (size_t)size);
+        std::string unmasked;
+        if (masked) {
+            unmasked.assign(payload);
+            for (size_t i = 0; i < unmasked.size(); i++) unmasked[i] ^= (char)p[maskAt + (i & 3)];
+            payload = unmasked;
+        }
+        offset += header + (size_t)size;
+
+        switch (opcode) {
+            case 0x0:   // continuation
+                fragments.append(payload);
+                if (fin) {
+                    onMessage(fragments, fragmentOpcode == 0x2);
+                    fragments.clear();
+                }
+                break;
+            case 0x1:
+            case 0x2:
+                if (fin) {
+                    onMessage(payload, opcode == 0x2);
+                } else {
+                    fragmentOpcode = opcode;
+                    fragments.assign(payload);
+                }
+                break;
+            case 0x8:
+                close();
+                return false;
+            case 0x9:
+                sendFrame(0xA, payload);
+                break;
+            default:    // pong and reserved opcodes
+                break;
+        }
+    }
+    if (currentState != State::Open) return false;
+    in.erase(0, offset);
+    return true;
+}
+
+// ----------------------
+// WsPoller
+// ----------------------
+WsPoller::WsPoller() : epollFd(::epoll_create1(EPOLL_CLOEXEC)) {}
+
+WsPoller::~WsPoller() {
+    if (epollFd >= 0) ::close(epollFd);
+}
+
+void WsPoller::add(WsConnection& connection, void* tag) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.ptr = tag;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, connection.fd(), &event);
+}
+
+void WsPoller::remove(WsConnection& connection) {
+    if (connection.fd() >= 0) ::epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd(), nullptr);
+}
+
+void WsPoller::update(WsConnection& connection, void* tag) {
+    if (connection.fd() < 0) return;
+    epoll_event event{};
+    event.events = EPOLLIN | (connection.wantsWrite() ? (uint32_t)EPOLLOUT : 0u);
+    event.data.ptr = tag;
+    ::epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd(), &event);
+}
+
+void WsPoller::poll(int timeoutMs, const std::function<void(void*, bool, bool)>& fn) {
+    epoll_event events[256];
+    int n = ::epoll_wait(epollFd, events, 256, timeoutMs);
+    for (int i = 0; i < n; i++) {
+        bool readable = events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR);
+        bool writable = events[i].events & EPOLLOUT;
+        fn(events[i].data.ptr, readable, writable);
+    }
+}
+
+uint64_t raiseFileLimit() {
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) return 0;
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    return (uint64_t)limit.rlim_cur;
+}
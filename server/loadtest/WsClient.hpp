@@ -0,0 +1,89 @@
+#pragma once
+#include <netinet/in.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// ---------- Minimal WebSocket client (load testing only) ----------
+// Plain TCP (no TLS), non-blocking, driven by an epoll loop (WsPoller).
+// Enough of RFC 6455 for the swarm: the upgrade handshake, masked client
+// frames, unfragmented or fragmented server frames, ping/pong and close.
+// The Sec-WebSocket-Accept value is not verified.
+class WsConnection {
+public:
+    enum class State : uint8_t { Connecting, Handshake, Open, Closed };
+
+    // Whole text or binary message from the server
+    using MessageHandler = std::function<void(std::string_view payload, bool binary)>;
+
+    WsConnection() = default;
+    ~WsConnection();
+
+    WsConnection(const WsConnection&) = delete;
+    WsConnection& operator=(const WsConnection&) = delete;
+
+    // Starts a non-blocking connect; the handshake is sent once writable.
+    // `subprotocol` is offered in Sec-WebSocket-Protocol when not empty.
+    bool connect(const sockaddr_in& address, std::string_view host, std::string_view subprotocol = {});
+    void close();
+
+    // Queued until the handshake completes
+    void sendText(std::string_view payload) { sendFrame(0x1, payload); }
+    void sendBinary(std::string_view payload) { sendFrame(0x2, payload); }
+
+    // Poller callbacks. False when the connection is closed afterwards.
+    bool onReadable(const MessageHandler& onMessage);
+    bool onWritable();
+
+    int fd() const { return socketFd; }
+    State state() const { return currentState; }
+    bool open() const { return currentState == State::Open; }
+    bool wantsWrite() const { return currentState == State::Connecting || outOffset < out.size(); }
+
+    uint64_t bytesSent() const { return sentBytes; }
+    uint64_t bytesReceived() const { return receivedBytes; }
+
+private:
+    void sendFrame(uint8_t opcode, std::string_view payload);
+    bool flush();
+    bool parseHandshake();
+    bool parseFrames(const MessageHandler& onMessage);
+
+    int socketFd = -1;
+    State currentState = State::Closed;
+    std::string out;            // bytes not yet written, from outOffset on
+    size_t outOffset = 0;
+    std::string pending;        // frames queued before the handshake completed
+    std::string in;             // bytes read but not yet parsed
+    std::string fragments;      // payload of a fragmented message so far
+    uint8_t fragmentOpcode = 0;
+    uint32_t maskState = 0x9e3779b9u;
+    uint64_t sentBytes = 0;
+    uint64_t receivedBytes = 0;
+};
+
+// ---------- epoll loop for many WsConnections ----------
+class WsPoller {
+public:
+    WsPoller();
+    ~WsPoller();
+
+    WsPoller(const WsPoller&) = delete;
+    WsPoller& operator=(const WsPoller&) = delete;
+
+    // `tag` comes back with every event for the connection
+    void add(WsConnection& connection, void* tag);
+    void remove(WsConnection& connection);
+    // Re-arms write interest after new frames were queued
+    void update(WsConnection& connection, void* tag);
+
+    // Waits up to timeoutMs and calls fn(tag, readable, writable) per ready connection
+    void poll(int timeoutMs, const std::function<void(void* tag, bool readable, bool writable)>& fn);
+
+private:
+    int epollFd = -1;
+};
+
+// Raises RLIMIT_NOFILE to its hard limit; returns the new soft limit
+uint64_t raiseFileLimit();
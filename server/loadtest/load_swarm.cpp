@@ -0,0 +1,747 @@
+// Headless load generator: thousands of simulated users speaking the same
+// protocol as client/game over plain WebSockets. Each user registers, logs
+// in, joins a room (following SHARD_REDIRECT handovers), subscribes to it
+// and then chats, clicks tiles and creates and moves furniture at the
+// configured per-user rates. Reports round-trip latency per message type,
+// chat broadcast lag (sender to every other swarm member in the room) and
+// throughput.
+//
+// Needs a running server (and so its Postgres) on --host/--port; users are
+// named <prefix><n> and are registered on first use. The server lets one
+// address have only a couple of logins in flight, so start it with
+// HABBO_LOGINS_PER_ADDRESS=0 for a swarm; otherwise "Too many attempts"
+// replies are retried with backoff and counted as throttled.
+//
+//   load_swarm --users 2000 --threads 4 --rooms Lobby,Lounge --room-dist zipf --duration 60
+#include <arpa/inet.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "JsonMessage.hpp"
+#include "JsonWriter.hpp"
+#include "Metrics.hpp"
+#include "WsClient.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t nowUs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// ----------------------
+// Options
+// ----------------------
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 9001;
+    int users = 100;
+    int threads = 1;
+    double rampPerSecond = 200;         // new connections per second over all threads
+    int durationSeconds = 30;           // after the last user started
+    int reportSeconds = 5;
+    std::vector<std::string> rooms = {"Lobby"};
+    bool zipf = false;                  // otherwise users spread evenly over rooms
+    double zipfExponent = 1.0;
+    std::string prefix = "swarm";
+    std::string password = "swarm-pass";
+    bool registerUsers = true;
+    int roomTiles = 10;                 // tx/ty are drawn from [0, roomTiles)
+    int furniturePerUser = 5;           // creates turn into moves once a user owns this many
+    int chatBytes = 32;
+    int timeoutMs = 5000;               // pending requests older than this count as timeouts
+    int loginRetries = 10;              // throttled /register or /login retries before a user gives up
+    // Per user, per second
+    double chatRate = 0.2;
+    double tileClickRate = 0.5;
+    double createRate = 0.05;
+    double updateRate = 0.2;
+    double subscribeRate = 0.01;
+};
+
+static void usage() {
+    std::printf(
+        "usage: load_swarm [options]\n"
+        "  --host H --port P          server address (127.0.0.1:9001)\n"
+        "  --users N --threads T      simulated users and client threads (100, 1)\n"
+        "  --ramp R                   connections started per second (200)\n"
+        "  --duration S --report S    run time after ramp-up and report interval (30, 5)\n"
+        "  --rooms A,B,...            rooms to join; single words, /join has no quoting (Lobby)\n"
+        "  --room-dist uniform|zipf   how users spread over --rooms (uniform)\n"
+        "  --zipf-s X                 zipf exponent (1.0)\n"
+        "  --prefix P --password W    user names are P<n> (swarm, swarm-pass)\n"
+        "  --no-register              users already exist; skip /register\n"
+        "  --room-tiles N             tiles drawn from [0, N) (10)\n"
+        "  --furniture-per-user N     items a user creates before it only moves them (5)\n"
+        "  --chat-bytes N             chat line length (32)\n"
+        "  --timeout-ms N             pending request timeout (5000)\n"
+        "  --login-retries N          retries of a throttled /register or /login (10)\n"
+        "  --chat R --tile-click R --create R --update R --subscribe R\n"
+        "                             per-user rates per second (0.2, 0.5, 0.05, 0.2, 0.01)\n");
+}
+
+static bool parseOptions(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--host") o.host = next();
+        else if (arg == "--port") o.port = std::atoi(next());
+        else if (arg == "--users") o.users = std::atoi(next());
+        else if (arg == "--threads") o.threads = std::max(1, std::atoi(next()));
+        else if (arg == "--ramp") o.rampPerSecond = std::atof(next());
+        else if (arg == "--duration") o.durationSeconds = std::atoi(next());
+        else if (arg == "--report") o.reportSeconds = std::max(1, std::atoi(next()));
+        else if (arg == "--rooms") {
+            o.rooms.clear();
+            std::string list = next();
+            for (size_t start = 0; start <= list.size();) {
+                size_t comma = list.find(',', start);
+                if (comma == std::string::npos) comma = list.size();
+                if (comma > start) o.rooms.push_back(list.substr(start, comma - start));
+                start = comma + 1;
+            }
+        }
+        else if (arg == "--room-dist") o.zipf = std::string(next()) == "zipf";
+        else if (arg == "--zipf-s") o.zipfExponent = std::atof(next());
+        else if (arg == "--prefix") o.prefix = next();
+        else if (arg == "--password") o.password = next();
+        else if (arg == "--no-register") o.registerUsers = false;
+        else if (arg == "--room-tiles") o.roomTiles = std::max(1, std::atoi(next()));
+        else if (arg == "--furniture-per-user") o.furniturePerUser = std::atoi(next());
+        else if (arg == "--chat-bytes") o.chatBytes = std::max(0, std::atoi(next()));
+        else if (arg == "--timeout-ms") o.timeoutMs = std::max(1, std::atoi(next()));
+        else if (arg == "--login-retries") o.loginRetries = std::max(0, std::atoi(next()));
+        else if (arg == "--chat") o.chatRate = std::atof(next());
+        else if (arg == "--tile-click") o.tileClickRate = std::atof(next());
+        else if (arg == "--create") o.createRate = std::atof(next());
+        else if (arg == "--update") o.updateRate = std::atof(next());
+        else if (arg == "--subscribe") o.subscribeRate = std::atof(next());
+        else if (arg == "--help" || arg == "-h") {
+            usage();
+            std::exit(0);
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            usage();
+            return false;
+        }
+    }
+    if (o.rooms.empty() || o.users <= 0) {
+        usage();
+        return false;
+    }
+    if (o.host == "localhost") o.host = "127.0.0.1";
+    return true;
+}
+
+// ----------------------
+// Statistics
+// Each client thread owns one SwarmStats; the reporter only reads it
+// (ValueHistogram and the counters are safe to read from another thread).
+// ----------------------
+enum class Op : uint8_t { Register, Login, Join, Resume, Subscribe, CreateFurniture, UpdateFurniture, TileClick, Count };
+
+static const char* const kOpNames[(size_t)Op::Count] = {
+    "/register", "/login", "/join", "RESUME_SESSION", "SUBSCRIBE_ROOM", "CREATE_FURNITURE", "UPDATE_FURNITURE", "TILE_CLICK",
+};
+
+struct OpStats {
+    ValueHistogram rttUs;
+    MetricCounter sent;
+    MetricCounter errors;
+    MetricCounter timeouts;
+    MetricCounter throttled;            // per-address login limit hit; retried
+};
+
+struct SwarmStats {
+    OpStats ops[(size_t)Op::Count];
+    ValueHistogram chatLagUs;           // chat line sent -> received by another swarm user
+    MetricCounter chatSent;
+    MetricCounter framesSent;
+    MetricCounter framesReceived;
+    MetricCounter bytesSent;
+    MetricCounter bytesReceived;
+    MetricGauge connected;
+    MetricGauge active;                 // joined, subscribed and running the mix
+    MetricCounter failed;               // users that gave up (connect, login or join failed)
+};
+
+static uint64_t percentile(const ValueHistogram::Snapshot& h, double q) {
+    if (h.count == 0) return 0;
+    uint64_t rank = (uint64_t)std::ceil(q * (double)h.count);
+    uint64_t seen = 0;
+    for (int i = 0; i < ValueHistogram::kBuckets; i++) {
+        seen += h.buckets[i];
+        if (seen >= rank) return ValueHistogram::bucketLimit(i) - 1;
+    }
+    return ValueHistogram::bucketLimit(ValueHistogram::kBuckets - 1);
+}
+
+static void printLatencyRow(const char* name, const ValueHistogram::Snapshot& h, uint64_t sent, uint64_t errors, uint64_t timeouts,
+                            uint64_t throttled) {
+    std::printf("  %-18s %9llu %9llu %7llu %7llu %9llu %9.2f %9.2f %9.2f %9.2f\n", name, (unsigned long long)sent,
+                (unsigned long long)h.count, (unsigned long long)errors, (unsigned long long)timeouts, (unsigned long long)throttled,
+                percentile(h, 0.50) / 1000.0, percentile(h, 0.99) / 1000.0, percentile(h, 0.999) / 1000.0,
+                h.count ? (double)h.sum / (double)h.count / 1000.0 : 0.0);
+}
+
+static void printReport(const std::vector<std::unique_ptr<SwarmStats>>& threads, double seconds, bool final) {
+    ValueHistogram::Snapshot rtt[(size_t)Op::Count];
+    uint64_t sent[(size_t)Op::Count] = {}, errors[(size_t)Op::Count] = {}, timeouts[(size_t)Op::Count] = {};
+    uint64_t throttled[(size_t)Op::Count] = {};
+    ValueHistogram::Snapshot lag;
+    uint64_t chats = 0, framesOut = 0, framesIn = 0, bytesOut = 0, bytesIn = 0, failed = 0;
+    int64_t connected = 0, active = 0;
+    for (const auto& s : threads) {
+        for (size_t i = 0; i < (size_t)Op::Count; i++) {
+            s->ops[i].rttUs.addTo(rtt[i]);
+            sent[i] += s->ops[i].sent.get();
+            errors[i] += s->ops[i].errors.get();
+            timeouts[i] += s->ops[i].timeouts.get();
+            throttled[i] += s->ops[i].throttled.get();
+        }
+        s->chatLagUs.addTo(lag);
+        chats += s->chatSent.get();
+        framesOut += s->framesSent.get();
+        framesIn += s->framesReceived.get();
+        bytesOut += s->bytesSent.get();
+        bytesIn += s->bytesReceived.get();
+        connected += s->connected.get();
+        active += s->active.get();
+        failed += s->failed.get();
+    }
+    std::printf("%s after %.1fs: connected=%lld active=%lld failed=%llu\n", final ? "== Final" : "-- Progress", seconds,
+                (long long)connected, (long long)active, (unsigned long long)failed);
+    std::printf("  throughput: out %.0f frames/s (%.1f KiB/s), in %.0f frames/s (%.1f KiB/s)\n",
+                framesOut / seconds, bytesOut / seconds / 1024.0, framesIn / seconds, bytesIn / seconds / 1024.0);
+    std::printf("  %-18s %9s %9s %7s %7s %9s %9s %9s %9s %9s\n", "round trip (ms)", "sent", "answered", "errors", "timeout",
+                "throttled", "p50", "p99", "p999", "mean");
+    for (size_t i = 0; i < (size_t)Op::Count; i++) {
+        if (sent[i]) printLatencyRow(kOpNames[i], rtt[i], sent[i], errors[i], timeouts[i], throttled[i]);
+    }
+    if (chats) {
+        std::printf("  %-18s %9s %9s\n", "broadcast lag (ms)", "sent", "delivered");
+        printLatencyRow("chat", lag, chats, 0, 0, 0);
+    }
+    std::fflush(stdout);
+}
+
+// ----------------------
+// Simulated user
+// ----------------------
+enum class Phase : uint8_t { Idle, Connecting, Registering, LoggingIn, Joining, Resuming, Subscribing, Active, Failed };
+
+struct Pending {
+    Op op;
+    uint64_t sentUs;
+};
+
+struct SimUser {
+    int index = 0;
+    std::string name;
+    std::string room;
+    WsConnection conn;
+    Phase phase = Phase::Idle;
+    uint64_t lastBytesSent = 0;
+    uint64_t lastBytesReceived = 0;
+
+    std::deque<Pending> pendingCommands;                // slash commands, answered in order with ✅/❌
+    std::unordered_map<std::string, Pending> pendingRequests;  // JSON requests by reqId
+    uint64_t nextRequestId = 1;
+
+    uint64_t retryAtUs = 0;                             // throttled /register or /login: resend then
+    int loginRetries = 0;
+
+    std::string resumeTicket;                           // SHARD_REDIRECT: reconnect and resume
+    int resumePort = 0;
+    uint64_t furnitureVersion = 0;
+    std::vector<std::string> furniture;                 // uids this user created
+    int createsInFlight = 0;
+    uint64_t nextFurnitureUid = 1;
+
+    uint64_t nextChatUs = 0;
+    uint64_t nextTileClickUs = 0;
+    uint64_t nextCreateUs = 0;
+    uint64_t nextUpdateUs = 0;
+    uint64_t nextSubscribeUs = 0;
+};
+
+static constexpr std::string_view kChatMarker = "lt|";   // chat lines: lt|<sentUs>|padding
+
+// ----------------------
+// Client thread: owns a share of the users, one epoll loop for all of them
+// ----------------------
+class SwarmThread {
+public:
+    SwarmThread(const Options& options, SwarmStats& stats, int first, int stride, std::atomic<bool>& stopping,
+                Clock::time_point start)
+        : options(options), stats(stats), stopping(stopping), start(start), rng(std::random_device{}() + first) {
+        inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)options.port);
+        for (int i = first; i < options.users; i += stride) {
+            auto user = std::make_unique<SimUser>();
+            user->index = i;
+            user->name = options.prefix + std::to_string(i);
+            user->room = pickRoom();
+            users.push_back(std::move(user));
+        }
+        // This thread's share of the global ramp
+        startIntervalUs = options.rampPerSecond > 0 ? 1e6 * stride / options.rampPerSecond : 0;
+        firstStartUs = options.rampPerSecond > 0 ? 1e6 * first / options.rampPerSecond : 0;
+    }
+
+    void run() {
+        uint64_t startUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(start.time_since_epoch()).count();
+        size_t started = 0;
+        uint64_t lastSweepUs = 0;
+        while (!stopping.load(std::memory_order_relaxed)) {
+            poller.poll(5, [this](void* tag, bool readable, bool writable) { onEvent(*(SimUser*)tag, readable, writable); });
+            uint64_t now = nowUs();
+            while (started < users.size() && now >= startUs + (uint64_t)(firstStartUs + startIntervalUs * started)) {
+                connectUser(*users[started++], 0);
+            }
+            for (auto& user : users) {
+                if (user->phase == Phase::Active) runMix(*user, now);
+                else if (user->retryAtUs && now >= user->retryAtUs) retryLogin(*user);
+            }
+            if (now - lastSweepUs > 100000) {
+                for (auto& user : users) expire(*user, now);
+                lastSweepUs = now;
+            }
+        }
+        for (auto& user : users) closeUser(*user);
+    }
+
+private:
+    // ---------- Setup ----------
+    std::string pickRoom() {
+        const auto& rooms = options.rooms;
+        if (!options.zipf || rooms.size() == 1) return rooms[std::uniform_int_distribution<size_t>(0, rooms.size() - 1)(rng)];
+        // Room k (1-based) is chosen with weight 1/k^s
+        std::vector<double> weights(rooms.size());
+        for (size_t k = 0; k < rooms.size(); k++) weights[k] = 1.0 / std::pow((double)(k + 1), options.zipfExponent);
+        return rooms[std::discrete_distribution<size_t>(weights.begin(), weights.end())(rng)];
+    }
+
+    void connectUser(SimUser& user, int port) {
+        sockaddr_in target = address;
+        if (port) target.sin_port = htons((uint16_t)port);
+        if (!user.conn.connect(target, options.host)) {
+            fail(user);
+            return;
+        }
+        user.lastBytesSent = user.conn.bytesSent();
+        user.lastBytesReceived = user.conn.bytesReceived();
+        user.phase = user.resumeTicket.empty() ? Phase::Connecting : Phase::Resuming;
+        poller.add(user.conn, &user);
+        stats.connected.set(stats.connected.get() + 1);
+        if (user.phase == Phase::Resuming) {
+            JsonWriter w;
+            std::string reqId = track(user, Op::Resume);
+            w.beginObject().field("type", "RESUME_SESSION").field("reqId", reqId).field("ticket", user.resumeTicket).endObject();
+            sendText(user, w.view());
+            user.resumeTicket.clear();
+            return;
+        }
+        if (options.registerUsers) {
+            user.phase = Phase::Registering;
+            sendRegister(user);
+        } else {
+            user.phase = Phase::LoggingIn;
+            sendLogin(user);
+        }
+    }
+
+    void sendRegister(SimUser& user) {
+        sendCommand(user, Op::Register, "/register " + user.name + " " + user.name + "@swarm.invalid " + options.password);
+    }
+
+    void sendLogin(SimUser& user) {
+        sendCommand(user, Op::Login, "/login " + user.name + " " + options.password);
+    }
+
+    // "Too many attempts": the server's per-address limit, not a failed login.
+    // Back off exponentially (200ms doubling up to 5s, jittered so the swarm
+    // does not come back in lockstep) and try the same command again.
+    void throttleLogin(SimUser& user) {
+        if (user.loginRetries >= options.loginRetries) return fail(user);
+        double backoffUs = std::min(5e6, 2e5 * (double)(1u << std::min(user.loginRetries, 5)));
+        backoffUs *= std::uniform_real_distribution<double>(0.5, 1.5)(rng);
+        user.loginRetries++;
+        user.retryAtUs = nowUs() + (uint64_t)backoffUs;
+    }
+
+    void retryLogin(SimUser& user) {
+        user.retryAtUs = 0;
+        if (user.phase == Phase::Registering) sendRegister(user);
+        else if (user.phase == Phase::LoggingIn) sendLogin(user);
+    }
+
+    void closeUser(SimUser& user) {
+        if (user.conn.fd() < 0) return;
+        countBytes(user);
+        poller.remove(user.conn);
+        user.conn.close();
+        stats.connected.set(stats.connected.get() - 1);
+        if (user.phase == Phase::Active) stats.active.set(stats.active.get() - 1);
+    }
+
+    void fail(SimUser& user) {
+        closeUser(user);
+        user.retryAtUs = 0;
+        user.phase = Phase::Failed;
+        stats.failed.add();
+    }
+
+    void becomeActive(SimUser& user) {
+        user.phase = Phase::Active;
+        stats.active.set(stats.active.get() + 1);
+        uint64_t now = nowUs();
+        user.nextChatUs = schedule(now, options.chatRate);
+        user.nextTileClickUs = schedule(now, options.tileClickRate);
+        user.nextCreateUs = schedule(now, options.createRate);
+        user.nextUpdateUs = schedule(now, options.updateRate);
+        user.nextSubscribeUs = schedule(now, options.subscribeRate);
+    }
+
+    // Poisson arrivals: exponential gaps with mean 1/rate
+    uint64_t schedule(uint64_t now, double ratePerSecond) {
+        if (ratePerSecond <= 0) return UINT64_MAX;
+        return now + (uint64_t)(std::exponential_distribution<double>(ratePerSecond)(rng) * 1e6);
+    }
+
+    // ---------- Sending ----------
+    void sendText(SimUser& user, std::string_view payload) {
+        user.conn.sendText(payload);
+        stats.framesSent.add();
+        poller.update(user.conn, &user);
+    }
+
+    void sendCommand(SimUser& user, Op op, const std::string& command) {
+        user.pendingCommands.push_back(Pending{op, nowUs()});
+        stats.ops[(size_t)op].sent.add();
+        sendText(user, command);
+    }
+
+    std::string track(SimUser& user, Op op) {
+        std::string reqId = "s" + std::to_string(user.nextRequestId++);
+        user.pendingRequests.emplace(reqId, Pending{op, nowUs()});
+        stats.ops[(size_t)op].sent.add();
+        return reqId;
+    }
+
+    void subscribe(SimUser& user) {
+        JsonWriter w;
+        std::string reqId = track(user, Op::Subscribe);
+        w.beginObject().field("type", "SUBSCRIBE_ROOM").field("reqId", reqId).field("room", user.room);
+        if (user.furnitureVersion) w.field("version", user.furnitureVersion);
+        w.endObject();
+        sendText(user, w.view());
+    }
+
+    // ---------- The scripted mix ----------
+    void runMix(SimUser& user, uint64_t now) {
+        std::uniform_int_distribution<int> tile(0, options.roomTiles - 1);
+        if (now >= user.nextChatUs) {
+            std::string line(kChatMarker);
+            line += std::to_string(nowUs());
+            line += '|';
+            if ((int)line.size() < options.chatBytes) line.append(options.chatBytes - line.size(), 'x');
+            sendText(user, line);
+            stats.chatSent.add();
+            user.nextChatUs = schedule(now, options.chatRate);
+        }
+        if (now >= user.nextTileClickUs) {
+            JsonWriter w;
+            std::string reqId = track(user, Op::TileClick);
+            w.beginObject().field("type", "TILE_CLICK").field("reqId", reqId).field("tx", tile(rng)).field("ty", tile(rng)).endObject();
+            sendText(user, w.view());
+            user.nextTileClickUs = schedule(now, options.tileClickRate);
+        }
+        if (now >= user.nextCreateUs) {
+            if ((int)user.furniture.size() + user.createsInFlight < options.furniturePerUser) {
+                JsonWriter w;
+                std::string reqId = track(user, Op::CreateFurniture);
+                std::string uid = user.name + "_f" + std::to_string(user.nextFurnitureUid++);
+                w.beginObject().field("type", "CREATE_FURNITURE").field("reqId", reqId).field("room", user.room).field("uid", uid);
+                w.key("furniture").beginObject().field("proto_id", "swarm_crate").field("tx", tile(rng)).field("ty", tile(rng)).endObject();
+                w.endObject();
+                sendText(user, w.view());
+                user.createsInFlight++;
+            }
+            user.nextCreateUs = schedule(now, options.createRate);
+        }
+        if (now >= user.nextUpdateUs) {
+            if (!user.furniture.empty()) {
+                const std::string& uid = user.furniture[std::uniform_int_distribution<size_t>(0, user.furniture.size() - 1)(rng)];
+                JsonWriter w;
+                std::string reqId = track(user, Op::UpdateFurniture);
+                w.beginObject().field("type", "UPDATE_FURNITURE").field("reqId", reqId).field("room", user.room).field("uid", uid);
+                w.field("tx", tile(rng)).field("ty", tile(rng)).endObject();
+                sendText(user, w.view());
+            }
+            user.nextUpdateUs = schedule(now, options.updateRate);
+        }
+        if (now >= user.nextSubscribeUs) {
+            subscribe(user);
+            user.nextSubscribeUs = schedule(now, options.subscribeRate);
+        }
+    }
+
+    // ---------- Receiving ----------
+    void onEvent(SimUser& user, bool readable, bool writable) {
+        if (writable && !user.conn.onWritable()) return onClosed(user);
+        if (readable) {
+            bool open = user.conn.onReadable([&](std::string_view payload, bool binary) {
+                stats.framesReceived.add();
+                if (!binary) onMessage(user, payload);
+            });
+            countBytes(user);
+            if (!open) return onClosed(user);
+        }
+        poller.update(user.conn, &user);
+    }
+
+    void onClosed(SimUser& user) {
+        if (user.phase == Phase::Failed) return;    // fail() already closed and counted it
+        countBytes(user);
+        poller.remove(user.conn);
+        stats.connected.set(stats.connected.get() - 1);
+        if (user.phase == Phase::Active) stats.active.set(stats.active.get() - 1);
+        // A handover closes this socket on purpose; the resume reconnects
+        if (!user.resumeTicket.empty()) {
+            connectUser(user, user.resumePort);
+            return;
+        }
+        if (stopping.load(std::memory_order_relaxed)) return;
+        user.retryAtUs = 0;
+        user.phase = Phase::Failed;
+        stats.failed.add();
+    }
+
+    void countBytes(SimUser& user) {
+        stats.bytesSent.add(user.conn.bytesSent() - user.lastBytesSent);
+        stats.bytesReceived.add(user.conn.bytesReceived() - user.lastBytesReceived);
+        user.lastBytesSent = user.conn.bytesSent();
+        user.lastBytesReceived = user.conn.bytesReceived();
+    }
+
+    void answered(const Pending& pending, bool ok) {
+        OpStats& op = stats.ops[(size_t)pending.op];
+        op.rttUs.record(nowUs() - pending.sentUs);
+        if (!ok) op.errors.add();
+    }
+
+    void onMessage(SimUser& user, std::string_view payload) {
+        if (!payload.empty() && payload.front() == '{') {
+            onJson(user, payload);
+            return;
+        }
+        // "<name>: lt|<sentUs>|..." from another swarm user
+        size_t marker = payload.find(kChatMarker);
+        if (marker != std::string_view::npos && marker >= 2 && payload.substr(marker - 2, 2) == ": ") {
+            uint64_t sentUs = std::strtoull(std::string(payload.substr(marker + kChatMarker.size(), 20)).c_str(), nullptr, 10);
+            uint64_t now = nowUs();
+            if (sentUs && sentUs <= now) stats.chatLagUs.record(now - sentUs);
+            return;
+        }
+        // Slash command replies start with ✅ or ❌; everything else is room chatter
+        bool ok = payload.rfind("✅", 0) == 0;
+        if (!ok && payload.rfind("❌", 0) != 0) return;
+        if (user.pendingCommands.empty()) return;
+        Pending pending = user.pendingCommands.front();
+        user.pendingCommands.pop_front();
+        if (!ok && (pending.op == Op::Register || pending.op == Op::Login) && payload.find("Too many") != std::string_view::npos) {
+            stats.ops[(size_t)pending.op].throttled.add();
+            return throttleLogin(user);
+        }
+        // A taken name is fine on re-runs: log in with it
+        bool registerTaken = pending.op == Op::Register && payload.find("already exist") != std::string_view::npos;
+        answered(pending, ok || registerTaken);
+
+        switch (pending.op) {
+            case Op::Register:
+                if (!ok && !registerTaken) return fail(user);
+                user.phase = Phase::LoggingIn;
+                sendLogin(user);
+                break;
+            case Op::Login:
+                if (!ok) return fail(user);
+                user.phase = Phase::Joining;
+                sendCommand(user, Op::Join, "/join " + user.room);
+                break;
+            case Op::Join:
+                if (!ok) return fail(user);
+                user.phase = Phase::Subscribing;
+                subscribe(user);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void onJson(SimUser& user, std::string_view payload) {
+        // Room events and ticks carry no reqId; replies put it right after the type
+        std::string_view head = payload.substr(0, 160);
+        std::string_view type = headField(head, "type");
+        if (type == "SHARD_REDIRECT") {
+            JsonMessage json;
+            if (!json.parse(payload) || user.pendingCommands.empty() || user.pendingCommands.front().op != Op::Join) return;
+            answered(user.pendingCommands.front(), true);
+            user.pendingCommands.clear();
+            user.resumeTicket = std::string(json.str("ticket"));
+            user.resumePort = (int)json.num("port", options.port);
+            user.conn.close();     // onEvent sees the close and reconnects (onClosed)
+            return;
+        }
+        std::string_view reqId = headField(head, "reqId");
+        if (reqId.empty()) return;
+        auto it = user.pendingRequests.find(std::string(reqId));
+        if (it == user.pendingRequests.end()) return;
+        Pending pending = it->second;
+        user.pendingRequests.erase(it);
+        bool ok = payload.find("\"error\":") == std::string_view::npos && payload.find("\"ok\":false") == std::string_view::npos;
+        answered(pending, ok);
+
+        switch (pending.op) {
+            case Op::Resume:
+                if (!ok) return fail(user);
+                user.phase = Phase::Subscribing;
+                subscribe(user);
+                break;
+            case Op::Subscribe:
+                user.furnitureVersion = versionOf(payload);
+                if (user.phase == Phase::Subscribing) {
+                    if (!ok) return fail(user);
+                    becomeActive(user);
+                }
+                break;
+            case Op::CreateFurniture:
+                user.createsInFlight--;
+                if (ok) user.furniture.push_back(std::string(headField(payload, "uid")));
+                break;
+            default:
+                break;
+        }
+    }
+
+    // "version":N near the start of a ROOM_STATE / FURNITURE_DELTAS reply
+    static uint64_t versionOf(std::string_view payload) {
+        size_t at = payload.substr(0, 256).find("\"version\":");
+        if (at == std::string_view::npos) return 0;
+        return std::strtoull(std::string(payload.substr(at + 10, 20)).c_str(), nullptr, 10);
+    }
+
+    // "key":"value" in a flat prefix of the frame; "" when absent
+    static std::string_view headField(std::string_view head, std::string_view key) {
+        std::string needle = "\"" + std::string(key) + "\":\"";
+        size_t at = head.find(needle);
+        if (at == std::string_view::npos) return {};
+        size_t begin = at + needle.size();
+        size_t end = head.find('"', begin);
+        return end == std::string_view::npos ? std::string_view() : head.substr(begin, end - begin);
+    }
+
+    // Requests that never got an answer (e.g. TILE_CLICK before the avatar was placed)
+    void expire(SimUser& user, uint64_t now) {
+        uint64_t limit = (uint64_t)options.timeoutMs * 1000;
+        for (auto it = user.pendingRequests.begin(); it != user.pendingRequests.end();) {
+            if (it->second.sentUs + limit > now) {
+                ++it;
+                continue;
+            }
+            stats.ops[(size_t)it->second.op].timeouts.add();
+            if (it->second.op == Op::CreateFurniture) user.createsInFlight--;
+            if (it->second.op == Op::Subscribe && user.phase == Phase::Subscribing) {
+                it = user.pendingRequests.erase(it);
+                fail(user);
+                return;
+            }
+            it = user.pendingRequests.erase(it);
+        }
+        if (!user.pendingCommands.empty() && user.pendingCommands.front().sentUs + limit <= now) {
+            stats.ops[(size_t)user.pendingCommands.front().op].timeouts.add();
+            user.pendingCommands.clear();
+            fail(user);
+        }
+    }
+
+    const Options& options;
+    SwarmStats& stats;
+    std::atomic<bool>& stopping;
+    Clock::time_point start;
+    std::mt19937_64 rng;
+    sockaddr_in address{};
+    WsPoller poller;
+    std::vector<std::unique_ptr<SimUser>> users;
+    double startIntervalUs = 0;
+    double firstStartUs = 0;
+};
+
+static std::atomic<bool> interrupted{false};
+
+static void onSignal(int) {
+    interrupted.store(true);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 2;
+    uint64_t files = raiseFileLimit();
+    if (files && files < (uint64_t)options.users + 64) {
+        std::fprintf(stderr, "⚠️ Open file limit is %llu; some of the %d connections will fail\n", (unsigned long long)files, options.users);
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int threadCount = std::min(options.threads, options.users);
+    std::printf("Swarm: %d users on %d thread(s) against %s:%d, rooms:", options.users, threadCount, options.host.c_str(), options.port);
+    for (const auto& room : options.rooms) std::printf(" %s", room.c_str());
+    std::printf(" (%s)\n", options.zipf ? "zipf" : "uniform");
+
+    std::atomic<bool> stopping{false};
+    auto start = Clock::now();
+    std::vector<std::unique_ptr<SwarmStats>> stats;
+    std::vector<std::unique_ptr<SwarmThread>> swarms;
+    for (int t = 0; t < threadCount; t++) {
+        stats.push_back(std::make_unique<SwarmStats>());
+        swarms.push_back(std::make_unique<SwarmThread>(options, *stats.back(), t, threadCount, stopping, start));
+    }
+    std::vector<std::thread> threads;
+    for (auto& swarm : swarms) threads.emplace_back([&swarm] { swarm->run(); });
+
+    double rampSeconds = options.rampPerSecond > 0 ? options.users / options.rampPerSecond : 0;
+    double totalSeconds = rampSeconds + options.durationSeconds;
+    auto nextReport = start + std::chrono::seconds(options.reportSeconds);
+    while (!interrupted.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = Clock::now();
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        if (elapsed >= totalSeconds) break;
+        if (now >= nextReport) {
+            printReport(stats, elapsed, false);
+            nextReport += std::chrono::seconds(options.reportSeconds);
+        }
+    }
+    stopping.store(true);
+    for (auto& thread : threads) thread.join();
+    printReport(stats, std::chrono::duration<double>(Clock::now() - start).count(), true);
+    return 0;
+}
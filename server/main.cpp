@@ -6,559 +6,1915 @@
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <cmath>
+#include <cstdlib>
+#include <openssl/rand.h>
 #include "core/Database.hpp"
+#include "core/DatabasePool.hpp"
+#include "core/AuthPool.hpp"
+#include "core/ChatJournal.hpp"
+#include "core/JsonWriter.hpp"
+#include "core/LogStore.hpp"
+#include "core/Metrics.hpp"
+#include "core/RoomJson.hpp"
+#include "core/Server.hpp"
+#include "core/TemplateCatalogue.hpp"
+#include "entities/FurnitureCatalog.hpp"
+#include "entities/Pathfinding.hpp"
+#include "entities/Presence.hpp"
+#include "entities/Room.hpp"
+#include "entities/User.hpp"
+#include "network/WebSocketSession.hpp"
+#include "network/Backpressure.hpp"
+#include "network/Broadcast.hpp"
+#include "network/JsonMessage.hpp"
+#include "network/MessageDispatcher.hpp"
+#include "network/Protocol.hpp"
 
-struct User {
-    int id = -1;                    // DB user ID
+static constexpr int kPublicPort = 9001;
+static constexpr int kShardPortBase = 9101;  // shard i also listens on kShardPortBase + i
+
+// Room simulation: tick rate and walking speed
+static constexpr int kRoomTickHz = 10;
+static constexpr float kWalkTilesPerSecond = 5.0f;
+// player_positions and rooms.player_count trail memory by at most this much
+static constexpr int kFlushMs = 3000;
+
+// Slow consumers: pause room streams at 256 KiB buffered, resync once drained
+// below 32 KiB, disconnect at 4 MiB or after 30 s without catching up
+static constexpr BackpressurePolicy kBackpressure{256 * 1024, 32 * 1024, 4 * 1024 * 1024, std::chrono::seconds(30)};
+
+// ----------------------
+// Per-shard state
+// Every loop thread has its own copy; other shards only reach it through
+// the shard mailboxes (core/Server.hpp).
+// ----------------------
+thread_local std::unordered_set<WebSocket*> clients;
+thread_local RoomRegistry roomRegistry; // room name -> handle and cached metadata
+thread_local Broadcaster broadcaster;   // room fan-out over uWS topics
+thread_local BackpressureMonitor backpressure(roomRegistry, broadcaster, kBackpressure);
+thread_local PresenceRegistry presence;  // who is in the rooms this shard owns
+thread_local PathService pathService;   // TILE_CLICK searches, capped expansions per tick
+thread_local RoomSimulation simulation(roomRegistry, kRoomTickHz, kWalkTilesPerSecond);
+
+ShardedServer* shards = nullptr;        // set once in main before the loops start
+SessionDirectory sessions;              // logged-in sessions across all shards
+TemplateCatalogue templateCatalogue;    // room templates, loaded at startup and on /reloadtemplates
+FurnitureCatalog furnitureCatalog;      // item footprints, loaded before the shards start; read-only after
+
+static const Tile kSpawnTile{3, 7};
+static constexpr auto kChatHistoryIdle = std::chrono::seconds(60); // empty rooms keep their chat this long
+static constexpr auto kRoomStateIdle = std::chrono::minutes(5);     // ...and their furniture and grids this long
+static constexpr const char* kFurnitureMetadataDir = "../client/game/metadata";
+
+// ----------------------
+// Graceful shutdown
+// SIGINT/SIGTERM only set a flag; a timer on every shard notices it, closes
+// that shard's listen sockets and clients so its run() returns and buffered
+// writes get flushed.
+// ----------------------
+static std::atomic<bool> shutdownRequested{false};
+static thread_local std::vector<us_listen_socket_t*> listenSockets;
+static thread_local us_timer_t* roomTimer = nullptr;   // closed here too, or run() never returns
+static thread_local us_timer_t* flushTimer = nullptr;
+
+static void onFlushTimer(us_timer_t* timer);
+
+static void onShutdownSignal(int) {
+    shutdownRequested.store(true);
+}
+
+static void onShutdownTimer(us_timer_t* timer) {
+    if (!shutdownRequested.load()) return;
+    if (ShardedServer::current()->index == 0) std::cout << "Shutting down...\n";
+    for (auto* socket : listenSockets) us_listen_socket_close(0, socket);
+    listenSockets.clear();
+    // close() re-enters the close handler, which erases from clients
+    std::vector<WebSocket*> open(clients.begin(), clients.end());
+    for (auto client : open) client->close();
+    if (roomTimer) {
+        us_timer_close(roomTimer);
+        roomTimer = nullptr;
+    }
+    // Closing the clients above already queued every position that was still
+    // dirty; one last flush carries the emptied rooms' player counts
+    if (flushTimer) {
+        onFlushTimer(flushTimer);
+        us_timer_close(flushTimer);
+        flushTimer = nullptr;
+    }
+    us_timer_close(timer);
+}
+
+// ----------------------
+// Response builders (JsonWriter appends into a reused per-thread buffer)
+// ----------------------
+
+// Opens a response object with its type and, when the client sent one, the reqId
+static JsonWriter& beginEnvelope(JsonWriter& w, std::string_view type, std::string_view reqId) {
+    return w.beginObject().field("type", type).optionalField("reqId", reqId);
+}
+
+static std::string roomObjectToJson(const RoomObject& o, std::string_view uid) {
+    JsonWriter w;
+    writeRoomObject(w, o, uid);
+    return w.str();
+}
+
+// With a snapshot, objects carry the uid clients know them by
+static void writeRoomObjects(JsonWriter& w, const std::vector<RoomObject>& objs, const FurnitureSnapshot* snapshot = nullptr) {
+    w.beginArray();
+    for (const auto& o : objs) writeRoomObject(w, o, snapshot ? snapshot->uidFor(o.id) : std::string());
+    w.endArray();
+}
+
+// Deferred DB results may arrive after the socket closed; check before touching it
+template <typename WS>
+static bool isAlive(WS* ws, const std::shared_ptr<bool>& alive) {
+    return ws && alive && *alive;
+}
+
+// ----------------------
+// Furniture replication (loop thread)
+// ----------------------
+
+// Completes a furniture load (nullopt: it failed) and runs the waiters
+static void finishFurniture(RoomHandle handle, std::optional<std::vector<RoomObject>> rows) {
+    Room* room = roomRegistry.get(handle);
+    if (!room) return;
+    if (rows.has_value()) room->furniture.finishLoad(std::move(rows.value()));
+    else room->furniture.abortLoad();
+    auto waiters = std::move(room->furniture.waiters);
+    room->furniture.waiters.clear();
+    for (auto& waiter : waiters) waiter(room->furniture.loaded());
+}
+
+// Completes a chat warm-up (nullopt: it failed) and runs the waiters
+static void finishChatHistory(RoomHandle handle, std::optional<std::vector<ChatLine>> lines) {
+    Room* room = roomRegistry.get(handle);
+    if (!room) return;
+    if (lines.has_value()) room->chat.finishWarm(std::move(lines.value()));
+    else room->chat.abortWarm();
+    auto waiters = std::move(room->chat.waiters);
+    room->chat.waiters.clear();
+    bool warm = room->chat.state() == ChatHistory::State::Warm;
+    for (auto& waiter : waiters) waiter(warm);
+}
+
+// Runs fn(loaded) once the room's furniture snapshot is in memory; the first
+// caller triggers the DB load and everyone arriving meanwhile waits on it.
+static void withFurniture(DatabasePool& dbPool, RoomHandle handle, std::function<void(bool)> fn) {
+    Room* room = roomRegistry.get(handle);
+    if (!room) {
+        fn(false);
+        return;
+    }
+    FurnitureSnapshot& snapshot = room->furniture;
+    if (snapshot.loaded()) {
+        fn(true);
+        return;
+    }
+    snapshot.waiters.push_back(std::move(fn));
+    if (snapshot.loading()) return;
+
+    auto finish = [handle](std::optional<std::vector<RoomObject>> rows) { finishFurniture(handle, std::move(rows)); };
+    snapshot.beginLoad();
+    bool queued = dbPool.submit(
+        [roomId = room->id](Storage& db) { return db.loadRoomObjects(roomId); },
+        finish);
+    if (!queued) finish(std::nullopt);
+}
+
+// Runs fn(warm) once the room's chat history is in memory; like withFurniture,
+// the first caller warms it from room_chat and later ones wait on that
+static void withChatHistory(DatabasePool& dbPool, RoomHandle handle, std::function<void(bool)> fn) {
+    Room* room = roomRegistry.get(handle);
+    if (!room) {
+        fn(false);
+        return;
+    }
+    ChatHistory& history = room->chat;
+    history.touch();
+    if (history.state() == ChatHistory::State::Warm) {
+        fn(true);
+        return;
+    }
+    history.waiters.push_back(std::move(fn));
+    if (history.state() == ChatHistory::State::Warming) return;
+
+    auto finish = [handle](std::optional<std::vector<ChatLine>> lines) { finishChatHistory(handle, std::move(lines)); };
+    history.beginWarm();
+    bool queued = dbPool.submit(
+        [roomId = room->id](Storage& db) { return db.getRecentChat(roomId, (int)ChatHistory::kCapacity); },
+        finish);
+    if (!queued) finish(std::nullopt);
+}
+
+// First join of a room nobody has open: furniture and chat backlog come from
+// one pipelined load instead of two queued queries. Afterwards withFurniture
+// and withChatHistory only queue their waiters on it.
+static void warmRoom(DatabasePool& dbPool, RoomHandle handle) {
+    Room* room = roomRegistry.get(handle);
+    if (!room) return;
+    if (room->furniture.loaded() || room->furniture.loading()) return;
+    if (room->chat.state() != ChatHistory::State::Cold) return;
+
+    auto finish = [handle](RoomLoad load) {
+        finishFurniture(handle, std::move(load.objects));
+        finishChatHistory(handle, std::move(load.chat));
+    };
+    room->furniture.beginLoad();
+    room->chat.beginWarm();
+    bool queued = dbPool.submit(
+        [roomId = room->id](Storage& db) { return db.loadRoom(roomId, (int)ChatHistory::kCapacity); },
+        finish);
+    if (!queued) finish(RoomLoad{});
+}
+
+// The room's walk grid, built from its layout on first use. Needs the
+// furniture snapshot loaded so the initial blockers are complete.
+static WalkGrid& ensureWalkGrid(Room& room) {
+    if (!room.walkGrid.built()) {
+        room.walkGrid.build(room.layoutJson, room.width, room.height);
+        room.furniture.rebuildBlockers();
+        room.interest.resize(room.walkGrid.width(), room.walkGrid.height());
+    }
+    return room.walkGrid;
+}
+
+static const std::string& furnitureJson(FurnitureSnapshot& snapshot) {
+    if (!snapshot.hasCachedJson()) {
+        JsonWriter w;
+        writeRoomObjects(w, snapshot.items(), &snapshot);
+        snapshot.setCachedJson(w.str());
+    }
+    return snapshot.cachedJson();
+}
+
+// Catch-up for a client that already has `knownVersion`: only the deltas since
+// then if the log still covers it, otherwise the full cached snapshot.
+static void sendFurnitureSync(WebSocket* ws, Room& room, const std::string& reqId, uint64_t knownVersion, uWS::OpCode opCode) {
+    FurnitureSnapshot& snapshot = room.furniture;
+    std::vector<const FurnitureDelta*> deltas;
+    JsonWriter w;
+    if (knownVersion > 0 && snapshot.deltasSince(knownVersion, deltas)) {
+        beginEnvelope(w, "FURNITURE_DELTAS", reqId);
+        w.field("room", room.name);
+        w.field("roomId", room.id);
+        w.field("fromVersion", knownVersion);
+        w.field("version", snapshot.version());
+        w.key("deltas").beginArray();
+        for (const FurnitureDelta* delta : deltas) {
+            w.beginObject();
+            w.field("change", furnitureChangeName(delta->change));
+            w.field("version", delta->version);
+            w.key("furniture").raw(delta->json);
+            w.endObject();
+        }
+        w.endArray();
+    } else {
+        beginEnvelope(w, "ROOM_STATE", reqId);
+        w.field("room", room.name);
+        w.field("roomId", room.id);
+        w.field("version", snapshot.version());
+        w.key("furniture").raw(furnitureJson(snapshot));
+    }
+    w.endObject();
+    sendDirect(ws, w.view(), opCode);
+    ws->getUserData()->viewFurnitureVersion = snapshot.version();
+}
+
+// Structured event for everyone who can see tile `at` (or `from`, where a
+// moved item came from). Rooms without interest filtering get it room-wide.
+static void publishInView(const Room& room, WireFormat format, std::string_view payload, Tile at, std::optional<Tile> from) {
+    const InterestGrid& interest = room.interest;
+    if (!interest.filtering()) {
+        broadcaster.toFormat(room, format, payload);
+        return;
+    }
+    ViewCell cell = interest.cellOf(at);
+    ViewCell previous = from ? interest.cellOf(*from) : ViewCell{};
+    auto publish = [&](ViewCell view) {
+        if (broadcaster.subscriberCount(room, view, format)) broadcaster.toView(room, view, format, payload);
+    };
+    interest.forEachVisible(cell, publish);
+    interest.forEachVisible(previous, [&](ViewCell view) {
+        if (!InterestGrid::sees(view, cell)) publish(view);
+    });
+}
+
+static Tile anchorTile(const RoomObject& object) {
+    return Tile{(int)std::lround(object.x), (int)std::lround(object.y)};
+}
+
+// Small per-change event instead of a full ROOM_STATE, encoded once per wire
+// format that has subscribers and sent to whoever can see the item (before and
+// after a move). version is 0 while the snapshot is still loading; clients
+// then just apply the change.
+static void broadcastFurnitureChange(const Room& room, FurnitureChange change, uint64_t version, std::string_view objectJson,
+                                     const RoomObject& object, std::string_view uid, const RoomObject* before = nullptr) {
+    std::optional<Tile> from;
+    if (before) from = anchorTile(*before);
+    if (broadcaster.subscriberCount(room, WireFormat::Json)) {
+        JsonWriter w;
+        writeFurnitureEvent(w, change, room.name, version, objectJson);
+        publishInView(room, WireFormat::Json, w.view(), anchorTile(object), from);
+    }
+    if (broadcaster.subscriberCount(room, WireFormat::Binary)) {
+        std::string frame;
+        frame.reserve(64);
+        writeFurnitureEventBinary(frame, change, room.id, version, object, uid);
+        publishInView(room, WireFormat::Binary, frame, anchorTile(object), from);
+    }
+    backpressure.watch(room);
+}
+
+// Moves an item in the room's snapshot, broadcasts the change and persists it
+// behind the broadcast. The sender's own items whose create is still in
+// flight are relayed by uid without a version, once they pass the same
+// placement check; their reservation moves along and the insert's done
+// callback places and persists them where they ended up. Returns the error to send back, empty on success:
+// not_found, a placement error or server_busy when the DB queue is full;
+// either way nothing changed and nobody was told.
+static std::string_view moveFurniture(DatabasePool& dbPool, Room& room, const void* sender, int objectId, std::string_view uid,
+                                      float tx, float ty, std::optional<float> rotation) {
+    const RoomObject* existing = room.furniture.find(objectId);
+    if (!existing) {
+        int token = room.furniture.findPending(std::string(uid), sender);
+        if (!token) return "not_found";
+        const PendingCreate* pending = room.furniture.pending(token);
+        float angle = rotation.value_or(pending->rotation);
+        ensureWalkGrid(room);
+        Placement placement = room.furniture.checkPlacement(pending->protoId, tx, ty, angle, token);
+        if (placement != Placement::Ok) return placementError(placement);
+        room.furniture.movePending(token, tx, ty, angle);
+        RoomObject relay{};
+        relay.id = 0;
+        relay.x = tx;
+        relay.y = ty;
+        relay.rotation = angle;
+        JsonWriter furniture;
+        furniture.beginObject().field("uid", uid).field("tx", tx).field("ty", ty).endObject();
+        broadcastFurnitureChange(room, FurnitureChange::Updated, 0, furniture.view(), relay, uid);
+        return {};
+    }
+    RoomObject before = *existing;
+    RoomObject object = before;
+    object.x = tx;
+    object.y = ty;
+    if (rotation.has_value()) object.rotation = rotation.value();
+    ensureWalkGrid(room);
+    Placement placement = room.furniture.checkPlacement(object.name, object.x, object.y, object.rotation, object.id);
+    if (placement != Placement::Ok) return placementError(placement);
+    // Queued first: a write that cannot be queued must not reach the snapshot
+    // or the room, or both would drift from room_objects until a reload
+    bool queued = dbPool.submit([object](Storage& db) { db.updateRoomObject(object.id, object.x, object.y, object.rotation); });
+    if (!queued) return "server_busy";
+    std::string objectUid = room.furniture.uidFor(objectId);
+    std::string objectJson = roomObjectToJson(object, objectUid);
+    uint64_t version = room.furniture.update(object, objectJson);
+    broadcastFurnitureChange(room, FurnitureChange::Updated, version, objectJson, object, objectUid, &before);
+    return {};
+}
+
+// A rejected move: the error plus where the item really is (when the room is
+// known here), so the sender can put it back. Binary clients get it as a JSON
+// text frame (they have no ack).
+static void sendMoveRejected(WebSocket* ws, std::string_view reqId, std::string_view error, const Room* room, int objectId, uWS::OpCode opCode) {
+    JsonWriter w;
+    beginEnvelope(w, "UPDATE_FURNITURE_RESPONSE", reqId).field("ok", false).field("error", error);
+    if (const RoomObject* object = room ? room->furniture.find(objectId) : nullptr) {
+        w.key("furniture");
+        writeRoomObject(w, *object, room->furniture.uidFor(objectId));
+    }
+    w.endObject();
+    sendDirect(ws, w.view(), opCode);
+}
+
+// ----------------------
+// Room helpers (loop thread)
+// ----------------------
+
+// Resolves a public room name through the registry; only a cache miss costs a DB round trip.
+template <typename Done>
+static void resolvePublicRoom(DatabasePool& dbPool, const std::string& roomName, Done done) {
+    RoomHandle cached = roomRegistry.findPublic(roomName);
+    if (cached != kNoRoom) {
+        done(cached);
+        return;
+    }
+    bool queued = dbPool.submit(
+        [roomName](Storage& db) { return db.getPublicRoomByName(roomName); },
+        [done](std::optional<RoomInfo> info) mutable {
+            done(info.has_value() ? roomRegistry.insert(info.value()) : kNoRoom);
+        });
+    if (!queued) done(kNoRoom);
+}
+
+// Room state is only touched on the shard that owns the room
+static bool ownsRoom(const Room& room) {
+    return shards->ownerOf(room.id) == ShardedServer::current()->index;
+}
+
+// A room named in a message: public rooms by name, otherwise the sender's
+// current room if it matches. Rooms owned by another shard are not found.
+static RoomHandle findNamedRoom(WebSocket* ws, const std::string& roomName) {
+    const Room* room = roomRegistry.get(roomRegistry.findPublic(roomName));
+    if (!room) {
+        const Room* current = roomRegistry.get(ws->getUserData()->currentRoom);
+        if (current && (roomName.empty() || current->name == roomName)) room = current;
+    }
+    return room && ownsRoom(*room) ? room->handle : kNoRoom;
+}
+
+// ----------------------
+// Avatar positions and presence
+// Each room's PositionStore is authoritative; player_positions is written in
+// bulk once per flush interval, plus right away for an avatar leaving a room.
+// PresenceRegistry likewise only sends rooms.player_count snapshots. Both go
+// through the pool's in-order lane, so an older batch can never land after a
+// newer one from a later flush or leave.
+// ----------------------
+static void savePositions(DatabasePool& dbPool, PositionBatch batch) {
+    if (batch.empty()) return;
+    size_t rows = batch.size();
+    bool queued = dbPool.submitInOrder([batch = std::move(batch)](Storage& db) { db.upsertPlayerPositions(batch); });
+    if (!queued) std::cerr << "⚠️ DB queue full; dropped " << rows << " position update(s)\n";
+}
+
+static void saveRoomCounts(DatabasePool& dbPool) {
+    std::vector<std::pair<int, int>> changed;
+    presence.takeChangedCounts(changed);
+    if (changed.empty()) return;
+    std::vector<int> roomIds, counts;
+    roomIds.reserve(changed.size());
+    counts.reserve(changed.size());
+    for (const auto& [roomId, count] : changed) {
+        roomIds.push_back(roomId);
+        counts.push_back(count);
+    }
+    bool queued = dbPool.submitInOrder([roomIds = std::move(roomIds), counts = std::move(counts)](Storage& db) {
+        db.updateRoomPlayerCounts(roomIds, counts);
+    });
+    if (!queued) std::cerr << "⚠️ DB queue full; dropped " << changed.size() << " player count update(s)\n";
+}
+
+// Chat buffers of rooms that have been empty for a while; they warm again on the next join
+static void evictIdleChat() {
+    auto now = ChatHistory::Clock::now();
+    roomRegistry.forEach([&](Room& room) {
+        if (room.chat.state() == ChatHistory::State::Warming || !room.avatars.empty() || presence.count(room.id) > 0) return;
+        if (now - room.chat.lastUsed() > kChatHistoryIdle) room.chat.evict();
+    });
+}
+
+// Furniture snapshot, walk grid and interest grid of rooms nobody is in or
+// subscribed to, once they have been idle for kRoomStateIdle. Only the
+// metadata stays; withFurniture and ensureWalkGrid load the rest on the next join.
+static void evictIdleRooms() {
+    auto now = std::chrono::steady_clock::now();
+    roomRegistry.forEach([&](Room& room) {
+        bool idle = room.avatars.empty() && !room.awake && presence.count(room.id) == 0 &&
+                    broadcaster.subscriberCount(room) == 0 && !room.furniture.busy();
+        if (!idle) {
+            room.idleSince = {};
+            return;
+        }
+        if (!room.furniture.loaded() && !room.walkGrid.built()) return;    // nothing held
+        if (room.idleSince == std::chrono::steady_clock::time_point{}) room.idleSince = now;
+        if (now - room.idleSince < kRoomStateIdle) return;
+        room.furniture.release();
+        room.walkGrid.reset();
+        room.interest.release();
+        room.idleSince = {};
+    });
+}
+
+// One upsert for every dirty position and one update for every changed room count on this shard
+static void onFlushTimer(us_timer_t* timer) {
+    DatabasePool& dbPool = **(DatabasePool**) us_timer_ext(timer);
+    PositionBatch batch;
+    roomRegistry.forEach([&batch](Room& room) { room.avatars.positions().takeDirty(batch); });
+    savePositions(dbPool, std::move(batch));
+    saveRoomCounts(dbPool);
+    evictIdleChat();
+    evictIdleRooms();
+    backpressure.sweepAll(clients);
+    Metrics::gauge(MetricFamily::RoomsOccupied).set((int64_t)presence.rooms());
+    Metrics::gauge(MetricFamily::RoomMembers).set((int64_t)presence.sessions());
+}
+
+// From memory while the session stands in its current room; otherwise from
+// player_positions, read in order behind every position write already
+// queued (e.g. the one for the room it just left)
+template <typename Done>
+static void lookupPlayerPosition(DatabasePool& dbPool, WebSocket* ws, Done done) {
+    const User* user = ws->getUserData();
+    if (Room* room = roomRegistry.get(user->currentRoom)) {
+        if (auto online = room->avatars.positions().find(user->id)) {
+            done(std::move(online));
+            return;
+        }
+    }
+    bool queued = dbPool.submitInOrder([userId = user->id](Storage& db) { return db.getPlayerPosition(userId); }, done);
+    if (!queued) done(std::nullopt);
+}
+
+// Removes ws from its current room and tells the others; returns the room it left
+static Room* leaveCurrentRoom(WebSocket* ws, DatabasePool& dbPool, const std::string& notice, uWS::OpCode opCode) {
+    User* user = ws->getUserData();
+    Room* room = roomRegistry.get(user->currentRoom);
+    user->currentRoom = kNoRoom;
+    pathService.cancel(ws);
+    backpressure.forget(ws);
+    if (!room) return nullptr;
+
+    PositionBatch lastPosition;
+    simulation.leave(room->handle, ws, lastPosition);
+    savePositions(dbPool, std::move(lastPosition));
+
+    broadcaster.setView(ws, *room, ViewCell{});
+    broadcaster.unsubscribe(ws, *room);
+    presence.leave(room->id, ws);
+
+    broadcaster.toRoom(*room, user->username + notice, opCode);
+    return room;
+}
+
+// ----------------------
+// Room simulation frames (loop thread)
+// ----------------------
+
+static void writeAvatar(JsonWriter& w, const RoomAvatar& avatar, bool withName) {
+    w.beginObject().field("id", avatar.id);
+    if (withName) w.field("name", avatar.username);
+    w.field("tx", avatar.tile.x).field("ty", avatar.tile.y).field("walking", avatar.walking());
+    w.endObject();
+}
+
+// Sent to the avatar's own session once it is placed: its avatar id, the
+// time per tile for tweens and everyone already in the room (in rooms with
+// interest filtering, everyone in view, plus the view geometry)
+static void sendRoomEntered(WebSocket* ws, const Room& room, const RoomAvatar& self) {
+    const InterestGrid& interest = room.interest;
+    ViewCell view = interest.filtering() ? interest.cellOf(self.tile) : ViewCell{};
+    JsonWriter w;
+    w.beginObject().field("type", "ROOM_ENTERED").field("room", room.name).field("roomId", room.id);
+    w.field("avatarId", self.id).field("stepMs", simulation.stepMs());
+    w.key("avatars").beginArray();
+    for (const auto& avatar : room.avatars.all()) {
+        if (!view.valid() || InterestGrid::sees(view, interest.cellOf(avatar.tile))) writeAvatar(w, avatar, true);
+    }
+    w.endArray();
+    if (view.valid()) {
+        w.key("view").beginObject();
+        w.field("cellTiles", InterestGrid::kCellTiles).field("radius", InterestGrid::kViewRadius);
+        w.endObject();
+    }
+    w.endObject();
+    sendDirect(ws, w.view(), uWS::OpCode::TEXT);
+}
+
+// The room's recent chat in one frame, oldest line first
+static void sendChatHistory(WebSocket* ws, const Room& room) {
+    if (room.chat.size() == 0) return;
+    JsonWriter w;
+    w.beginObject().field("type", "CHAT_HISTORY").field("room", room.name);
+    w.key("lines").beginArray();
+    room.chat.forEach([&w](const std::string& username, const std::string& message) {
+        w.beginObject().field("user", username).field("message", message).endObject();
+    });
+    w.endArray();
+    w.endObject();
+    sendDirect(ws, w.view(), uWS::OpCode::TEXT);
+}
+
+// One ROOM_TICK frame: `changed` indexes the roster, with whether the avatar's
+// name goes along (the first time these recipients see it)
+using TickAvatars = std::vector<std::pair<size_t, bool>>;
+
+static void writeRoomTickJson(JsonWriter& w, const Room& room, uint64_t tick, const TickAvatars& changed,
+                              const std::vector<uint32_t>& left) {
+    const auto& avatars = room.avatars.all();
+    w.beginObject().field("type", "ROOM_TICK").field("room", room.name).field("roomId", room.id).field("tick", tick);
+    w.key("avatars").beginArray();
+    for (const auto& [index, named] : changed) writeAvatar(w, avatars[index], named);
+    w.endArray();
+    if (!left.empty()) {
+        w.key("left").beginArray();
+        for (uint32_t id : left) w.value(id);
+        w.endArray();
+    }
+    w.endObject();
+}
+
+static void writeRoomTickBinary(std::string& frame, const Room& room, uint64_t tick, const TickAvatars& changed,
+                                const std::vector<uint32_t>& left) {
+    const auto& avatars = room.avatars.all();
+    BinaryWriter b(frame);
+    b.op(BinaryOp::RoomTick).varint(room.id).varint(tick).varint(changed.size());
+    for (const auto& [index, named] : changed) {
+        const RoomAvatar& avatar = avatars[index];
+        uint8_t flags = (avatar.walking() ? kAvatarWalking : 0) | (named ? kAvatarHasName : 0);
+        b.varint(avatar.id).u8(flags);
+        if (named) b.str(avatar.username);
+        b.coord(avatar.tile.x).coord(avatar.tile.y);
+    }
+    b.varint(left.size());
+    for (uint32_t id : left) b.varint(id);
+}
+
+static void sendRoomTick(WebSocket* ws, const Room& room, uint64_t tick, const TickAvatars& changed,
+                         const std::vector<uint32_t>& left) {
+    if (ws->getUserData()->wireFormat == WireFormat::Binary) {
+        std::string frame;
+        writeRoomTickBinary(frame, room, tick, changed, left);
+        sendDirect(ws, frame, uWS::OpCode::BINARY);
+        return;
+    }
+    JsonWriter w;
+    writeRoomTickJson(w, room, tick, changed, left);
+    sendDirect(ws, w.view(), uWS::OpCode::TEXT);
+}
+
+// The furniture anchored in `cells`, replacing whatever the client shows
+// there: items that changed or arrived while out of sight come with it, and
+// the client drops the ones inside `areas` that are not listed. Only the
+// cells asked for, never the whole room.
+static void sendFurnitureView(WebSocket* ws, const Room& room, const std::vector<ViewCell>& cells) {
+    if (cells.empty()) return;
+    const FurnitureSnapshot& snapshot = room.furniture;
+    JsonWriter w;
+    beginEnvelope(w, "FURNITURE_VIEW", "");
+    w.field("room", room.name);
+    w.field("roomId", room.id);
+    w.field("version", snapshot.version());
+    w.key("areas").beginArray();
+    for (ViewCell cell : cells) {
+        int x0 = cell.x * InterestGrid::kCellTiles;
+        int y0 = cell.y * InterestGrid::kCellTiles;
+        w.beginObject().field("x0", x0).field("y0", y0);
+        w.field("x1", x0 + InterestGrid::kCellTiles - 1).field("y1", y0 + InterestGrid::kCellTiles - 1).endObject();
+    }
+    w.endArray();
+    w.key("furniture").beginArray();
+    for (const RoomObject& object : snapshot.items()) {
+        ViewCell cell = room.interest.cellOf(anchorTile(object));
+        if (std::find(cells.begin(), cells.end(), cell) == cells.end()) continue;
+        writeRoomObject(w, object, snapshot.uidFor(object.id));
+    }
+    w.endArray();
+    w.endObject();
+    sendDirect(ws, w.view(), uWS::OpCode::TEXT);
+}
+
+// Points ws at the view cell its avatar moved into. What came into view
+// arrives as named avatars, what went out of view as "left", and the
+// furniture of the cells that came into view as FURNITURE_VIEW (the in-view
+// topics kept the rest current). `from` is invalid when the avatar was just
+// placed (ROOM_ENTERED carries the avatars then).
+static void followView(WebSocket* ws, Room& room, ViewCell from, ViewCell to, uint64_t tick = 0) {
+    User* user = ws->getUserData();
+    broadcaster.setView(ws, room, to);
+    if (user->slow) return;     // the resync sends everything once it drains
+    const InterestGrid& interest = room.interest;
+    if (from.valid()) {
+        static thread_local TickAvatars appeared;
+        static thread_local std::vector<uint32_t> vanished;
+        appeared.clear();
+        vanished.clear();
+        const auto& avatars = room.avatars.all();
+        interest.forEachVisible(to, [&](ViewCell cell) {
+            if (InterestGrid::sees(from, cell)) return;
+            for (const auto& [id, owner] : interest.avatarsIn(cell)) {
+                if (const RoomAvatar* avatar = room.avatars.find(owner)) appeared.emplace_back(avatar - avatars.data(), true);
+            }
+        });
+        interest.forEachVisible(from, [&](ViewCell cell) {
+            if (InterestGrid::sees(to, cell)) return;
+            for (const auto& entry : interest.avatarsIn(cell)) vanished.push_back(entry.first);
+        });
+        if (!appeared.empty() || !vanished.empty()) sendRoomTick(ws, room, tick, appeared, vanished);
+    }
+    const FurnitureSnapshot& snapshot = room.furniture;
+    if (!snapshot.loaded()) return;
+    static thread_local std::vector<ViewCell> uncovered;
+    uncovered.clear();
+    if (from.valid()) {
+        interest.forEachVisible(to, [&](ViewCell cell) {
+            if (!InterestGrid::sees(from, cell)) uncovered.push_back(cell);
+        });
+    } else if (user->viewFurnitureVersion && snapshot.version() != user->viewFurnitureVersion) {
+        // Changed between its ROOM_STATE and now, when it starts following a view
+        interest.forEachVisible(to, [&](ViewCell cell) { uncovered.push_back(cell); });
+    }
+    sendFurnitureView(ws, room, uncovered);
+    user->viewFurnitureVersion = snapshot.version();
+}
+
+// Everything that changed in the room during one tick as a single frame per
+// wire format: avatars that moved, entered or started/stopped walking, and ids
+// that left. Names only travel the first time an avatar appears. With
+// interest filtering each view cell gets its own frame, holding only what
+// happened in sight of it, and viewers that crossed into another cell are
+// moved over afterwards.
+static void broadcastRoomTick(Room& room, uint64_t tick) {
+    const AvatarRoster& roster = room.avatars;
+    if (room.interest.filtering()) {
+        static thread_local std::vector<ViewFrame> frames;
+        static thread_local std::vector<ViewMove> moves;
+        size_t count = room.interest.collect(roster.all(), roster.departed(), frames, moves);
+        for (size_t n = 0; n < count; n++) {
+            const ViewFrame& frame = frames[n];
+            if (broadcaster.subscriberCount(room, frame.cell, WireFormat::Json)) {
+                JsonWriter w;
+                writeRoomTickJson(w, room, tick, frame.avatars, frame.left);
+                broadcaster.toView(room, frame.cell, WireFormat::Json, w.view());
+            }
+            if (broadcaster.subscriberCount(room, frame.cell, WireFormat::Binary)) {
+                std::string out;
+                writeRoomTickBinary(out, room, tick, frame.avatars, frame.left);
+                broadcaster.toView(room, frame.cell, WireFormat::Binary, out);
+            }
+        }
+        for (const ViewMove& move : moves) {
+            auto* ws = static_cast<WebSocket*>(const_cast<void*>(move.owner));
+            followView(ws, room, move.from, move.to, tick);
+        }
+        return;
+    }
+
+    static thread_local TickAvatars changed;
+    changed.clear();
+    const auto& avatars = roster.all();
+    for (size_t i = 0; i < avatars.size(); i++) {
+        if (avatars[i].changed) changed.emplace_back(i, avatars[i].joined);
+    }
+    if (broadcaster.subscriberCount(room, WireFormat::Json)) {
+        JsonWriter w;
+        writeRoomTickJson(w, room, tick, changed, roster.departed());
+        broadcaster.toFormat(room, WireFormat::Json, w.view());
+    }
+    if (broadcaster.subscriberCount(room, WireFormat::Binary)) {
+        std::string frame;
+        writeRoomTickBinary(frame, room, tick, changed, roster.departed());
+        broadcaster.toFormat(room, WireFormat::Binary, frame);
+    }
+}
+
+// ----------------------
+// Session handover between shards (loop thread)
+// A socket cannot move to another loop, so a session entering a room owned
+// by another shard is parked there under a one-time ticket; the client
+// reconnects to that shard's port and sends RESUME_SESSION with it.
+// ----------------------
+struct SessionTicket {
+    uint64_t sessionId = 0;             // parked in `sessions` until redeemed
+    int userId = -1;
     std::string username;
-    int currentRoomId = -1;         // DB room ID
-    std::string currentRoomName;    // Room name for chat display
-    std::unordered_set<std::string> roles; // e.g., admin, helper
-    std::vector<std::string> inventory;    // item names for now
+    std::unordered_set<std::string> roles;
+    std::vector<std::string> inventory;
+    RoomInfo room;
+    std::string remoteAddress;          // only redeemable from the address it was issued to
+    std::chrono::steady_clock::time_point expires;
 };
 
+static constexpr auto kTicketLifetime = std::chrono::seconds(30);
+static thread_local std::unordered_map<std::string, SessionTicket> sessionTickets; // parked on this shard
+
+// The token is a bearer credential for the whole session, roles included, so
+// its 128 bits come from the CSPRNG (BoringSSL, linked through uSockets)
+static std::string newTicketToken() {
+    static const char kHex[] = "0123456789abcdef";
+    unsigned char bytes[16];
+    RAND_bytes(bytes, sizeof(bytes));
+    std::string token;
+    token.reserve(2 * sizeof(bytes));
+    for (unsigned char b : bytes) {
+        token += kHex[b >> 4];
+        token += kHex[b & 0xf];
+    }
+    return token;
+}
+
+static RoomInfo roomInfoOf(const Room& room) {
+    RoomInfo info{};
+    info.id = room.id;
+    info.name = room.name;
+    info.ownerId = room.ownerId;
+    info.isPublic = room.isPublic;
+    info.pinCode = room.pinCode;
+    info.layoutJson = room.layoutJson;
+    info.width = room.width;
+    info.height = room.height;
+    return info;
+}
+
+// The ticket is stored on the owning shard first and only then is the client
+// told to reconnect, so the reconnect can never arrive ahead of its ticket.
+static void handOver(WebSocket* ws, const Room& room, uWS::OpCode opCode) {
+    User* user = ws->getUserData();
+    size_t owner = shards->ownerOf(room.id);
+    size_t home = ShardedServer::current()->index;
+    int port = shards->shard(owner).port;
+
+    SessionTicket ticket;
+    ticket.sessionId = user->sessionId;
+    ticket.userId = user->id;
+    ticket.username = user->username;
+    ticket.roles = user->roles;
+    ticket.inventory = user->inventory;
+    ticket.room = roomInfoOf(room);
+    ticket.remoteAddress = user->remoteAddress;
+    ticket.expires = std::chrono::steady_clock::now() + kTicketLifetime;
+
+    // Closing this socket must not drop the session the ticket carries over
+    if (user->sessionId) sessions.park(user->sessionId);
+    bool posted = shards->post(owner,
+        [ticket = std::move(ticket), token = newTicketToken(), home, port, ws, alive = user->alive, opCode]() mutable {
+            auto now = std::chrono::steady_clock::now();
+            for (auto it = sessionTickets.begin(); it != sessionTickets.end();) {
+                if (it->second.expires < now) {
+                    if (it->second.sessionId) sessions.remove(it->second.sessionId, nullptr);
+                    it = sessionTickets.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            std::string roomName = ticket.room.name;
+            sessionTickets[token] = std::move(ticket);
+
+            bool replied = shards->post(home, [ws, alive, token, roomName, port, opCode] {
+                if (!isAlive(ws, alive)) return;
+                JsonWriter w;
+                w.beginObject().field("type", "SHARD_REDIRECT").field("room", roomName);
+                w.field("port", port).field("ticket", token).endObject();
+                sendDirect(ws, w.view(), opCode);
+            });
+            if (!replied) std::cerr << "⚠️ Shard mailbox full; dropped a handover redirect\n";
+        });
+    if (!posted) {
+        if (user->sessionId) sessions.resume(user->sessionId, home, ws);
+        sendDirect(ws, "❌ Server busy, please try again.", opCode);
+    }
+}
+
+static void enterRoom(WebSocket* ws, RoomHandle handle, DatabasePool& dbPool, uWS::OpCode opCode) {
+    Room* room = roomRegistry.get(handle);
+    if (!room) return;
+    User* user = ws->getUserData();
+
+    // Leave previous room
+    leaveCurrentRoom(ws, dbPool, " has left the room.", opCode);
+
+    if (!ownsRoom(*room)) {
+        handOver(ws, *room, opCode);
+        return;
+    }
+
+    // Join new room
+    user->currentRoom = handle;
+    broadcaster.subscribe(ws, *room);
+    warmRoom(dbPool, handle);
+    // Warms the snapshot so deltas carry versions, then places the avatar on a
+    // free tile: where the user last stood in this room, else the spawn tile
+    withFurniture(dbPool, handle, [ws, alive = user->alive, handle, &dbPool](bool loaded) {
+        if (!loaded || !isAlive(ws, alive)) return;
+        auto place = [ws, alive, handle](std::optional<PlayerPosition> saved) {
+            if (!isAlive(ws, alive)) return;
+            User* user = ws->getUserData();
+            Room* room = roomRegistry.get(handle);
+            if (!room || user->currentRoom != handle || room->avatars.find(ws)) return;
+            WalkGrid& grid = ensureWalkGrid(*room);
+            Tile spawn = grid.spawnTile(kSpawnTile);
+            if (saved && saved->roomId == room->id) {
+                Tile last{(int)std::lround(saved->x), (int)std::lround(saved->y)};
+                if (grid.walkable(last.x, last.y)) spawn = last;
+            }
+            RoomAvatar* avatar = simulation.join(handle, ws, user->id, user->username, spawn);
+            if (!avatar) return;
+            if (room->interest.filtering()) followView(ws, *room, ViewCell{}, room->interest.cellOf(spawn));
+            sendRoomEntered(ws, *room, *avatar);
+        };
+        User* user = ws->getUserData();
+        if (user->savedPosition) place(std::exchange(user->savedPosition, std::nullopt));
+        else if (user->id > 0) lookupPlayerPosition(dbPool, ws, place);
+        else place(std::nullopt);
+    });
+    presence.enter(room->id, ws, user->id);
+
+    sendDirect(ws, "✅ Joined room: " + room->name, opCode);
+    withChatHistory(dbPool, handle, [ws, alive = user->alive, handle](bool warm) {
+        if (!warm || !isAlive(ws, alive) || ws->getUserData()->currentRoom != handle) return;
+        if (const Room* room = roomRegistry.get(handle)) sendChatHistory(ws, *room);
+    });
+    broadcaster.toRoomExcept(ws, *room, user->username + " has joined the room.", opCode);
+    backpressure.watch(*room);
+}
+
+static void sendError(WebSocket* ws, std::string_view type, std::string_view reqId, std::string_view error, uWS::OpCode opCode) {
+    JsonWriter w;
+    beginEnvelope(w, type, reqId).field("error", error).endObject();
+    sendDirect(ws, w.view(), opCode);
+}
+
+static void sendBusy(WebSocket* ws, std::string_view type, std::string_view reqId, uWS::OpCode opCode) {
+    sendError(ws, type, reqId, "server_busy", opCode);
+}
+
+// ----------------------
+// Sessions (SessionDirectory in entities/User.hpp)
+// ----------------------
+
+// Runs fn on the session's own loop, if the session is still connected there
+static void withSession(const SessionRef& ref, std::function<void(WebSocket*)> fn) {
+    auto run = [ref, fn = std::move(fn)] {
+        auto* ws = static_cast<WebSocket*>(ref.socket);
+        if (!ws || !clients.count(ws) || ws->getUserData()->sessionId != ref.id) return;
+        fn(ws);
+    };
+    if (ref.shard == ShardedServer::current()->index) run();
+    else if (!shards->post(ref.shard, std::move(run))) std::cerr << "⚠️ Shard mailbox full; dropped a session task\n";
+}
+
+static void closeSession(const SessionRef& ref, std::string notice) {
+    withSession(ref, [notice = std::move(notice)](WebSocket* ws) {
+        sendDirect(ws, notice, uWS::OpCode::TEXT);
+        ws->close();
+    });
+}
+
+// ----------------------
+// Login and registration
+// The DB hop loads everything in one round trip; bcrypt then runs on the
+// auth pool, so neither the loop nor a DB connection waits on it. The
+// address slot is held until the login is answered.
+// ----------------------
+static void handleLogin(WebSocket* ws, DatabasePool& dbPool, AuthPool& authPool,
+                        const std::string& username, const std::string& password, uWS::OpCode opCode) {
+    User* user = ws->getUserData();
+    AuthPool::Slot slot = authPool.admit(user->remoteAddress);
+    if (!slot) {
+        sendDirect(ws, "❌ Too many login attempts, please wait.", opCode);
+        return;
+    }
+    auto alive = user->alive;
+    bool queued = dbPool.submit(
+        [username](Storage& db) { return db.loadLogin(username); },
+        [ws, alive, username, password, slot, opCode, &authPool](std::optional<LoginRecord> record) {
+            if (!isAlive(ws, alive)) return;
+            if (!record) {
+                sendDirect(ws, "❌ Invalid credentials", opCode);
+                return;
+            }
+            std::string hash = record->passwordHash;
+            bool verifying = authPool.submit(
+                [password, hash = std::move(hash)] { return bcrypt::validatePassword(password, hash); },
+                [ws, alive, username, slot, record = std::move(*record), opCode](bool valid) mutable {
+                    if (!isAlive(ws, alive)) return;
+                    if (!valid) {
+                        sendDirect(ws, "❌ Invalid credentials", opCode);
+                        return;
+                    }
+                    User* user = ws->getUserData();
+                    // One session per user: the newest login wins
+                    if (user->sessionId) sessions.remove(user->sessionId, ws);
+                    auto displaced = sessions.add(record.userId, username, ShardedServer::current()->index, ws, user->sessionId);
+                    if (displaced) closeSession(*displaced, "⚠️ You logged in from another location.");
+                    user->id = record.userId;
+                    user->username = username;
+                    user->roles = std::move(record.roles);
+                    user->inventory = std::move(record.inventory);
+                    user->savedPosition = std::move(record.position);
+                    sendDirect(ws, "✅ Logged in as: " + std::to_string(user->id) + " " + username, opCode);
+                });
+            if (!verifying) sendDirect(ws, "❌ Server busy, please try again.", opCode);
+        });
+    if (!queued) sendDirect(ws, "❌ Server busy, please try again.", opCode);
+}
+
+static void handleRegister(WebSocket* ws, DatabasePool& dbPool, AuthPool& authPool, const std::string& username,
+                           const std::string& email, const std::string& password, uWS::OpCode opCode) {
+    AuthPool::Slot slot = authPool.admit(ws->getUserData()->remoteAddress);
+    if (!slot) {
+        sendDirect(ws, "❌ Too many attempts, please wait.", opCode);
+        return;
+    }
+    auto alive = ws->getUserData()->alive;
+    bool queued = authPool.submit(
+        [password] { return bcrypt::generateHash(password); },
+        [ws, alive, username, email, slot, opCode, &dbPool](std::string hash) {
+            if (!isAlive(ws, alive)) return;
+            bool stored = dbPool.submit(
+                [username, email, hash = std::move(hash)](Storage& db) { return db.createUserWithHash(username, email, hash); },
+                [ws, alive, slot, opCode](bool created) {
+                    if (!isAlive(ws, alive)) return;
+                    if (!created) {
+                        sendDirect(ws, "❌ Registration failed (username/email may already exist)", opCode);
+                        return;
+                    }
+                    sendDirect(ws, "✅ Registration successful! You can now log in.", opCode);
+                });
+            if (!stored) sendDirect(ws, "❌ Server busy, please try again.", opCode);
+        });
+    if (!queued) sendDirect(ws, "❌ Server busy, please try again.", opCode);
+}
+
+// ----------------------
+// Pathfinding (loop thread)
 // ----------------------
-// Global state
+
+static void sendPath(WebSocket* ws, const Room& room, Tile from, PathStatus status, const std::vector<Tile>& path,
+                     WireFormat format, std::string_view reqId, uWS::OpCode opCode) {
+    bool found = status == PathStatus::Found;
+    if (format == WireFormat::Binary) {
+        std::string frame;
+        BinaryWriter out(frame);
+        out.op(BinaryOp::Path).varint(room.id).varint(0).u8(found ? 0 : 1).coord(from.x).coord(from.y);
+        out.varint(found ? path.size() : 0);
+        if (found) {
+            for (const Tile& t : path) out.coord(t.x).coord(t.y);
+        }
+        sendDirect(ws, frame, uWS::OpCode::BINARY);
+        return;
+    }
+
+    JsonWriter w;
+    beginEnvelope(w, "PATH", reqId).field("room", room.name).field("roomId", room.id);
+    if (found) {
+        w.key("from").beginArray().value(from.x).value(from.y).endArray();
+        w.key("path").beginArray();
+        for (const Tile& t : path) w.beginArray().value(t.x).value(t.y).endArray();
+        w.endArray();
+    } else {
+        w.field("error", "unreachable");
+    }
+    w.endObject();
+    sendDirect(ws, w.view(), opCode);
+}
+
+// Plans a walk from the sender's tile to `goal` in its current room and
+// answers with PATH once the search completes (usually inline, otherwise on
+// a later pathfinding tick). A newer click supersedes a pending search.
+static void handleTileClick(WebSocket* ws, DatabasePool& dbPool, Tile goal, WireFormat format,
+                            std::string reqId, uWS::OpCode opCode) {
+    User* user = ws->getUserData();
+    RoomHandle handle = user->currentRoom;
+    if (!roomRegistry.get(handle)) {
+        if (format == WireFormat::Json) sendError(ws, "PATH", reqId, "not_in_room", opCode);
+        return;
+    }
+    auto alive = user->alive;
+    withFurniture(dbPool, handle, [ws, alive, handle, goal, format, reqId, opCode](bool loaded) {
+        if (!isAlive(ws, alive)) return;
+        User* user = ws->getUserData();
+        Room* room = roomRegistry.get(handle);
+        if (!room || user->currentRoom != handle) return;
+        if (!loaded) {
+            if (format == WireFormat::Json) sendBusy(ws, "PATH", reqId, opCode);
+            return;
+        }
+        RoomAvatar* avatar = room->avatars.find(ws);
+        if (!avatar) return;    // not placed yet
+        ensureWalkGrid(*room);
+        // Halt on the current tile so the new route starts where the avatar
+        // stands. The start only has to be inside the room: an avatar that
+        // had furniture dropped on it can still walk off.
+        simulation.stop(handle, ws);
+        Tile from = avatar->tile;
+
+        pathService.request(ws, roomRegistry, handle, from, goal,
+            [ws, alive, handle, from, format, reqId, opCode](PathStatus status, const std::vector<Tile>& path) {
+                if (!isAlive(ws, alive)) return;
+                User* user = ws->getUserData();
+                Room* room = roomRegistry.get(handle);
+                if (!room || user->currentRoom != handle) return;
+                if (status == PathStatus::Found && !path.empty()) simulation.walk(handle, ws, path);
+                sendPath(ws, *room, from, status, path, format, reqId, opCode);
+            });
+    });
+}
+
+// Paths first, so routes found this tick start walking in the same step
+static void onRoomTimer(us_timer_t*) {
+    pathService.tick(roomRegistry);
+    simulation.tick(broadcastRoomTick);
+    backpressure.sweep();
+}
+
+// ----------------------
+// Metrics labels for inbound messages (JSON messages use their EventType name)
 // ----------------------
-std::unordered_set<uWS::WebSocket<false, true, User>*> clients;
-std::unordered_map<std::string, std::unordered_set<uWS::WebSocket<false, true, User>*>> rooms;
+static std::string_view binaryMessageLabel(std::string_view frame) {
+    switch (frame.empty() ? (BinaryOp)0 : (BinaryOp)frame.front()) {
+        case BinaryOp::MoveFurniture: return "BIN_MOVE_FURNITURE";
+        case BinaryOp::TileClick: return "BIN_TILE_CLICK";
+        default: return "BIN_UNKNOWN";
+    }
+}
+
+// The command word of a slash command, or CHAT for anything else
+static std::string_view textMessageLabel(std::string_view message) {
+    static constexpr std::string_view kCommands[] = {
+        "/login", "/register", "/join", "/leave", "/kick", "/dbstats", "/reloadrooms",
+        "/slowclients", "/reloadtemplates", "/check_email", "/check_username",
+    };
+    if (message.empty() || message.front() != '/') return "CHAT";
+    std::string_view word = message.substr(0, message.find(' '));
+    for (std::string_view command : kCommands) {
+        if (command == word) return command;
+    }
+    return "/unknown";
+}
+
+// Counts the message under `label` and names the timer measuring it
+static void labelMessage(ScopedTimer& timer, std::string_view label) {
+    Metrics::counter(MetricFamily::MessagesReceived, label).add();
+    timer.relabel(label);
+}
 
 // ----------------------
-// Tiny JSON-field helpers (string-based quick extraction)
-// These are not a full JSON parser but are robust enough for
-// our controlled message shapes: {"type":"X", "reqId":"...","roomId":123, ...}
+// Binary frames (clients that negotiated kBinarySubprotocol)
+// Binary requests carry no room name and act on the sender's current room.
+// There is no ack: the room event reaches the sender through its topic too.
 // ----------------------
-static std::string extract_string_field(const std::string& s, const std::string& key) {
-    std::string pat = "\"" + key + "\"";
-    auto pos = s.find(pat);
-    if (pos == std::string::npos) return "";
-    pos = s.find(':', pos + pat.size());
-    if (pos == std::string::npos) return "";
-    // find first quote after colon
-    auto q1 = s.find('"', pos);
-    if (q1 == std::string::npos) return "";
-    auto q2 = s.find('"', q1 + 1);
-    if (q2 == std::string::npos) return "";
-    return s.substr(q1 + 1, q2 - (q1 + 1));
-}
-
-static long extract_int_field(const std::string& s, const std::string& key, long fallback = -1) {
-    std::string pat = "\"" + key + "\"";
-    auto pos = s.find(pat);
-    if (pos == std::string::npos) return fallback;
-    pos = s.find(':', pos + pat.size());
-    if (pos == std::string::npos) return fallback;
-    // substring from pos+1 until comma or closing brace
-    auto start = pos + 1;
-    while (start < (int)s.size() && isspace((unsigned char)s[start])) start++;
-    // accept numbers (and negative)
-    std::string num;
-    if (start < (int)s.size() && (s[start] == '-' || isdigit((unsigned char)s[start]))) {
-        int i = start;
-        if (s[i] == '-') { num.push_back('-'); i++; }
-        while (i < (int)s.size() && (isdigit((unsigned char)s[i]))) { num.push_back(s[i]); i++; }
-        try { return std::stol(num); } catch (...) { return fallback; }
-    }
-    return fallback;
-}
-
-// Build JSON safely for text responses (escape simple quotes)
-// Minimal escaping for control characters & quotes:
-static std::string escape_json_string(const std::string& in) {
-    std::string out;
-    out.reserve(in.size() + 10);
-    for (char c : in) {
-        switch (c) {
-            case '"': out += "\\\""; break;
-            case '\\': out += "\\\\"; break;
-            case '\b': out += "\\b"; break;
-            case '\f': out += "\\f"; break;
-            case '\n': out += "\\n"; break;
-            case '\r': out += "\\r"; break;
-            case '\t': out += "\\t"; break;
-            default: out += c; break;
+static void handleBinaryMessage(WebSocket* ws, std::string_view frame, DatabasePool& dbPool) {
+    BinaryReader in(frame);
+    BinaryOp op = (BinaryOp)in.u8();
+    Room* room = roomRegistry.get(ws->getUserData()->currentRoom);
+    switch (op) {
+        case BinaryOp::MoveFurniture: {
+            uint8_t flags = in.u8();
+            int objectId = (int)in.varint();
+            std::string_view uid = (flags & kFurnitureHasUid) ? in.str() : std::string_view();
+            float tx = (float)in.coord();
+            float ty = (float)in.coord();
+            std::optional<float> rotation;
+            if (flags & kFurnitureHasRotation) rotation = (float)in.svarint();
+            if (!in.ok() || !room) return;
+            if (flags & kFurnitureHasUid) objectId = room->furniture.resolveUid(std::string(uid));
+            std::string_view error = moveFurniture(dbPool, *room, ws, objectId, uid, tx, ty, rotation);
+            if (!error.empty()) sendMoveRejected(ws, "", error, room, objectId, uWS::OpCode::TEXT);
+            return;
+        }
+        case BinaryOp::TileClick: {
+            Tile goal{(int)std::lround(in.coord()), (int)std::lround(in.coord())};
+            if (!in.ok()) return;
+            handleTileClick(ws, dbPool, goal, WireFormat::Binary, "", uWS::OpCode::BINARY);
+            return;
         }
+        default:
+            return;
     }
-    return out;
-}
-
-// Create a compact JSON array of room templates (from DB)
-static std::string roomTemplatesToJson(const std::vector<RoomTemplate>& tmpls) {
-    std::ostringstream ss;
-    ss << "[";
-    bool first = true;
-    for (const auto& t : tmpls) {
-        if (!first) ss << ",";
-        first = false;
-        ss << "{";
-        ss << "\"id\":" << t.id << ",";
-        ss << "\"name\":\"" << escape_json_string(t.name) << "\",";
-        ss << "\"width\":" << t.width << ",";
-        ss << "\"height\":" << t.height << ",";
-        ss << "\"skew_angle\":" << t.skewAngle << ",";
-        ss << "\"texture_path\":\"" << escape_json_string(t.texturePath) << "\",";
-        // defaultLayoutJson stored as string (may already be JSON). We will include as string.
-        ss << "\"default_layout_json\":\"" << escape_json_string(t.defaultLayoutJson) << "\",";
-        ss << "\"editable\":" << (t.editable ? "true" : "false");
-        ss << "}";
-    }
-    ss << "]";
-    return ss.str();
-}
-
-static std::string roomObjectsToJson(const std::vector<RoomObject>& objs) {
-    std::ostringstream ss;
-    ss << "[";
-    bool first = true;
-    for (const auto& o : objs) {
-        if (!first) ss << ",";
-        first = false;
-        ss << "{";
-        ss << "\"id\":" << o.id << ",";
-        ss << "\"name\":\"" << escape_json_string(o.name) << "\",";
-        ss << "\"sprite_path\":\"" << escape_json_string(o.spritePath) << "\",";
-        // we store tx/ty as x/y
-        ss << "\"tx\":" << o.x << ",";
-        ss << "\"ty\":" << o.y << ",";
-        ss << "\"rotation\":" << o.rotation << ",";
-        ss << "\"scale\":" << o.scale << ",";
-        ss << "\"interactable\":" << (o.interactable ? "true" : "false");
-        ss << "}";
-    }
-    ss << "]";
-    return ss.str();
 }
 
 int main() {
-    Database db("dbname=hobo user=dame password=swaa2213 host=localhost");
+    // Postgres unless HABBO_STORAGE_DIR names a directory for the embedded store
+    const std::string connStr = "dbname=hobo user=dame password=swaa2213 host=localhost";
+    std::shared_ptr<LogStore> logStore;
+    StorageFactory openStorage = [connStr] { return std::make_shared<Database>(connStr); };
+    if (const char* storageDir = std::getenv("HABBO_STORAGE_DIR")) {
+        logStore = std::make_shared<LogStore>(storageDir);
+        openStorage = [logStore] { return logStore; };
+    }
+    std::shared_ptr<Storage> db = openStorage(); // startup-only; request handlers go through dbPool
+    DatabasePool dbPool(openStorage, std::max(2u, std::thread::hardware_concurrency()));
+    // HABBO_LOGINS_PER_ADDRESS overrides the 2 logins one address may have in
+    // flight; 0 means no limit, for load runs where every user shares an address
+    size_t loginsPerAddress = 2;
+    if (const char* limit = std::getenv("HABBO_LOGINS_PER_ADDRESS")) loginsPerAddress = std::strtoul(limit, nullptr, 10);
+    AuthPool authPool(std::max(1u, std::thread::hardware_concurrency() / 2), 512, loginsPerAddress);
+    ChatJournal chatJournal(openStorage);
+
+    // Footprints come from the client's furniture metadata; without them every item is 1x1
+    for (const char* file : {"furniture.json", "objects.json", "walls.json"}) {
+        std::string path = std::string(kFurnitureMetadataDir) + "/" + file;
+        if (furnitureCatalog.loadFile(path) < 0) std::cerr << "⚠️ Could not read furniture metadata " << path << "\n";
+    }
+    std::cout << "✅ Loaded " << furnitureCatalog.size() << " furniture footprints\n";
+
+    // Templates are read once here; handlers serve them from the catalogue
+    templateCatalogue.publish(db->getAllRoomTemplates());
+    auto catalogue = templateCatalogue.current();
+    std::cout << "✅ Loaded " << catalogue->templates.size() << " room templates (version " << catalogue->version << ")\n";
 
     // Ensure default rooms from templates exist (safe to call repeatedly)
-    db.createRoomFromTemplate(1, 1, "Lobby"); // Create a default Lobby room if not exists
-    db.createRoomFromTemplate(1, 2, "Chill Zone");
-    db.createRoomFromTemplate(1, 3, "Gaming Room");
+    const std::pair<int, const char*> defaultRooms[] = {{1, "Lobby"}, {2, "Chill Zone"}, {3, "Gaming Room"}};
+    for (const auto& [templateId, roomName] : defaultRooms) {
+        if (const RoomTemplate* tpl = catalogue->find(templateId)) db->createRoomFromTemplate(1, *tpl, roomName);
+    }
+
+    // Presence is in memory only; counts left over from a previous run are stale
+    db->resetPresence();
 
     // Quick test authenticate (you already had this)
-    auto id = db.authenticateUser("dame", "swaa2213");
+    auto id = db->authenticateUser("dame", "swaa2213");
     if (id.has_value()) {
         std::cout << "✅ Authenticated user ID: " << id.value() << std::endl;
     } else {
         std::cout << "❌ Invalid login" << std::endl;
     }
 
-    uWS::App()
-        .ws<User>("/*", {
-            // ----------------------
-            // New connection
-            // ----------------------
-            .open = [&](auto* ws) {
-                clients.insert(ws);
-                ws->getUserData()->id = -1; // not logged in
-            },
-
-            // ----------------------
-            // Incoming messages
-            // ----------------------
-            .message = [&](auto* ws, std::string_view message, uWS::OpCode opCode) {
-                std::string msg(message);
-
-                // If it looks like JSON (starts with '{'), attempt to handle JSON messages using "type" field
-                if (!msg.empty() && msg.front() == '{') {
-                    // extract a few common fields
-                    std::string type = extract_string_field(msg, "type");
-                    std::string reqId = extract_string_field(msg, "reqId");
-                    // ---------- GET_ROOM_TEMPLATES ----------
-                    if (type == "GET_ROOM_TEMPLATES") {
-                        auto tmpls = db.getAllRoomTemplates();
-                        std::ostringstream out;
-                        out << "{";
-                        out << "\"type\":\"ROOM_TEMPLATES\",";
-                        if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                        out << "\"data\":" << roomTemplatesToJson(tmpls);
-                        out << "}";
-                        ws->send(out.str(), opCode);
-                        return;
-                    }
+    std::signal(SIGINT, onShutdownSignal);
+    std::signal(SIGTERM, onShutdownSignal);
 
-                    // ---------- GET_ROOM_TEMPLATE (single) ----------
-                    if (type == "GET_ROOM_TEMPLATE") {
-                        long templateId = extract_int_field(msg, "templateId", -1);
-                        auto tplOpt = db.getRoomTemplateById((int)templateId);
-                        if (!tplOpt.has_value()) {
-                            std::ostringstream out;
-                            out << "{";
-                            out << "\"type\":\"ROOM_TEMPLATE\",";
-                            if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                            out << "\"error\":\"not_found\"";
-                            out << "}";
-                            ws->send(out.str(), opCode);
-                            return;
-                        }
-                        const auto tpl = tplOpt.value();
-                        std::ostringstream out;
-                        out << "{";
-                        out << "\"type\":\"ROOM_TEMPLATE\",";
-                        if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                        out << "\"data\":{";
-                        out << "\"id\":" << tpl.id << ",";
-                        out << "\"name\":\"" << escape_json_string(tpl.name) << "\",";
-                        out << "\"width\":" << tpl.width << ",";
-                        out << "\"height\":" << tpl.height << ",";
-                        out << "\"skew_angle\":" << tpl.skewAngle << ",";
-                        out << "\"texture_path\":\"" << escape_json_string(tpl.texturePath) << "\",";
-                        out << "\"default_layout_json\":\"" << escape_json_string(tpl.defaultLayoutJson) << "\",";
-                        out << "\"editable\":" << (tpl.editable ? "true" : "false");
-                        out << "}}";
-                        ws->send(out.str(), opCode);
-                        return;
-                    }
+    // ----------------------
+    // JSON request handlers
+    // ----------------------
+    MessageDispatcher dispatcher;
 
-                    // ---------- GET_ROOM_FURNITURE ----------
-                    if (type == "GET_ROOM_FURNITURE") {
-                        long roomId = extract_int_field(msg, "roomId", -1);
-                        if (roomId == -1) {
-                            std::ostringstream out;
-                            out << "{";
-                            out << "\"type\":\"ROOM_FURNITURE\",";
-                            if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                            out << "\"data\":[]";
-                            out << "}";
-                            ws->send(out.str(), opCode);
-                            return;
-                        }
-                        auto objs = db.getRoomObjects((int)roomId);
-                        std::ostringstream out;
-                        out << "{";
-                        out << "\"type\":\"ROOM_FURNITURE\",";
-                        if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                        out << "\"data\":" << roomObjectsToJson(objs);
-                        out << "}";
-                        ws->send(out.str(), opCode);
-                        return;
-                    }
+    // ---------- GET_ROOM_TEMPLATES ----------
+    // Precomputed bytes from the catalogue; a client that already holds the
+    // current version only gets the version back with notModified
+    dispatcher.on(EventType::GetRoomTemplates, [&](WebSocket* ws, const JsonMessage& json, uWS::OpCode opCode) {
+        auto catalogue = templateCatalogue.current();
+        JsonWriter w;
+        beginEnvelope(w, "ROOM_TEMPLATES", json.str("reqId")).field("version", catalogue->version);
+        if (json.str("version") == catalogue->version) w.field("notModified", true);
+        else w.key("data").raw(catalogue->listJson);
+        w.endObject();
+        sendDirect(ws, w.view(), opCode);
+    });
 
-                    // ---------- SUBSCRIBE_ROOM ----------
-                    // Client requests to be added to broadcast list for a named room
-                    if (type == "SUBSCRIBE_ROOM") {
-                        std::string roomName = extract_string_field(msg, "room");
-                        if (!roomName.empty()) {
-                            rooms[roomName].insert(ws);
-                            // send back current room state (layout + furniture)
-                            int roomId = db.getPublicRoomIdByName(roomName);
-                            std::vector<RoomObject> objs;
-                            if (roomId != -1) objs = db.getRoomObjects(roomId);
+    // ---------- GET_ROOM_TEMPLATE (single) ----------
+    dispatcher.on(EventType::GetRoomTemplate, [&](WebSocket* ws, const JsonMessage& json, uWS::OpCode opCode) {
+        auto catalogue = templateCatalogue.current();
+        const std::string* item = catalogue->findJson((int)json.num("templateId", -1));
+        if (!item) {
+            sendError(ws, "ROOM_TEMPLATE", json.str("reqId"), "not_found", opCode);
+            return;
+        }
+        JsonWriter w;
+        beginEnvelope(w, "ROOM_TEMPLATE", json.str("reqId")).field("version", catalogue->version);
+        w.key("data").raw(*item).endObject();
+        sendDirect(ws, w.view(), opCode);
+    });
 
-                            std::ostringstream out;
-                            out << "{";
-                            out << "\"type\":\"ROOM_STATE\",";
-                            if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                            out << "\"room\":\"" << escape_json_string(roomName) << "\",";
-                            out << "\"furniture\":" << roomObjectsToJson(objs);
-                            out << "}";
-                            ws->send(out.str(), opCode);
-                        } else {
-                            std::ostringstream out;
-                            out << "{";
-                            out << "\"type\":\"SUBSCRIBE_ROOM_RESPONSE\",";
-                            if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                            out << "\"error\":\"missing_room\"";
-                            out << "}";
-                            ws->send(out.str(), opCode);
-                        }
+    // ---------- GET_ROOM_FURNITURE ----------
+    dispatcher.on(EventType::GetRoomFurniture, [&](WebSocket* ws, const JsonMessage& json, uWS::OpCode opCode) {
+        std::string reqId(json.str("reqId"));
+        long roomId = json.num("roomId", -1);
+        if (roomId == -1) {
+            JsonWriter w;
+            beginEnvelope(w, "ROOM_FURNITURE", reqId).key("data").beginArray().endArray().endObject();
+            sendDirect(ws, w.view(), opCode);
+            return;
+        }
+        // Rooms with a live snapshot are served from memory
+        if (Room* room = roomRegistry.get(roomRegistry.findById((int)roomId))) {
+            if (room->furniture.loaded()) {
+                JsonWriter w;
+                beginEnvelope(w, "ROOM_FURNITURE", reqId);
+                w.field("version", room->furniture.version());
+                w.key("data").raw(furnitureJson(room->furniture));
+                w.endObject();
+                sendDirect(ws, w.view(), opCode);
+                return;
+            }
+        }
+        auto alive = ws->getUserData()->alive;
+        bool queued = dbPool.submit(
+            [roomId](Storage& db) { return db.getRoomObjects((int)roomId); },
+            [ws, alive, reqId, opCode](std::vector<RoomObject> objs) {
+                if (!isAlive(ws, alive)) return;
+                JsonWriter w;
+                beginEnvelope(w, "ROOM_FURNITURE", reqId).key("data");
+                writeRoomObjects(w, objs);
+                w.endObject();
+                sendDirect(ws, w.view(), opCode);
+            });
+        if (!queued) sendBusy(ws, "ROOM_FURNITURE", reqId, opCode);
+    });
+
+    // ---------- SUBSCRIBE_ROOM ----------
+    // Client requests to be added to broadcast list for a named room.
+    // Optional "version": the furniture version the client already has.
+    dispatcher.on(EventType::SubscribeRoom, [&](WebSocket* ws, const JsonMessage& json, uWS::OpCode opCode) {
+        std::string reqId(json.str("reqId"));
+        std::string roomName(json.str("room"));
+        long knownVersion = json.num("version", 0);
+        if (!roomName.empty()) {
+            auto alive = ws->getUserData()->alive;
+            resolvePublicRoom(dbPool, roomName, [ws, alive, reqId, roomName, knownVersion, opCode, &dbPool](RoomHandle handle) {
+                if (!isAlive(ws, alive)) return;
+                Room* room = roomRegistry.get(handle);
+                if (!room) {
+                    JsonWriter w;
+                    beginEnvelope(w, "ROOM_STATE", reqId).field("room", roomName);
+                    w.key("furniture").beginArray().endArray().endObject();
+                    sendDirect(ws, w.view(), opCode);
+                    return;
+                }
+                if (!ownsRoom(*room)) {
+                    sendError(ws, "ROOM_STATE", reqId, "wrong_shard", opCode);
+                    return;
+                }
+                broadcaster.subscribe(ws, *room);
+
+                // send back current room state (or just what changed since knownVersion)
+                withFurniture(dbPool, handle, [ws, alive, reqId, handle, knownVersion, opCode](bool loaded) {
+                    if (!isAlive(ws, alive)) return;
+                    Room* room = roomRegistry.get(handle);
+                    if (!room || !loaded) {
+                        sendBusy(ws, "ROOM_STATE", reqId, opCode);
                         return;
                     }
+                    sendFurnitureSync(ws, *room, reqId, knownVersion > 0 ? (uint64_t)knownVersion : 0, opCode);
+                });
+            });
+        } else {
+            sendError(ws, "SUBSCRIBE_ROOM_RESPONSE", reqId, "missing_room", opCode);
+        }
+    });
 
-                    // ---------- CREATE_FURNITURE ----------
-                    // Persist new furniture to DB. Expect fields: room (name) and furniture object with proto_id, tx, ty
-                    if (type == "CREATE_FURNITURE") {
-                        std::string roomName = extract_string_field(msg, "room");
-                        std::string uid = extract_string_field(msg, "uid"); // client's local uid (we echo it back)
-                        // naive extraction of nested "furniture":{"proto_id":"sofa","tx":4,"ty":3,"color":...}
-                        std::string proto = extract_string_field(msg, "proto_id");
-                        long tx = extract_int_field(msg, "tx", 0);
-                        long ty = extract_int_field(msg, "ty", 0);
-
-                        int roomId = -1;
-                        if (!roomName.empty()) roomId = db.getPublicRoomIdByName(roomName);
-                        if (roomId == -1) {
-                            // attempt to find by current user's room id
-                            if (ws->getUserData()->currentRoomId != -1) roomId = ws->getUserData()->currentRoomId;
-                        }
+    // ---------- CREATE_FURNITURE ----------
+    // Persist new furniture to DB. Expect fields: room (name) and furniture object with proto_id, tx, ty
+    dispatcher.on(EventType::CreateFurniture, [&](WebSocket* ws, const JsonMessage& json, uWS::OpCode opCode) {
+        std::string reqId(json.str("reqId"));
+        std::string roomName(json.str("room"));
+        std::string uid(json.str("uid")); // client's local uid (we echo it back)
+        // naive extraction of nested "furniture":{"proto_id":"sofa","tx":4,"ty":3,"color":...}
+        std::string proto(json.str("proto_id"));
+        long tx = json.num("tx", 0);
+        long ty = json.num("ty", 0);
 
-                        if (roomId == -1) {
-                            std::ostringstream out;
-                            out << "{";
-                            out << "\"type\":\"CREATE_FURNITURE_RESPONSE\",";
-                            if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                            out << "\"error\":\"room_not_found\"";
-                            out << "}";
-                            ws->send(out.str(), opCode);
-                            return;
-                        }
+        auto alive = ws->getUserData()->alive;
+        auto onRoom = [ws, alive, reqId, uid, proto, tx, ty, opCode, &dbPool](RoomHandle handle) {
+            if (!isAlive(ws, alive)) return;
+            // attempt to find by current user's room
+            if (handle == kNoRoom) handle = ws->getUserData()->currentRoom;
+            const Room* room = roomRegistry.get(handle);
+            if (!room) {
+                sendError(ws, "CREATE_FURNITURE_RESPONSE", reqId, "room_not_found", opCode);
+                return;
+            }
+            if (!ownsRoom(*room)) {
+                sendError(ws, "CREATE_FURNITURE_RESPONSE", reqId, "wrong_shard", opCode);
+                return;
+            }
 
-                        // Persist: we map proto -> name, leave sprite_path empty for now
-                        bool ok = db.addRoomObject(roomId, proto.empty() ? "furniture" : proto, "", (float)tx, (float)ty, 0.0f, 1.0f, false);
-
-                        // fetch fresh furniture and broadcast ROOM_STATE to room
-                        auto objs = db.getRoomObjects(roomId);
-                        std::ostringstream broadcast;
-                        broadcast << "{";
-                        broadcast << "\"type\":\"ROOM_STATE\",";
-                        broadcast << "\"room\":\"" << escape_json_string(roomName) << "\",";
-                        broadcast << "\"furniture\":" << roomObjectsToJson(objs);
-                        broadcast << "}";
-                        // broadcast to sockets subscribed to that room
-                        if (!roomName.empty()) {
-                            for (auto client : rooms[roomName]) {
-                                client->send(broadcast.str(), uWS::OpCode::TEXT);
+            // Placement is checked against the snapshot, so it has to be in memory first
+            withFurniture(dbPool, handle, [ws, alive, reqId, uid, proto, tx, ty, handle, opCode, &dbPool](bool loaded) {
+                if (!isAlive(ws, alive)) return;
+                Room* room = roomRegistry.get(handle);
+                if (!room || !loaded) {
+                    sendBusy(ws, "CREATE_FURNITURE_RESPONSE", reqId, opCode);
+                    return;
+                }
+
+                // Persist: we map proto -> name, leave sprite_path empty for now
+                RoomObject object{};
+                object.name = proto.empty() ? "furniture" : proto;
+                object.x = (float)tx;
+                object.y = (float)ty;
+                object.rotation = 0.0f;
+                object.scale = 1.0f;
+                object.interactable = false;
+
+                ensureWalkGrid(*room);
+                Placement placement = room->furniture.checkPlacement(object.name, object.x, object.y, object.rotation);
+                if (placement != Placement::Ok) {
+                    JsonWriter w;
+                    beginEnvelope(w, "CREATE_FURNITURE_RESPONSE", reqId).field("ok", false).field("error", placementError(placement)).field("uid", uid).endObject();
+                    sendDirect(ws, w.view(), opCode);
+                    return;
+                }
+                int reservation = room->furniture.reserve(object.name, object.x, object.y, object.rotation, uid, ws);
+                bool queued = dbPool.submit(
+                    [roomId = room->id, object](Storage& db) {
+                        return db.addRoomObject(roomId, object.name, object.spritePath, object.x, object.y, object.rotation, object.scale, object.interactable);
+                    },
+                    [ws, alive, reqId, uid, handle, object, reservation, opCode, &dbPool](int objectId) mutable {
+                        Room* room = roomRegistry.get(handle);
+                        RoomObject inserted = object;
+                        if (room) {
+                            // The creator may have moved it while the insert was in flight
+                            if (const PendingCreate* latest = room->furniture.pending(reservation)) {
+                                object.x = latest->x;
+                                object.y = latest->y;
+                                object.rotation = latest->rotation;
+                            }
+                            room->furniture.release(reservation);
+                        }
+                        if (objectId != -1 && room) {
+                            // apply to the snapshot and broadcast only the new item
+                            object.id = objectId;
+                            bool moved = object.x != inserted.x || object.y != inserted.y || object.rotation != inserted.rotation;
+                            if (moved && !dbPool.submit([object](Storage& db) { db.updateRoomObject(object.id, object.x, object.y, object.rotation); })) {
+                                // Keep it where room_objects has it
+                                object.x = inserted.x;
+                                object.y = inserted.y;
+                                object.rotation = inserted.rotation;
                             }
+                            std::string objectJson = roomObjectToJson(object, uid);
+                            uint64_t version = room->furniture.add(object, uid, objectJson);
+                            broadcastFurnitureChange(*room, FurnitureChange::Added, version, objectJson, object, uid);
                         }
+                        if (!isAlive(ws, alive)) return;
 
                         // reply to the originator (include original uid so client can map)
-                        std::ostringstream out;
-                        out << "{";
-                        out << "\"type\":\"CREATE_FURNITURE_RESPONSE\",";
-                        if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                        out << "\"ok\":" << (ok ? "true" : "false") << ",";
-                        out << "\"uid\":\"" << escape_json_string(uid) << "\"";
-                        out << "}";
-                        ws->send(out.str(), opCode);
-                        return;
-                    }
+                        JsonWriter w;
+                        beginEnvelope(w, "CREATE_FURNITURE_RESPONSE", reqId);
+                        w.field("ok", objectId != -1);
+                        if (objectId != -1) w.field("id", objectId);
+                        w.field("uid", uid);
+                        w.endObject();
+                        sendDirect(ws, w.view(), opCode);
+                    });
+                if (!queued) {
+                    room->furniture.release(reservation);
+                    sendBusy(ws, "CREATE_FURNITURE_RESPONSE", reqId, opCode);
+                }
+            });
+        };
+        if (roomName.empty()) onRoom(kNoRoom);
+        else resolvePublicRoom(dbPool, roomName, onRoom);
+    });
 
-                    // ---------- UPDATE_FURNITURE ----------
-                    // We broadcast update to room clients. Persistence of updates is left as-is (see note).
-                    if (type == "UPDATE_FURNITURE") {
-                        std::string roomName = extract_string_field(msg, "room");
-                        std::string uid = extract_string_field(msg, "uid");
-                        long tx = extract_int_field(msg, "tx", 0);
-                        long ty = extract_int_field(msg, "ty", 0);
-
-                        // build update payload
-                        std::ostringstream broadcast;
-                        broadcast << "{";
-                        broadcast << "\"type\":\"FURNITURE_UPDATED\",";
-                        if (!reqId.empty()) broadcast << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                        broadcast << "\"room\":\"" << escape_json_string(roomName) << "\",";
-                        broadcast << "\"furniture\":{";
-                        broadcast << "\"uid\":\"" << escape_json_string(uid) << "\",";
-                        broadcast << "\"tx\":" << tx << ",";
-                        broadcast << "\"ty\":" << ty;
-                        broadcast << "}}";
-
-                        // broadcast to sockets subscribed to that room
-                        if (!roomName.empty()) {
-                            for (auto client : rooms[roomName]) {
-                                client->send(broadcast.str(), uWS::OpCode::TEXT);
-                            }
-                        }
+    // ---------- UPDATE_FURNITURE ----------
+    // The snapshot is authoritative: queue the write, then apply and broadcast the delta.
+    dispatcher.on(EventType::UpdateFurniture, [&](WebSocket* ws, const JsonMessage& json, uWS::OpCode opCode) {
+        std::string reqId(json.str("reqId"));
+        std::string roomName(json.str("room"));
+        std::string uid(json.str("uid"));
+        long tx = json.num("tx", 0);
+        long ty = json.num("ty", 0);
 
-                        // reply ack
-                        std::ostringstream out;
-                        out << "{";
-                        out << "\"type\":\"UPDATE_FURNITURE_RESPONSE\",";
-                        if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                        out << "\"ok\":true";
-                        out << "}";
-                        ws->send(out.str(), opCode);
-                        return;
-                    }
+        // An empty name means the sender's current room, as for DELETE
+        Room* room = roomRegistry.get(findNamedRoom(ws, roomName));
+        if (!room) {
+            const Room* named = roomRegistry.get(roomRegistry.findPublic(roomName));
+            sendMoveRejected(ws, reqId, named && !ownsRoom(*named) ? "wrong_shard" : "room_not_found", nullptr, 0, opCode);
+            return;
+        }
+        int objectId = room->furniture.resolveUid(uid);
+        std::optional<float> rotation;
+        if (json.has("rotation")) rotation = (float)json.num("rotation", 0);
+        std::string_view error = moveFurniture(dbPool, *room, ws, objectId, uid, (float)tx, (float)ty, rotation);
+        if (!error.empty()) {
+            sendMoveRejected(ws, reqId, error, room, objectId, opCode);
+            return;
+        }
+
+        // reply ack
+        JsonWriter w;
+        beginEnvelope(w, "UPDATE_FURNITURE_RESPONSE", reqId).field("ok", true).endObject();
+        sendDirect(ws, w.view(), opCode);
+    });
+
+    // ---------- DELETE_FURNITURE ----------
+    // Expect fields: room (name) and uid of the item to remove
+    dispatcher.on(EventType::DeleteFurniture, [&](WebSocket* ws, const JsonMessage& json, uWS::OpCode opCode) {
+        std::string reqId(json.str("reqId"));
+        std::string roomName(json.str("room"));
+        std::string uid(json.str("uid"));
+
+        Room* room = roomRegistry.get(findNamedRoom(ws, roomName));
+        int objectId = room ? room->furniture.resolveUid(uid) : -1;
+        bool found = room && room->furniture.find(objectId);
+        // Same order as moveFurniture: nothing is removed unless the delete is queued
+        if (found && !dbPool.submit([objectId, roomId = room->id](Storage& db) { db.removeRoomObject(objectId, roomId); })) {
+            sendBusy(ws, "DELETE_FURNITURE_RESPONSE", reqId, opCode);
+            return;
+        }
+        if (found) {
+            RoomObject removed = *room->furniture.find(objectId);
+            std::string removedUid = room->furniture.uidFor(objectId);
+            JsonWriter furniture;
+            furniture.beginObject().field("id", objectId).field("uid", removedUid).endObject();
+            uint64_t version = room->furniture.remove(objectId, furniture.str());
+            broadcastFurnitureChange(*room, FurnitureChange::Removed, version, furniture.view(), removed, removedUid);
+        }
+
+        if (found) {
+            JsonWriter w;
+            beginEnvelope(w, "DELETE_FURNITURE_RESPONSE", reqId).field("ok", true).endObject();
+            sendDirect(ws, w.view(), opCode);
+        } else {
+            sendError(ws, "DELETE_FURNITURE_RESPONSE", reqId, "not_found", opCode);
+        }
+    });
+
+    // ---------- TILE_CLICK ----------
+    // Expect fields: tx, ty (tile in the sender's current room). Answered with PATH.
+    dispatcher.on(EventType::TileClick, [&](WebSocket* ws, const JsonMessage& json, uWS::OpCode opCode) {
+        Tile goal{(int)json.num("tx", -1), (int)json.num("ty", -1)};
+        handleTileClick(ws, dbPool, goal, WireFormat::Json, std::string(json.str("reqId")), opCode);
+    });
+
+    // ---------- RESUME_SESSION ----------
+    // A session handed over by another shard (see handOver). Expect field: ticket.
+    dispatcher.on(EventType::ResumeSession, [&](WebSocket* ws, const JsonMessage& json, uWS::OpCode opCode) {
+        std::string reqId(json.str("reqId"));
+        auto it = sessionTickets.find(std::string(json.str("ticket")));
+        if (it == sessionTickets.end() || it->second.expires < std::chrono::steady_clock::now()) {
+            if (it != sessionTickets.end()) sessionTickets.erase(it);
+            sendError(ws, "RESUME_SESSION_RESPONSE", reqId, "invalid_ticket", opCode);
+            return;
+        }
+        // A leaked ticket is useless from any other address (and stays
+        // redeemable by its owner until it expires)
+        if (it->second.remoteAddress != ws->getUserData()->remoteAddress) {
+            sendError(ws, "RESUME_SESSION_RESPONSE", reqId, "invalid_ticket", opCode);
+            return;
+        }
+        SessionTicket ticket = std::move(it->second);
+        sessionTickets.erase(it);
+        // Logged in again elsewhere while this ticket waited
+        if (ticket.sessionId && !sessions.resume(ticket.sessionId, ShardedServer::current()->index, ws)) {
+            sendError(ws, "RESUME_SESSION_RESPONSE", reqId, "session_replaced", opCode);
+            return;
+        }
 
-                    // unknown JSON type -> return an error envelope (or ignore)
-                    {
-                        std::ostringstream out;
-                        out << "{";
-                        out << "\"type\":\"ERROR\",";
-                        if (!reqId.empty()) out << "\"reqId\":\"" << escape_json_string(reqId) << "\",";
-                        out << "\"message\":\"unknown_type\"";
-                        out << "}";
-                        ws->send(out.str(), opCode);
+        User* user = ws->getUserData();
+        user->sessionId = ticket.sessionId;
+        user->id = ticket.userId;
+        user->username = std::move(ticket.username);
+        user->roles = std::move(ticket.roles);
+        user->inventory = std::move(ticket.inventory);
+
+        JsonWriter w;
+        beginEnvelope(w, "RESUME_SESSION_RESPONSE", reqId).field("ok", true).field("username", user->username).endObject();
+        sendDirect(ws, w.view(), opCode);
+        enterRoom(ws, roomRegistry.insert(ticket.room), dbPool, opCode);
+    });
+
+    // ----------------------
+    // Shards: one event loop per hardware thread (core/Server.hpp)
+    // ----------------------
+    ShardedServer server(std::thread::hardware_concurrency(), kShardPortBase);
+    shards = &server;
+    std::cout << "✅ Starting " << server.size() << " shard(s)\n";
+
+    server.run([&](Shard& shard) {
+        us_timer_t* shutdownTimer = us_create_timer((us_loop_t*) uWS::Loop::get(), 0, 0);
+        us_timer_set(shutdownTimer, onShutdownTimer, 200, 200);
+        roomTimer = us_create_timer((us_loop_t*) uWS::Loop::get(), 0, 0);
+        us_timer_set(roomTimer, onRoomTimer, simulation.tickIntervalMs(), simulation.tickIntervalMs());
+        flushTimer = us_create_timer((us_loop_t*) uWS::Loop::get(), 0, sizeof(DatabasePool*));
+        *(DatabasePool**) us_timer_ext(flushTimer) = &dbPool;
+        us_timer_set(flushTimer, onFlushTimer, kFlushMs, kFlushMs);
+        roomRegistry.setCatalog(&furnitureCatalog);
+
+        uWS::App app;
+        broadcaster.attach(&app);
+        // A connection that caught up gets the current avatars and the furniture changes it missed
+        backpressure.setResync([](WebSocket* ws, Room& room, uint64_t furnitureVersion) {
+            if (const RoomAvatar* avatar = room.avatars.find(ws)) sendRoomEntered(ws, room, *avatar);
+            if (room.furniture.loaded()) sendFurnitureSync(ws, room, "", furnitureVersion, uWS::OpCode::TEXT);
+        });
+
+        app.ws<User>("/*", {
+                // uWS silently drops publishes past this; BackpressureMonitor acts well before
+                .maxBackpressure = kBackpressure.dropBytes,
+
+                // ----------------------
+                // Upgrade: the wire format comes from Sec-WebSocket-Protocol
+                // ----------------------
+                .upgrade = [](auto* res, auto* req, auto* context) {
+                    User user;
+                    std::string_view protocol;
+                    user.wireFormat = negotiateWireFormat(req->getHeader("sec-websocket-protocol"), protocol);
+                    res->template upgrade<User>(std::move(user),
+                                                req->getHeader("sec-websocket-key"),
+                                                protocol,
+                                                req->getHeader("sec-websocket-extensions"),
+                                                context);
+                },
+
+                // ----------------------
+                // New connection
+                // ----------------------
+                .open = [&](auto* ws) {
+                    clients.insert(ws);
+                    Metrics::gauge(MetricFamily::Connections).set((int64_t)clients.size());
+                    ws->getUserData()->id = -1; // not logged in
+                    ws->getUserData()->alive = std::make_shared<bool>(true);
+                    ws->getUserData()->remoteAddress = std::string(ws->getRemoteAddressAsText());
+                },
+
+                // ----------------------
+                // Incoming messages
+                // ----------------------
+                .message = [&](auto* ws, std::string_view message, uWS::OpCode opCode) {
+                    // Loop time only; DB work is timed per query on the pool
+                    ScopedTimer timer(MetricFamily::MessageDuration, {});
+                    static thread_local MetricCounter& receivedBytes = Metrics::counter(MetricFamily::ReceivedBytes);
+                    receivedBytes.add(message.size());
+
+                    if (opCode == uWS::OpCode::BINARY) {
+                        labelMessage(timer, binaryMessageLabel(message));
+                        handleBinaryMessage(ws, message, dbPool);
                         return;
                     }
-                } // end JSON handling
-
-                // ---------- FALLBACK: old slash command text handling ----------
-                if (!msg.empty() && msg[0] == '/') {
-                    // Command processing (kept as you had it)
-                    if (msg.find("/login ") == 0) {
-                        auto splitPos = msg.find(' ', 7);
-                        if (splitPos == std::string::npos) {
-                            ws->send("❌ Usage: /login <username> <password>", opCode);
-                            return;
-                        }
 
-                        std::string username = msg.substr(7, splitPos - 7);
-                        std::string password = msg.substr(splitPos + 1);
+                    // JSON requests are decoded in place and routed on their hashed "type"
+                    if (!message.empty() && message.front() == '{') {
+                        JsonMessage json;
+                        bool parsed = json.parse(message);
+                        EventType type = parsed ? json.type() : EventType::Unknown;
+                        labelMessage(timer, type != EventType::Unknown ? eventTypeName(type) : parsed ? "UNKNOWN" : "BAD_JSON");
+                        if (parsed && dispatcher.dispatch(ws, json, opCode)) return;
 
-                        auto userIdOpt = db.authenticateUser(username, password);
-                        if (userIdOpt.has_value()) {
-                            int userId = userIdOpt.value();
-                            ws->getUserData()->id = userId;
-                            ws->getUserData()->username = username;
-                            ws->getUserData()->roles = db.getUserRoles(userId);
-                            ws->getUserData()->inventory = db.getUserInventory(userId);
+                        JsonWriter w;
+                        beginEnvelope(w, "ERROR", parsed ? json.str("reqId") : std::string_view());
+                        w.field("message", parsed ? "unknown_type" : "bad_json").endObject();
+                        sendDirect(ws, w.view(), opCode);
+                        return;
+                    }
 
-                            ws->send("✅ Logged in as: " + std::to_string(userId) + " " + username, opCode);
-                        } else {
-                            ws->send("❌ Invalid credentials", opCode);
-                        }
-                    } else if (msg.find("/register ") == 0) {
-                        std::istringstream iss(msg.substr(10));
-                        std::string email, username, password;
-                        iss >> username >> email >> password;
+                    labelMessage(timer, textMessageLabel(message));
+                    std::string msg(message);
 
-                        if (email.empty() || username.empty() || password.empty()) {
-                            ws->send("❌ Please fill all fields", opCode);
-                            return;
-                        }
+                    // ---------- FALLBACK: old slash command text handling ----------
+                    if (!msg.empty() && msg[0] == '/') {
+                        // Command processing (kept as you had it)
+                        auto alive = ws->getUserData()->alive;
+                        bool queued = true;
+                        if (msg.find("/login ") == 0) {
+                            auto splitPos = msg.find(' ', 7);
+                            if (splitPos == std::string::npos) {
+                                sendDirect(ws, "❌ Usage: /login <username> <password>", opCode);
+                                return;
+                            }
 
-                        if (!db.createUser(username, email, password)) {
-                            ws->send("❌ Registration failed (username/email may already exist)", opCode);
+                            std::string username = msg.substr(7, splitPos - 7);
+                            std::string password = msg.substr(splitPos + 1);
+                            handleLogin(ws, dbPool, authPool, username, password, opCode);
                             return;
-                        }
-
-                        ws->send("✅ Registration successful! You can now log in.", opCode);
-                    } else if (msg.find("/join ") == 0) {
-                        std::istringstream iss(msg.substr(6));
-                        std::string roomName, pin;
-                        iss >> roomName >> pin;
-
-                        int roomId = db.getPublicRoomIdByName(roomName);
+                        } else if (msg.find("/register ") == 0) {
+                            std::istringstream iss(msg.substr(10));
+                            std::string email, username, password;
+                            iss >> username >> email >> password;
 
-                        if (roomId == -1 && !pin.empty()) {
-                            roomId = db.getRoomIdByOwner(roomName, ws->getUserData()->id, pin);
-                            if (roomId == -1) {
-                                ws->send("❌ No private room found with that name or incorrect pin.", opCode);
+                            if (email.empty() || username.empty() || password.empty()) {
+                                sendDirect(ws, "❌ Please fill all fields", opCode);
                                 return;
                             }
-                        } else if (roomId == -1) {
-                            ws->send("❌ No public room found with that name.", opCode);
+
+                            handleRegister(ws, dbPool, authPool, username, email, password, opCode);
                             return;
-                        }
+                        } else if (msg.find("/join ") == 0) {
+                            std::istringstream iss(msg.substr(6));
+                            std::string roomName, pin;
+                            iss >> roomName >> pin;
+                            int userId = ws->getUserData()->id;
 
-                        // Leave previous room
-                        if (ws->getUserData()->currentRoomId != -1) {
-                            std::string prevRoom = ws->getUserData()->currentRoomName;
-                            rooms[prevRoom].erase(ws);
-                            db.removePlayerFromRoom(ws->getUserData()->id, ws->getUserData()->currentRoomId);
+                            // Cached rooms join without touching the DB
+                            RoomHandle cached = roomRegistry.findPublic(roomName);
+                            if (cached == kNoRoom && !pin.empty()) {
+                                RoomHandle priv = roomRegistry.findPrivate(roomName, userId);
+                                if (priv != kNoRoom && roomRegistry.get(priv)->pinMatches(pin)) cached = priv;
+                            }
+                            if (cached != kNoRoom) {
+                                enterRoom(ws, cached, dbPool, opCode);
+                                return;
+                            }
 
-                            for (auto client : rooms[prevRoom])
-                                client->send(ws->getUserData()->username + " has left the room.", opCode);
-                        }
+                            queued = dbPool.submit(
+                                [roomName, pin, userId](Storage& db) {
+                                    auto info = db.getPublicRoomByName(roomName);
+                                    if (!info.has_value() && !pin.empty()) info = db.getRoomByOwner(roomName, userId);
+                                    return info;
+                                },
+                                [ws, alive, pin, opCode, &dbPool](std::optional<RoomInfo> info) {
+                                    if (!isAlive(ws, alive)) return;
+                                    RoomHandle handle = info.has_value() ? roomRegistry.insert(info.value()) : kNoRoom;
+                                    const Room* room = roomRegistry.get(handle);
+                                    if (!room && pin.empty()) {
+                                        sendDirect(ws, "❌ No public room found with that name.", opCode);
+                                        return;
+                                    }
+                                    if (!room || (!room->isPublic && !room->pinMatches(pin))) {
+                                        sendDirect(ws, "❌ No private room found with that name or incorrect pin.", opCode);
+                                        return;
+                                    }
+                                    enterRoom(ws, handle, dbPool, opCode);
+                                });
+                        } else if (msg == "/leave") {
+                            if (Room* left = leaveCurrentRoom(ws, dbPool, " has left the room.", opCode)) {
+                                sendDirect(ws, "✅ Left room: " + left->name, opCode);
+                            }
+                        } else if (msg.find("/kick ") == 0) {
+                            if (!ws->getUserData()->roles.count("admin")) {
+                                sendDirect(ws, "❌ You do not have permission to kick users.", opCode);
+                                return;
+                            }
+                            auto target = sessions.findByUsername(msg.substr(6));
+                            if (!target) {
+                                sendDirect(ws, "❌ User is not online.", opCode);
+                                return;
+                            }
+                            closeSession(*target, "⚠️ You have been kicked by an admin.");
+                        } else if (msg == "/dbstats") {
+                            if (!ws->getUserData()->roles.count("admin")) {
+                                sendDirect(ws, "❌ You do not have permission to view server stats.", opCode);
+                                return;
+                            }
+                            auto st = dbPool.stats();
+                            std::ostringstream out;
+                            out << "DB pool: workers=" << st.workers
+                                << " queue=" << st.queueDepth << "/" << st.queueCapacity
+                                << " submitted=" << st.submitted << " completed=" << st.completed
+                                << " rejected=" << st.rejected
+                                << " avg_wait_ms=" << st.avgWaitMs << " max_wait_ms=" << st.maxWaitMs
+                                << " avg_run_ms=" << st.avgRunMs;
+                            auto as = authPool.stats();
+                            out << " | Auth pool: workers=" << as.workers
+                                << " queue=" << as.queueDepth << "/" << as.queueCapacity
+                                << " completed=" << as.completed << " rejected=" << as.rejected
+                                << " throttled=" << as.throttled << " addresses=" << as.addressesInFlight
+                                << " avg_wait_ms=" << as.avgWaitMs << " avg_run_ms=" << as.avgRunMs;
+                            auto cj = chatJournal.stats();
+                            out << " | Chat journal: pending=" << cj.pendingLines << " (" << cj.pendingBytes << " bytes)"
+                                << " flushed=" << cj.flushed << " batches=" << cj.batches
+                                << " avg_batch=" << cj.avgBatchSize << " avg_flush_ms=" << cj.avgFlushMs
+                                << " rejected=" << cj.rejected << " failures=" << cj.failures << " poisoned=" << cj.poisoned;
+                            if (logStore) {
+                                auto ls = logStore->stats();
+                                out << " | Store: rooms=" << ls.rooms << " objects=" << ls.roomObjects
+                                    << " users=" << ls.users << " wal=" << ls.walSequence << " (" << ls.walBytes << " bytes)"
+                                    << " records=" << ls.records << " snapshots=" << ls.snapshots
+                                    << " last_snapshot_ms=" << ls.lastSnapshotMs;
+                            }
+                            auto rt = simulation.stats();
+                            out << " | Room tick: hz=" << simulation.tickHz() << " active_rooms=" << rt.activeRooms
+                                << " ticks=" << rt.ticks << " frames=" << rt.frames
+                                << " avg_us=" << rt.avgTickUs << " max_us=" << rt.maxTickUs
+                                << " budget_us=" << rt.budgetUs << " overruns=" << rt.overruns;
+                            auto ps = pathService.stats();
+                            out << " | Paths: pending=" << ps.pending << " found=" << ps.found
+                                << " unreachable=" << ps.unreachable << " expansions=" << ps.expansions
+                                << " saturated_ticks=" << ps.saturatedTicks;
+                            Shard* shard = ShardedServer::current();
+                            out << " | Shard: " << shard->index << "/" << shards->size()
+                                << " clients=" << clients.size() << " rooms=" << roomRegistry.size()
+                                << " mailbox=" << shard->mailbox.depth() << " posted=" << shard->mailbox.posted()
+                                << " rejected=" << shard->mailbox.rejected();
+                            out << " | Sessions: online=" << sessions.size();
+                            auto bp = backpressure.stats();
+                            out << " | Backpressure: slow=" << bp.slowNow << " slowed=" << bp.slowed
+                                << " recovered=" << bp.recovered << " dropped=" << bp.dropped
+                                << " chat_skipped=" << bp.chatSkipped << " peak_buffered=" << bp.peakBufferedBytes;
+                            out << " | Presence: rooms=" << presence.rooms() << " sessions=" << presence.sessions();
+                            size_t chatRooms = 0, chatLines = 0, chatBytes = 0;
+                            roomRegistry.forEach([&](Room& r) {
+                                if (r.chat.state() == ChatHistory::State::Cold) return;
+                                chatRooms++;
+                                chatLines += r.chat.size();
+                                chatBytes += r.chat.bytes();
+                            });
+                            out << " | Chat history: rooms=" << chatRooms << " lines=" << chatLines << " (" << chatBytes << " bytes)";
+                            sendDirect(ws, out.str(), opCode);
+                        } else if (msg == "/reloadrooms") {
+                            if (!ws->getUserData()->roles.count("admin")) {
+                                sendDirect(ws, "❌ You do not have permission to reload rooms.", opCode);
+                                return;
+                            }
+                            // Cached metadata is re-read from the DB on next lookup; handles stay valid
+                            roomRegistry.invalidateAll();
+                            sendDirect(ws, "✅ Room cache invalidated (" + std::to_string(roomRegistry.size()) + " rooms).", opCode);
+                        } else if (msg == "/slowclients") {
+                            if (!ws->getUserData()->roles.count("admin")) {
+                                sendDirect(ws, "❌ You do not have permission to view server stats.", opCode);
+                                return;
+                            }
+                            // This shard only: the connections with the most unsent data
+                            std::ostringstream out;
+                            out << "Buffered bytes (shard " << ShardedServer::current()->index << "):";
+                            for (const auto& [client, buffered] : backpressure.heaviest(clients, 10)) {
+                                const User* u = client->getUserData();
+                                out << "\n  " << (u->username.empty() ? "(guest)" : u->username) << " " << buffered
+                                    << " peak=" << u->peakBuffered << (u->slow ? " slow" : "");
+                            }
+                            sendDirect(ws, out.str(), opCode);
+                        } else if (msg == "/reloadtemplates") {
+                            if (!ws->getUserData()->roles.count("admin")) {
+                                sendDirect(ws, "❌ You do not have permission to reload templates.", opCode);
+                                return;
+                            }
+                            queued = dbPool.submit(
+                                [](Storage& db) { return db.getAllRoomTemplates(); },
+                                [ws, alive, opCode](std::vector<RoomTemplate> tmpls) {
+                                    // An empty result is far more likely a failed query than a wiped table
+                                    if (tmpls.empty()) {
+                                        if (isAlive(ws, alive)) sendDirect(ws, "❌ No templates loaded; keeping the current catalogue.", opCode);
+                                        return;
+                                    }
+                                    templateCatalogue.publish(std::move(tmpls));
+                                    auto catalogue = templateCatalogue.current();
+                                    if (!isAlive(ws, alive)) return;
+                                    sendDirect(ws, "✅ Templates reloaded (" + std::to_string(catalogue->templates.size()) +
+                                             " templates, version " + catalogue->version + ").", opCode);
+                                });
+                        } else if (msg.find("/check_email ") == 0) {
+                            std::string email = msg.substr(13);
+                            if (email.empty()) {
+                                sendDirect(ws, "❌ Email cannot be empty", opCode);
+                                return;
+                            }
 
-                        // Join new room
-                        ws->getUserData()->currentRoomId = roomId;
-                        ws->getUserData()->currentRoomName = roomName;
-                        rooms[roomName].insert(ws);
-                        db.addPlayerToRoom(ws->getUserData()->id, roomId);
-
-                        ws->send("✅ Joined room: " + roomName, opCode);
-                        for (auto client : rooms[roomName])
-                            if (client != ws)
-                                client->send(ws->getUserData()->username + " has joined the room.", opCode);
-                    } else if (msg == "/leave") {
-                        std::string room = ws->getUserData()->currentRoomName;
-                        int roomId = ws->getUserData()->currentRoomId;
-
-                        if (!room.empty() && roomId != -1) {
-                            rooms[room].erase(ws);
-                            db.removePlayerFromRoom(ws->getUserData()->id, roomId);
-
-                            ws->getUserData()->currentRoomId = -1;
-                            ws->getUserData()->currentRoomName = "";
-                            ws->send("✅ Left room: " + room, opCode);
-
-                            for (auto client : rooms[room])
-                                client->send(ws->getUserData()->username + " has left the room.", opCode);
-                        }
-                    } else if (msg.find("/kick ") == 0) {
-                        if (!ws->getUserData()->roles.count("admin")) {
-                            ws->send("❌ You do not have permission to kick users.", opCode);
-                            return;
-                        }
-                        std::string targetUser = msg.substr(6);
-                        for (auto client : clients) {
-                            if (client->getUserData()->username == targetUser) {
-                                client->send("⚠️ You have been kicked by an admin.", opCode);
-                                client->close();
-                                break;
+                            queued = dbPool.submit(
+                                [email](Storage& db) { return db.isEmailRegistered(email); },
+                                [ws, alive, opCode](bool exists) {
+                                    if (!isAlive(ws, alive)) return;
+                                    if (exists) {
+                                        sendDirect(ws, "❌ This email is already registered", opCode);
+                                    } else {
+                                        sendDirect(ws, "✅ Email is available", opCode);
+                                    }
+                                });
+                        } else if (msg.find("/check_username ") == 0) {
+                            std::string username = msg.substr(16);
+                            if (username.empty()) {
+                                sendDirect(ws, "❌ Username cannot be empty", opCode);
+                                return;
                             }
-                        }
-                    } else if (msg.find("/check_email ") == 0) {
-                        std::string email = msg.substr(13);
-                        if (email.empty()) {
-                            ws->send("❌ Email cannot be empty", opCode);
-                            return;
-                        }
 
-                        bool exists = db.isEmailRegistered(email);
-                        if (exists) {
-                            ws->send("❌ This email is already registered", opCode);
+                            queued = dbPool.submit(
+                                [username](Storage& db) { return db.isUsernameRegistered(username); },
+                                [ws, alive, opCode](bool exists) {
+                                    if (!isAlive(ws, alive)) return;
+                                    if (exists) {
+                                        sendDirect(ws, "❌ This username is already taken", opCode);
+                                    } else {
+                                        sendDirect(ws, "✅ Username is available", opCode);
+                                    }
+                                });
                         } else {
-                            ws->send("✅ Email is available", opCode);
-                        }
-                    } else if (msg.find("/check_username ") == 0) {
-                        std::string username = msg.substr(16);
-                        if (username.empty()) {
-                            ws->send("❌ Username cannot be empty", opCode);
-                            return;
+                            sendDirect(ws, "❌ Unknown command", opCode);
                         }
+                        if (!queued) sendDirect(ws, "❌ Server is busy, please try again.", opCode);
+                    } else { // ROOM CHAT //
+                        // Simple chat message to current room
+                        Room* room = roomRegistry.get(ws->getUserData()->currentRoom);
+                        const std::string& username = ws->getUserData()->username;
 
-                        bool exists = db.isUsernameRegistered(username);
-                        if (exists) {
-                            ws->send("❌ This username is already taken", opCode);
-                        } else {
-                            ws->send("✅ Username is available", opCode);
-                        }
-                    } else {
-                        ws->send("❌ Unknown command", opCode);
-                    }
-                } else { // ROOM CHAT //
-                    // Simple chat message to current room
-                    std::string room = ws->getUserData()->currentRoomName;
-                    int roomId = db.getPublicRoomIdByName(room);
-                    std::string username = ws->getUserData()->username;
-
-                    if (!room.empty()) {
-                        int room_id = db.getPublicRoomIdByName(room); // you likely already have this or a similar function
-                        if (room_id != -1) {
-                            db.insertChatMessage(room_id, username, msg);
-                        }
-                    
-                        for (auto client : rooms[room]) {
-                            if (client != ws) {
-                                client->send(username + ": " + msg, opCode);
+                        if (room) {
+                            // Buffered write-behind; fan-out does not wait for the commit
+                            if (!chatJournal.append(room->id, username, msg)) {
+                                sendDirect(ws, "⚠️ Chat is busy, message not sent. Please try again.", opCode);
+                                return;
                             }
+
+                            room->chat.push(username, msg);
+                            room->chat.touch();
+                            broadcaster.toRoomExcept(ws, *room, username + ": " + msg, opCode);
+                            backpressure.watch(*room);
+                            backpressure.countChat(*room);
+                        } else {
+                            sendDirect(ws, "❌ You are not in a room. Use /join <room_name> [pin]", opCode);
                         }
-                    } else {
-                        ws->send("❌ You are not in a room. Use /join <room_name> [pin]", opCode);
                     }
-                }
 
-            },
+                },
 
-            // ----------------------
-            // Connection closed
-            // ----------------------
-            .close = [&](auto* ws, int, std::string_view) {
-                clients.erase(ws);
-                std::string room = ws->getUserData()->currentRoomName;
-                int roomId = ws->getUserData()->currentRoomId;
+                // Buffered data went out; slow connections may have caught up
+                .drain = [](auto* ws) {
+                    backpressure.onDrain(ws);
+                },
 
-                if (!room.empty() && roomId != -1) {
-                    rooms[room].erase(ws);
-                    db.removePlayerFromRoom(ws->getUserData()->id, roomId);
-
-                    for (auto client : rooms[room])
-                        client->send(ws->getUserData()->username + " has disconnected.", uWS::OpCode::TEXT);
+                // ----------------------
+                // Connection closed
+                // ----------------------
+                .close = [&](auto* ws, int, std::string_view) {
+                    clients.erase(ws);
+                    Metrics::gauge(MetricFamily::Connections).set((int64_t)clients.size());
+                    *ws->getUserData()->alive = false;
+                    if (ws->getUserData()->sessionId) sessions.remove(ws->getUserData()->sessionId, ws);
+                    // uWS drops the remaining topic subscriptions once this returns
+                    leaveCurrentRoom(ws, dbPool, " has disconnected.", uWS::OpCode::TEXT);
                 }
-            }
-        })
-        .listen(9001, [](auto* token) {
-            if (token) std::cout << "✅ Server listening on port 9001\n";
-            else std::cerr << "❌ Failed to bind port 9001\n";
-        })
-        .run();
+            })
+            // Prometheus scrape; any shard answers for all of them (Metrics
+            // sums every thread's series)
+            .get("/metrics", [](auto* res, auto*) {
+                res->writeHeader("Content-Type", "text/plain; version=0.0.4")->end(Metrics::render());
+            })
+            // uSockets binds with SO_REUSEPORT, so every shard can listen on the public port
+            .listen(kPublicPort, [&shard](auto* token) {
+                if (token) listenSockets.push_back(token);
+                if (!token) std::cerr << "❌ Shard " << shard.index << " failed to bind port " << kPublicPort << "\n";
+                else if (shard.index == 0) std::cout << "✅ Server listening on port " << kPublicPort << "\n";
+            })
+            .listen(shard.port, [&shard](auto* token) {
+                if (token) listenSockets.push_back(token);
+                else std::cerr << "❌ Shard " << shard.index << " failed to bind port " << shard.port << "\n";
+            })
+            .run();
+    }, [&] {
+        // Every loop has returned but is still allocated: results of the jobs
+        // drained here defer onto them and are simply never run
+        authPool.stop();
+        chatJournal.stop(); // flush buffered chat before exit
+        dbPool.stop();      // drain queued writes before exit
+    });
 
+    if (logStore) logStore->close();
     std::cout << "Server stopped.\n";
     return 0;
 }
@@ -0,0 +1,126 @@
+#include "Backpressure.hpp"
+#include <algorithm>
+#include "User.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+BackpressureMonitor::BackpressureMonitor(RoomRegistry& rooms, Broadcaster& broadcaster, BackpressurePolicy policy)
+    : rooms(rooms), broadcaster(broadcaster), limits(policy) {}
+
+void BackpressureMonitor::watch(const Room& room) {
+    if (watchedSet.insert(room.handle).second) watched.push_back(room.handle);
+}
+
+BackpressureMonitor::Verdict BackpressureMonitor::check(WebSocket* ws) {
+    User* user = ws->getUserData();
+    unsigned int buffered = ws->getBufferedAmount();
+    user->peakBuffered = std::max(user->peakBuffered, buffered);
+    counters.peakBufferedBytes = std::max(counters.peakBufferedBytes, buffered);
+    if (buffered > limits.dropBytes) return Verdict::Hopeless;
+    if (user->slow && Clock::now() - user->slowSince > limits.maxSlowFor) return Verdict::Hopeless;
+    return buffered > limits.slowBytes ? Verdict::Slow : Verdict::Fine;
+}
+
+void BackpressureMonitor::enterSlow(WebSocket* ws, Room& room) {
+    User* user = ws->getUserData();
+    user->slow = true;
+    user->slowSince = Clock::now();
+    user->slowFurnitureVersion = room.furniture.version();
+    user->chatSkipped = 0;
+    broadcaster.unsubscribe(ws, room);
+    slowByRoom[room.handle].push_back(ws);
+    slowCount++;
+    counters.slowed++;
+}
+
+void BackpressureMonitor::sweep() {
+    // Closing re-enters forget() and the roster, so only collect here
+    std::vector<WebSocket*> hopeless;
+    for (RoomHandle handle : watched) {
+        Room* room = rooms.get(handle);
+        if (!room) continue;
+        for (const auto& avatar : room->avatars.all()) {
+            auto* ws = static_cast<WebSocket*>(const_cast<void*>(avatar.owner));
+            Verdict verdict = check(ws);
+            if (verdict == Verdict::Hopeless) hopeless.push_back(ws);
+            else if (verdict == Verdict::Slow && !ws->getUserData()->slow) enterSlow(ws, *room);
+        }
+    }
+    watched.clear();
+    watchedSet.clear();
+    for (WebSocket* ws : hopeless) {
+        counters.dropped++;
+        ws->close();
+    }
+}
+
+void BackpressureMonitor::sweepAll(const std::unordered_set<WebSocket*>& clients) {
+    std::vector<WebSocket*> hopeless;
+    for (WebSocket* ws : clients) {
+        if (check(ws) == Verdict::Hopeless) hopeless.push_back(ws);
+    }
+    for (WebSocket* ws : hopeless) {
+        counters.dropped++;
+        ws->close();
+    }
+}
+
+void BackpressureMonitor::countChat(const Room& room) {
+    auto it = slowByRoom.find(room.handle);
+    if (it == slowByRoom.end()) return;
+    for (WebSocket* ws : it->second) ws->getUserData()->chatSkipped++;
+    counters.chatSkipped += it->second.size();
+}
+
+void BackpressureMonitor::onDrain(WebSocket* ws) {
+    User* user = ws->getUserData();
+    if (!user->slow || ws->getBufferedAmount() > limits.recoverBytes) return;
+    Room* room = rooms.get(user->currentRoom);
+    uint64_t furnitureVersion = user->slowFurnitureVersion;
+    uint32_t skipped = user->chatSkipped;
+    forget(ws);
+    counters.recovered++;
+    if (!room) return;
+
+    broadcaster.subscribe(ws, *room);
+    if (resync) resync(ws, *room, furnitureVersion);
+    if (skipped > 0) {
+        sendDirect(ws, "⚠️ " + std::to_string(skipped) + " chat message(s) skipped while your connection was slow.",
+                 uWS::OpCode::TEXT);
+    }
+}
+
+void BackpressureMonitor::forget(WebSocket* ws) {
+    User* user = ws->getUserData();
+    if (!user->slow) return;
+    user->slow = false;
+    user->chatSkipped = 0;
+    slowCount--;
+    for (auto it = slowByRoom.begin(); it != slowByRoom.end(); ++it) {
+        auto& members = it->second;
+        auto pos = std::find(members.begin(), members.end(), ws);
+        if (pos == members.end()) continue;
+        *pos = members.back();
+        members.pop_back();
+        if (members.empty()) slowByRoom.erase(it);
+        break;
+    }
+}
+
+BackpressureStats BackpressureMonitor::stats() const {
+    BackpressureStats s = counters;
+    s.slowNow = slowCount;
+    return s;
+}
+
+std::vector<std::pair<WebSocket*, unsigned int>> BackpressureMonitor::heaviest(
+    const std::unordered_set<WebSocket*>& clients, size_t limit) const {
+    std::vector<std::pair<WebSocket*, unsigned int>> out;
+    out.reserve(clients.size());
+    for (WebSocket* ws : clients) out.emplace_back(ws, ws->getBufferedAmount());
+    size_t n = std::min(limit, out.size());
+    std::partial_sort(out.begin(), out.begin() + n, out.end(),
+                      [](const auto& a, const auto& b) { return a.second > b.second; });
+    out.resize(n);
+    return out;
+}
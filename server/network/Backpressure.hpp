@@ -0,0 +1,83 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "Broadcast.hpp"
+#include "Room.hpp"
+#include "WebSocketSession.hpp"
+
+// ---------- Slow-consumer policy ----------
+struct BackpressurePolicy {
+    unsigned int slowBytes = 256 * 1024;        // above: room streams paused, chat only counted
+    unsigned int recoverBytes = 32 * 1024;      // drained below: resubscribed and resynced
+    unsigned int dropBytes = 4 * 1024 * 1024;   // above: disconnected
+    std::chrono::seconds maxSlowFor{30};        // still slow after this long: disconnected
+};
+
+struct BackpressureStats {
+    size_t slowNow = 0;
+    uint64_t slowed = 0;
+    uint64_t recovered = 0;
+    uint64_t dropped = 0;
+    uint64_t chatSkipped = 0;
+    unsigned int peakBufferedBytes = 0;         // highest any single connection reached
+};
+
+// ---------- Backpressure Monitor ----------
+// Keeps one slow connection from growing an unbounded, mostly stale backlog.
+// Room traffic goes out through shared topics, so a lagging socket cannot be
+// filtered per message; instead it is unsubscribed from its room's topics.
+// While it catches up, nothing accumulates for it: avatar and furniture
+// state is coalesced into a single resync on recovery (the current avatar
+// list and the furniture changes since it fell behind), and chat is reduced
+// to a count that is reported then. Loop-thread only, one per shard.
+class BackpressureMonitor {
+public:
+    // Sends the current room state to a connection that caught up
+    using Resync = std::function<void(WebSocket*, Room&, uint64_t furnitureVersion)>;
+
+    BackpressureMonitor(RoomRegistry& rooms, Broadcaster& broadcaster, BackpressurePolicy policy = {});
+
+    void setResync(Resync fn) { resync = std::move(fn); }
+    const BackpressurePolicy& policy() const { return limits; }
+
+    // The room got traffic; its members are checked in the next sweep()
+    void watch(const Room& room);
+    // Checks the members of every watched room. Once per tick.
+    void sweep();
+    // Hard limits only, for connections outside any room. Infrequent.
+    void sweepAll(const std::unordered_set<WebSocket*>& clients);
+
+    // A chat line went to the room; its slow members are owed a mention
+    void countChat(const Room& room);
+    // uWS drain handler
+    void onDrain(WebSocket* ws);
+    // Leaving the room or closing: drops any slow state without a resync
+    void forget(WebSocket* ws);
+
+    BackpressureStats stats() const;
+    // Most backed-up connections first
+    std::vector<std::pair<WebSocket*, unsigned int>> heaviest(const std::unordered_set<WebSocket*>& clients,
+                                                              size_t limit) const;
+
+private:
+    enum class Verdict { Fine, Slow, Hopeless };
+
+    Verdict check(WebSocket* ws);
+    void enterSlow(WebSocket* ws, Room& room);
+
+    RoomRegistry& rooms;
+    Broadcaster& broadcaster;
+    BackpressurePolicy limits;
+    Resync resync;
+
+    std::vector<RoomHandle> watched;
+    std::unordered_set<RoomHandle> watchedSet;
+    std::unordered_map<RoomHandle, std::vector<WebSocket*>> slowByRoom;
+    size_t slowCount = 0;
+    BackpressureStats counters;
+};
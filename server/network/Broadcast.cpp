@@ -0,0 +1,90 @@
+#include "Broadcast.hpp"
+#include "Metrics.hpp"
+#include "User.hpp"
+
+// Series are cached per thread; every loop thread has its own
+static void countPublish(unsigned int recipients, size_t bytes) {
+    static thread_local ValueHistogram& fanout = Metrics::histogram(MetricFamily::RoomFanout);
+    static thread_local MetricCounter& publishes = Metrics::counter(MetricFamily::Publishes);
+    static thread_local MetricCounter& published = Metrics::counter(MetricFamily::PublishedBytes);
+    fanout.record(recipients);
+    publishes.add();
+    published.add((uint64_t)bytes * recipients);
+}
+
+void sendDirect(WebSocket* ws, std::string_view payload, uWS::OpCode opCode) {
+    static thread_local MetricCounter& sends = Metrics::counter(MetricFamily::DirectSends);
+    static thread_local MetricCounter& sent = Metrics::counter(MetricFamily::DirectSentBytes);
+    sends.add();
+    sent.add(payload.size());
+    ws->send(payload, opCode);
+}
+
+std::string Broadcaster::viewTopic(const Room& room, ViewCell cell, WireFormat format) {
+    return room.topic + "/v" + std::to_string(cell.x) + "_" + std::to_string(cell.y) +
+           (format == WireFormat::Binary ? "/bin" : "/json");
+}
+
+void Broadcaster::subscribe(WebSocket* ws, const Room& room) {
+    User* user = ws->getUserData();
+    ws->subscribe(room.topic);
+    ws->subscribe(room.eventTopic(user->wireFormat));
+    if (user->view.valid()) ws->subscribe(viewTopic(room, user->view, user->wireFormat));
+}
+
+void Broadcaster::unsubscribe(WebSocket* ws, const Room& room) {
+    User* user = ws->getUserData();
+    ws->unsubscribe(room.topic);
+    ws->unsubscribe(room.eventTopic(user->wireFormat));
+    if (user->view.valid()) ws->unsubscribe(viewTopic(room, user->view, user->wireFormat));
+}
+
+void Broadcaster::setView(WebSocket* ws, const Room& room, ViewCell cell) {
+    User* user = ws->getUserData();
+    if (user->view == cell) return;
+    if (!user->slow) {
+        if (user->view.valid()) ws->unsubscribe(viewTopic(room, user->view, user->wireFormat));
+        if (cell.valid()) ws->subscribe(viewTopic(room, cell, user->wireFormat));
+    }
+    user->view = cell;
+}
+
+void Broadcaster::toRoom(const Room& room, std::string_view payload, uWS::OpCode opCode) {
+    if (!app) return;
+    countPublish(app->numSubscribers(room.topic), payload.size());
+    app->publish(room.topic, payload, opCode);
+}
+
+void Broadcaster::toRoomExcept(WebSocket* sender, const Room& room, std::string_view payload, uWS::OpCode opCode) {
+    unsigned int subscribers = subscriberCount(room);
+    countPublish(subscribers ? subscribers - 1 : 0, payload.size());
+    sender->publish(room.topic, payload, opCode);
+}
+
+void Broadcaster::toFormat(const Room& room, WireFormat format, std::string_view payload) {
+    uWS::OpCode opCode = format == WireFormat::Binary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT;
+    if (!app) return;
+    const std::string& topic = room.eventTopic(format);
+    countPublish(app->numSubscribers(topic), payload.size());
+    app->publish(topic, payload, opCode);
+}
+
+void Broadcaster::toView(const Room& room, ViewCell cell, WireFormat format, std::string_view payload) {
+    uWS::OpCode opCode = format == WireFormat::Binary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT;
+    if (!app) return;
+    std::string topic = viewTopic(room, cell, format);
+    countPublish(app->numSubscribers(topic), payload.size());
+    app->publish(topic, payload, opCode);
+}
+
+unsigned int Broadcaster::subscriberCount(const Room& room) const {
+    return app ? app->numSubscribers(room.topic) : 0;
+}
+
+unsigned int Broadcaster::subscriberCount(const Room& room, WireFormat format) const {
+    return app ? app->numSubscribers(room.eventTopic(format)) : 0;
+}
+
+unsigned int Broadcaster::subscriberCount(const Room& room, ViewCell cell, WireFormat format) const {
+    return app ? app->numSubscribers(viewTopic(room, cell, format)) : 0;
+}
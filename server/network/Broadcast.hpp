@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include "Room.hpp"
+#include "WebSocketSession.hpp"
+
+// ---------- Room Broadcasts ----------
+// Room fan-out goes through uWS topics. Callers serialize a payload once and
+// the topic tree shares it across every subscriber, so there is no
+// per-recipient copy or socket set to maintain. Each room has one topic for
+// everyone (text chat, notices) plus one per wire format for structured
+// events, which each socket joins according to its negotiated format.
+// In rooms with an interest grid (entities/Interest.hpp) movement and
+// furniture events go to per-view-cell topics instead; each socket follows
+// the one view cell its avatar stands in.
+// Every room publish is counted for /metrics (core/Metrics.hpp): recipients,
+// publishes and bytes times recipients.
+class Broadcaster {
+public:
+    void attach(uWS::App* app) { this->app = app; }
+
+    // Both include the socket's view topic, if it has one; unsubscribing keeps
+    // the view so a later subscribe (backpressure resync) restores it
+    void subscribe(WebSocket* ws, const Room& room);
+    void unsubscribe(WebSocket* ws, const Room& room);
+
+    // Moves ws to another view cell (an invalid cell drops the view). While
+    // the socket is slow only the cell is recorded.
+    void setView(WebSocket* ws, const Room& room, ViewCell cell);
+
+    void toRoom(const Room& room, std::string_view payload, uWS::OpCode opCode = uWS::OpCode::TEXT);
+    // Everyone subscribed to the room except `sender` (uWS skips the publisher)
+    void toRoomExcept(WebSocket* sender, const Room& room, std::string_view payload, uWS::OpCode opCode = uWS::OpCode::TEXT);
+
+    // Structured event already encoded for `format`; reaches only sockets using it
+    void toFormat(const Room& room, WireFormat format, std::string_view payload);
+
+    // Structured event for the sockets viewing `cell`
+    void toView(const Room& room, ViewCell cell, WireFormat format, std::string_view payload);
+
+    unsigned int subscriberCount(const Room& room) const;
+    unsigned int subscriberCount(const Room& room, WireFormat format) const;
+    unsigned int subscriberCount(const Room& room, ViewCell cell, WireFormat format) const;
+
+private:
+    static std::string viewTopic(const Room& room, ViewCell cell, WireFormat format);
+
+    uWS::App* app = nullptr;
+};
+
+// A frame for one socket, counted like the room publishes
+void sendDirect(WebSocket* ws, std::string_view payload, uWS::OpCode opCode);
@@ -0,0 +1,97 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// ---------- Inbound JSON message types ----------
+enum class EventType : uint8_t {
+    Unknown = 0,
+    GetRoomTemplates,
+    GetRoomTemplate,
+    GetRoomFurniture,
+    SubscribeRoom,
+    CreateFurniture,
+    UpdateFurniture,
+    DeleteFurniture,
+    TileClick,
+    ResumeSession,
+    Count
+};
+
+constexpr size_t kEventTypeCount = (size_t)EventType::Count;
+
+// Wire names, indexed by EventType
+constexpr std::array<std::string_view, kEventTypeCount> kEventTypeNames = {
+    "",
+    "GET_ROOM_TEMPLATES",
+    "GET_ROOM_TEMPLATE",
+    "GET_ROOM_FURNITURE",
+    "SUBSCRIBE_ROOM",
+    "CREATE_FURNITURE",
+    "UPDATE_FURNITURE",
+    "DELETE_FURNITURE",
+    "TILE_CLICK",
+    "RESUME_SESSION",
+};
+
+constexpr std::string_view eventTypeName(EventType type) {
+    return kEventTypeNames[(size_t)type];
+}
+
+// ----------------------
+// Compile-time perfect hash: a seeded FNV-1a whose seed is searched at
+// compile time so every name lands in its own slot. Lookup is one hash,
+// one table read and one compare against the candidate name.
+// ----------------------
+namespace event_hash {
+
+constexpr size_t kTableSize = 32;
+static_assert((kTableSize & (kTableSize - 1)) == 0, "table size must be a power of two");
+static_assert(kEventTypeCount <= kTableSize, "grow kTableSize");
+
+constexpr uint32_t hash(std::string_view s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char c : s) {
+        h ^= (uint8_t)c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+constexpr uint32_t findSeed() {
+    for (uint32_t seed = 0; seed < 100000; seed++) {
+        bool used[kTableSize] = {};
+        bool ok = true;
+        for (size_t i = 1; i < kEventTypeCount && ok; i++) {
+            size_t slot = hash(kEventTypeNames[i], seed) & (kTableSize - 1);
+            if (used[slot]) ok = false;
+            used[slot] = true;
+        }
+        if (ok) return seed;
+    }
+    return UINT32_MAX;
+}
+
+constexpr uint32_t kSeed = findSeed();
+static_assert(kSeed != UINT32_MAX, "no perfect hash seed found for event names");
+
+constexpr std::array<uint8_t, kTableSize> buildTable() {
+    std::array<uint8_t, kTableSize> table{};
+    for (size_t i = 1; i < kEventTypeCount; i++) {
+        table[hash(kEventTypeNames[i], kSeed) & (kTableSize - 1)] = (uint8_t)i;
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, kTableSize> kTable = buildTable();
+
+} // namespace event_hash
+
+constexpr EventType eventTypeFromName(std::string_view name) {
+    uint8_t index = event_hash::kTable[event_hash::hash(name, event_hash::kSeed) & (event_hash::kTableSize - 1)];
+    return (index != 0 && kEventTypeNames[index] == name) ? (EventType)index : EventType::Unknown;
+}
+
+static_assert(eventTypeFromName("SUBSCRIBE_ROOM") == EventType::SubscribeRoom, "perfect hash broken");
+static_assert(eventTypeFromName("NOT_A_TYPE") == EventType::Unknown, "perfect hash broken");
@@ -0,0 +1,290 @@
+#pragma once
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "EventTypes.hpp"
+
+// ---------- Inbound JSON decoder ----------
+// Tokenizes a frame once into string_view fields pointing straight into the
+// frame. Nested object keys are flattened (lookups prefer the shallowest
+// match), so {"furniture":{"proto_id":...}} still finds proto_id. Only
+// strings with escapes are decoded, into a fixed per-message arena, so
+// parsing never allocates. Frames with more than kMaxFields fields, deeper
+// than kMaxDepth, or escaped strings beyond the arena are rejected.
+class JsonMessage {
+public:
+    static constexpr size_t kMaxFields = 48;
+    static constexpr size_t kMaxDepth = 8;
+    static constexpr size_t kArenaSize = 4096;
+
+    enum class Kind : uint8_t { String, Number, Bool, Null, Object, Array };
+
+    struct Field {
+        std::string_view key;
+        std::string_view value;   // strings: decoded contents; others: raw token
+        Kind kind;
+        uint8_t depth;
+    };
+
+    bool parse(std::string_view frame) {
+        p = frame.data();
+        end = p + frame.size();
+        count = 0;
+        arenaUsed = 0;
+        eventType = EventType::Unknown;
+        skipWs();
+        if (p >= end || *p != '{') return false;
+        if (!parseObject(1)) return false;
+        skipWs();
+        if (p != end) return false;
+        eventType = eventTypeFromName(str("type"));
+        return true;
+    }
+
+    EventType type() const { return eventType; }
+
+    const Field* find(std::string_view key) const {
+        const Field* best = nullptr;
+        for (size_t i = 0; i < count; i++) {
+            if (fields[i].key == key && (!best || fields[i].depth < best->depth)) best = &fields[i];
+        }
+        return best;
+    }
+
+    bool has(std::string_view key) const { return find(key) != nullptr; }
+
+    // "" when missing or not a string
+    std::string_view str(std::string_view key) const {
+        const Field* f = find(key);
+        return (f && f->kind == Kind::String) ? f->value : std::string_view();
+    }
+
+    // Integer part of a number field; fallback when missing or not a number
+    long num(std::string_view key, long fallback = -1) const {
+        const Field* f = find(key);
+        if (!f || f->kind != Kind::Number) return fallback;
+        long out = fallback;
+        auto res = std::from_chars(f->value.data(), f->value.data() + f->value.size(), out);
+        return res.ec == std::errc() ? out : fallback;
+    }
+
+    bool boolean(std::string_view key, bool fallback = false) const {
+        const Field* f = find(key);
+        if (!f || f->kind != Kind::Bool) return fallback;
+        return f->value == "true";
+    }
+
+    size_t size() const { return count; }
+    const Field& at(size_t i) const { return fields[i]; }
+
+private:
+    void skipWs() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+    }
+
+    bool parseObject(size_t depth) {
+        if (depth > kMaxDepth) return false;
+        p++; // '{'
+        skipWs();
+        if (p < end && *p == '}') { p++; return true; }
+        for (;;) {
+            skipWs();
+            if (p >= end || *p != '"') return false;
+            std::string_view key;
+            bool keyEscaped = false;
+            if (!scanString(key, keyEscaped)) return false;
+            skipWs();
+            if (p >= end || *p != ':') return false;
+            p++;
+            skipWs();
+            if (count >= kMaxFields) return false;
+            size_t slot = count++;
+            fields[slot].key = key;
+            fields[slot].depth = (uint8_t)depth;
+            if (!parseValue(fields[slot], depth)) return false;
+            skipWs();
+            if (p >= end) return false;
+            if (*p == ',') { p++; continue; }
+            if (*p == '}') { p++; return true; }
+            return false;
+        }
+    }
+
+    bool parseArray(size_t depth) {
+        if (depth > kMaxDepth) return false;
+        p++; // '['
+        skipWs();
+        if (p < end && *p == ']') { p++; return true; }
+        for (;;) {
+            skipWs();
+            Field scratch{};
+            // Array elements are not addressable by key; only nested objects register fields
+            if (!parseValue(scratch, depth)) return false;
+            skipWs();
+            if (p >= end) return false;
+            if (*p == ',') { p++; continue; }
+            if (*p == ']') { p++; return true; }
+            return false;
+        }
+    }
+
+    bool parseValue(Field& field, size_t depth) {
+        if (p >= end) return false;
+        const char* start = p;
+        switch (*p) {
+            case '"': {
+                bool escaped = false;
+                std::string_view raw;
+                if (!scanString(raw, escaped)) return false;
+                field.kind = Kind::String;
+                if (!escaped) {
+                    field.value = raw;
+                    return true;
+                }
+                return unescapeInto(raw, field.value);
+            }
+            case '{':
+                field.kind = Kind::Object;
+                if (!parseObject(depth + 1)) return false;
+                field.value = std::string_view(start, p - start);
+                return true;
+            case '[':
+                field.kind = Kind::Array;
+                if (!parseArray(depth + 1)) return false;
+                field.value = std::string_view(start, p - start);
+                return true;
+            case 't':
+                field.kind = Kind::Bool;
+                return literal("true", field);
+            case 'f':
+                field.kind = Kind::Bool;
+                return literal("false", field);
+            case 'n':
+                field.kind = Kind::Null;
+                return literal("null", field);
+            default:
+                if (*p == '-' || (*p >= '0' && *p <= '9')) {
+                    p++;
+                    while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-')) p++;
+                    field.kind = Kind::Number;
+                    field.value = std::string_view(start, p - start);
+                    return true;
+                }
+                return false;
+        }
+    }
+
+    bool literal(std::string_view word, Field& field) {
+        if ((size_t)(end - p) < word.size() || std::string_view(p, word.size()) != word) return false;
+        field.value = std::string_view(p, word.size());
+        p += word.size();
+        return true;
+    }
+
+    // p at the opening quote; out = raw contents between the quotes
+    bool scanString(std::string_view& out, bool& escaped) {
+        const char* start = ++p;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') {
+                out = std::string_view(start, p - start);
+                p++;
+                return true;
+            }
+            if (c == '\\') {
+                escaped = true;
+                p += 2;
+                continue;
+            }
+            p++;
+        }
+        return false;
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static bool readHex4(const char*& s, const char* e, uint32_t& out) {
+        if (e - s < 4) return false;
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            int v = hexValue(s[i]);
+            if (v < 0) return false;
+            out = (out << 4) | (uint32_t)v;
+        }
+        s += 4;
+        return true;
+    }
+
+    bool put(char c) {
+        if (arenaUsed >= kArenaSize) return false;
+        arena[arenaUsed++] = c;
+        return true;
+    }
+
+    bool unescapeInto(std::string_view raw, std::string_view& out) {
+        size_t start = arenaUsed;
+        const char* s = raw.data();
+        const char* e = s + raw.size();
+        while (s < e) {
+            char c = *s++;
+            if (c != '\\') {
+                if (!put(c)) return false;
+                continue;
+            }
+            if (s >= e) return false;
+            char esc = *s++;
+            switch (esc) {
+                case '"': case '\\': case '/': if (!put(esc)) return false; break;
+                case 'b': if (!put('\b')) return false; break;
+                case 'f': if (!put('\f')) return false; break;
+                case 'n': if (!put('\n')) return false; break;
+                case 'r': if (!put('\r')) return false; break;
+                case 't': if (!put('\t')) return false; break;
+                case 'u': {
+                    uint32_t cp;
+                    if (!readHex4(s, e, cp)) return false;
+                    // surrogate pair
+                    if (cp >= 0xD800 && cp <= 0xDBFF && e - s >= 6 && s[0] == '\\' && s[1] == 'u') {
+                        const char* t = s + 2;
+                        uint32_t lo;
+                        if (readHex4(t, e, lo) && lo >= 0xDC00 && lo <= 0xDFFF) {
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                            s = t;
+                        }
+                    }
+                    if (cp < 0x80) {
+                        if (!put((char)cp)) return false;
+                    } else if (cp < 0x800) {
+                        if (!put((char)(0xC0 | (cp >> 6))) || !put((char)(0x80 | (cp & 0x3F)))) return false;
+                    } else if (cp < 0x10000) {
+                        if (!put((char)(0xE0 | (cp >> 12))) || !put((char)(0x80 | ((cp >> 6) & 0x3F))) ||
+                            !put((char)(0x80 | (cp & 0x3F)))) return false;
+                    } else {
+                        if (!put((char)(0xF0 | (cp >> 18))) || !put((char)(0x80 | ((cp >> 12) & 0x3F))) ||
+                            !put((char)(0x80 | ((cp >> 6) & 0x3F))) || !put((char)(0x80 | (cp & 0x3F)))) return false;
+                    }
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        out = std::string_view(arena.data() + start, arenaUsed - start);
+        return true;
+    }
+
+    const char* p = nullptr;
+    const char* end = nullptr;
+    EventType eventType = EventType::Unknown;
+    size_t count = 0;
+    size_t arenaUsed = 0;
+    std::array<Field, kMaxFields> fields;
+    std::array<char, kArenaSize> arena;
+};
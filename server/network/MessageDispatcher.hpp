@@ -0,0 +1,27 @@
+#pragma once
+#include <array>
+#include <functional>
+#include "EventTypes.hpp"
+#include "JsonMessage.hpp"
+#include "WebSocketSession.hpp"
+
+// ---------- JSON Message Dispatch ----------
+// One handler slot per EventType; a decoded message is routed with a single
+// array index instead of comparing its type against every known name.
+class MessageDispatcher {
+public:
+    using Handler = std::function<void(WebSocket*, const JsonMessage&, uWS::OpCode)>;
+
+    void on(EventType type, Handler handler) { handlers[(size_t)type] = std::move(handler); }
+
+    // False when no handler is registered for the message's type
+    bool dispatch(WebSocket* ws, const JsonMessage& msg, uWS::OpCode opCode) const {
+        const Handler& handler = handlers[(size_t)msg.type()];
+        if (!handler) return false;
+        handler(ws, msg, opCode);
+        return true;
+    }
+
+private:
+    std::array<Handler, kEventTypeCount> handlers;
+};
@@ -0,0 +1,51 @@
+#include "Protocol.hpp"
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+WireFormat negotiateWireFormat(std::string_view offered, std::string_view& selected) {
+    bool offersBinary = false;
+    bool offersJson = false;
+    while (!offered.empty()) {
+        size_t comma = offered.find(',');
+        std::string_view token = trim(offered.substr(0, comma));
+        if (token == kBinarySubprotocol) offersBinary = true;
+        else if (token == kJsonSubprotocol) offersJson = true;
+        if (comma == std::string_view::npos) break;
+        offered.remove_prefix(comma + 1);
+    }
+    if (offersBinary) {
+        selected = kBinarySubprotocol;
+        return WireFormat::Binary;
+    }
+    selected = offersJson ? kJsonSubprotocol : std::string_view();
+    return WireFormat::Json;
+}
+
+void writeFurnitureEventBinary(std::string& out, FurnitureChange change, int roomId, uint64_t version,
+                               const RoomObject& object, std::string_view uid) {
+    BinaryWriter b(out);
+    int rotation = (int)std::lround(object.rotation);
+    switch (change) {
+        case FurnitureChange::Added:
+            b.op(BinaryOp::FurnitureAdded).varint(roomId).varint(version);
+            b.varint(object.id).str(uid).str(object.name).coord(object.x).coord(object.y).svarint(rotation);
+            break;
+        case FurnitureChange::Updated: {
+            bool known = object.id > 0;
+            uint8_t flags = known ? kFurnitureHasRotation : kFurnitureHasUid;
+            b.op(BinaryOp::FurnitureUpdated).varint(roomId).varint(version);
+            b.u8(flags).varint(known ? object.id : 0);
+            if (!known) b.str(uid);
+            b.coord(object.x).coord(object.y);
+            if (known) b.svarint(rotation);
+            break;
+        }
+        case FurnitureChange::Removed:
+            b.op(BinaryOp::FurnitureRemoved).varint(roomId).varint(version).varint(object.id);
+            break;
+    }
+}
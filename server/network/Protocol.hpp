@@ -0,0 +1,144 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Records.hpp"
+
+// ---------- Binary Wire Protocol ----------
+// Chosen per connection at upgrade through Sec-WebSocket-Protocol. Clients
+// that offer kBinarySubprotocol get binary frames for high-frequency room
+// traffic (movement, furniture); clients that offer nothing stay on text
+// JSON. Everything else (login, chat, templates) is text on both.
+//
+// Frame: [opcode u8][fields...]
+//   varint   unsigned LEB128
+//   svarint  zigzag LEB128
+//   coord    svarint of round(tile * kCoordScale), i.e. 1/16-tile fixed point
+//   str      varint byte length, then UTF-8 bytes
+// The version is part of the subprotocol name; a breaking change bumps it.
+
+enum class WireFormat : uint8_t { Json, Binary };
+
+constexpr std::string_view kBinarySubprotocol = "habbo.bin.1";
+constexpr std::string_view kJsonSubprotocol = "habbo.json";
+constexpr int kCoordScale = 16;
+
+enum class BinaryOp : uint8_t {
+    // client -> server
+    MoveFurniture = 0x01,    // u8 flags, varint id, [str uid], coord tx, coord ty, [svarint rotation]
+    TileClick = 0x02,        // coord tx, coord ty
+
+    // server -> client; each starts with varint roomId, varint version (0 = unversioned)
+    FurnitureAdded = 0x81,   // varint id, str uid, str name, coord tx, coord ty, svarint rotation
+    FurnitureUpdated = 0x82, // u8 flags, varint id, [str uid], coord tx, coord ty, [svarint rotation]
+    FurnitureRemoved = 0x83, // varint id
+    Path = 0x84,             // u8 status (0 found, 1 unreachable), coord fx, coord fy, varint n, n x (coord tx, coord ty)
+    RoomTick = 0x85,         // version is the tick; varint n, n x avatar, varint m, m x varint departed id
+                             // avatar: varint id, u8 flags, [str name], coord tx, coord ty
+};
+
+// Flags for MoveFurniture / FurnitureUpdated
+constexpr uint8_t kFurnitureHasUid = 0x01;      // id is 0 and the item is named by uid
+constexpr uint8_t kFurnitureHasRotation = 0x02; // otherwise rotation is unchanged
+
+constexpr uint8_t kAvatarWalking = 0x01;
+constexpr uint8_t kAvatarHasName = 0x02;         // first frame after the avatar entered
+
+// Picks the wire format from the client's offered subprotocols. `selected`
+// is the protocol to echo back ("" when the client offered none we know).
+WireFormat negotiateWireFormat(std::string_view offered, std::string_view& selected);
+
+// Appends the FurnitureAdded/Updated/Removed frame for `object`. An object
+// without an id (its create is still in flight) is named by uid.
+void writeFurnitureEventBinary(std::string& out, FurnitureChange change, int roomId, uint64_t version,
+                               const RoomObject& object, std::string_view uid);
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& out) : out(out) {}
+
+    BinaryWriter& op(BinaryOp o) { return u8((uint8_t)o); }
+
+    BinaryWriter& u8(uint8_t v) {
+        out.push_back((char)v);
+        return *this;
+    }
+
+    BinaryWriter& varint(uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((char)v);
+        return *this;
+    }
+
+    BinaryWriter& svarint(int64_t v) { return varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+
+    BinaryWriter& coord(double tiles) { return svarint((int64_t)std::lround(tiles * kCoordScale)); }
+
+    BinaryWriter& str(std::string_view s) {
+        varint(s.size());
+        out.append(s.data(), s.size());
+        return *this;
+    }
+
+private:
+    std::string& out;
+};
+
+// Reads never run past the end; a short or malformed frame just flips ok().
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view in)
+        : p((const uint8_t*)in.data()), end((const uint8_t*)in.data() + in.size()) {}
+
+    bool ok() const { return !failed; }
+    bool atEnd() const { return p == end; }
+
+    uint8_t u8() {
+        if (p >= end) return fail();
+        return *p++;
+    }
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) return fail();
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        return fail();
+    }
+
+    int64_t svarint() {
+        uint64_t v = varint();
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+
+    double coord() { return (double)svarint() / kCoordScale; }
+
+    std::string_view str() {
+        uint64_t len = varint();
+        if (failed || len > (uint64_t)(end - p)) {
+            fail();
+            return {};
+        }
+        std::string_view s((const char*)p, (size_t)len);
+        p += len;
+        return s;
+    }
+
+private:
+    uint8_t fail() {
+        failed = true;
+        p = end;
+        return 0;
+    }
+
+    const uint8_t* p;
+    const uint8_t* end;
+    bool failed = false;
+};
@@ -0,0 +1,7 @@
+#pragma once
+#include <uWebSockets/App.h>
+
+// Per-connection user data lives in entities/User.hpp; only a pointer type is
+// needed here so entities can hold sockets without pulling in each other.
+struct User;
+using WebSocket = uWS::WebSocket<false, true, User>;